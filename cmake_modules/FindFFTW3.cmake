@@ -30,6 +30,12 @@ else (FFTW3_LIBRARIES)
     /usr/local/lib
   )
 
+  find_path(FFTW3_INCLUDE_DIR fftw3.h
+    PATHS
+    ${GNUWIN32_DIR}/include
+    /usr/local/include
+  )
+
   if(FFTW3_LIBRARIES)
     set(FFTW3_FOUND TRUE)
   else (FFTW3_LIBRARIES)
@@ -47,6 +53,6 @@ else (FFTW3_LIBRARIES)
     endif (FFTW3_FIND_REQUIRED)
   endif (FFTW3_FOUND)
 
-  mark_as_advanced(FFTW3_LIBRARIES)
+  mark_as_advanced(FFTW3_INCLUDE_DIR FFTW3_LIBRARIES)
   
 endif (FFTW3_LIBRARIES)
@@ -0,0 +1,276 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+    Correlation rows benchmark
+
+    Feeds packets from a mock packet source, as the read thread does with the cross-correlator,
+    into CorrelationRows and checks that row r of every stream holds packet r. Then reports the
+    time per packet against appending each packet with a realloc of every stream.
+
+    bench_correlationrows [--packets N] [--lines N] [--lags N] [--output FILE]
+*/
+
+#include "correlationrows.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief The MockPacketSource class builds packets the way ahp_xc_get_packet() returns them,
+ * with magnitudes that tell the packet, the line or baseline and the lag apart.
+ */
+class MockPacketSource
+{
+  public:
+    MockPacketSource(unsigned int lines, unsigned int lags) : lines(lines), baselines(lines * (lines - 1) / 2),
+        autoLags(lags), crossLags(lags * 2 - 1)
+    {
+        autocorrelations.resize(lines);
+        crosscorrelations.resize(baselines);
+        autoValues.assign(lines, std::vector<ahp_xc_correlation>(autoLags));
+        crossValues.assign(baselines, std::vector<ahp_xc_correlation>(crossLags));
+        for (unsigned int x = 0; x < lines; x++)
+        {
+            autocorrelations[x].lag_size = autoLags;
+            autocorrelations[x].correlations = autoValues[x].data();
+        }
+        for (unsigned int x = 0; x < baselines; x++)
+        {
+            crosscorrelations[x].lag_size = crossLags;
+            crosscorrelations[x].correlations = crossValues[x].data();
+        }
+        memset(&packet, 0, sizeof(packet));
+        packet.autocorrelations = autocorrelations.data();
+        packet.crosscorrelations = crosscorrelations.data();
+    }
+
+    static double autoMagnitude(size_t n, unsigned int x, unsigned int lag)
+    {
+        return n * 7.0 + x * 100.0 + lag;
+    }
+    static double crossMagnitude(size_t n, unsigned int x, unsigned int lag)
+    {
+        return n * 3.0 + x * 1000.0 + lag;
+    }
+
+    const ahp_xc_packet *next(size_t n)
+    {
+        for (unsigned int x = 0; x < lines; x++)
+            for (unsigned int i = 0; i < autoLags; i++)
+                autoValues[x][i].magnitude = autoMagnitude(n, x, i);
+        for (unsigned int x = 0; x < baselines; x++)
+            for (unsigned int i = 0; i < crossLags; i++)
+                crossValues[x][i].magnitude = crossMagnitude(n, x, i);
+        return &packet;
+    }
+
+    const unsigned int lines, baselines, autoLags, crossLags;
+
+  private:
+    ahp_xc_packet packet;
+    std::vector<ahp_xc_sample> autocorrelations, crosscorrelations;
+    std::vector<std::vector<ahp_xc_correlation>> autoValues, crossValues;
+};
+
+static std::vector<dsp_stream_p> makeStreams(unsigned int count, unsigned int lags)
+{
+    std::vector<dsp_stream_p> streams(count);
+    for (dsp_stream_p &stream : streams)
+    {
+        stream = dsp_stream_new();
+        dsp_stream_add_dim(stream, static_cast<int>(lags));
+        dsp_stream_add_dim(stream, 1);
+        dsp_stream_alloc_buffer(stream, stream->len);
+    }
+    return streams;
+}
+
+static void freeStreams(std::vector<dsp_stream_p> &streams)
+{
+    for (dsp_stream_p stream : streams)
+    {
+        dsp_stream_free_buffer(stream);
+        dsp_stream_free(stream);
+    }
+}
+
+// Row r of every stream is packet r, sampled across the integration
+static bool checkRows(const MockPacketSource &source, const std::vector<dsp_stream_p> &autoStreams,
+                      const std::vector<dsp_stream_p> &crossStreams, size_t packets)
+{
+    bool ok = true;
+    for (unsigned int x = 0; x < source.lines; x++)
+        ok = ok && autoStreams[x]->sizes[1] == static_cast<int>(packets) && autoStreams[x]->len == static_cast<int>(packets * source.autoLags);
+    for (unsigned int x = 0; x < source.baselines; x++)
+        ok = ok && crossStreams[x]->sizes[1] == static_cast<int>(packets) && crossStreams[x]->len == static_cast<int>(packets * source.crossLags);
+    for (size_t r = 0; r < packets && ok; r += packets / 97 + 1)
+    {
+        for (unsigned int x = 0; x < source.lines; x++)
+            for (unsigned int i = 0; i < source.autoLags; i++)
+                ok = ok && autoStreams[x]->buf[r * source.autoLags + i] == MockPacketSource::autoMagnitude(r, x, i);
+        for (unsigned int x = 0; x < source.baselines; x++)
+            for (unsigned int i = 0; i < source.crossLags; i++)
+                ok = ok && crossStreams[x]->buf[r * source.crossLags + i] == MockPacketSource::crossMagnitude(r, x, i);
+    }
+    return ok;
+}
+
+// The row of each stream grown with a realloc for every packet
+static void reallocRows(std::vector<dsp_stream_p> &streams, const ahp_xc_sample *samples, bool first)
+{
+    for (size_t x = 0; x < streams.size(); x++)
+    {
+        dsp_stream_p stream = streams[x];
+        if (!first)
+        {
+            stream->sizes[1]++;
+            stream->len += stream->sizes[0];
+            stream->buf = static_cast<dsp_t*>(realloc(stream->buf, sizeof(dsp_t) * static_cast<size_t>(stream->len)));
+        }
+        dsp_t *row = stream->buf + stream->len - stream->sizes[0];
+        for (unsigned int i = 0; i < samples[x].lag_size; i++)
+            row[i] = samples[x].correlations[i].magnitude;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t packets     = 1000000;
+    int lines          = 2;
+    int lags           = 16;
+    const char *output = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--packets"))
+            packets = strtoull(argv[++i], nullptr, 10);
+        else if (arg("--lines"))
+            lines = atoi(argv[++i]);
+        else if (arg("--lags"))
+            lags = atoi(argv[++i]);
+        else if (arg("--output"))
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--packets N] [--lines N] [--lags N] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (packets < 1 || lines < 2 || lags < 2)
+    {
+        fprintf(stderr, "At least one packet, two lines and two lags are needed\n");
+        return 2;
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+
+    MockPacketSource source(static_cast<unsigned int>(lines), static_cast<unsigned int>(lags));
+    std::vector<dsp_stream_p> autoStreams = makeStreams(source.lines, source.autoLags);
+    std::vector<dsp_stream_p> crossStreams = makeStreams(source.baselines, source.crossLags);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"ahp_xc_correlation_rows\",\n");
+    fprintf(out, "  \"config\": {\"packets\": %zu, \"lines\": %u, \"baselines\": %u, \"auto_lags\": %u, \"cross_lags\": %u},\n",
+            packets, source.lines, source.baselines, source.autoLags, source.crossLags);
+    fprintf(out, "  \"runs\": [\n");
+
+    bool ok = true;
+    CorrelationRows rows;
+    rows.setStreams(autoStreams.data(), source.lines, crossStreams.data(), source.baselines);
+
+    // Sized from the integration time, first with new buffers then reusing them, then new
+    // buffers from an estimate eight times short
+    const struct
+    {
+        const char *name;
+        size_t expected;
+        bool fresh;
+    } runs[] =
+    {
+        { "first_integration", packets + 1, false },
+        { "reused_buffers", packets + 1, false },
+        { "short_estimate", packets / 8 + 1, true },
+    };
+    for (const auto &run : runs)
+    {
+        if (run.fresh)
+        {
+            freeStreams(autoStreams);
+            freeStreams(crossStreams);
+            autoStreams = makeStreams(source.lines, source.autoLags);
+            crossStreams = makeStreams(source.baselines, source.crossLags);
+            rows.setStreams(autoStreams.data(), source.lines, crossStreams.data(), source.baselines);
+        }
+        rows.expect(run.expected);
+        auto start = std::chrono::steady_clock::now();
+        for (size_t n = 0; n < packets; n++)
+        {
+            if (!rows.append(source.next(n)))
+            {
+                fprintf(stderr, "Out of memory after %zu packets\n", n);
+                return 1;
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        bool passed = rows.getRows() == packets && checkRows(source, autoStreams, crossStreams, packets);
+        ok = ok && passed;
+        fprintf(out, "    {\"run\": \"%s\", \"seconds\": %.4f, \"ns_per_packet\": %.0f, \"capacity\": %zu, \"passed\": %s},\n",
+                run.name, seconds, seconds * 1e9 / packets, rows.getCapacity(), passed ? "true" : "false");
+        rows.reset();
+    }
+
+    // Previous layout: one realloc per stream and packet
+    freeStreams(autoStreams);
+    freeStreams(crossStreams);
+    autoStreams = makeStreams(source.lines, source.autoLags);
+    crossStreams = makeStreams(source.baselines, source.crossLags);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t n = 0; n < packets; n++)
+    {
+        const ahp_xc_packet *packet = source.next(n);
+        reallocRows(autoStreams, packet->autocorrelations, n == 0);
+        reallocRows(crossStreams, packet->crosscorrelations, n == 0);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    bool passed = checkRows(source, autoStreams, crossStreams, packets);
+    ok = ok && passed;
+    fprintf(out, "    {\"run\": \"per_packet_realloc\", \"seconds\": %.4f, \"ns_per_packet\": %.0f, \"passed\": %s}\n",
+            seconds, seconds * 1e9 / packets, passed ? "true" : "false");
+    fprintf(out, "  ]\n}\n");
+    if (output)
+        fclose(out);
+
+    freeStreams(autoStreams);
+    freeStreams(crossStreams);
+    return ok ? 0 : 1;
+}
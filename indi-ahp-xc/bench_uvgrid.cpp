@@ -0,0 +1,248 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+    UV gridding benchmark
+
+    Grids pseudo random visibilities with every kernel and checks the result against a scalar
+    gridder that evaluates the kernel directly, cell by cell. Then reports the throughput for
+    several worker counts. When built with FFTW, a point source must come out of the dirty
+    image at its centre.
+
+    bench_uvgrid [--size N] [--support N] [--visibilities N] [--output FILE]
+*/
+
+#include "config.h"
+#include "uvgrid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef struct
+{
+    double u, v, value;
+} Sample;
+
+static std::vector<Sample> makeSamples(size_t count, int size)
+{
+    std::vector<Sample> samples(count);
+    uint32_t seed = 1;
+    auto uniform = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0;
+    };
+    for (Sample &s : samples)
+    {
+        // Some fall off the grid on purpose
+        s.u     = (uniform() - 0.5) * size * 1.05;
+        s.v     = (uniform() - 0.5) * size * 1.05;
+        s.value = uniform() * 100;
+    }
+    return samples;
+}
+
+// Same gridding, from the definitions
+static void referenceGrid(UVGrid::Kernel kernel, int support, int size, const std::vector<Sample> &samples,
+                          std::vector<double> &grid)
+{
+    if (kernel == UVGrid::NEAREST)
+        support = 1;
+    grid.assign(static_cast<size_t>(size) * size, 0);
+    for (const Sample &s : samples)
+    {
+        for (int sign = 1; sign >= -1; sign -= 2)
+        {
+            double x = size / 2 + sign * s.u;
+            double y = size / 2 + sign * s.v;
+            if (x < -0.5 || x >= size - 0.5 || y < -0.5 || y >= size - 0.5)
+                continue;
+
+            // Cells within half the support, the far edge included
+            int x0 = static_cast<int>(floor(x - support / 2.0)) + 1;
+            int y0 = static_cast<int>(floor(y - support / 2.0)) + 1;
+            double sx = 0, sy = 0;
+            for (int i = 0; i < support; i++)
+            {
+                sx += UVGrid::kernelValue(kernel, support, (x0 + i - x) / (support / 2.0));
+                sy += UVGrid::kernelValue(kernel, support, (y0 + i - y) / (support / 2.0));
+            }
+            for (int j = 0; j < support; j++)
+            {
+                for (int i = 0; i < support; i++)
+                {
+                    int cx = x0 + i, cy = y0 + j;
+                    if (cx < 0 || cx >= size || cy < 0 || cy >= size)
+                        continue;
+                    grid[static_cast<size_t>(cy) * size + cx] += s.value *
+                            UVGrid::kernelValue(kernel, support, (cx - x) / (support / 2.0)) *
+                            UVGrid::kernelValue(kernel, support, (cy - y) / (support / 2.0)) / (sx * sy);
+                }
+            }
+        }
+    }
+}
+
+static const char *kernelName(UVGrid::Kernel kernel)
+{
+    switch (kernel)
+    {
+        case UVGrid::KAISER_BESSEL:
+            return "kaiser_bessel";
+        case UVGrid::PROLATE_SPHEROIDAL:
+            return "prolate_spheroidal";
+        default:
+            return "nearest";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int size            = 1024;
+    int support         = 6;
+    size_t visibilities = 1 << 22;
+    const char *output  = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--size"))
+            size = atoi(argv[++i]);
+        else if (arg("--support"))
+            support = atoi(argv[++i]);
+        else if (arg("--visibilities"))
+            visibilities = strtoull(argv[++i], nullptr, 10);
+        else if (arg("--output"))
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--size N] [--support N] [--visibilities N] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (size < 16 || support < 1 || support > UVGrid::MAX_SUPPORT)
+    {
+        fprintf(stderr, "The grid needs at least 16 cells a side and a support up to %d\n", UVGrid::MAX_SUPPORT);
+        return 2;
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"ahp_xc_uvgrid\",\n");
+    fprintf(out, "  \"config\": {\"size\": %d, \"support\": %d, \"visibilities\": %zu},\n", size, support, visibilities);
+
+    bool ok = true;
+    std::vector<Sample> samples = makeSamples(visibilities, size);
+    std::vector<double> grid(static_cast<size_t>(size) * size), reference;
+    const UVGrid::Kernel kernels[] = { UVGrid::NEAREST, UVGrid::KAISER_BESSEL, UVGrid::PROLATE_SPHEROIDAL };
+
+    // Correctness on a short run, across several batches and workers
+    fprintf(out, "  \"check\": [\n");
+    size_t checkCount = std::min<size_t>(visibilities, 50000);
+    std::vector<Sample> check(samples.begin(), samples.begin() + checkCount);
+    for (UVGrid::Kernel kernel : kernels)
+    {
+        UVGrid uvgrid;
+        uvgrid.setup(size, size, kernel, support, 3);
+        for (const Sample &s : check)
+            uvgrid.add(s.u, s.v, s.value);
+        uvgrid.finish(grid.data());
+        referenceGrid(kernel, support, size, check, reference);
+
+        double peak = 0, maxError = 0, total = 0, referenceTotal = 0;
+        for (size_t z = 0; z < grid.size(); z++)
+        {
+            peak = std::max(peak, fabs(reference[z]));
+            maxError = std::max(maxError, fabs(grid[z] - reference[z]));
+            total += grid[z];
+            referenceTotal += reference[z];
+        }
+        bool passed = maxError <= 2e-3 * peak;
+        ok = ok && passed;
+        fprintf(out, "    {\"kernel\": \"%s\", \"max_error\": %.3g, \"total\": %.6g, \"reference_total\": %.6g, \"passed\": %s}%s\n",
+                kernelName(kernel), maxError / peak, total, referenceTotal, passed ? "true" : "false",
+                kernel != UVGrid::PROLATE_SPHEROIDAL ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+
+#ifdef HAVE_FFTW3
+    {
+        // Unit visibilities everywhere are a point source at the phase centre
+        UVGrid uvgrid;
+        uvgrid.setup(size, size, UVGrid::PROLATE_SPHEROIDAL, support, 1);
+        for (const Sample &s : check)
+            uvgrid.add(s.u * 0.5, s.v * 0.5, 1);
+        uvgrid.finish(grid.data());
+        std::vector<double> image(grid.size());
+        uvgrid.dirtyImage(grid.data(), image.data());
+        size_t brightest = std::max_element(image.begin(), image.end()) - image.begin();
+        bool passed = brightest == static_cast<size_t>(size / 2) * size + size / 2;
+        ok = ok && passed;
+        fprintf(out, "  \"dirty_image\": {\"peak\": [%zu, %zu], \"expected\": [%d, %d], \"passed\": %s},\n",
+                brightest % size, brightest / size, size / 2, size / 2, passed ? "true" : "false");
+    }
+#endif
+
+    // Throughput
+    fprintf(out, "  \"runs\": [\n");
+    auto start = std::chrono::steady_clock::now();
+    referenceGrid(UVGrid::PROLATE_SPHEROIDAL, support, size, samples, reference);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    fprintf(out, "    {\"kernel\": \"prolate_spheroidal\", \"scalar_reference\": true, \"seconds\": %.4f, \"mvis\": %.2f},\n",
+            seconds, visibilities / seconds / 1e6);
+
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (UVGrid::Kernel kernel : kernels)
+    {
+        for (int workers = 1; workers <= cores; workers *= 2)
+        {
+            UVGrid uvgrid;
+            uvgrid.setup(size, size, kernel, support, workers);
+
+            start = std::chrono::steady_clock::now();
+            for (const Sample &s : samples)
+                uvgrid.add(s.u, s.v, s.value);
+            uvgrid.finish(grid.data());
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            bool last = kernel == UVGrid::PROLATE_SPHEROIDAL && workers * 2 > cores;
+            fprintf(out, "    {\"kernel\": \"%s\", \"workers\": %d, \"seconds\": %.4f, \"mvis\": %.2f}%s\n", kernelName(kernel),
+                    workers, seconds, visibilities / seconds / 1e6, last ? "" : ",");
+        }
+    }
+    fprintf(out, "  ]\n}\n");
+    if (output)
+        fclose(out);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "correlationrows.h"
+
+#include <cstdlib>
+#include <cstring>
+
+static bool reserveStream(dsp_stream_p stream, size_t rows)
+{
+    dsp_t *buf = static_cast<dsp_t*>(realloc(stream->buf, sizeof(dsp_t) * rows * static_cast<size_t>(stream->sizes[0])));
+    if(buf == nullptr)
+        return false;
+    stream->buf = buf;
+    return true;
+}
+
+static void appendStream(dsp_stream_p stream, size_t row, const ahp_xc_sample &sample)
+{
+    dsp_t *out = stream->buf + row * static_cast<size_t>(stream->sizes[0]);
+    for(unsigned int i = 0; i < sample.lag_size && i < static_cast<unsigned int>(stream->sizes[0]); i++)
+        out[i] = sample.correlations[i].magnitude;
+    stream->sizes[1] = static_cast<int>(row + 1);
+    stream->len = stream->sizes[0] * stream->sizes[1];
+}
+
+static void resetStream(dsp_stream_p stream)
+{
+    stream->sizes[1] = 1;
+    stream->len = stream->sizes[0];
+    memset(stream->buf, 0, sizeof(dsp_t) * static_cast<size_t>(stream->len));
+}
+
+void CorrelationRows::setStreams(dsp_stream_p *autocorrelations, unsigned int lines, dsp_stream_p *crosscorrelations,
+                                 unsigned int baselines)
+{
+    this->autocorrelations = autocorrelations;
+    this->crosscorrelations = crosscorrelations;
+    this->lines = lines;
+    this->baselines = baselines;
+
+    // Streams hold one empty row until the first packet
+    rows = 0;
+    capacity = 1;
+    expectedRows = 0;
+}
+
+bool CorrelationRows::reserve(size_t rows)
+{
+    if(rows <= capacity)
+        return true;
+
+    for(unsigned int x = 0; x < lines; x++)
+    {
+        if(!reserveStream(autocorrelations[x], rows))
+            return false;
+    }
+    for(unsigned int x = 0; x < baselines; x++)
+    {
+        if(!reserveStream(crosscorrelations[x], rows))
+            return false;
+    }
+    capacity = rows;
+    return true;
+}
+
+bool CorrelationRows::append(const ahp_xc_packet *packet)
+{
+    // First packet of an integration, sized from the integration time
+    if(expectedRows > 0)
+    {
+        reset();
+        reserve(expectedRows);
+        expectedRows = 0;
+    }
+    // Doubled if the estimate was short
+    if(rows == capacity && !reserve(capacity * 2))
+        return false;
+
+    for(unsigned int x = 0; x < lines; x++)
+        appendStream(autocorrelations[x], rows, packet->autocorrelations[x]);
+    for(unsigned int x = 0; x < baselines; x++)
+        appendStream(crosscorrelations[x], rows, packet->crosscorrelations[x]);
+    rows++;
+    return true;
+}
+
+void CorrelationRows::reset()
+{
+    rows = 0;
+    for(unsigned int x = 0; x < lines; x++)
+        resetStream(autocorrelations[x]);
+    for(unsigned int x = 0; x < baselines; x++)
+        resetStream(crosscorrelations[x]);
+}
@@ -0,0 +1,82 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <dsp.h>
+#include <ahp/ahp_xc.h>
+
+#include <cstddef>
+
+/**
+ * @brief The CorrelationRows class appends one row per packet to the correlation streams.
+ *
+ * Every stream grows by one row of lags per packet, so they share a row count and a row
+ * capacity. Rows are written in place at row * lags, the layout of the FITS image, and the
+ * buffers only grow: after a reset they are kept for the next integration.
+ */
+class CorrelationRows
+{
+  public:
+    /**
+     * @brief setStreams Streams filled from the autocorrelations and crosscorrelations of each
+     * packet, lags x 1 with room for one row. Rows count and capacity start over.
+     * @param autocorrelations,lines One stream per line, lines is 0 without an autocorrelator.
+     * @param crosscorrelations,baselines One stream per baseline, baselines is 0 without a crosscorrelator.
+     */
+    void setStreams(dsp_stream_p *autocorrelations, unsigned int lines, dsp_stream_p *crosscorrelations,
+                    unsigned int baselines);
+
+    /** @brief expect Start over with the next packet, with room for rows packets. */
+    void expect(size_t rows)
+    {
+        expectedRows = rows;
+    }
+
+    /** @brief reserve Grow every stream buffer to hold rows packets. */
+    bool reserve(size_t rows);
+
+    /** @brief append Write the correlations of a packet as the next row of each stream. */
+    bool append(const ahp_xc_packet *packet);
+
+    /** @brief reset Back to a single empty row, keeping the allocated buffers. */
+    void reset();
+
+    size_t getRows() const
+    {
+        return rows;
+    }
+    size_t getCapacity() const
+    {
+        return capacity;
+    }
+
+  private:
+    dsp_stream_p *autocorrelations { nullptr };
+    dsp_stream_p *crosscorrelations { nullptr };
+    unsigned int lines { 0 };
+    unsigned int baselines { 0 };
+
+    // Rows written in the current integration, rows allocated in each stream buffer, and rows
+    // expected from the integration time
+    size_t rows { 0 };
+    size_t capacity { 0 };
+    size_t expectedRows { 0 };
+};
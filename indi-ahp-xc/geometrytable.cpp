@@ -0,0 +1,137 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "geometrytable.h"
+
+#include <indicom.h>
+
+#include <cmath>
+
+std::shared_ptr<GeometryTable> GeometryTable::build(const Array &array, int plotWidth, int plotHeight)
+{
+    unsigned int nlines = static_cast<unsigned int>(array.locations.size());
+    unsigned int nbaselines = nlines * (nlines - 1) / 2;
+    std::shared_ptr<GeometryTable> table = std::make_shared<GeometryTable>();
+    table->delay.assign(nlines, 0);
+    table->delayClocks.assign(nlines, -1);
+    table->plotU.assign(nbaselines, 0);
+    table->plotV.assign(nbaselines, 0);
+    table->plotted.assign(nbaselines, false);
+    table->plotWidth = plotWidth;
+    table->plotHeight = plotHeight;
+    bool plot = plotWidth > 0 && plotHeight > 0;
+
+    double center_tmp[3] = {0, 0, 0};
+    int first = -1;
+    int idx = 1;
+    for(unsigned int x = 0; x < nlines; x++)
+    {
+        if(array.enabled[x])
+        {
+            if(first > -1)
+            {
+                center_tmp[0] += array.locations[x][0] - array.locations[first][0];
+                center_tmp[1] += array.locations[x][1] - array.locations[first][1];
+                center_tmp[2] += array.locations[x][2] - array.locations[first][2];
+                idx++;
+            }
+            else
+            {
+                first = static_cast<int>(x);
+            }
+        }
+    }
+    if(first < 0)
+    {
+        // No lines enabled, nothing to steer
+        return table;
+    }
+    center_tmp[0] /= idx;
+    center_tmp[1] /= idx;
+    center_tmp[2] /= idx;
+    center_tmp[0] += array.locations[first][0];
+    center_tmp[1] += array.locations[first][1];
+    center_tmp[2] += array.locations[first][2];
+    unsigned int farest = 0;
+    double delay_max = 0;
+    for(unsigned int x = 0; x < nlines; x++)
+    {
+        if(array.enabled[x])
+        {
+            double center[3] =
+            {
+                array.locations[x][0] - center_tmp[0],
+                array.locations[x][1] - center_tmp[1],
+                array.locations[x][2] - center_tmp[2],
+            };
+            double delay_tmp = array.lineDelay(center) / sqrt(pow(center[0], 2) + pow(center[1], 2) + pow(center[2], 2));
+            farest = (delay_tmp > delay_max ? x : farest);
+            delay_max = (delay_tmp > delay_max ? delay_tmp : delay_max);
+        }
+    }
+    table->delayClocks[farest] = 0;
+    idx = 0;
+    for(unsigned int x = 0; x < nlines; x++)
+    {
+        for(unsigned int y = x + 1; y < nlines; y++)
+        {
+            if(array.enabled[x] && array.enabled[y])
+            {
+                double d = fabs(array.baselineDelay(static_cast<unsigned int>(idx)));
+                unsigned int delay_clocks = d * array.frequency / LIGHTSPEED;
+                delay_clocks = (delay_clocks > 0 ? (delay_clocks < array.delaySize ? delay_clocks : array.delaySize - 1) : 0);
+                if(y == farest)
+                {
+                    table->delay[x] = d;
+                    table->delayClocks[x] = static_cast<int>(delay_clocks);
+                }
+                if(x == farest)
+                {
+                    table->delay[y] = d;
+                    table->delayClocks[y] = static_cast<int>(delay_clocks);
+                }
+                if(plot)
+                {
+                    // The grid drops what falls outside
+                    double u = 0, v = 0;
+                    array.baselineUV(static_cast<unsigned int>(idx), &u, &v);
+                    table->plotU[idx] = plotWidth * u / 2.0;
+                    table->plotV[idx] = plotHeight * v / 2.0;
+                    table->plotted[idx] = true;
+                }
+            }
+            idx++;
+        }
+    }
+    return table;
+}
+
+void GeometryTable::steer(std::vector<int> &channelClocks,
+                          const std::function<void(unsigned int channel, unsigned int clocks, bool first)> &setChannel) const
+{
+    for(unsigned int x = 0; x < delayClocks.size() && x < channelClocks.size(); x++)
+    {
+        int clocks = delayClocks[x];
+        if(clocks < 0 || clocks == channelClocks[x])
+            continue;
+        setChannel(x, static_cast<unsigned int>(clocks), channelClocks[x] < 0);
+        channelClocks[x] = clocks;
+    }
+}
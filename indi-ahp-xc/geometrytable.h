@@ -0,0 +1,79 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief The GeometryTable struct holds the pointing dependent quantities of the array.
+ *
+ * Recomputed by the geometry thread and never modified once published: the read thread only
+ * compares the delays against what the channels were last given, and grids each baseline at
+ * its UV position.
+ */
+struct GeometryTable
+{
+    /**
+     * @brief The Array struct describes the lines, and how the current pointing projects them.
+     */
+    struct Array
+    {
+        // Location of each line (m), and whether it is enabled
+        std::vector<std::array<double, 3>> locations;
+        std::vector<bool> enabled;
+        // Delay (m) of a position relative to the array centre, towards the pointing
+        std::function<double(double *position)> lineDelay;
+        // Delay (m) and UV coordinates of a baseline, by baseline index
+        std::function<double(unsigned int baseline)> baselineDelay;
+        std::function<void(unsigned int baseline, double *u, double *v)> baselineUV;
+        // Cross-correlator clock (Hz) and delay line length (clocks)
+        double frequency { 0 };
+        unsigned int delaySize { 1 };
+    };
+
+    /**
+     * @brief build Compute the table for the pointing of array.
+     * @param plotWidth,plotHeight Size of the UV plot in cells, 0 when there is no plot.
+     */
+    static std::shared_ptr<GeometryTable> build(const Array &array, int plotWidth, int plotHeight);
+
+    /**
+     * @brief steer Give each channel its delay when it differs from what it was last given.
+     * @param channelClocks Delay clocks last given to each channel, -1 for none yet, updated.
+     * @param setChannel Called with the channel, its delay in clocks, and whether it had none yet.
+     */
+    void steer(std::vector<int> &channelClocks,
+               const std::function<void(unsigned int channel, unsigned int clocks, bool first)> &setChannel) const;
+
+    // Delay of each line to the farest one (m), and the matching cross-correlator delay in
+    // clocks, -1 for disabled lines
+    std::vector<double> delay;
+    std::vector<int> delayClocks;
+    // UV position of each baseline in plot cells from the centre, for enabled baselines
+    std::vector<double> plotU;
+    std::vector<double> plotV;
+    std::vector<bool> plotted;
+    int plotWidth { 0 };
+    int plotHeight { 0 };
+};
@@ -33,6 +33,7 @@
 #include <libnova/julian_day.h>
 
 #include <connectionplugins/connectionserial.h>
+#include "config.h"
 #include "indi_ahp_xc.h"
 
 static unsigned int nplots = 1;
@@ -363,7 +364,6 @@ void AHP_XC::Callback()
     ahp_xc_packet* packet = ahp_xc_alloc_packet();
 
     EnableCapture(true);
-    threadsRunning = true;
     while (threadsRunning)
     {
         if(ahp_xc_get_packet(packet))
@@ -371,81 +371,13 @@ void AHP_XC::Callback()
             usleep(ahp_xc_get_packettime());
             continue;
         }
-        int idx = 0;
-        double lst = get_local_sidereal_time(Longitude);
-        double ha = get_local_hour_angle(lst, RA);
-        get_alt_az_coordinates(ha * 15, Dec, Latitude, &Altitude, &Azimuth);
-
-        double center_tmp[3] = {0, 0, 0};
-        int first = -1;
-        idx = 1;
-        for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
-        {
-            if(lineEnableSP[x].sp[0].s == ISS_ON)
-            {
-                if(first > -1)
-                {
-                    center_tmp[0] += lineLocationNP[x].np[0].value - lineLocationNP[first].np[0].value;
-                    center_tmp[1] += lineLocationNP[x].np[1].value - lineLocationNP[first].np[1].value;
-                    center_tmp[2] += lineLocationNP[x].np[2].value - lineLocationNP[first].np[2].value;
-                    idx++;
-                }
-                else
-                {
-                    first = static_cast<int>(x);
-                }
-            }
-        }
-        center_tmp[0] /= idx;
-        center_tmp[1] /= idx;
-        center_tmp[2] /= idx;
-        center_tmp[0] += lineLocationNP[first].np[0].value;
-        center_tmp[1] += lineLocationNP[first].np[1].value;
-        center_tmp[2] += lineLocationNP[first].np[2].value;
-        unsigned int farest = 0;
-        double delay_max = 0;
-        for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
-        {
-            if(lineEnableSP[x].sp[0].s == ISS_ON)
-            {
-                center[x].x = lineLocationNP[x].np[0].value - center_tmp[0];
-                center[x].y = lineLocationNP[x].np[1].value - center_tmp[1];
-                center[x].z = lineLocationNP[x].np[2].value - center_tmp[2];
-                double delay_tmp = baseline_delay(Altitude, Azimuth, center[x].values) / sqrt(pow(center[x].x, 2) + pow(center[x].y,
-                                   2) + pow(center[x].z, 2));
-                farest = (delay_tmp > delay_max ? x : farest);
-                delay_max = (delay_tmp > delay_max ? delay_tmp : delay_max);
-            }
-        }
-        delay[farest] = 0;
-        ahp_xc_set_channel_auto(static_cast<unsigned int>(farest), 0, 1, 1);
-        ahp_xc_set_channel_cross(static_cast<unsigned int>(farest), 0, 1, 1);
-        idx = 0;
-        for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
+        std::shared_ptr<const GeometryTable> table = std::atomic_load(&geometry);
+        table->steer(channelClocks, [](unsigned int x, unsigned int clocks, bool first)
         {
-            for(unsigned int y = x + 1; y < ahp_xc_get_nlines(); y++)
-            {
-                if((lineEnableSP[x].sp[0].s == ISS_ON) && lineEnableSP[y].sp[0].s == ISS_ON)
-                {
-                    double d = fabs(baselines[idx]->getDelay(Altitude, Azimuth));
-                    unsigned int delay_clocks = d * ahp_xc_get_frequency() / LIGHTSPEED;
-                    delay_clocks = (delay_clocks > 0 ? (delay_clocks < ahp_xc_get_delaysize() ? delay_clocks : ahp_xc_get_delaysize() - 1) : 0);
-                    if(y == farest)
-                    {
-                        delay[x] = d;
-                        ahp_xc_set_channel_auto(x, 0, 1, 1);
-                        ahp_xc_set_channel_cross(x, delay_clocks, 1, 1);
-                    }
-                    if(x == farest)
-                    {
-                        delay[y] = d;
-                        ahp_xc_set_channel_auto(y, 0, 1, 1);
-                        ahp_xc_set_channel_cross(y, delay_clocks, 1, 1);
-                    }
-                }
-                idx++;
-            }
-        }
+            if(first)
+                ahp_xc_set_channel_auto(x, 0, 1, 1);
+            ahp_xc_set_channel_cross(x, clocks, 1, 1);
+        });
         if(InIntegration)
         {
             timeleft = CalcTimeLeft();
@@ -456,6 +388,13 @@ void AHP_XC::Callback()
                 timeleft = 0;
                 // We're done exposing
                 LOG_INFO("Integration complete, downloading plots...");
+                if(nplots > 0)
+                {
+                    std::lock_guard<std::mutex> lock(gridMutex);
+                    uvGrid.finish(plot_str[0]->buf);
+                }
+                if(dirtyImageS[0].s == ISS_ON)
+                    sendDirtyImage();
                 // Additional BLOBs
                 char **blobs = static_cast<char**>(malloc(sizeof(char*)*static_cast<unsigned int>(plotBP.nbp) + 1));
                 for(unsigned int x = 0; x < nplots; x++)
@@ -498,9 +437,6 @@ void AHP_XC::Callback()
                             autocorrelationsB[x].bloblen = static_cast<int>(memsize);
                             free(fits);
                         }
-                        autocorrelations_str[x]->sizes[1] = 1;
-                        autocorrelations_str[x]->len = autocorrelations_str[x]->sizes[0];
-                        dsp_stream_alloc_buffer(autocorrelations_str[x], autocorrelations_str[x]->len);
                     }
                     LOG_INFO("Autocorrelations BLOBs generated, downloading...");
                     sendFile(autocorrelationsB, autocorrelationsBP, ahp_xc_get_nlines());
@@ -512,25 +448,17 @@ void AHP_XC::Callback()
                 if(ahp_xc_get_nbaselines() > 0 && ahp_xc_get_crosscorrelator_lagsize() > 1)
                 {
                     blobs = static_cast<char**>(realloc(blobs, sizeof(char*)*static_cast<unsigned int>(crosscorrelationsBP.nbp) + 1));
-                    idx = 0;
-                    for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
+                    for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
                     {
-                        for(unsigned int y = x + 1; y < ahp_xc_get_nlines(); y++)
+                        size_t memsize = static_cast<unsigned int>(crosscorrelations_str[x]->len) * sizeof(double);
+                        void* fits = createFITS(-64, &memsize, crosscorrelations_str[x]);
+                        if(fits != nullptr)
                         {
-                            size_t memsize = static_cast<unsigned int>(crosscorrelations_str[x]->len) * sizeof(double);
-                            void* fits = createFITS(-64, &memsize, crosscorrelations_str[x]);
-                            if(fits != nullptr)
-                            {
-                                blobs[x] = static_cast<char*>(malloc(memsize));
-                                memcpy(blobs[x], fits, memsize);
-                                crosscorrelationsB[x].blob = blobs[x];
-                                crosscorrelationsB[x].bloblen = static_cast<int>(memsize);
-                                free(fits);
-                            }
-                            crosscorrelations_str[idx]->sizes[1] = 1;
-                            crosscorrelations_str[idx]->len = crosscorrelations_str[idx]->sizes[0];
-                            dsp_stream_alloc_buffer(crosscorrelations_str[idx], crosscorrelations_str[idx]->len);
-                            idx++;
+                            blobs[x] = static_cast<char*>(malloc(memsize));
+                            memcpy(blobs[x], fits, memsize);
+                            crosscorrelationsB[x].blob = blobs[x];
+                            crosscorrelationsB[x].bloblen = static_cast<int>(memsize);
+                            free(fits);
                         }
                     }
                     LOG_INFO("Crosscorrelations BLOBs generated, downloading...");
@@ -541,6 +469,8 @@ void AHP_XC::Callback()
                     }
                 }
                 free(blobs);
+                // Buffers are kept for the next integration
+                correlationRows.reset();
                 LOG_INFO("Download complete.");
             }
             else
@@ -548,63 +478,23 @@ void AHP_XC::Callback()
                 // Filling BLOBs
                 if(nplots > 0)
                 {
-                    idx = 0;
-                    for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
-                    {
-                        for(unsigned int y = x + 1; y < ahp_xc_get_nlines(); y++)
-                        {
-                            if((lineEnableSP[x].sp[0].s == ISS_ON) && lineEnableSP[y].sp[0].s == ISS_ON)
-                            {
-                                int w = plot_str[0]->sizes[0];
-                                int h = plot_str[0]->sizes[1];
-                                INDI::Correlator::UVCoordinate uv = baselines[idx]->getUVCoordinates(Altitude, Azimuth);
-                                int xx = static_cast<int>(w * uv.u / 2.0);
-                                int yy = static_cast<int>(h * uv.v / 2.0);
-                                int z = w * h / 2 + w / 2 + xx + yy * w;
-                                if(xx >= -w / 2 && xx < w / 2 && yy >= -w / 2 && yy < h / 2)
-                                {
-                                    plot_str[0]->buf[z] += (double)packet->crosscorrelations[idx].correlations[packet->crosscorrelations[idx].lag_size /
-                                                           2].magnitude / (double)packet->crosscorrelations[idx].correlations[packet->crosscorrelations[idx].lag_size /
-                                                                   2].counts;
-                                    plot_str[0]->buf[w * h - 1 - z] += (double)
-                                                                       packet->crosscorrelations[idx].correlations[packet->crosscorrelations[idx].lag_size / 2].magnitude /
-                                                                       packet->crosscorrelations[idx].correlations[packet->crosscorrelations[idx].lag_size / 2].counts;
-                                }
-                            }
-                            idx++;
-                        }
-                    }
-                }
-                if(ahp_xc_get_nlines() > 0 && ahp_xc_get_autocorrelator_lagsize() > 1)
-                {
-                    for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
+                    std::lock_guard<std::mutex> lock(gridMutex);
+                    int w = plot_str[0]->sizes[0];
+                    int h = plot_str[0]->sizes[1];
+                    for(unsigned int idx = 0; idx < ahp_xc_get_nbaselines(); idx++)
                     {
-                        int pos = autocorrelations_str[x]->len - autocorrelations_str[x]->sizes[0];
-                        autocorrelations_str[x]->sizes[1]++;
-                        autocorrelations_str[x]->len += autocorrelations_str[x]->sizes[0];
-                        autocorrelations_str[x]->buf = (dsp_t*)realloc(autocorrelations_str[x]->buf,
-                                                       sizeof(dsp_t) * static_cast<unsigned int>(autocorrelations_str[x]->len));
-                        for(unsigned int i = 0; i < packet->autocorrelations[x].lag_size; i++)
-                            autocorrelations_str[x]->buf[pos++] = packet->autocorrelations[x].correlations[i].magnitude;
-                    }
-                }
-                if(ahp_xc_get_nbaselines() > 0 && ahp_xc_get_crosscorrelator_lagsize() > 1)
-                {
-                    for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
-                    {
-                        int pos = crosscorrelations_str[x]->len - crosscorrelations_str[x]->sizes[0];
-                        crosscorrelations_str[x]->sizes[1]++;
-                        crosscorrelations_str[x]->len += crosscorrelations_str[x]->sizes[0];
-                        crosscorrelations_str[x]->buf = (dsp_t*)realloc(crosscorrelations_str[x]->buf,
-                                                        sizeof(dsp_t) * static_cast<unsigned int>(crosscorrelations_str[x]->len));
-                        for(unsigned int i = 0; i < packet->crosscorrelations[x].lag_size; i++)
-                            crosscorrelations_str[x]->buf[pos++] = packet->crosscorrelations[x].correlations[i].magnitude;
+                        if(!table->plotted[idx] || table->plotWidth != w || table->plotHeight != h)
+                            continue;
+                        ahp_xc_correlation *correlation = &packet->crosscorrelations[idx].correlations[packet->crosscorrelations[idx].lag_size / 2];
+                        uvGrid.add(table->plotU[idx], table->plotV[idx], (double)correlation->magnitude / (double)correlation->counts);
                     }
                 }
+                if(!correlationRows.append(packet))
+                    LOG_ERROR("Failed to allocate the correlations buffers, packet dropped.");
             }
         }
 
-        idx = 0;
+        int idx = 0;
         for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
         {
             if(lineEnableSP[x].sp[0].s == ISS_ON)
@@ -626,6 +516,116 @@ void AHP_XC::Callback()
     ahp_xc_free_packet(packet);
 }
 
+/**************************************************************************************
+** Recompute the geometry every GEOMETRY_PERIOD, or as soon as the array changes
+***************************************************************************************/
+void AHP_XC::GeometryCallback()
+{
+    std::unique_lock<std::mutex> lock(geometryMutex);
+    while (threadsRunning)
+    {
+        lock.unlock();
+        updateGeometry();
+        lock.lock();
+        geometryWake.wait_for(lock, std::chrono::milliseconds(static_cast<int>(geometryN[0].value)));
+    }
+}
+
+void AHP_XC::wakeGeometry()
+{
+    std::lock_guard<std::mutex> lock(geometryMutex);
+    geometryWake.notify_all();
+}
+
+/**************************************************************************************
+** Build and publish the delay and plot tables for the current pointing
+***************************************************************************************/
+void AHP_XC::updateGeometry()
+{
+    double lst = get_local_sidereal_time(Longitude);
+    double ha = get_local_hour_angle(lst, RA);
+    get_alt_az_coordinates(ha * 15, Dec, Latitude, &Altitude, &Azimuth);
+
+    GeometryTable::Array lines;
+    lines.locations.resize(ahp_xc_get_nlines());
+    lines.enabled.resize(ahp_xc_get_nlines());
+    for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
+    {
+        lines.enabled[x] = (lineEnableSP[x].sp[0].s == ISS_ON);
+        for(int i = 0; i < 3; i++)
+            lines.locations[x][i] = lineLocationNP[x].np[i].value;
+    }
+    lines.lineDelay = [this](double *position)
+    {
+        return baseline_delay(Altitude, Azimuth, position);
+    };
+    lines.baselineDelay = [this](unsigned int idx)
+    {
+        return baselines[idx]->getDelay(Altitude, Azimuth);
+    };
+    lines.baselineUV = [this](unsigned int idx, double *u, double *v)
+    {
+        INDI::Correlator::UVCoordinate uv = baselines[idx]->getUVCoordinates(Altitude, Azimuth);
+        *u = uv.u;
+        *v = uv.v;
+    };
+    lines.frequency = ahp_xc_get_frequency();
+    lines.delaySize = ahp_xc_get_delaysize();
+
+    std::shared_ptr<GeometryTable> table;
+    if(nplots > 0)
+        table = GeometryTable::build(lines, plot_str[0]->sizes[0], plot_str[0]->sizes[1]);
+    else
+        table = GeometryTable::build(lines, 0, 0);
+    std::atomic_store(&geometry, std::shared_ptr<const GeometryTable>(table));
+}
+
+/**************************************************************************************
+** Size the UV grid after the plot, with the selected kernel
+***************************************************************************************/
+void AHP_XC::setupGrid()
+{
+    if(nplots == 0)
+        return;
+    std::lock_guard<std::mutex> lock(gridMutex);
+    UVGrid::Kernel kernel = static_cast<UVGrid::Kernel>(IUFindOnSwitchIndex(&griddingSP));
+    if(!uvGrid.setup(plot_str[0]->sizes[0], plot_str[0]->sizes[1], kernel, static_cast<int>(griddingSupportN[0].value)))
+        LOG_ERROR("Unable to set up the UV grid");
+    uvGrid.reset();
+}
+
+/**************************************************************************************
+** Transform the gridded plot into a dirty image and send it
+***************************************************************************************/
+void AHP_XC::sendDirtyImage()
+{
+    if(nplots == 0)
+        return;
+    dsp_stream_p image = dsp_stream_copy(plot_str[0]);
+    if(!uvGrid.dirtyImage(plot_str[0]->buf, image->buf))
+    {
+        LOG_WARN("Dirty image not available, the driver was built without FFTW");
+    }
+    else
+    {
+        size_t memsize = static_cast<unsigned int>(image->len) * sizeof(double);
+        void* fits = createFITS(-64, &memsize, image);
+        if(fits != nullptr)
+        {
+            char *blob = static_cast<char*>(malloc(memsize));
+            memcpy(blob, fits, memsize);
+            dirtyImageB.blob = blob;
+            dirtyImageB.bloblen = static_cast<int>(memsize);
+            free(fits);
+            LOG_INFO("Dirty image generated, downloading...");
+            sendFile(&dirtyImageB, dirtyImageBP, 1);
+            free(blob);
+        }
+    }
+    dsp_stream_free_buffer(image);
+    dsp_stream_free(image);
+}
+
 AHP_XC::AHP_XC()
 {
     clock_divider = 0;
@@ -669,12 +669,21 @@ AHP_XC::AHP_XC()
     framebuffer = static_cast<double*>(malloc(sizeof(double)));
     totalcounts = static_cast<double*>(malloc(sizeof(double)));
     totalcorrelations = static_cast<ahp_xc_correlation*>(malloc(sizeof(ahp_xc_correlation)));
-    delay = static_cast<double*>(malloc(sizeof(double)));
     baselines = static_cast<baseline**>(malloc(sizeof(baseline)));
 }
 
 bool AHP_XC::Disconnect()
 {
+    // Both threads read the streams freed below
+    threadsRunning = false;
+    wakeGeometry();
+
+    if(readThread.joinable())
+        readThread.join();
+    if(geometryThread.joinable())
+        geometryThread.join();
+    uvGrid.stop();
+
     for(unsigned int x = 0; x < nplots; x++)
     {
         dsp_stream_free_buffer(plot_str[x]);
@@ -699,10 +708,7 @@ bool AHP_XC::Disconnect()
         }
     }
 
-    threadsRunning = false;
-
-    readThread->join();
-    readThread->~thread();
+    correlationRows.setStreams(nullptr, 0, nullptr, 0);
 
     ahp_xc_disconnect();
 
@@ -733,6 +739,12 @@ bool AHP_XC::saveConfigItems(FILE *fp)
         }
     }
     IUSaveConfigNumber(fp, &settingsNP);
+    IUSaveConfigNumber(fp, &geometryNP);
+    IUSaveConfigSwitch(fp, &griddingSP);
+    IUSaveConfigNumber(fp, &griddingSupportNP);
+#ifdef HAVE_FFTW3
+    IUSaveConfigSwitch(fp, &dirtyImageSP);
+#endif
 
     INDI::Spectrograph::saveConfigItems(fp);
     return true;
@@ -756,6 +768,26 @@ bool AHP_XC::initProperties()
     IUFillNumberVector(&settingsNP, settingsN, 2, getDeviceName(), "INTERFEROMETER_SETTINGS", "AHP_XC Settings",
                        MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
 
+    IUFillNumber(&geometryN[0], "GEOMETRY_PERIOD_VALUE", "Delay update period (ms)", "%.0f", 10, 60000, 10, 100);
+    IUFillNumberVector(&geometryNP, geometryN, 1, getDeviceName(), "GEOMETRY_PERIOD", "Geometry",
+                       MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&griddingS[UVGrid::NEAREST], "GRIDDING_NEAREST", "Nearest cell", ISS_OFF);
+    IUFillSwitch(&griddingS[UVGrid::KAISER_BESSEL], "GRIDDING_KAISER_BESSEL", "Kaiser-Bessel", ISS_OFF);
+    IUFillSwitch(&griddingS[UVGrid::PROLATE_SPHEROIDAL], "GRIDDING_PROLATE_SPHEROIDAL", "Prolate spheroidal", ISS_ON);
+    IUFillSwitchVector(&griddingSP, griddingS, 3, getDeviceName(), "GRIDDING_KERNEL", "Gridding kernel",
+                       MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillNumber(&griddingSupportN[0], "GRIDDING_SUPPORT_VALUE", "Kernel support (cells)", "%.0f", 2, UVGrid::MAX_SUPPORT, 1, 6);
+    IUFillNumberVector(&griddingSupportNP, griddingSupportN, 1, getDeviceName(), "GRIDDING_SUPPORT", "Gridding",
+                       MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
+
+    IUFillSwitch(&dirtyImageS[0], "DIRTY_IMAGE_ON", "On", ISS_OFF);
+    IUFillSwitch(&dirtyImageS[1], "DIRTY_IMAGE_OFF", "Off", ISS_ON);
+    IUFillSwitchVector(&dirtyImageSP, dirtyImageS, 2, getDeviceName(), "DIRTY_IMAGE", "Dirty image",
+                       MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+    IUFillBLOB(&dirtyImageB, "DIRTY_IMAGE_DATA", "Dirty image", ".fits");
+    IUFillBLOBVector(&dirtyImageBP, &dirtyImageB, 1, getDeviceName(), "DIRTY_IMAGES", "Images", "Stats", IP_RO, 60, IPS_IDLE);
+
     // Set minimum exposure speed to 0.001 seconds
     setMinMaxStep("SENSOR_INTEGRATION", "SENSOR_INTEGRATION_VALUE", 1.0, STELLAR_DAY, 1, false);
     setDefaultPollingPeriod(500);
@@ -787,6 +819,13 @@ void AHP_XC::ISGetProperties(const char *dev)
             defineProperty(&crosscorrelationsBP);
         defineProperty(&correlationsNP);
         defineProperty(&settingsNP);
+        defineProperty(&geometryNP);
+        defineProperty(&griddingSP);
+        defineProperty(&griddingSupportNP);
+#ifdef HAVE_FFTW3
+        defineProperty(&dirtyImageSP);
+        defineProperty(&dirtyImageBP);
+#endif
 
         // Define our properties
     }
@@ -823,6 +862,13 @@ bool AHP_XC::updateProperties()
             defineProperty(&crosscorrelationsBP);
         defineProperty(&correlationsNP);
         defineProperty(&settingsNP);
+        defineProperty(&geometryNP);
+        defineProperty(&griddingSP);
+        defineProperty(&griddingSupportNP);
+#ifdef HAVE_FFTW3
+        defineProperty(&dirtyImageSP);
+        defineProperty(&dirtyImageBP);
+#endif
     }
     else
         // We're disconnected
@@ -833,6 +879,13 @@ bool AHP_XC::updateProperties()
             deleteProperty(crosscorrelationsBP.name);
         deleteProperty(correlationsNP.name);
         deleteProperty(settingsNP.name);
+        deleteProperty(geometryNP.name);
+        deleteProperty(griddingSP.name);
+        deleteProperty(griddingSupportNP.name);
+#ifdef HAVE_FFTW3
+        deleteProperty(dirtyImageSP.name);
+        deleteProperty(dirtyImageBP.name);
+#endif
         for (unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
         {
             deleteProperty(lineEnableSP[x].name);
@@ -865,6 +918,7 @@ void AHP_XC::setupParams()
         plot_str[0]->len = size * size;
         dsp_stream_alloc_buffer(plot_str[0], plot_str[0]->len);
     }
+    setupGrid();
 }
 
 /**************************************************************************************
@@ -876,6 +930,11 @@ bool AHP_XC::StartIntegration(double duration)
         return false;
 
     IntegrationRequest = static_cast<double>(duration);
+    // The read thread starts over and allocates this many rows with the first packet, the buffers only grow
+    double packettime = ahp_xc_get_packettime();
+    correlationRows.expect((packettime > 0 ? static_cast<size_t>(IntegrationRequest / packettime) : 0) + 1);
+    // Kernel changes apply from the next integration, the grid starts empty
+    setupGrid();
     gettimeofday(&ExpStart, nullptr);
     InIntegration = true;
     // We're done
@@ -926,6 +985,7 @@ bool AHP_XC::ISNewNumber(const char *dev, const char *name, double values[], cha
                 }
             }
             IDSetNumber(&lineLocationNP[i], nullptr);
+            wakeGeometry();
         }
     }
 
@@ -937,6 +997,24 @@ bool AHP_XC::ISNewNumber(const char *dev, const char *name, double values[], cha
             baselines[x]->setWavelength(settingsN[0].value);
         }
         IDSetNumber(&settingsNP, nullptr);
+        wakeGeometry();
+        return true;
+    }
+
+    if(!strcmp(griddingSupportNP.name, name))
+    {
+        IUUpdateNumber(&griddingSupportNP, values, names, n);
+        griddingSupportNP.s = IPS_OK;
+        IDSetNumber(&griddingSupportNP, nullptr);
+        return true;
+    }
+
+    if(!strcmp(geometryNP.name, name))
+    {
+        IUUpdateNumber(&geometryNP, values, names, n);
+        geometryNP.s = IPS_OK;
+        IDSetNumber(&geometryNP, nullptr);
+        wakeGeometry();
         return true;
     }
 
@@ -980,6 +1058,24 @@ bool AHP_XC::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
     for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
         baselines[x]->ISNewSwitch(dev, name, states, names, n);
 
+    if(!strcmp(name, griddingSP.name))
+    {
+        IUUpdateSwitch(&griddingSP, states, names, n);
+        griddingSP.s = IPS_OK;
+        IDSetSwitch(&griddingSP, nullptr);
+        return true;
+    }
+
+#ifdef HAVE_FFTW3
+    if(!strcmp(name, dirtyImageSP.name))
+    {
+        IUUpdateSwitch(&dirtyImageSP, states, names, n);
+        dirtyImageSP.s = IPS_OK;
+        IDSetSwitch(&dirtyImageSP, nullptr);
+        return true;
+    }
+#endif
+
     for(unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
     {
         if(!strcmp(name, lineEnableSP[x].name))
@@ -1008,6 +1104,7 @@ bool AHP_XC::ISNewSwitch(const char *dev, const char *name, ISState *states, cha
                 deleteProperty(lineDelayNP[x].name);
             }
             IDSetSwitch(&lineEnableSP[x], nullptr);
+            wakeGeometry();
         }
         if(!strcmp(name, linePowerSP[x].name))
         {
@@ -1117,10 +1214,11 @@ void AHP_XC::TimerHit()
         return;  //  No need to reset timer if we are not connected anymore
 
     int idx = 0;
+    std::shared_ptr<const GeometryTable> table = std::atomic_load(&geometry);
     correlationsNP.s = IPS_BUSY;
     for (unsigned int x = 0; x < ahp_xc_get_nlines(); x++)
     {
-        double line_delay = delay[x];
+        double line_delay = table->delay[x];
         double steradian = pow(asin(primaryAperture * 0.5 / primaryFocalLength), 2);
         double photon_flux = ((double)totalcounts[x]) * 1000.0 / getCurrentPollingPeriod();
         double photon_flux0 = calc_photon_flux(0, settingsNP.np[1].value, settingsNP.np[0].value, steradian);
@@ -1235,11 +1333,8 @@ bool AHP_XC::Connect()
                                        static_cast<unsigned long>(ahp_xc_get_nlines()) * sizeof(double) +1));
     totalcorrelations = static_cast<ahp_xc_correlation*>(realloc(totalcorrelations,
                         static_cast<unsigned long>(ahp_xc_get_nbaselines()) * sizeof(ahp_xc_correlation) + 1));
-    delay = static_cast<double*>(realloc(delay, static_cast<unsigned long>(ahp_xc_get_nlines()) * sizeof(double) +1));
     baselines = static_cast<baseline**>(realloc(baselines,
                                         static_cast<unsigned long>(ahp_xc_get_nbaselines()) * sizeof(baseline*) + 1));
-    center = static_cast<INDI::Correlator::Baseline*>(malloc(sizeof (INDI::Correlator::Baseline) * static_cast<unsigned long>
-             (ahp_xc_get_nlines())));
 
     memset (totalcounts, 0, static_cast<unsigned long>(ahp_xc_get_nlines())*sizeof(double) +1);
     memset (totalcorrelations, 0, static_cast<unsigned long>(ahp_xc_get_nbaselines())*sizeof(ahp_xc_correlation) + 1);
@@ -1256,6 +1351,9 @@ bool AHP_XC::Connect()
         baselines[x]->initProperties();
     }
 
+    correlationRows.setStreams(autocorrelations_str, ahp_xc_get_autocorrelator_lagsize() > 1 ? ahp_xc_get_nlines() : 0,
+                               crosscorrelations_str, ahp_xc_get_crosscorrelator_lagsize() > 1 ? ahp_xc_get_nbaselines() : 0);
+
     int idx = 0;
     char tab[MAXINDINAME];
     char name[MAXINDINAME];
@@ -1374,7 +1472,12 @@ bool AHP_XC::Connect()
     // Start the timer
     SetTimer(getCurrentPollingPeriod());
 
-    readThread = new std::thread(&AHP_XC::Callback, this);
+    // The read thread steers the channels from the first packet on, so it needs a table already
+    channelClocks.assign(ahp_xc_get_nlines(), -1);
+    updateGeometry();
+    threadsRunning = true;
+    readThread = std::thread(&AHP_XC::Callback, this);
+    geometryThread = std::thread(&AHP_XC::GeometryCallback, this);
 
     return true;
 }
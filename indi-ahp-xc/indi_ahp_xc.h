@@ -23,6 +23,15 @@
 #include "indispectrograph.h"
 #include "indicorrelator.h"
 #include <ahp/ahp_xc.h>
+#include "correlationrows.h"
+#include "geometrytable.h"
+#include "uvgrid.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 class baseline : public INDI::Correlator
 {
@@ -40,6 +49,13 @@ class AHP_XC : public INDI::Spectrograph
 public:
     AHP_XC();
     virtual ~AHP_XC() override {
+        threadsRunning = false;
+        wakeGeometry();
+        if(readThread.joinable())
+            readThread.join();
+        if(geometryThread.joinable())
+            geometryThread.join();
+
         for(unsigned int x = 0; x < ahp_xc_get_nbaselines(); x++)
             baselines[x]->~baseline();
 
@@ -82,7 +98,6 @@ public:
 
         free(totalcounts);
         free(totalcorrelations);
-        free(delay);
         free(baselines);
     }
 
@@ -123,7 +138,8 @@ private:
         ENABLE_CAPTURE = 13
     };
 
-    std::thread *readThread;
+    std::thread readThread;
+    std::thread geometryThread;
 
     INumber *correlationsN;
     INumberVectorProperty correlationsNP;
@@ -153,10 +169,8 @@ private:
     ahp_xc_correlation *totalcorrelations;
     double Altitude;
     double Azimuth;
-    double *delay;
     double *framebuffer;
     baseline** baselines;
-    INDI::Correlator::Baseline *center;
 
     IBLOB *plotB;
     IBLOBVectorProperty plotBP;
@@ -171,15 +185,49 @@ private:
     dsp_stream_p *crosscorrelations_str;
     dsp_stream_p *plot_str;
 
+    // One row per packet in every correlation stream
+    CorrelationRows correlationRows;
+
     INumber settingsN[2];
     INumberVectorProperty settingsNP;
 
+    INumber geometryN[1];
+    INumberVectorProperty geometryNP;
+
+    ISwitch griddingS[3];
+    ISwitchVectorProperty griddingSP;
+
+    INumber griddingSupportN[1];
+    INumberVectorProperty griddingSupportNP;
+
+    ISwitch dirtyImageS[2];
+    ISwitchVectorProperty dirtyImageSP;
+
+    IBLOB dirtyImageB;
+    IBLOBVectorProperty dirtyImageBP;
+
+    // Plots are gridded by uvGrid during the integration and copied into plot_str at its end
+    UVGrid uvGrid;
+    std::mutex gridMutex;
+
+    // Pointing dependent quantities, swapped in whole by the geometry thread
+    std::shared_ptr<const GeometryTable> geometry;
+    std::mutex geometryMutex;
+    std::condition_variable geometryWake;
+    // Delay clocks last sent to each channel, read thread only
+    std::vector<int> channelClocks;
+
     unsigned int clock_frequency;
     unsigned int clock_divider;
 
     double timeleft;
     double wavelength;
     void Callback();
+    void GeometryCallback();
+    void updateGeometry();
+    void setupGrid();
+    void sendDirtyImage();
+    void wakeGeometry();
     bool callHandshake();
     // Utility functions
     double CalcTimeLeft();
@@ -0,0 +1,209 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+    Geometry table against the recorded per-packet steering and plotting
+
+    The pointing model is a plain projection: delays are the dot product with the pointing
+    direction, UV coordinates a rotation of the baseline scaled to fit the plot.
+*/
+
+#include "geometrytable.h"
+#include "uvgrid.h"
+#include "test_geometrytable_fixture.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+static void direction(double alt, double az, double *v)
+{
+    alt *= M_PI / 180;
+    az *= M_PI / 180;
+    v[0] = cos(alt) * sin(az);
+    v[1] = cos(alt) * cos(az);
+    v[2] = sin(alt);
+}
+
+static void baselineOf(unsigned int idx, double *b)
+{
+    for(unsigned int x = 0, n = 0; x < FIXTURE_LINES; x++)
+    {
+        for(unsigned int y = x + 1; y < FIXTURE_LINES; y++, n++)
+        {
+            if(n != idx)
+                continue;
+            for(int i = 0; i < 3; i++)
+                b[i] = fixtureLocations[y][i] - fixtureLocations[x][i];
+        }
+    }
+}
+
+static GeometryTable::Array fixtureArray(int pointing, bool enabled = true)
+{
+    double alt = fixturePointings[pointing][0];
+    double az = fixturePointings[pointing][1];
+    GeometryTable::Array array;
+    for(unsigned int x = 0; x < FIXTURE_LINES; x++)
+    {
+        array.locations.push_back({ fixtureLocations[x][0], fixtureLocations[x][1], fixtureLocations[x][2] });
+        array.enabled.push_back(enabled && x != FIXTURE_DISABLED_LINE);
+    }
+    array.lineDelay = [alt, az](double *position)
+    {
+        double v[3];
+        direction(alt, az, v);
+        return position[0] * v[0] + position[1] * v[1] + position[2] * v[2];
+    };
+    array.baselineDelay = [array](unsigned int idx)
+    {
+        double b[3];
+        baselineOf(idx, b);
+        return array.lineDelay(b);
+    };
+    array.baselineUV = [alt, az](unsigned int idx, double *u, double *v)
+    {
+        double b[3], d[3];
+        baselineOf(idx, b);
+        direction(alt, az, d);
+        *u = (b[0] * d[1] - b[1] * d[0]) / 100.0;
+        *v = (b[2] * cos(alt * M_PI / 180) - b[0] * d[2]) / 100.0;
+    };
+    array.frequency = FIXTURE_FREQUENCY;
+    array.delaySize = FIXTURE_DELAY_SIZE;
+    return array;
+}
+
+static bool baselineEnabled(unsigned int idx)
+{
+    for(unsigned int x = 0, n = 0; x < FIXTURE_LINES; x++)
+        for(unsigned int y = x + 1; y < FIXTURE_LINES; y++, n++)
+            if(n == idx)
+                return x != FIXTURE_DISABLED_LINE && y != FIXTURE_DISABLED_LINE;
+    return false;
+}
+
+TEST(GeometryTableTest, recorded_delays)
+{
+    for(int p = 0; p < FIXTURE_POINTINGS; p++)
+    {
+        auto table = GeometryTable::build(fixtureArray(p), FIXTURE_PLOT_WIDTH, FIXTURE_PLOT_HEIGHT);
+        for(unsigned int x = 0; x < FIXTURE_LINES; x++)
+        {
+            EXPECT_NEAR(table->delay[x], fixtureDelay[p][x], 1e-9) << "pointing " << p << " line " << x;
+            EXPECT_EQ(table->delayClocks[x], fixtureClocks[p][x]) << "pointing " << p << " line " << x;
+        }
+    }
+}
+
+TEST(GeometryTableTest, recorded_plot_cells)
+{
+    for(int p = 0; p < FIXTURE_POINTINGS; p++)
+    {
+        auto table = GeometryTable::build(fixtureArray(p), FIXTURE_PLOT_WIDTH, FIXTURE_PLOT_HEIGHT);
+        EXPECT_EQ(table->plotWidth, FIXTURE_PLOT_WIDTH);
+        EXPECT_EQ(table->plotHeight, FIXTURE_PLOT_HEIGHT);
+        for(unsigned int idx = 0; idx < FIXTURE_BASELINES; idx++)
+        {
+            ASSERT_EQ(table->plotted[idx], baselineEnabled(idx)) << "pointing " << p << " baseline " << idx;
+            if(!table->plotted[idx])
+                continue;
+            EXPECT_EQ(static_cast<int>(table->plotU[idx]), fixtureCells[p][idx][0]) << "pointing " << p << " baseline " << idx;
+            EXPECT_EQ(static_cast<int>(table->plotV[idx]), fixtureCells[p][idx][1]) << "pointing " << p << " baseline " << idx;
+        }
+    }
+
+    // Nothing to plot without a plot
+    auto table = GeometryTable::build(fixtureArray(0), 0, 0);
+    for(unsigned int idx = 0; idx < FIXTURE_BASELINES; idx++)
+        EXPECT_FALSE(table->plotted[idx]);
+}
+
+TEST(GeometryTableTest, recorded_packets_replay)
+{
+    UVGrid grid;
+    ASSERT_TRUE(grid.setup(FIXTURE_PLOT_WIDTH, FIXTURE_PLOT_HEIGHT, UVGrid::NEAREST, 1, 1));
+
+    std::vector<int> channelClocks(FIXTURE_LINES, -1);
+    int hwAuto[FIXTURE_LINES], hwCross[FIXTURE_LINES];
+    for(unsigned int x = 0; x < FIXTURE_LINES; x++)
+        hwAuto[x] = hwCross[x] = -1;
+    int writes = 0;
+    auto setChannel = [&](unsigned int x, unsigned int clocks, bool first)
+    {
+        if(first)
+            hwAuto[x] = 0;
+        hwCross[x] = static_cast<int>(clocks);
+        writes++;
+    };
+
+    for(int p = 0; p < FIXTURE_POINTINGS; p++)
+    {
+        auto table = GeometryTable::build(fixtureArray(p), FIXTURE_PLOT_WIDTH, FIXTURE_PLOT_HEIGHT);
+        for(int k = 0; k < FIXTURE_PACKETS; k++)
+        {
+            writes = 0;
+            table->steer(channelClocks, setChannel);
+            // The channels only change with the pointing
+            if(k > 0)
+            {
+                EXPECT_EQ(writes, 0) << "pointing " << p << " packet " << k;
+            }
+            for(unsigned int x = 0; x < FIXTURE_LINES; x++)
+            {
+                EXPECT_EQ(hwCross[x], fixtureClocks[p][x]) << "pointing " << p << " line " << x;
+                EXPECT_EQ(hwAuto[x], x == FIXTURE_DISABLED_LINE ? -1 : 0);
+            }
+            for(unsigned int idx = 0; idx < FIXTURE_BASELINES; idx++)
+            {
+                if(table->plotted[idx])
+                    grid.add(table->plotU[idx], table->plotV[idx],
+                             static_cast<double>(fixtureMagnitude[p][k][idx]) / fixtureCounts[p][k][idx]);
+            }
+        }
+    }
+
+    std::vector<double> plot(FIXTURE_PLOT_WIDTH * FIXTURE_PLOT_HEIGHT);
+    grid.finish(plot.data());
+    double total = 0;
+    for(double cell : plot)
+        total += cell;
+    EXPECT_NEAR(total, fixturePlotTotal, 1e-9 * fixturePlotTotal);
+}
+
+TEST(GeometryTableTest, no_lines_enabled)
+{
+    auto table = GeometryTable::build(fixtureArray(0, false), FIXTURE_PLOT_WIDTH, FIXTURE_PLOT_HEIGHT);
+    std::vector<int> channelClocks(FIXTURE_LINES, -1);
+    int writes = 0;
+    table->steer(channelClocks, [&](unsigned int, unsigned int, bool)
+    {
+        writes++;
+    });
+    EXPECT_EQ(writes, 0);
+    for(unsigned int idx = 0; idx < FIXTURE_BASELINES; idx++)
+        EXPECT_FALSE(table->plotted[idx]);
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,201 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+    Geometry table fixture
+
+    Recorded from the per-packet steering and plotting the geometry thread replaced, run on the
+    array and pointing model of test_geometrytable.cpp: eight lines with line 4 disabled, a 400 MHz
+    clock with a 32 clocks delay line, and a 64 x 48 plot. For each pointing, the line delays,
+    the delay each channel was left with (-1 for never set), the plot cell of each baseline (0, 0
+    for disabled baselines), and the middle lag of the packets replayed. The plot total is the sum
+    of the plot after every packet.
+*/
+
+#pragma once
+
+static const unsigned int FIXTURE_LINES = 8;
+static const unsigned int FIXTURE_BASELINES = 28;
+static const unsigned int FIXTURE_DISABLED_LINE = 3;
+static const int FIXTURE_POINTINGS = 6;
+static const int FIXTURE_PACKETS = 4;
+static const double FIXTURE_FREQUENCY = 400e6;
+static const unsigned int FIXTURE_DELAY_SIZE = 32;
+static const int FIXTURE_PLOT_WIDTH = 64;
+static const int FIXTURE_PLOT_HEIGHT = 48;
+
+static const double fixtureLocations[FIXTURE_LINES][3] =
+{
+    { -10.91, -7.24, 1.91 },
+    { -1.78, -7.68, -0.94 },
+    { -16.53, -3.23, -1.94 },
+    { 1.11, 14.75, -0.68 },
+    { -4.28, 6.97, 0.69 },
+    { 7.76, -6.16, 1.72 },
+    { -9.5, 10.03, -0.98 },
+    { 14.05, -13.04, 1.16 },
+};
+
+static const double fixturePointings[FIXTURE_POINTINGS][2] =
+{
+    { 85, 10 }, { 62.5, 95 }, { 47, 170 }, { 33, 215 }, { 21.5, 290 }, { 12, 340 }
+};
+
+static const double fixtureDelay[FIXTURE_POINTINGS][FIXTURE_LINES] =
+{
+    { 0, 2.7387434163003226, 3.576220196197244, 0, 0.10465154158524359, 0.18598110891218614, 1.3753505070300189, 0.86721408030049862 },
+    { 8.3760460599247146, 6.6865969745591123, 14.537568725891639, 0, 6.9803233524342909, 0, 10.985933952748567, 2.6734996147016639 },
+    { 0.70759208771916571, 0, 5.4669492072339771, 0, 8.9434489399339636, 2.0543131407240325, 12.838212647494041, 7.0105301912068434 },
+    { 0, 5.6418523158414278, 2.1482708957133436, 0, 13.616017604366755, 9.8264881077865684, 14.116743299294567, 8.4306869808404681 },
+    { 4.7786413510251373, 13.945605883084328, 0, 0, 6.5004968694929151, 20.827900092364668, 1.5749159258179581, 28.721893071942873 },
+    { 10.589542898186908, 14.640927420402358, 5.8240294510217083, 0, 0, 15.882332619476539, 4.211742281782711, 24.426866262116427 },
+};
+
+static const int fixtureClocks[FIXTURE_POINTINGS][FIXTURE_LINES] =
+{
+    { 0, 3, 4, -1, 0, 0, 1, 1 },
+    { 11, 8, 19, -1, 9, 0, 14, 3 },
+    { 0, 0, 7, -1, 11, 2, 17, 9 },
+    { 0, 7, 2, -1, 18, 13, 18, 11 },
+    { 6, 18, 0, -1, 8, 27, 2, 31 },
+    { 14, 19, 7, -1, 0, 21, 5, 31 },
+};
+
+static const int fixtureCells[FIXTURE_POINTINGS][FIXTURE_BASELINES][2] =
+{
+    {
+        { 0, -2 }, { 0, 1 }, { 0, 0 }, { 0, -1 }, { 0, -4 }, { 0, 0 }, { 0, -5 },
+        { 0, 3 }, { 0, 0 }, { 0, 0 }, { 0, -2 }, { 0, 1 }, { 0, -3 }, { 0, 0 },
+        { 0, -2 }, { 0, -5 }, { 0, -1 }, { 0, -7 }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+        { 0, 0 }, { 0, -2 }, { 0, 1 }, { 0, -4 }, { 0, 4 }, { 0, -1 }, { 0, -5 }
+    },
+    {
+        { 0, -2 }, { 0, 0 }, { 0, 0 }, { -2, -1 }, { 0, -3 }, { -2, 0 }, { 0, -5 },
+        { 0, 3 }, { 0, 0 }, { -2, 0 }, { 0, -1 }, { -2, 1 }, { 0, -3 }, { 0, 0 },
+        { -1, -2 }, { 0, -4 }, { -2, -1 }, { 1, -6 }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+        { 0, 0 }, { 1, -2 }, { 0, 0 }, { 2, -3 }, { -2, 3 }, { 0, -1 }, { 3, -4 }
+    },
+    {
+        { -1, -2 }, { 1, 0 }, { 0, 0 }, { -1, -1 }, { -4, -3 }, { 0, 0 }, { -5, -4 },
+        { 3, 2 }, { 0, 0 }, { 0, 0 }, { -2, -1 }, { 0, 1 }, { -3, -2 }, { 0, 0 },
+        { -3, -1 }, { -5, -3 }, { -2, -1 }, { -6, -4 }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+        { 0, 0 }, { -2, -1 }, { 1, 0 }, { -3, -3 }, { 3, 2 }, { -1, -1 }, { -4, -3 }
+    },
+    {
+        { -2, -1 }, { 1, 0 }, { 0, 0 }, { 0, -1 }, { -3, -2 }, { 2, 0 }, { -6, -3 },
+        { 3, 1 }, { 0, 0 }, { 2, 0 }, { -1, 0 }, { 4, 1 }, { -4, -1 }, { 0, 0 },
+        { -1, -1 }, { -5, -2 }, { 0, 0 }, { -8, -3 }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+        { 0, 0 }, { -4, -1 }, { 1, 0 }, { -7, -2 }, { 6, 1 }, { -2, 0 }, { -8, -2 }
+    },
+    {
+        { 0, -1 }, { 0, 0 }, { 0, 0 }, { 4, 0 }, { 2, -1 }, { 4, 0 }, { 0, -2 },
+        { 0, 1 }, { 0, 0 }, { 3, 0 }, { 1, 0 }, { 4, 0 }, { 0, 0 }, { 0, 0 },
+        { 4, 0 }, { 1, -1 }, { 4, 0 }, { 0, -1 }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+        { 0, 0 }, { -2, 0 }, { 0, 0 }, { -3, -1 }, { 2, 0 }, { -1, 0 }, { -4, -1 }
+    },
+    {
+        { 2, -1 }, { -1, 0 }, { 0, 0 }, { 3, 0 }, { 5, 0 }, { 2, 0 }, { 6, -1 },
+        { -3, 0 }, { 0, 0 }, { 0, 0 }, { 2, 0 }, { 0, 0 }, { 4, 0 }, { 0, 0 },
+        { 4, 0 }, { 6, 0 }, { 3, 0 }, { 7, 0 }, { 0, 0 }, { 0, 0 }, { 0, 0 },
+        { 0, 0 }, { 2, 0 }, { -1, 0 }, { 3, 0 }, { -3, 0 }, { 1, 0 }, { 4, 0 }
+    },
+};
+
+static const int fixtureMagnitude[FIXTURE_POINTINGS][FIXTURE_PACKETS][FIXTURE_BASELINES] =
+{
+    {
+        { 612, 409, 907, 800, 0, 232, 150, 453, 60, 343, 242, 371, 901, 887, 95, 653, 571, 531, 211, 779, 316, 569, 398, 277, 821, 343, 690, 146 },
+        { 789, 27, 722, 400, 773, 705, 180, 414, 212, 661, 999, 163, 788, 440, 906, 211, 39, 114, 947, 916, 975, 376, 446, 462, 444, 151, 786, 349 },
+        { 92, 545, 578, 772, 22, 524, 40, 979, 38, 33, 334, 561, 375, 430, 353, 988, 255, 913, 5, 235, 369, 662, 321, 261, 179, 920, 719, 577 },
+        { 140, 348, 901, 553, 239, 515, 391, 16, 819, 192, 767, 425, 408, 27, 861, 906, 274, 616, 6, 9, 37, 691, 551, 808, 953, 294, 797, 527 },
+    },
+    {
+        { 792, 954, 966, 874, 188, 663, 44, 540, 867, 610, 607, 663, 634, 764, 856, 537, 136, 784, 723, 405, 137, 930, 920, 613, 363, 41, 270, 964 },
+        { 647, 540, 642, 200, 703, 606, 43, 333, 483, 665, 616, 611, 420, 871, 499, 557, 110, 99, 104, 122, 480, 227, 96, 6, 999, 808, 98, 924 },
+        { 743, 851, 266, 181, 393, 850, 911, 189, 942, 589, 322, 174, 526, 445, 788, 264, 539, 919, 742, 677, 797, 908, 431, 134, 946, 758, 94, 371 },
+        { 420, 643, 462, 320, 585, 34, 575, 620, 429, 989, 397, 189, 307, 406, 786, 590, 753, 636, 202, 435, 985, 887, 200, 168, 321, 259, 0, 809 },
+    },
+    {
+        { 217, 197, 56, 171, 971, 444, 839, 402, 748, 991, 394, 230, 189, 54, 755, 164, 567, 685, 937, 497, 936, 298, 46, 811, 643, 26, 246, 468 },
+        { 170, 549, 582, 525, 179, 549, 800, 459, 903, 986, 467, 776, 818, 880, 263, 746, 413, 0, 529, 252, 821, 199, 801, 578, 398, 640, 20, 996 },
+        { 394, 984, 883, 942, 593, 701, 789, 812, 367, 59, 16, 461, 892, 330, 687, 86, 178, 558, 337, 199, 344, 628, 718, 864, 686, 12, 39, 616 },
+        { 101, 399, 180, 403, 877, 81, 897, 937, 86, 885, 811, 997, 86, 349, 224, 614, 170, 219, 478, 400, 612, 856, 985, 33, 510, 146, 448, 92 },
+    },
+    {
+        { 402, 722, 703, 596, 483, 47, 457, 417, 7, 620, 823, 195, 908, 199, 779, 971, 902, 244, 389, 127, 910, 2, 569, 285, 14, 256, 816, 507 },
+        { 818, 915, 345, 401, 705, 979, 262, 402, 670, 677, 383, 368, 204, 319, 189, 348, 952, 263, 544, 59, 865, 327, 72, 406, 934, 947, 990, 246 },
+        { 561, 707, 147, 415, 973, 12, 641, 437, 417, 357, 855, 177, 120, 845, 167, 70, 43, 825, 869, 260, 911, 29, 484, 453, 759, 702, 182, 911 },
+        { 159, 572, 320, 335, 504, 815, 863, 896, 271, 696, 346, 284, 573, 61, 440, 997, 331, 882, 15, 965, 691, 48, 283, 541, 525, 893, 645, 18 },
+    },
+    {
+        { 735, 602, 966, 476, 498, 196, 703, 442, 57, 424, 153, 356, 931, 270, 519, 463, 804, 320, 772, 390, 53, 541, 760, 481, 649, 739, 387, 796 },
+        { 817, 838, 209, 94, 713, 314, 33, 951, 270, 18, 486, 753, 520, 917, 183, 292, 746, 516, 705, 819, 928, 998, 728, 216, 139, 138, 378, 42 },
+        { 440, 476, 709, 398, 540, 799, 770, 739, 143, 868, 385, 208, 743, 206, 914, 950, 539, 872, 862, 320, 182, 714, 286, 71, 380, 172, 470, 309 },
+        { 719, 961, 256, 290, 333, 847, 801, 526, 362, 56, 89, 164, 392, 116, 695, 952, 906, 767, 985, 781, 270, 644, 264, 71, 770, 363, 181, 122 },
+    },
+    {
+        { 86, 934, 943, 152, 448, 694, 403, 8, 480, 456, 850, 42, 849, 301, 36, 17, 199, 529, 646, 551, 398, 265, 933, 802, 584, 725, 86, 729 },
+        { 320, 25, 564, 463, 218, 273, 418, 573, 930, 824, 63, 6, 408, 879, 225, 658, 739, 986, 385, 130, 753, 93, 14, 975, 710, 925, 60, 888 },
+        { 73, 649, 240, 33, 695, 777, 87, 96, 76, 509, 760, 427, 337, 223, 20, 302, 925, 850, 940, 323, 622, 13, 100, 562, 861, 59, 450, 681 },
+        { 840, 492, 881, 895, 867, 46, 533, 694, 169, 773, 326, 281, 356, 355, 279, 580, 372, 330, 165, 588, 593, 171, 655, 129, 25, 435, 608, 637 },
+    },
+};
+
+static const int fixtureCounts[FIXTURE_POINTINGS][FIXTURE_PACKETS][FIXTURE_BASELINES] =
+{
+    {
+        { 43, 20, 84, 68, 66, 33, 28, 33, 41, 40, 10, 93, 36, 93, 57, 49, 62, 56, 70, 48, 20, 4, 54, 94, 78, 28, 68, 79 },
+        { 16, 60, 20, 81, 56, 58, 20, 19, 89, 17, 100, 41, 76, 15, 23, 12, 50, 28, 86, 53, 86, 99, 66, 98, 28, 78, 12, 97 },
+        { 10, 90, 17, 51, 63, 51, 99, 83, 97, 50, 55, 90, 82, 61, 49, 11, 18, 100, 49, 9, 36, 25, 86, 47, 73, 76, 48, 25 },
+        { 82, 64, 87, 11, 76, 27, 65, 42, 38, 30, 72, 50, 13, 83, 26, 61, 40, 56, 71, 90, 74, 18, 15, 13, 46, 34, 28, 15 },
+    },
+    {
+        { 26, 11, 1, 40, 97, 78, 74, 75, 67, 57, 38, 49, 52, 9, 93, 67, 11, 100, 46, 41, 12, 53, 37, 89, 82, 58, 35, 73 },
+        { 48, 92, 11, 55, 47, 62, 30, 1, 64, 31, 98, 100, 75, 86, 74, 7, 9, 57, 14, 55, 21, 78, 1, 70, 35, 38, 21, 41 },
+        { 37, 6, 17, 83, 87, 38, 72, 50, 52, 9, 71, 37, 55, 79, 55, 90, 72, 45, 9, 33, 14, 32, 39, 79, 50, 22, 82, 20 },
+        { 25, 70, 9, 65, 94, 36, 44, 17, 52, 52, 100, 35, 16, 78, 56, 54, 97, 44, 67, 100, 63, 17, 10, 37, 3, 53, 83, 96 },
+    },
+    {
+        { 54, 47, 22, 84, 19, 3, 37, 19, 74, 81, 45, 87, 31, 73, 74, 30, 9, 59, 54, 1, 61, 13, 82, 64, 66, 79, 99, 20 },
+        { 5, 34, 28, 45, 95, 11, 10, 83, 23, 73, 29, 96, 39, 43, 41, 1, 97, 9, 64, 65, 50, 57, 85, 7, 91, 59, 100, 62 },
+        { 65, 7, 32, 73, 8, 19, 13, 39, 93, 28, 80, 75, 45, 74, 38, 59, 77, 71, 21, 63, 22, 15, 24, 24, 85, 21, 89, 31 },
+        { 8, 69, 76, 83, 21, 10, 13, 82, 31, 27, 93, 10, 41, 47, 92, 79, 86, 62, 4, 57, 60, 71, 51, 79, 3, 84, 6, 98 },
+    },
+    {
+        { 52, 9, 96, 29, 62, 26, 5, 65, 39, 71, 63, 90, 57, 7, 78, 88, 87, 38, 54, 98, 15, 25, 3, 100, 10, 96, 55, 75 },
+        { 39, 10, 57, 1, 70, 54, 48, 80, 38, 29, 43, 27, 77, 21, 81, 98, 5, 59, 19, 28, 29, 39, 40, 96, 61, 49, 71, 96 },
+        { 3, 43, 94, 35, 13, 23, 82, 45, 43, 86, 35, 7, 79, 59, 58, 69, 87, 94, 81, 32, 21, 61, 33, 75, 90, 50, 35, 66 },
+        { 68, 55, 64, 32, 84, 80, 13, 47, 10, 65, 80, 67, 94, 72, 81, 52, 40, 82, 41, 15, 57, 47, 21, 58, 28, 17, 18, 80 },
+    },
+    {
+        { 28, 100, 85, 85, 100, 2, 12, 73, 80, 95, 90, 43, 86, 53, 88, 13, 68, 14, 35, 48, 53, 76, 83, 33, 38, 24, 40, 22 },
+        { 86, 95, 44, 30, 62, 88, 90, 4, 24, 27, 61, 59, 1, 18, 25, 77, 23, 15, 8, 1, 26, 95, 6, 92, 60, 84, 97, 58 },
+        { 58, 38, 93, 72, 15, 55, 57, 63, 66, 88, 9, 21, 89, 74, 24, 100, 22, 55, 50, 86, 35, 20, 34, 89, 94, 97, 89, 9 },
+        { 46, 31, 56, 68, 76, 36, 70, 85, 13, 91, 76, 35, 30, 91, 39, 89, 60, 28, 80, 10, 50, 87, 58, 12, 62, 10, 12, 69 },
+    },
+    {
+        { 14, 41, 60, 88, 52, 4, 99, 97, 52, 87, 35, 93, 34, 11, 17, 67, 29, 72, 59, 84, 89, 48, 76, 40, 45, 78, 38, 6 },
+        { 85, 22, 81, 87, 79, 68, 100, 66, 21, 99, 84, 68, 22, 76, 35, 84, 59, 75, 39, 95, 75, 55, 36, 14, 43, 93, 13, 89 },
+        { 80, 67, 55, 16, 7, 19, 75, 96, 14, 64, 43, 97, 37, 84, 5, 73, 100, 9, 68, 25, 26, 6, 42, 33, 45, 29, 98, 20 },
+        { 66, 23, 84, 91, 30, 79, 36, 88, 78, 4, 89, 53, 88, 61, 99, 84, 89, 4, 30, 39, 86, 11, 51, 61, 91, 64, 8, 67 },
+    },
+};
+
+static const double fixturePlotTotal = 22650.046694995086;
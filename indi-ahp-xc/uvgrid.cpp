@@ -0,0 +1,387 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "config.h"
+#include "uvgrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef HAVE_FFTW3
+#include <fftw3.h>
+#endif
+
+// Kernel table rows per cell
+#define OVERSAMPLE  (1024)
+#define BATCH_SIZE  (4096)
+// Every worker holds a whole grid
+#define MAX_WORKERS (4)
+
+#ifdef HAVE_FFTW3
+// The FFTW planner is not thread safe
+static std::mutex planner;
+#endif
+
+// Modified Bessel function of the first kind, order zero
+static double bessel_i0(double x)
+{
+    double sum = 1, term = 1;
+    for (int k = 1; term > sum * 1e-17; k++)
+    {
+        term *= (x * x / 4) / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Rational approximation of the prolate spheroidal wave function, m = 6 and alpha = 1 (Schwab 1984)
+static double spheroidal(double nu)
+{
+    static const double p[2][5] =
+    {
+        { 8.203343e-2, -3.644705e-1, 6.278660e-1, -5.335581e-1, 2.312756e-1 },
+        { 4.028559e-3, -3.697768e-2, 1.021332e-1, -1.201436e-1, 6.412774e-2 },
+    };
+    static const double q[2][3] =
+    {
+        { 1.0, 8.212018e-1, 2.078043e-1 },
+        { 1.0, 9.599102e-1, 2.918724e-1 },
+    };
+    int part  = nu < 0.75 ? 0 : 1;
+    double d  = nu * nu - (part ? 1.0 : 0.5625);
+    double top = 0, bottom = 0;
+    for (int k = 4; k >= 0; k--)
+        top = top * d + p[part][k];
+    for (int k = 2; k >= 0; k--)
+        bottom = bottom * d + q[part][k];
+    return top / bottom;
+}
+
+double UVGrid::kernelValue(Kernel kernel, int support, double nu)
+{
+    nu = fabs(nu);
+    if (nu > 1)
+        return 0;
+    switch (kernel)
+    {
+        case KAISER_BESSEL:
+        {
+            // Beatty et al. 2005, for a grid oversampled twice
+            double beta = M_PI * sqrt(std::max(0.0, pow(support * 0.75, 2) - 0.8));
+            return bessel_i0(beta * sqrt(1 - nu * nu)) / bessel_i0(beta);
+        }
+        case PROLATE_SPHEROIDAL:
+            return (1 - nu * nu) * spheroidal(nu);
+        default:
+            return 1;
+    }
+}
+
+UVGrid::~UVGrid()
+{
+    stop();
+}
+
+bool UVGrid::setup(int width, int height, Kernel kernel, int support, int workers)
+{
+    if (width < 1 || height < 1 || support < 1 || support > MAX_SUPPORT)
+        return false;
+    if (kernel == NEAREST)
+        support = 1;
+    if (workers <= 0)
+        workers = std::max(1, std::min(MAX_WORKERS, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+    if (running && width == this->width && height == this->height && kernel == this->kernel && support == this->support
+            && workers == static_cast<int>(this->workers.size()))
+        return true;
+
+    stop();
+    this->width   = width;
+    this->height  = height;
+    this->kernel  = kernel;
+    this->support = support;
+    padding       = MAX_SUPPORT;
+    stride        = width + 2 * padding;
+
+    // One row of weights for each offset of the first cell from the visibility
+    table.assign((OVERSAMPLE + 1) * MAX_SUPPORT, 0);
+    for (int r = 0; r <= OVERSAMPLE; r++)
+    {
+        double *w = &table[r * MAX_SUPPORT];
+        double sum = 0;
+        for (int i = 0; i < support; i++)
+        {
+            w[i] = kernelValue(kernel, support, (i + static_cast<double>(r) / OVERSAMPLE - support / 2.0) / (support / 2.0));
+            sum += w[i];
+        }
+        // Each visibility adds its own value to the grid, whatever its offset from the cells
+        for (int i = 0; i < support; i++)
+            w[i] /= sum;
+    }
+
+    running = true;
+    for (int i = 0; i < workers; i++)
+    {
+        std::unique_ptr<Worker> worker(new Worker);
+        worker->grid.assign(static_cast<size_t>(stride) * (height + 2 * padding), 0);
+        this->workers.push_back(std::move(worker));
+    }
+    for (auto &worker : this->workers)
+        worker->thread = std::thread(&UVGrid::workerLoop, this, worker.get());
+
+    batch.clear();
+    batch.reserve(BATCH_SIZE);
+    return true;
+}
+
+void UVGrid::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    queued.notify_all();
+
+    for (auto &worker : workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+    }
+    workers.clear();
+    jobs.clear();
+    spare.clear();
+    batch.clear();
+    busy = 0;
+}
+
+void UVGrid::reset()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]()
+    {
+        return jobs.empty() && busy == 0;
+    });
+    for (auto &worker : workers)
+        std::fill(worker->grid.begin(), worker->grid.end(), 0);
+    batch.clear();
+}
+
+void UVGrid::add(double u, double v, double value)
+{
+    if (!running)
+        return;
+
+    auto push = [this, value](double x, double y)
+    {
+        if (x >= -0.5 && x < width - 0.5 && y >= -0.5 && y < height - 0.5)
+            batch.push_back({ x, y, value });
+    };
+    // The conjugate sits around the same centre
+    push(width / 2 + u, height / 2 + v);
+    push(width / 2 - u, height / 2 - v);
+    if (batch.size() >= BATCH_SIZE)
+        dispatch();
+}
+
+void UVGrid::dispatch()
+{
+    Batch next;
+    std::unique_lock<std::mutex> lock(mutex);
+    // Bounded queue, a slow grid slows the caller down instead of eating memory
+    done.wait(lock, [this]()
+    {
+        return jobs.size() < 2 * workers.size();
+    });
+    if (!spare.empty())
+    {
+        next = std::move(spare.back());
+        spare.pop_back();
+    }
+    next.clear();
+    jobs.push_back(std::move(batch));
+    batch = std::move(next);
+    queued.notify_one();
+}
+
+void UVGrid::finish(double *grid)
+{
+    if (!batch.empty() && running)
+        dispatch();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]()
+        {
+            return jobs.empty() && busy == 0;
+        });
+    }
+
+    std::fill(grid, grid + static_cast<size_t>(width) * height, 0);
+    for (auto &worker : workers)
+    {
+        for (int y = 0; y < height; y++)
+        {
+            const double *row = &worker->grid[static_cast<size_t>(y + padding) * stride + padding];
+            for (int x = 0; x < width; x++)
+                grid[static_cast<size_t>(y) * width + x] += row[x];
+        }
+    }
+
+    reset();
+}
+
+void UVGrid::workerLoop(Worker *worker)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        queued.wait(lock, [this]()
+        {
+            return !running || !jobs.empty();
+        });
+        if (!running)
+            return;
+
+        Batch job = std::move(jobs.front());
+        jobs.pop_front();
+        busy++;
+        // Room in the queue
+        done.notify_all();
+        lock.unlock();
+
+        accumulate(worker, job);
+
+        lock.lock();
+        spare.push_back(std::move(job));
+        busy--;
+        done.notify_all();
+    }
+}
+
+const double *UVGrid::weights(double position, int *first) const
+{
+    double start = position - support / 2.0;
+    // Positions on the grid start above -MAX_SUPPORT, this is floor(start) + 1 without the call
+    *first = static_cast<int>(start + MAX_SUPPORT) - MAX_SUPPORT + 1;
+    return &table[static_cast<int>((*first - start) * OVERSAMPLE + 0.5) * MAX_SUPPORT];
+}
+
+void UVGrid::accumulate(Worker *worker, const Batch &batch)
+{
+    if (support == 1)
+    {
+        for (const Visibility &visibility : batch)
+        {
+            int fx, fy;
+            weights(visibility.x, &fx);
+            weights(visibility.y, &fy);
+            worker->grid[static_cast<size_t>(fy + padding) * stride + fx + padding] += visibility.value;
+        }
+        return;
+    }
+
+    for (const Visibility &visibility : batch)
+    {
+        int fx, fy;
+        const double *wx = weights(visibility.x, &fx);
+        const double *wy = weights(visibility.y, &fy);
+
+        // The padding takes the zero weights past the support, the row loop has a fixed
+        // length and no branches
+        double *cell = &worker->grid[static_cast<size_t>(fy + padding) * stride + fx + padding];
+        for (int j = 0; j < support; j++, cell += stride)
+        {
+            double value = visibility.value * wy[j];
+            for (int i = 0; i < MAX_SUPPORT; i++)
+                cell[i] += value * wx[i];
+        }
+    }
+}
+
+std::vector<double> UVGrid::taper(int size) const
+{
+    // Image plane response of the kernel, sampled at the cell offsets and normalised as gridded
+    std::vector<double> t(size, 0);
+    double sum = 0;
+    for (int k = -MAX_SUPPORT; k <= MAX_SUPPORT; k++)
+    {
+        double c = kernelValue(kernel, support, k / (support / 2.0));
+        sum += c;
+        for (int x = 0; x < size; x++)
+            t[x] += c * cos(2 * M_PI * k * (x - size / 2) / size);
+    }
+    for (int x = 0; x < size; x++)
+        t[x] /= sum;
+    return t;
+}
+
+bool UVGrid::dirtyImage(const double *grid, double *image) const
+{
+#ifdef HAVE_FFTW3
+    size_t len = static_cast<size_t>(width) * height;
+    fftw_complex *buf = fftw_alloc_complex(len);
+    if (buf == nullptr)
+        return false;
+    fftw_plan plan;
+    {
+        std::lock_guard<std::mutex> lock(planner);
+        plan = fftw_plan_dft_2d(height, width, buf, buf, FFTW_BACKWARD, FFTW_ESTIMATE);
+    }
+
+    // The grid centre goes to the origin, and back to the image centre after the transform
+    auto origin = [this](int x, int y)
+    {
+        return static_cast<size_t>((y + height - height / 2) % height) * width + (x + width - width / 2) % width;
+    };
+    double total = 0;
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            size_t z = origin(x, y);
+            buf[z][0] = grid[static_cast<size_t>(y) * width + x];
+            buf[z][1] = 0;
+            total += buf[z][0];
+        }
+    }
+    fftw_execute(plan);
+
+    std::vector<double> tx = taper(width), ty = taper(height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            double t = tx[x] * ty[y];
+            double value = buf[origin(x, y)][0] / (total != 0 ? total : 1);
+            image[static_cast<size_t>(y) * width + x] = fabs(t) > 1e-3 ? value / t : 0;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(planner);
+        fftw_destroy_plan(plan);
+    }
+    fftw_free(buf);
+    return true;
+#else
+    (void)grid;
+    (void)image;
+    return false;
+#endif
+}
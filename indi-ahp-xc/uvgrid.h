@@ -0,0 +1,143 @@
+/*
+    indi_interferometer - a telescope array driver for INDI
+    Support for AHP cross-correlators
+    Copyright (C) 2020  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The UVGrid class accumulates visibilities onto a regular UV plane.
+ *
+ * Each visibility is spread over support x support cells with a separable anti-aliasing kernel,
+ * read from an oversampled lookup table, and its conjugate is gridded at the opposite position.
+ * Visibilities are queued in batches to a pool of workers, each with its own padded grid, so the
+ * inner loops need no bounds checks and the workers never contend on the cells.
+ */
+class UVGrid
+{
+  public:
+    typedef enum
+    {
+        NEAREST = 0,
+        KAISER_BESSEL,
+        PROLATE_SPHEROIDAL,
+    } Kernel;
+
+    // Widest kernel, the inner loops always run this many cells
+    static const int MAX_SUPPORT = 8;
+
+    UVGrid() = default;
+    ~UVGrid();
+
+    /**
+     * @brief setup Build the kernel table, allocate the grids and start the workers. Does
+     * nothing if the configuration did not change.
+     * @param width Grid width in cells, u = 0 is at width / 2.
+     * @param height Grid height in cells, v = 0 is at height / 2.
+     * @param kernel Gridding kernel, NEAREST always has a support of one cell.
+     * @param support Kernel width in cells, up to MAX_SUPPORT.
+     * @param workers Number of worker threads, 0 for one per spare core.
+     */
+    bool setup(int width, int height, Kernel kernel, int support, int workers = 0);
+
+    /** @brief stop Join the workers and free the grids. */
+    void stop();
+
+    /** @brief reset Drop everything gridded so far. */
+    void reset();
+
+    /**
+     * @brief add Queue a visibility and its conjugate. Visibilities falling outside the grid
+     * are dropped. Call from a single thread.
+     * @param u,v Position in cells from the grid centre.
+     */
+    void add(double u, double v, double value);
+
+    /** @brief finish Wait for the queued visibilities and write the summed grid, row by row, then reset. */
+    void finish(double *grid);
+
+    /**
+     * @brief dirtyImage Inverse transform a grid written by finish() into an image, with the
+     * kernel taper divided out. Only available when built with FFTW.
+     */
+    bool dirtyImage(const double *grid, double *image) const;
+
+    /** @brief kernelValue Kernel at nu, the distance from its centre in units of half the support. */
+    static double kernelValue(Kernel kernel, int support, double nu);
+
+    int getWidth() const
+    {
+        return width;
+    }
+    int getHeight() const
+    {
+        return height;
+    }
+    int getSupport() const
+    {
+        return support;
+    }
+
+  private:
+    // Position in grid cells, from the first cell
+    typedef struct Visibility
+    {
+        double x, y, value;
+    } Visibility;
+    typedef std::vector<Visibility> Batch;
+
+    typedef struct Worker
+    {
+        std::thread thread;
+        std::vector<double> grid;
+    } Worker;
+
+    void workerLoop(Worker *worker);
+    void accumulate(Worker *worker, const Batch &batch);
+    const double *weights(double position, int *first) const;
+    std::vector<double> taper(int size) const;
+    void dispatch();
+
+    int width { 0 };
+    int height { 0 };
+    Kernel kernel { NEAREST };
+    int support { 0 };
+    // Worker grids have this many spare cells around, and this many per row
+    int padding { 0 };
+    int stride { 0 };
+    // Normalised kernel weights, MAX_SUPPORT per row, by sub-cell offset
+    std::vector<double> table;
+
+    // Producer state
+    Batch batch;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex mutex;
+    std::condition_variable queued, done;
+    std::deque<Batch> jobs;
+    std::vector<Batch> spare;
+    int busy { 0 };
+    bool running { false };
+};
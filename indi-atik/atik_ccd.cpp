@@ -986,6 +986,29 @@ bool ATIKCCD::StartExposure(float duration)
     PrimaryCCD.setExposureDuration(duration);
     ExposureRequest = duration;
 
+    // The SDK downloads every frame into the buffer the previous frame may still be sent from,
+    // so the camera is only armed once that frame is released, see releaseSDKFrame()
+    {
+        std::lock_guard<std::mutex> lock(m_SDKFrameMutex);
+        if (m_SDKFrameRefs > 0)
+        {
+            LOG_DEBUG("Previous frame is still being sent, exposure starts once it is released.");
+            m_SDKStartPending = true;
+            InExposure = true;
+            return true;
+        }
+    }
+
+    return armExposure();
+}
+
+/////////////////////////////////////////////////////////
+/// Arm the camera for ExposureRequest
+/////////////////////////////////////////////////////////
+bool ATIKCCD::armExposure()
+{
+    float duration = ExposureRequest;
+
     // Camera needs to be in idle state to start exposure after previous abort
     int maxWaitCount = 1000; // 1000 * 0.1s = 100s
     while (ArtemisCameraState(hCam) != CAMERA_IDLE && --maxWaitCount > 0)
@@ -1045,6 +1068,10 @@ bool ATIKCCD::StartExposure(float duration)
 bool ATIKCCD::AbortExposure()
 {
     LOG_DEBUG("Aborting camera exposure...");
+    {
+        std::lock_guard<std::mutex> lock(m_SDKFrameMutex);
+        m_SDKStartPending = false;
+    }
     pthread_mutex_lock(&condMutex);
     threadRequest = StateAbort;
     pthread_cond_signal(&cv);
@@ -1114,17 +1141,55 @@ bool ATIKCCD::grabImage()
         PrimaryCCD.setFrameBufferSize(bufferSize, false);
     }
 
+    // Zero copy: the SDK buffer is swapped in as the frame buffer for as long as INDI uses it
+    uint8_t *image = reinterpret_cast<uint8_t*>(ArtemisImageBuffer(hCam));
+    if (image == nullptr)
+        return false;
+    acquireSDKFrame();
     std::unique_lock<std::mutex> guard(ccdBufferLock);
-    PrimaryCCD.setFrameBuffer(reinterpret_cast<uint8_t*>(ArtemisImageBuffer(hCam)));
+    PrimaryCCD.setFrameBuffer(image);
     guard.unlock();
 
     if (ExposureRequest > VERBOSE_EXPOSURE)
         LOG_INFO("Download complete.");
 
+    // Returns once the frame is processed and its BLOB sent
     ExposureComplete(&PrimaryCCD);
+
+    guard.lock();
+    PrimaryCCD.setFrameBuffer(nullptr);
+    guard.unlock();
+    releaseSDKFrame();
     return true;
 }
 
+/////////////////////////////////////////////////////////
+/// SDK image buffer lifetime tracking
+/////////////////////////////////////////////////////////
+void ATIKCCD::acquireSDKFrame()
+{
+    std::lock_guard<std::mutex> lock(m_SDKFrameMutex);
+    m_SDKFrameRefs++;
+}
+
+void ATIKCCD::releaseSDKFrame()
+{
+    std::unique_lock<std::mutex> lock(m_SDKFrameMutex);
+    if (m_SDKFrameRefs > 0)
+        m_SDKFrameRefs--;
+    if (m_SDKFrameRefs > 0 || !m_SDKStartPending)
+        return;
+    m_SDKStartPending = false;
+    lock.unlock();
+
+    // An exposure requested while the frame was in flight
+    if (!armExposure())
+    {
+        InExposure = false;
+        PrimaryCCD.setExposureFailed();
+    }
+}
+
 /////////////////////////////////////////////////////////
 /// Cooler & Filter Wheel monitoring
 /////////////////////////////////////////////////////////
@@ -26,6 +26,8 @@
 #include <indifilterinterface.h>
 #include <indiccd.h>
 
+#include <mutex>
+
 class ATIKCCD : public INDI::CCD, public INDI::FilterInterface
 {
     public:
@@ -133,6 +135,13 @@ class ATIKCCD : public INDI::CCD, public INDI::FilterInterface
 
         // Retrieve image from SDK
         bool grabImage();
+        bool armExposure();
+
+        // The frame handed to INDI is the SDK image buffer itself, swapped in as the frame buffer
+        // until ExposureComplete has sent it. An exposure requested meanwhile is only armed once
+        // the frame is released, so the SDK never downloads over a frame that is in flight.
+        void acquireSDKFrame();
+        void releaseSDKFrame();
 
         /**
          * @brief setupParams get initial camera parameters
@@ -246,6 +255,11 @@ class ATIKCCD : public INDI::CCD, public INDI::FilterInterface
         pthread_mutex_t condMutex = PTHREAD_MUTEX_INITIALIZER;
         pthread_mutex_t accessMutex = PTHREAD_MUTEX_INITIALIZER;
 
+        // SDK image buffer lifetime
+        std::mutex m_SDKFrameMutex;
+        int m_SDKFrameRefs {0};
+        bool m_SDKStartPending {false};
+
         // Pulse Guiding
         int WEtimerID;
         int NStimerID;
@@ -0,0 +1,322 @@
+/*
+    Celestron AUX bus multiplexer
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "auxbus.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+AUXBus::~AUXBus()
+{
+    stop();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+bool AUXBus::start(int fd, uint32_t lineRate)
+{
+    stop();
+    if (fd <= 0)
+        return false;
+
+    m_FD = fd;
+    m_RX.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Requests.clear();
+        m_Unsolicited.clear();
+        m_Stats = Statistics();
+        m_Stats.lineRate = lineRate;
+        m_StatsStart = Clock::now();
+    }
+
+    m_Running = true;
+    m_Reader = std::thread(&AUXBus::readerLoop, this);
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXBus::stop()
+{
+    m_Running = false;
+    if (m_Reader.joinable())
+        m_Reader.join();
+    m_Replied.notify_all();
+    m_FD = -1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXBus::expect(const AUXCommand &command)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    expireRequests();
+
+    Request request;
+    request.source      = command.source();
+    request.destination = command.destination();
+    request.command     = command.command();
+    request.sent        = Clock::now();
+    request.done        = false;
+    m_Requests.push_back(request);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+bool AUXBus::write(const AUXBuffer &buf)
+{
+    std::lock_guard<std::mutex> lock(m_WriteMutex);
+    size_t written = 0;
+
+    while (m_Running && written < buf.size())
+    {
+        ssize_t n = ::write(m_FD, buf.data() + written, buf.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+
+            struct pollfd pfd = { m_FD, POLLOUT, 0 };
+            if (poll(&pfd, 1, 1000) <= 0)
+                return false;
+            continue;
+        }
+        written += n;
+    }
+
+    std::lock_guard<std::mutex> statsLock(m_Mutex);
+    m_Stats.bytesSent += written;
+    return written == buf.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+bool AUXBus::waitReply(const AUXCommand &command, AUXCommand &reply, int timeoutMS)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    auto find = [&]()
+    {
+        for (auto it = m_Requests.begin(); it != m_Requests.end(); ++it)
+            if (it->source == command.source() && it->destination == command.destination() && it->command == command.command())
+                return it;
+        return m_Requests.end();
+    };
+
+    bool replied = m_Replied.wait_for(lock, std::chrono::milliseconds(timeoutMS), [&]()
+    {
+        auto it = find();
+        return !m_Running || it == m_Requests.end() || it->done;
+    });
+
+    auto it = find();
+    if (it == m_Requests.end())
+        return false;
+
+    bool ok = replied && it->done;
+    if (ok)
+        reply = it->reply;
+    else
+        m_Stats.timeouts++;
+    m_Requests.erase(it);
+    return ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+bool AUXBus::popUnsolicited(AUXCommand &frame)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    expireRequests();
+    if (m_Unsolicited.empty())
+        return false;
+    frame = m_Unsolicited.front();
+    m_Unsolicited.pop_front();
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+AUXBus::Statistics AUXBus::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Statistics stats = m_Stats;
+    stats.elapsedMS = std::chrono::duration<double, std::milli>(Clock::now() - m_StatsStart).count();
+    return stats;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXBus::resetStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    double lineRate = m_Stats.lineRate;
+    m_Stats = Statistics();
+    m_Stats.lineRate = lineRate;
+    m_StatsStart = Clock::now();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/// Runs in the reader thread
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXBus::readerLoop()
+{
+    uint8_t buf[256];
+
+    while (m_Running)
+    {
+        struct pollfd pfd = { m_FD, POLLIN, 0 };
+        int rc = poll(&pfd, 1, 100);
+        if (rc < 0 && errno != EINTR)
+            break;
+        if (rc <= 0)
+            continue;
+
+        ssize_t n = ::read(m_FD, buf, sizeof(buf));
+        if (n < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+                continue;
+            break;
+        }
+        // Socket closed by the mount
+        if (n == 0)
+            break;
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.bytesReceived += n;
+        }
+        m_RX.insert(m_RX.end(), buf, buf + n);
+        parseFrames();
+    }
+
+    // Wake up any waiter, the link is gone
+    m_Running = false;
+    m_Replied.notify_all();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/// Frame: 0x3b <len> <src> <dst> <cmd> <len-3 data bytes> <checksum>
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXBus::parseFrames()
+{
+    size_t i = 0;
+
+    while (i < m_RX.size())
+    {
+        if (m_RX[i] != 0x3b)
+        {
+            i++;
+            continue;
+        }
+        if (m_RX.size() - i < 2)
+            break;
+
+        size_t len = m_RX[i + 1];
+        if (len < 3)
+        {
+            i++;
+            continue;
+        }
+        if (m_RX.size() - i < len + 3)
+            break;
+
+        int cs = 0;
+        for (size_t j = i + 1; j < i + len + 2; j++)
+            cs += m_RX[j];
+        if (static_cast<uint8_t>((~cs + 1) & 0xFF) != m_RX[i + len + 2])
+        {
+            // Not a frame after all, resynchronise on the next preamble
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stats.checksumErrors++;
+            i++;
+            continue;
+        }
+
+        route(AUXBuffer(m_RX.begin() + i, m_RX.begin() + i + len + 3));
+        i += len + 3;
+    }
+
+    m_RX.erase(m_RX.begin(), m_RX.begin() + i);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXBus::route(const AUXBuffer &frame)
+{
+    AUXCommand cmd(frame);
+
+    // Our own command echoed by the bus
+    if (cmd.source() == APP)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (auto &request : m_Requests)
+        {
+            if (!request.done && request.destination == cmd.source() && request.source == cmd.destination()
+                    && request.command == cmd.command())
+            {
+                request.done  = true;
+                request.reply = cmd;
+                m_Stats.replies++;
+                m_Stats.totalReplyMS += std::chrono::duration<double, std::milli>(Clock::now() - request.sent).count();
+                m_Replied.notify_all();
+                return;
+            }
+        }
+
+        if (m_Unsolicited.size() >= MAX_UNSOLICITED)
+            m_Unsolicited.pop_front();
+        m_Unsolicited.push_back(cmd);
+        m_Stats.unsolicited++;
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/// Called with m_Mutex held. Requests sent without waiting for the reply would otherwise
+/// accumulate: their replies go to the driver thread like any other frame.
+/////////////////////////////////////////////////////////////////////////////////////
+void AUXBus::expireRequests()
+{
+    auto now = Clock::now();
+    while (!m_Requests.empty() && now - m_Requests.front().sent > std::chrono::milliseconds(EXPIRE_MS))
+    {
+        if (m_Requests.front().done && m_Unsolicited.size() < MAX_UNSOLICITED)
+            m_Unsolicited.push_back(m_Requests.front().reply);
+        m_Requests.pop_front();
+    }
+}
@@ -0,0 +1,141 @@
+/*
+    Celestron AUX bus multiplexer
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include "auxproto.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief The AUXBus class reads AUX frames continuously from a serial port or a socket and routes
+ * each reply to the request waiting for it.
+ *
+ * Replies are matched on source, destination and command, oldest request first, so independent
+ * commands (e.g. AZM and ALT position queries) can be written back to back and their replies
+ * collected afterwards. Frames that do not answer a pending request, such as GPS queries from the
+ * hand controller, are queued for the driver thread. Echoes of our own commands are dropped.
+ *
+ * Only usable on links that carry complete AUX frames in both directions: not with the PC port
+ * RTS/CTS handshake, nor through the hand controller passthrough.
+ */
+class AUXBus
+{
+    public:
+        typedef struct Statistics
+        {
+            uint64_t bytesSent {0};
+            uint64_t bytesReceived {0};
+            uint64_t replies {0};           // Frames routed to a request
+            uint64_t unsolicited {0};       // Frames passed to the driver thread
+            uint64_t checksumErrors {0};
+            uint64_t timeouts {0};
+            double totalReplyMS {0};        // Sum of request to reply delays
+            double elapsedMS {0};           // Since the statistics were reset
+            double lineRate {0};            // bits/s
+
+            /** @return fraction of the time the half-duplex bus was transmitting, 10 bits per byte. */
+            double utilisation() const
+            {
+                return (elapsedMS > 0 && lineRate > 0) ? (bytesSent + bytesReceived) * 10.0 / lineRate / (elapsedMS / 1000.0) : 0;
+            }
+            double averageReplyMS() const
+            {
+                return replies ? totalReplyMS / replies : 0;
+            }
+        } Statistics;
+
+        AUXBus() = default;
+        ~AUXBus();
+
+        /**
+         * @brief start Start the reader thread.
+         * @param fd Open serial port or connected socket.
+         * @param lineRate Bus line rate in bits/s, only used for the statistics.
+         */
+        bool start(int fd, uint32_t lineRate);
+        void stop();
+        bool isRunning() const
+        {
+            return m_Running;
+        }
+
+        /**
+         * @brief expect Register command as waiting for a reply. Must be called before the command is
+         * written so that a fast reply can not be missed.
+         */
+        void expect(const AUXCommand &command);
+
+        /** @brief write Write a complete frame to the link. */
+        bool write(const AUXBuffer &buf);
+
+        /**
+         * @brief waitReply Wait for the reply to a command registered with expect().
+         * @param timeoutMS Maximum wait in milliseconds.
+         * @return true with the reply filled in, false on timeout or if the link failed.
+         */
+        bool waitReply(const AUXCommand &command, AUXCommand &reply, int timeoutMS);
+
+        /** @brief popUnsolicited Retrieve a frame that did not answer one of our requests. */
+        bool popUnsolicited(AUXCommand &frame);
+
+        Statistics getStatistics();
+        void resetStatistics();
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+        typedef struct Request
+        {
+            AUXTargets source, destination;
+            AUXCommands command;
+            Clock::time_point sent;
+            bool done;
+            AUXCommand reply;
+        } Request;
+
+        void readerLoop();
+        void parseFrames();
+        void route(const AUXBuffer &frame);
+        void expireRequests();
+
+        int m_FD {-1};
+        std::atomic<bool> m_Running {false};
+        std::thread m_Reader;
+        std::mutex m_WriteMutex;
+
+        // Protected by m_Mutex
+        std::mutex m_Mutex;
+        std::condition_variable m_Replied;
+        std::deque<Request> m_Requests;
+        std::deque<AUXCommand> m_Unsolicited;
+        Statistics m_Stats;
+        Clock::time_point m_StatsStart;
+
+        // Reader thread only
+        AUXBuffer m_RX;
+
+        // Replies nobody waited for are handed to the driver thread after this delay
+        static constexpr int EXPIRE_MS {5000};
+        static constexpr size_t MAX_UNSOLICITED {64};
+};
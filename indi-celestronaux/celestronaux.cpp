@@ -36,6 +36,7 @@
 #include <alignment/DriverCommon.h>
 #include "celestronaux.h"
 #include "config.h"
+#include "trackingrates.h"
 
 #define DEBUG_PID
 
@@ -149,6 +150,8 @@ bool CelestronAUX::Handshake()
         else
             std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
+        startAUXBus();
+
         // read firmware version, if read ok, detected scope
         LOG_DEBUG("Communicating with mount motor controllers...");
         if (getVersion(AZM) && getVersion(ALT))
@@ -159,6 +162,7 @@ bool CelestronAUX::Handshake()
         {
             LOG_ERROR("Got no response from target ALT or AZM.");
             LOG_ERROR("Cannot continue without connection to motor controllers.");
+            m_Bus.stop();
             return false;
         }
 
@@ -192,6 +196,9 @@ bool CelestronAUX::Handshake()
 bool CelestronAUX::Disconnect()
 {
     Abort();
+    if (m_Bus.isRunning())
+        updateAUXBusStatistics();
+    m_Bus.stop();
     return INDI::Telescope::Disconnect();
 }
 
@@ -376,6 +383,13 @@ bool CelestronAUX::initProperties()
     AngleNP[AXIS_ALT].fill("AXIS_ALT", "Axis 2", "%.2f", -90, 90, 0, 0);
     AngleNP.fill(getDeviceName(), "TELESCOPE_ENCODER_ANGLES", "Angles", MOUNTINFO_TAB, IP_RO, 60, IPS_IDLE);
 
+    // AUX bus load, over the last BUS_STATS_INTERVAL, pipelined command mode only
+    AUXBusNP[AUX_BUS_UTILISATION].fill("UTILISATION", "Utilisation (%)", "%.1f", 0, 100, 0, 0);
+    AUXBusNP[AUX_BUS_REPLY_MS].fill("REPLY_MS", "Avg reply (ms)", "%.1f", 0, 10000, 0, 0);
+    AUXBusNP[AUX_BUS_TIMEOUTS].fill("TIMEOUTS", "Timeouts", "%.f", 0, 1e9, 0, 0);
+    AUXBusNP[AUX_BUS_CHECKSUM_ERRORS].fill("CHECKSUM_ERRORS", "Checksum errors", "%.f", 0, 1e9, 0, 0);
+    AUXBusNP.fill(getDeviceName(), "AUX_BUS_STATISTICS", "AUX Bus", MOUNTINFO_TAB, IP_RO, 60, IPS_IDLE);
+
     // PID Control
     Axis1PIDNP[Propotional].fill("Propotional", "Propotional", "%.2f", 0, 500, 10, 0);
     Axis1PIDNP[Derivative].fill("Derivative", "Derivative", "%.2f", 0, 500, 10, 0);
@@ -535,6 +549,8 @@ bool CelestronAUX::updateProperties()
         // Encoders
         defineProperty(EncoderNP);
         defineProperty(AngleNP);
+        if (m_Bus.isRunning())
+            defineProperty(AUXBusNP);
         if (m_MountType == ALT_AZ)
         {
             defineProperty(Axis1PIDNP);
@@ -698,6 +714,7 @@ bool CelestronAUX::updateProperties()
 
         deleteProperty(EncoderNP.getName());
         deleteProperty(AngleNP.getName());
+        deleteProperty(AUXBusNP.getName());
 
         if (m_MountType == ALT_AZ)
         {
@@ -764,6 +781,8 @@ bool CelestronAUX::ISNewBLOB(const char *dev, const char *name, int sizes[], int
     {
         // Process alignment properties
         ProcessAlignmentBLOBProperties(this, name, sizes, blobsizes, blobs, formats, names, n);
+        if (strstr(name, "ALIGNMENT"))
+            m_TrackingJacobianValid = false;
     }
     // Pass it up the chain
     return INDI::Telescope::ISNewBLOB(dev, name, sizes, blobsizes, blobs, formats, names, n);
@@ -885,6 +904,8 @@ bool CelestronAUX::ISNewNumber(const char *dev, const char *name, double values[
 
         // Process Alignment Properties
         ProcessAlignmentNumberProperties(this, name, values, names, n);
+        if (strstr(name, "ALIGNMENT"))
+            m_TrackingJacobianValid = false;
 
     }
 
@@ -1058,6 +1079,8 @@ bool CelestronAUX::ISNewSwitch(const char *dev, const char *name, ISState *state
 
         // Process alignment properties
         ProcessAlignmentSwitchProperties(this, name, states, names, n);
+        if (strstr(name, "ALIGNMENT"))
+            m_TrackingJacobianValid = false;
 
         // Process Focus Properties
         if (strstr(name, "FOCUS_"))
@@ -1076,7 +1099,11 @@ bool CelestronAUX::ISNewSwitch(const char *dev, const char *name, ISState *state
 bool CelestronAUX::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
 {
     if (!strcmp(dev, getDeviceName()))
+    {
         ProcessAlignmentTextProperties(this, name, texts, names, n);
+        if (strstr(name, "ALIGNMENT"))
+            m_TrackingJacobianValid = false;
+    }
 
     return INDI::Telescope::ISNewText(dev, name, texts, names, n);
 }
@@ -1286,7 +1313,8 @@ bool CelestronAUX::guidePulse(INDI_EQ_AXIS axis, uint32_t ms, int8_t rate)
             m_GuideDETimer.start(ticks * 10);
         else
             m_GuideRATimer.start(ticks * 10);
-        return sendAUXCommand(cmd);
+        // The acknowledgement is never read, MC_AUX_GUIDE_ACTIVE tells when the pulse is over
+        return sendAUXCommand(cmd, false);
     }
     // For Alt-Az mounts in tracking state, add to guide delta
     else if (TrackState == SCOPE_TRACKING)
@@ -1357,6 +1385,55 @@ void CelestronAUX::resetTracking()
     m_Controllers[AXIS_ALT]->setIntegratorLimits(-10000, 10000);
     m_TrackingElapsedTimer.restart();
     m_GuideOffset[AXIS_AZ] = m_GuideOffset[AXIS_ALT] = 0;
+    m_TrackingJacobianValid = false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+/// See trackingrates.h for the geometry.
+/////////////////////////////////////////////////////////////////////////////////////
+void CelestronAUX::predictTrackingRates(const INDI::IHorizontalCoordinates &skyAltAz,
+                                        const INDI::IHorizontalCoordinates &mountAltAz, double rates[2])
+{
+    double v[3], sky[3], mount[3], m[3];
+
+    TrackingRates::horizontalToVector(skyAltAz.azimuth, skyAltAz.altitude, v);
+    TrackingRates::skyMotion(m_Location.latitude, v, sky);
+
+    // Without a Jacobian the mount follows the sky directly
+    for (int i = 0; i < 3; i++)
+        mount[i] = m_TrackingJacobianValid ?
+                   m_TrackingJacobian[i][0] * sky[0] + m_TrackingJacobian[i][1] * sky[1] + m_TrackingJacobian[i][2] * sky[2] : sky[i];
+
+    TrackingRates::horizontalToVector(mountAltAz.azimuth, mountAltAz.altitude, m);
+    TrackingRates::mountRates(m, mount, TRACKRATE_SIDEREAL / 3600.0, rates);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+bool CelestronAUX::updateTrackingJacobian(const INDI::IHorizontalCoordinates &skyAltAz, double JD)
+{
+    auto toMount = [&](const double * direction, double * mount)
+    {
+        INDI::IHorizontalCoordinates sky { 0, 0 }, mountAltAz { 0, 0 };
+        INDI::IEquatorialCoordinates equatorial { 0, 0 };
+        TelescopeDirectionVector TDV;
+        sky.azimuth  = range360(std::atan2(direction[1], direction[0]) * 180 / M_PI);
+        sky.altitude = std::atan2(direction[2], std::hypot(direction[0], direction[1])) * 180 / M_PI;
+        INDI::HorizontalToEquatorial(&sky, &m_Location, JD, &equatorial);
+        if (!TransformCelestialToTelescope(equatorial.rightascension, equatorial.declination, 0, TDV))
+            return false;
+        AltitudeAzimuthFromTelescopeDirectionVector(TDV, mountAltAz);
+        TrackingRates::horizontalToVector(mountAltAz.azimuth, mountAltAz.altitude, mount);
+        return true;
+    };
+
+    if (!TrackingRates::jacobian(skyAltAz.azimuth, skyAltAz.altitude, TRACKING_JACOBIAN_STEP, toMount, m_TrackingJacobian))
+        return false;
+
+    m_TrackingJacobianAltAz = skyAltAz;
+    m_TrackingJacobianTarget = m_SkyTrackingTarget;
+    return true;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -1375,26 +1452,20 @@ bool CelestronAUX::ReadScopeStatus()
     if (!isConnected())
         return false;
 
-    if (!getStatus(AXIS_AZ))
-        return false;
-    if (!getStatus(AXIS_ALT))
-        return false;
-
     double axis1 = EncoderNP[AXIS_AZ].getValue();
     double axis2 = EncoderNP[AXIS_ALT].getValue();
 
-    if (!getEncoder(AXIS_AZ))
-    {
-        if (EncoderNP.getState() != IPS_ALERT)
-        {
-            EncoderNP.setState(IPS_ALERT);
-            AngleNP.setState(IPS_ALERT);
-            EncoderNP.apply();
-            AngleNP.apply();
-        }
+    // Status and position queries for both axes are independent. In a batch the queries are
+    // only sent, their replies are collected and checked by endAUXBatch().
+    beginAUXBatch();
+    bool statusOK  = getStatus(AXIS_AZ) && getStatus(AXIS_ALT);
+    bool encoderOK = statusOK && getEncoder(AXIS_AZ) && getEncoder(AXIS_ALT);
+    bool ok = endAUXBatch();
+
+    if (!statusOK)
         return false;
-    }
-    if (!getEncoder(AXIS_ALT))
+
+    if (!encoderOK || !ok)
     {
         if (EncoderNP.getState() != IPS_ALERT)
         {
@@ -1850,6 +1921,9 @@ void CelestronAUX::TimerHit()
 {
     INDI::Telescope::TimerHit();
 
+    if (m_Bus.isRunning() && m_BusStatsTimer.elapsed() >= BUS_STATS_INTERVAL)
+        updateAUXBusStatistics();
+
     if(!enforceSlewLimits())
         return;
 
@@ -1880,13 +1954,12 @@ void CelestronAUX::TimerHit()
             else if (m_MountType == ALT_AZ)
             {
                 TelescopeDirectionVector TDV;
-                TelescopeDirectionVector futureTDV;
-                TelescopeDirectionVector pastTDV;
                 INDI::IHorizontalCoordinates targetMountAxisCoordinates { 0, 0 };
-                INDI::IHorizontalCoordinates pastMountAxisCoordinates { 0, 0 };
-                INDI::IHorizontalCoordinates futureMountAxisCoordinates { 0, 0 };
-                double timeStep { 5.0 }; // time step for tracking rate estimation in seconds
-                double JDoffset { timeStep / (60 * 60 * 24) } ; // The same in days
+                INDI::IHorizontalCoordinates skyAltAz { 0, 0 };
+                double JDnow {ln_get_julian_from_sys()};
+
+                // Apparent position of the target, the tracking rates follow from it analytically.
+                INDI::EquatorialToHorizontal(&m_SkyTrackingTarget, &m_Location, JDnow, &skyAltAz);
 
                 // Start by transforming tracking target celestial coordinates to telescope coordinates.
                 if (TransformCelestialToTelescope(m_SkyTrackingTarget.rightascension, m_SkyTrackingTarget.declination,
@@ -1894,40 +1967,29 @@ void CelestronAUX::TimerHit()
                 {
                     // If mount is Alt-Az then that's all we need to do
                     AltitudeAzimuthFromTelescopeDirectionVector(TDV, targetMountAxisCoordinates);
-                    TransformCelestialToTelescope(m_SkyTrackingTarget.rightascension, m_SkyTrackingTarget.declination,
-                                                  JDoffset, futureTDV);
-                    AltitudeAzimuthFromTelescopeDirectionVector(futureTDV, futureMountAxisCoordinates);
-                    TransformCelestialToTelescope(m_SkyTrackingTarget.rightascension, m_SkyTrackingTarget.declination,
-                                                  -JDoffset, pastTDV);
-                    AltitudeAzimuthFromTelescopeDirectionVector(pastTDV, pastMountAxisCoordinates);
 
+                    // Refresh the local alignment Jacobian if the model changed or the target moved.
+                    double moved = std::hypot(skyAltAz.altitude - m_TrackingJacobianAltAz.altitude,
+                                              range180(skyAltAz.azimuth - m_TrackingJacobianAltAz.azimuth) * std::cos(skyAltAz.altitude * M_PI / 180));
+                    if (!m_TrackingJacobianValid || moved > TRACKING_JACOBIAN_REFRESH ||
+                            m_TrackingJacobianTarget.rightascension != m_SkyTrackingTarget.rightascension ||
+                            m_TrackingJacobianTarget.declination != m_SkyTrackingTarget.declination)
+                        m_TrackingJacobianValid = updateTrackingJacobian(skyAltAz, JDnow);
                 }
                 // If transformation failed.
                 else
                 {
-                    double JDnow {ln_get_julian_from_sys()};
-                    INDI::IEquatorialCoordinates EquatorialCoordinates { 0, 0 };
-                    EquatorialCoordinates.rightascension  = m_SkyTrackingTarget.rightascension;
-                    EquatorialCoordinates.declination = m_SkyTrackingTarget.declination;
-                    INDI::EquatorialToHorizontal(&EquatorialCoordinates, &m_Location, JDnow, &targetMountAxisCoordinates);
-                    INDI::EquatorialToHorizontal(&EquatorialCoordinates, &m_Location, JDnow + JDoffset, &futureMountAxisCoordinates);
-                    INDI::EquatorialToHorizontal(&EquatorialCoordinates, &m_Location, JDnow - JDoffset, &pastMountAxisCoordinates);
+                    targetMountAxisCoordinates = skyAltAz;
+                    m_TrackingJacobianValid = false;
                 }
 
-
                 // Calculate expected tracking rates
-                double predRate[2] = {0, 0};
-                // Central difference, error quadratic in timestep
                 // Rates in deg/s
-                predRate[AXIS_AZ] = range180(AzimuthToDegrees(futureMountAxisCoordinates.azimuth - pastMountAxisCoordinates.azimuth)) /
-                                    timeStep / 2;
-                predRate[AXIS_ALT] = (futureMountAxisCoordinates.altitude - pastMountAxisCoordinates.altitude) / timeStep / 2;
-
-                LOGF_DEBUG("Predicted positions (AZ):  %9.4f  %9.4f (now, future, degs)",
-                           AzimuthToDegrees(targetMountAxisCoordinates.azimuth),
-                           AzimuthToDegrees(futureMountAxisCoordinates.azimuth)) ;
-                LOGF_DEBUG("Predicted positions (AL):  %9.4f  %9.4f (now, future, degs)", targetMountAxisCoordinates.altitude,
-                           futureMountAxisCoordinates.altitude);
+                double predRate[2] = {0, 0};
+                predictTrackingRates(skyAltAz, targetMountAxisCoordinates, predRate);
+
+                LOGF_DEBUG("Predicted position (AZ, AL):  %9.4f  %9.4f (degs)",
+                           AzimuthToDegrees(targetMountAxisCoordinates.azimuth), targetMountAxisCoordinates.altitude);
                 LOGF_DEBUG("Predicted Rates (AZ, ALT): %9.4f  %9.4f (arcsec/s)", 3600 * predRate[AXIS_AZ], 3600 * predRate[AXIS_ALT]);
 
                 // Rates in units 1024 * arcsec/s
@@ -1984,7 +2046,8 @@ void CelestronAUX::TimerHit()
                                trackRates[AXIS_AZ] - predRate[AXIS_AZ]);
 #endif
 
-                    // Set the tracking rate
+                    // Set the tracking rate, both axes in one batch
+                    beginAUXBatch();
                     trackByRate(AXIS_AZ, trackRates[AXIS_AZ]);
                 }
 
@@ -2012,6 +2075,24 @@ void CelestronAUX::TimerHit()
 #endif
                     trackByRate(AXIS_ALT, trackRates[AXIS_ALT]);
                 }
+                bool ok = endAUXBatch();
+
+                if (!ok)
+                {
+                    // Not acknowledged, send both rates again on the next tick
+                    m_LastTrackRate[AXIS_AZ] = m_LastTrackRate[AXIS_ALT] = -1;
+                    if (TrackStateSP.getState() != IPS_ALERT)
+                    {
+                        LOG_WARN("Mount did not acknowledge the tracking rates.");
+                        TrackStateSP.setState(IPS_ALERT);
+                        TrackStateSP.apply();
+                    }
+                }
+                else if (TrackStateSP.getState() == IPS_ALERT)
+                {
+                    TrackStateSP.setState(IPS_BUSY);
+                    TrackStateSP.apply();
+                }
                 break;
             }
             break;
@@ -2522,7 +2603,7 @@ bool CelestronAUX::setGuideRate(AUXTargets target, uint8_t rate)
     AUXBuffer data(1);
     data[0] = rate;
     AUXCommand cmd(MC_SET_AUTOGUIDE_RATE, APP, target, data);
-    if (! sendAUXCommand(cmd))
+    if (! sendAUXCommand(cmd, false))
         return false;
     return true;
 }
@@ -3318,6 +3399,30 @@ bool CelestronAUX::tcpReadResponse()
 /////////////////////////////////////////////////////////////////////////////////////
 bool CelestronAUX::readAUXResponse(AUXCommand c)
 {
+    if (m_Bus.isRunning())
+    {
+        // Collected by endAUXBatch()
+        if (m_BatchActive)
+        {
+            m_BatchCommands.push_back(c);
+            return true;
+        }
+
+        AUXCommand reply;
+        bool rc = m_Bus.waitReply(c, reply, READ_TIMEOUT * 1000);
+
+        // Frames from other devices on the bus, e.g. GPS queries from the hand controller
+        AUXCommand frame;
+        while (m_Bus.popUnsolicited(frame))
+            processResponse(frame);
+
+        if (rc)
+            processResponse(reply);
+        else
+            DEBUGF(DBG_CAUX, "No reply to %s from %s.", c.commandName(), c.moduleName(c.destination()));
+        return rc;
+    }
+
     if (getActiveConnection() == serialConnection)
         return serialReadResponse(c);
     else
@@ -3329,7 +3434,20 @@ bool CelestronAUX::readAUXResponse(AUXCommand c)
 /////////////////////////////////////////////////////////////////////////////////////
 int CelestronAUX::sendBuffer(AUXBuffer buf)
 {
-    if ( PortFD > 0 )
+    if (m_Bus.isRunning())
+    {
+        if (!m_Bus.write(buf))
+        {
+            LOG_ERROR("CAUX::sendBuffer");
+            return 0;
+        }
+
+        char hexbuf[32 * 3] = {0};
+        hex_dump(hexbuf, buf, buf.size());
+        DEBUGF(DBG_SERIAL, "CMD <%s>", hexbuf);
+        return buf.size();
+    }
+    else if ( PortFD > 0 )
     {
         int n;
 
@@ -3355,11 +3473,22 @@ int CelestronAUX::sendBuffer(AUXBuffer buf)
 /////////////////////////////////////////////////////////////////////////////////////
 ///
 /////////////////////////////////////////////////////////////////////////////////////
-bool CelestronAUX::sendAUXCommand(AUXCommand &command)
+bool CelestronAUX::sendAUXCommand(AUXCommand &command, bool awaitReply)
 {
     AUXBuffer buf;
     command.logCommand();
 
+    if (m_Bus.isRunning())
+    {
+        command.fillBuf(buf);
+        // Register before writing, the reply may arrive before sendBuffer returns. A reply nobody
+        // waits for is not registered: it would otherwise answer the next waitReply on the same
+        // command in its place.
+        if (command.source() == APP && awaitReply)
+            m_Bus.expect(command);
+        return (sendBuffer(buf) == static_cast<int>(buf.size()));
+    }
+
     if (m_IsRTSCTS || !m_isHandController || getActiveConnection() != serialConnection)
         // Direct connection (AUX/PC/USB port)
         command.fillBuf(buf);
@@ -3389,6 +3518,82 @@ bool CelestronAUX::sendAUXCommand(AUXCommand &command)
 }
 
 
+/////////////////////////////////////////////////////////////////////////////////////
+/// The reader thread needs complete AUX frames in both directions. The PC port RTS/CTS
+/// handshake and the hand controller passthrough are strictly one command at a time,
+/// so they keep the synchronous path.
+/////////////////////////////////////////////////////////////////////////////////////
+void CelestronAUX::startAUXBus()
+{
+    uint32_t lineRate = 0;
+
+    if (getActiveConnection() != serialConnection)
+        lineRate = 19200;
+    else if (PortTypeSP[PORT_AUX_PC].getState() == ISS_ON && !m_IsRTSCTS)
+        lineRate = 19200;
+    else if (PortTypeSP[PORT_HC_USB].getState() == ISS_ON && !m_isHandController)
+        lineRate = 9600;
+
+    if (lineRate == 0)
+    {
+        m_Bus.stop();
+        LOG_DEBUG("AUX bus: synchronous command mode.");
+        return;
+    }
+
+    tcflush(PortFD, TCIOFLUSH);
+    if (m_Bus.start(PortFD, lineRate))
+    {
+        LOG_DEBUG("AUX bus: pipelined command mode.");
+        m_BusStatsTimer.start();
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void CelestronAUX::beginAUXBatch()
+{
+    m_BatchCommands.clear();
+    m_BatchActive = m_Bus.isRunning();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+bool CelestronAUX::endAUXBatch()
+{
+    if (!m_BatchActive)
+        return true;
+
+    m_BatchActive = false;
+    bool rc = true;
+    for (auto &command : m_BatchCommands)
+        rc = readAUXResponse(command) && rc;
+    m_BatchCommands.clear();
+    return rc;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+///
+/////////////////////////////////////////////////////////////////////////////////////
+void CelestronAUX::updateAUXBusStatistics()
+{
+    AUXBus::Statistics stats = m_Bus.getStatistics();
+    AUXBusNP[AUX_BUS_UTILISATION].setValue(stats.utilisation() * 100);
+    AUXBusNP[AUX_BUS_REPLY_MS].setValue(stats.averageReplyMS());
+    AUXBusNP[AUX_BUS_TIMEOUTS].setValue(stats.timeouts);
+    AUXBusNP[AUX_BUS_CHECKSUM_ERRORS].setValue(stats.checksumErrors);
+    AUXBusNP.setState((stats.timeouts || stats.checksumErrors) ? IPS_ALERT : IPS_OK);
+    AUXBusNP.apply();
+    LOGF_DEBUG("AUX bus: %.1f%% utilisation, %llu replies (avg %.1f ms), %llu timeouts, %llu unsolicited, %llu checksum errors.",
+               stats.utilisation() * 100, static_cast<unsigned long long>(stats.replies), stats.averageReplyMS(),
+               static_cast<unsigned long long>(stats.timeouts), static_cast<unsigned long long>(stats.unsolicited),
+               static_cast<unsigned long long>(stats.checksumErrors));
+    m_Bus.resetStatistics();
+    m_BusStatsTimer.start();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Wrap functions around the standard driver communication functions tty_read
 // and tty_write.
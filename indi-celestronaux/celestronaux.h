@@ -40,6 +40,7 @@
 #include <termios.h>
 
 #include "auxproto.h"
+#include "auxbus.h"
 
 class CelestronAUX :
     public INDI::Telescope,
@@ -195,6 +196,19 @@ class CelestronAUX :
         bool SetTrackRate(double raRate, double deRate) override;
         void resetTracking();
 
+        /**
+         * @brief predictTrackingRates Alt-Az rates of the sky tracking target in mount coordinates.
+         * The sky motion is the closed-form derivative of the target direction with respect to hour
+         * angle. It is mapped to the mount through a local Jacobian of the alignment transform, which
+         * is only refreshed when the model changes or the target moved.
+         * @param skyAltAz apparent position of the target now.
+         * @param mountAltAz position of the target in mount coordinates.
+         * @param rates filled with AZ and ALT rates in degrees/s.
+         */
+        void predictTrackingRates(const INDI::IHorizontalCoordinates &skyAltAz, const INDI::IHorizontalCoordinates &mountAltAz,
+                                  double rates[2]);
+        bool updateTrackingJacobian(const INDI::IHorizontalCoordinates &skyAltAz, double JD);
+
         /**
          * @brief TrackByRate Set axis tracking rate in arcsecs/sec.
          * @param axis AZ or ALT
@@ -305,13 +319,21 @@ class CelestronAUX :
         INDI::IHorizontalCoordinates m_MountCurrentAltAz {0, 0};
 
         INDI::ElapsedTimer m_TrackingElapsedTimer;
+
+        // Alignment transform linearised around m_TrackingJacobianAltAz, acting on direction vectors
+        // (north, east, zenith) so that it stays well conditioned near the zenith.
+        double m_TrackingJacobian[3][3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+        INDI::IHorizontalCoordinates m_TrackingJacobianAltAz {0, 0};
+        INDI::IEquatorialCoordinates m_TrackingJacobianTarget {0, 0};
+        bool m_TrackingJacobianValid {false};
         INDI::Timer m_GuideRATimer, m_GuideDETimer;
 
 
         /////////////////////////////////////////////////////////////////////////////////////
         /// Auxiliary Command Communication
         /////////////////////////////////////////////////////////////////////////////////////
-        bool sendAUXCommand(AUXCommand &command);
+        // awaitReply false for commands whose reply is never read with readAUXResponse
+        bool sendAUXCommand(AUXCommand &command, bool awaitReply = true);
         void closeConnection();
         void emulateGPS(AUXCommand &m);
         bool serialReadResponse(AUXCommand c);
@@ -319,6 +341,13 @@ class CelestronAUX :
         bool readAUXResponse(AUXCommand c);
         bool processResponse(AUXCommand &cmd);
         int sendBuffer(AUXBuffer buf);
+        // Between these calls, readAUXResponse only records the commands and endAUXBatch collects
+        // all replies, so that independent commands go out back to back on the bus.
+        void beginAUXBatch();
+        bool endAUXBatch();
+        void startAUXBus();
+        // Publish the bus statistics since the last call, then reset them
+        void updateAUXBusStatistics();
         void formatModelString(char *s, int n, uint16_t model);
         void formatVersionString(char *s, int n, uint8_t *verBuf);
 
@@ -373,6 +402,12 @@ class CelestronAUX :
         bool m_IsRTSCTS {false};
         bool m_isHandController {false};
 
+        // Reader thread and reply routing, only on links carrying whole AUX frames
+        AUXBus m_Bus;
+        bool m_BatchActive {false};
+        std::vector<AUXCommand> m_BatchCommands;
+        INDI::ElapsedTimer m_BusStatsTimer;
+
         ///////////////////////////////////////////////////////////////////////////////
         /// Celestron AUX Properties
         ///////////////////////////////////////////////////////////////////////////////
@@ -417,6 +452,10 @@ class CelestronAUX :
         // Angles
         INDI::PropertyNumber AngleNP {2};
 
+        // AUX bus statistics
+        INDI::PropertyNumber AUXBusNP {4};
+        enum { AUX_BUS_UTILISATION, AUX_BUS_REPLY_MS, AUX_BUS_TIMEOUTS, AUX_BUS_CHECKSUM_ERRORS };
+
         int32_t m_LastTrackRate[2] = {-1, -1};
         double m_TrackStartSteps[2] = {0, 0};
         double m_LastOffset[2] = {0, 0};
@@ -482,6 +521,12 @@ class CelestronAUX :
         static constexpr uint8_t READ_TIMEOUT {1};
         // ms
         static constexpr uint8_t CTS_TIMEOUT {100};
+        // degrees, sky motion of the tracking target before the alignment Jacobian is refreshed
+        static constexpr double TRACKING_JACOBIAN_REFRESH {1.0};
+        // degrees, finite difference step of the alignment Jacobian
+        static constexpr double TRACKING_JACOBIAN_STEP {0.1};
+        // ms, AUX bus statistics logging period
+        static constexpr uint32_t BUS_STATS_INTERVAL {60000};
         // Coord Wrap
         static constexpr const char *CORDWRAP_TAB {"Coord Wrap"};
         static constexpr const char *MOUNTINFO_TAB {"Mount Info"};
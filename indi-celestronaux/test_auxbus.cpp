@@ -0,0 +1,341 @@
+/*
+    Celestron AUX bus multiplexer tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    AUXBus against a bus stub on a pty. The stub echoes what it receives, as the
+    half-duplex AUX bus does, and answers the frames from APP through a handler
+    running on its own thread.
+*/
+
+#include "auxbus.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
+#include <functional>
+#include <mutex>
+#include <poll.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static AUXBuffer frame(AUXCommand command)
+{
+    AUXBuffer buf;
+    command.fillBuf(buf);
+    return buf;
+}
+
+static AUXBuffer positionReply(AUXTargets axis, uint32_t position)
+{
+    AUXCommand reply(MC_GET_POSITION, axis, APP);
+    reply.setData(position, 3);
+    return frame(reply);
+}
+
+// AUX bus served on the master side of a pty pair, the bus under test gets the slave side
+class AUXBusPtyStub
+{
+    public:
+        // Frames to send back for a frame from APP, called on the stub thread
+        typedef std::function<std::vector<AUXBuffer>(const AUXCommand &)> Handler;
+
+        AUXBusPtyStub()
+        {
+            master = posix_openpt(O_RDWR | O_NOCTTY);
+            if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+                return;
+            slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+            if (slave < 0)
+                return;
+
+            struct termios tio;
+            tcgetattr(slave, &tio);
+            cfmakeraw(&tio);
+            tcsetattr(slave, TCSANOW, &tio);
+        }
+
+        ~AUXBusPtyStub()
+        {
+            hangup();
+            if (slave >= 0)
+                close(slave);
+        }
+
+        void start(Handler handler)
+        {
+            this->handler = handler;
+            server = std::thread(&AUXBusPtyStub::serve, this);
+        }
+
+        // Raw bytes from another device on the bus
+        void inject(const AUXBuffer &buf)
+        {
+            std::lock_guard<std::mutex> lock(writeMutex);
+            write(master, buf.data(), buf.size());
+        }
+
+        // The mount goes away, the slave side reads fail from now on
+        void hangup()
+        {
+            running = false;
+            if (server.joinable())
+                server.join();
+            if (master >= 0)
+                close(master);
+            master = -1;
+        }
+
+        int slave { -1 };
+        std::atomic<int> received { 0 };
+
+    private:
+        void serve()
+        {
+            AUXBuffer rx;
+            while (running)
+            {
+                struct pollfd p = { master, POLLIN, 0 };
+                if (poll(&p, 1, 20) <= 0)
+                    continue;
+                uint8_t data[256];
+                int n = read(master, data, sizeof(data));
+                if (n <= 0)
+                    continue;
+                // The bus echoes every byte to all devices, the sender included
+                inject(AUXBuffer(data, data + n));
+                rx.insert(rx.end(), data, data + n);
+
+                while (rx.size() >= 2 && rx.size() >= static_cast<size_t>(rx[1]) + 3)
+                {
+                    AUXCommand command(AUXBuffer(rx.begin(), rx.begin() + rx[1] + 3));
+                    rx.erase(rx.begin(), rx.begin() + rx[1] + 3);
+                    received++;
+                    for (auto &reply : handler(command))
+                        inject(reply);
+                }
+            }
+        }
+
+        int master { -1 };
+        std::atomic<bool> running { true };
+        std::mutex writeMutex;
+        Handler handler;
+        std::thread server;
+};
+
+class AUXBusTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            ASSERT_GE(stub.slave, 0);
+        }
+
+        void TearDown() override
+        {
+            bus.stop();
+        }
+
+        bool send(AUXCommand command, bool awaitReply = true)
+        {
+            if (awaitReply)
+                bus.expect(command);
+            return bus.write(frame(command));
+        }
+
+        // Unsolicited frames arrive on the reader thread, poll for one
+        bool waitUnsolicited(AUXCommand &command, int timeoutMS)
+        {
+            auto start = Clock::now();
+            while (!bus.popUnsolicited(command))
+            {
+                if (Clock::now() - start > std::chrono::milliseconds(timeoutMS))
+                    return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            return true;
+        }
+
+        AUXBusPtyStub stub;
+        AUXBus bus;
+};
+
+TEST_F(AUXBusTest, replies_routed_out_of_order)
+{
+    // The ALT reply comes first, once both queries are on the bus
+    int queries = 0;
+    stub.start([&queries](const AUXCommand & command)
+    {
+        std::vector<AUXBuffer> replies;
+        if (command.command() == MC_GET_POSITION && ++queries == 2)
+        {
+            replies.push_back(positionReply(ALT, 0x222222));
+            replies.push_back(positionReply(AZM, 0x111111));
+        }
+        return replies;
+    });
+    ASSERT_TRUE(bus.start(stub.slave, 19200));
+
+    AUXCommand azm(MC_GET_POSITION, APP, AZM), alt(MC_GET_POSITION, APP, ALT);
+    ASSERT_TRUE(send(azm));
+    ASSERT_TRUE(send(alt));
+
+    AUXCommand reply;
+    ASSERT_TRUE(bus.waitReply(azm, reply, 1000));
+    EXPECT_EQ(reply.source(), AZM);
+    EXPECT_EQ(reply.getData(), 0x111111u);
+    ASSERT_TRUE(bus.waitReply(alt, reply, 1000));
+    EXPECT_EQ(reply.source(), ALT);
+    EXPECT_EQ(reply.getData(), 0x222222u);
+
+    // The echoes of our own queries are dropped
+    EXPECT_FALSE(bus.popUnsolicited(reply));
+
+    AUXBus::Statistics stats = bus.getStatistics();
+    EXPECT_EQ(stats.replies, 2u);
+    EXPECT_EQ(stats.unsolicited, 0u);
+    EXPECT_EQ(stats.timeouts, 0u);
+    EXPECT_EQ(stats.bytesSent, 2 * frame(azm).size());
+    // Two echoes and two replies
+    EXPECT_EQ(stats.bytesReceived, 2 * frame(azm).size() + 2 * positionReply(AZM, 0).size());
+    EXPECT_GT(stats.utilisation(), 0);
+    EXPECT_NEAR(stats.utilisation(), (stats.bytesSent + stats.bytesReceived) * 10.0 / 19200 / (stats.elapsedMS / 1000), 1e-9);
+
+    bus.resetStatistics();
+    stats = bus.getStatistics();
+    EXPECT_EQ(stats.replies, 0u);
+    EXPECT_EQ(stats.lineRate, 19200);
+}
+
+TEST_F(AUXBusTest, unsolicited_after_bad_frame)
+{
+    stub.start([](const AUXCommand &)
+    {
+        return std::vector<AUXBuffer>();
+    });
+    ASSERT_TRUE(bus.start(stub.slave, 19200));
+
+    // Line noise, a frame with a bad checksum, then a GPS query from the hand controller
+    AUXBuffer corrupt = positionReply(AZM, 0x123456);
+    corrupt.back() ^= 0x55;
+    AUXBuffer noise = { 0x00, 0xff, 0x3b, 0x01 };
+    noise.insert(noise.end(), corrupt.begin(), corrupt.end());
+    AUXBuffer query = frame(AUXCommand(GPS_GET_LAT, HC, GPS));
+    noise.insert(noise.end(), query.begin(), query.end());
+    stub.inject(noise);
+
+    AUXCommand command;
+    ASSERT_TRUE(waitUnsolicited(command, 1000));
+    EXPECT_EQ(command.source(), HC);
+    EXPECT_EQ(command.destination(), GPS);
+    EXPECT_EQ(command.command(), GPS_GET_LAT);
+    EXPECT_FALSE(bus.popUnsolicited(command));
+
+    AUXBus::Statistics stats = bus.getStatistics();
+    EXPECT_GE(stats.checksumErrors, 1u);
+    EXPECT_EQ(stats.unsolicited, 1u);
+}
+
+TEST_F(AUXBusTest, timeout_then_late_reply)
+{
+    std::atomic<bool> answer { false };
+    stub.start([&answer](const AUXCommand & command)
+    {
+        std::vector<AUXBuffer> replies;
+        if (answer)
+            replies.push_back(positionReply(command.destination(), 0x000042));
+        return replies;
+    });
+    ASSERT_TRUE(bus.start(stub.slave, 19200));
+
+    AUXCommand azm(MC_GET_POSITION, APP, AZM);
+    ASSERT_TRUE(send(azm));
+    AUXCommand reply;
+    auto start = Clock::now();
+    EXPECT_FALSE(bus.waitReply(azm, reply, 200));
+    EXPECT_GE(Clock::now() - start, std::chrono::milliseconds(200));
+    EXPECT_EQ(bus.getStatistics().timeouts, 1u);
+
+    // Once given up on, the request is gone: waiting again does not block, and a late reply is
+    // handed to the driver thread
+    EXPECT_FALSE(bus.waitReply(azm, reply, 1000));
+    stub.inject(positionReply(AZM, 0x000007));
+    ASSERT_TRUE(waitUnsolicited(reply, 1000));
+    EXPECT_EQ(reply.getData(), 0x000007u);
+
+    answer = true;
+    ASSERT_TRUE(send(azm));
+    ASSERT_TRUE(bus.waitReply(azm, reply, 1000));
+    EXPECT_EQ(reply.getData(), 0x000042u);
+}
+
+TEST_F(AUXBusTest, unawaited_reply_does_not_answer_later_request)
+{
+    // Each acknowledgement carries a sequence number
+    std::atomic<int> sequence { 0 };
+    stub.start([&sequence](const AUXCommand & command)
+    {
+        AUXCommand ack(command.command(), command.destination(), command.source());
+        ack.setData(++sequence, 1);
+        return std::vector<AUXBuffer> { frame(ack) };
+    });
+    ASSERT_TRUE(bus.start(stub.slave, 19200));
+
+    // A guide pulse is sent without waiting for its acknowledgement
+    AUXBuffer data = { 10, 50 };
+    AUXCommand pulse(MC_AUX_GUIDE, APP, AZM, data);
+    ASSERT_TRUE(send(pulse, false));
+    AUXCommand reply;
+    ASSERT_TRUE(waitUnsolicited(reply, 1000));
+    EXPECT_EQ(reply.getData(), 1u);
+
+    // The next pulse that is waited for gets its own acknowledgement
+    ASSERT_TRUE(send(pulse));
+    ASSERT_TRUE(bus.waitReply(pulse, reply, 1000));
+    EXPECT_EQ(reply.getData(), 2u);
+    EXPECT_EQ(bus.getStatistics().replies, 1u);
+}
+
+TEST_F(AUXBusTest, link_loss_wakes_waiter)
+{
+    stub.start([](const AUXCommand &)
+    {
+        return std::vector<AUXBuffer>();
+    });
+    ASSERT_TRUE(bus.start(stub.slave, 19200));
+
+    AUXCommand azm(MC_GET_POSITION, APP, AZM);
+    ASSERT_TRUE(send(azm));
+    std::thread mount([this]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        stub.hangup();
+    });
+
+    AUXCommand reply;
+    auto start = Clock::now();
+    EXPECT_FALSE(bus.waitReply(azm, reply, 5000));
+    EXPECT_LT(Clock::now() - start, std::chrono::milliseconds(2000));
+    mount.join();
+    EXPECT_FALSE(bus.isRunning());
+}
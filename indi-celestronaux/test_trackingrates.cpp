@@ -0,0 +1,212 @@
+/*
+    Celestron AUX alt-az tracking rate prediction tests
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "trackingrates.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+
+// degrees/s
+static const double SIDEREAL = 15.041067178670 / 3600.0;
+static const double DEG      = M_PI / 180;
+
+static double range180(double x)
+{
+    x = std::fmod(x, 360);
+    if (x > 180)
+        x -= 360;
+    if (x < -180)
+        x += 360;
+    return x;
+}
+
+static void vectorToHorizontal(const double v[3], double &azimuth, double &altitude)
+{
+    altitude = std::atan2(v[2], std::hypot(v[0], v[1])) / DEG;
+    azimuth  = std::atan2(v[1], v[0]) / DEG;
+    if (azimuth < 0)
+        azimuth += 360;
+}
+
+// Hour angle and declination to alt-az, azimuth from north through east
+static void equatorialToHorizontal(double ha, double dec, double latitude, double &azimuth, double &altitude)
+{
+    double h = ha * DEG, d = dec * DEG, p = latitude * DEG;
+    double v[3] =
+    {
+        std::sin(d) * std::cos(p) - std::cos(d) * std::cos(h) * std::sin(p),
+        -std::cos(d) * std::sin(h),
+        std::sin(d) * std::sin(p) + std::cos(d) * std::cos(h) * std::cos(p)
+    };
+    vectorToHorizontal(v, azimuth, altitude);
+}
+
+// Alignment model of a mount whose axes are rotated by angle degrees about axis, with a tube
+// flexure of flexure * cos(altitude) degrees so that the transform is not linear
+class RotatedMount
+{
+    public:
+        RotatedMount(double x, double y, double z, double angle, double flexure = 0) : angle(angle * DEG), flexure(flexure)
+        {
+            double n = std::sqrt(x * x + y * y + z * z);
+            axis[0] = x / n;
+            axis[1] = y / n;
+            axis[2] = z / n;
+        }
+
+        void toMount(const double v[3], double m[3]) const
+        {
+            double c = std::cos(angle), s = std::sin(angle);
+            double kv = axis[0] * v[0] + axis[1] * v[1] + axis[2] * v[2];
+            double cross[3] =
+            {
+                axis[1] * v[2] - axis[2] * v[1],
+                axis[2] * v[0] - axis[0] * v[2],
+                axis[0] * v[1] - axis[1] * v[0]
+            };
+            for (int i = 0; i < 3; i++)
+                m[i] = v[i] * c + cross[i] * s + axis[i] * kv * (1 - c);
+
+            if (flexure != 0)
+            {
+                double azimuth, altitude;
+                vectorToHorizontal(m, azimuth, altitude);
+                TrackingRates::horizontalToVector(azimuth, altitude - flexure * std::cos(altitude * DEG), m);
+            }
+        }
+
+        void toMount(double azimuth, double altitude, double &mountAzimuth, double &mountAltitude) const
+        {
+            double v[3], m[3];
+            TrackingRates::horizontalToVector(azimuth, altitude, v);
+            toMount(v, m);
+            vectorToHorizontal(m, mountAzimuth, mountAltitude);
+        }
+
+    private:
+        double axis[3];
+        double angle;
+        double flexure;
+};
+
+struct GridResult
+{
+    int targets { 0 };
+    // arcsec/s
+    double worst { 0 };
+    double worstNearZenith { 0 };
+};
+
+// Predicted rates against a 0.01 s central difference of the mount position, with the Jacobian
+// taken 0.5 degrees away from the target as it drifts between refreshes
+static GridResult checkGrid(const RotatedMount &mount)
+{
+    GridResult result;
+    auto toMount = [&](const double * sky, double * m)
+    {
+        mount.toMount(sky, m);
+        return true;
+    };
+
+    for (double latitude = -60; latitude <= 60; latitude += 30)
+        for (double dec = -80; dec < 90; dec += 5)
+            for (double ha = -180; ha < 180; ha += 7.5)
+            {
+                double azimuth, altitude, mountAzimuth, mountAltitude;
+                equatorialToHorizontal(ha, dec, latitude, azimuth, altitude);
+                if (altitude < 5 || altitude > 85)
+                    continue;
+                mount.toMount(azimuth, altitude, mountAzimuth, mountAltitude);
+                if (mountAltitude > 89.99)
+                    continue;
+
+                const double dt = 0.01;
+                double azPlus, altPlus, azMinus, altMinus, mAzPlus, mAltPlus, mAzMinus, mAltMinus;
+                equatorialToHorizontal(ha + SIDEREAL * dt, dec, latitude, azPlus, altPlus);
+                equatorialToHorizontal(ha - SIDEREAL * dt, dec, latitude, azMinus, altMinus);
+                mount.toMount(azPlus, altPlus, mAzPlus, mAltPlus);
+                mount.toMount(azMinus, altMinus, mAzMinus, mAltMinus);
+                double numerical[2] = { range180(mAzPlus - mAzMinus) / (2 * dt), (mAltPlus - mAltMinus) / (2 * dt) };
+
+                double refAzimuth, refAltitude, jacobian[3][3];
+                equatorialToHorizontal(ha - 0.5 / std::max(std::cos(dec * DEG), 0.2), dec, latitude, refAzimuth, refAltitude);
+                EXPECT_TRUE(TrackingRates::jacobian(refAzimuth, refAltitude, 0.1, toMount, jacobian));
+
+                double v[3], sky[3], motion[3], m[3], predicted[2];
+                TrackingRates::horizontalToVector(azimuth, altitude, v);
+                TrackingRates::skyMotion(latitude, v, sky);
+                for (int i = 0; i < 3; i++)
+                    motion[i] = jacobian[i][0] * sky[0] + jacobian[i][1] * sky[1] + jacobian[i][2] * sky[2];
+                TrackingRates::horizontalToVector(mountAzimuth, mountAltitude, m);
+                TrackingRates::mountRates(m, motion, SIDEREAL, predicted);
+
+                double error = 3600 * std::max(std::fabs(predicted[0] - numerical[0]), std::fabs(predicted[1] - numerical[1]));
+                result.worst = std::max(result.worst, error);
+                if (mountAltitude > 85)
+                    result.worstNearZenith = std::max(result.worstNearZenith, error);
+                result.targets++;
+            }
+
+    return result;
+}
+
+TEST(TrackingRatesTest, sky_motion_matches_numerical_rates)
+{
+    // No alignment correction, the Jacobian is the identity
+    GridResult result = checkGrid(RotatedMount(0, 0, 1, 0));
+    EXPECT_GT(result.targets, 1000);
+    EXPECT_LT(result.worst, 0.01);
+}
+
+TEST(TrackingRatesTest, aligned_mount_matches_numerical_rates)
+{
+    // Mount axes tilted by 2 degrees, brings targets close to the mount zenith
+    GridResult result = checkGrid(RotatedMount(0.3, -0.5, 0.81, 2));
+    EXPECT_GT(result.targets, 1000);
+    EXPECT_LT(result.worst, 0.01);
+    EXPECT_LT(result.worstNearZenith, 0.01);
+}
+
+TEST(TrackingRatesTest, flexed_mount_matches_numerical_rates)
+{
+    // Non-linear model, the Jacobian is only right close to where it was taken
+    GridResult result = checkGrid(RotatedMount(0.3, -0.5, 0.81, 2, 0.5));
+    EXPECT_GT(result.targets, 1000);
+    EXPECT_LT(result.worst, 0.1);
+    RecordProperty("worst_error_mas_per_s", static_cast<int>(result.worst * 1000));
+    RecordProperty("worst_near_zenith_mas_per_s", static_cast<int>(result.worstNearZenith * 1000));
+}
+
+TEST(TrackingRatesTest, jacobian_reports_transform_failure)
+{
+    double jacobian[3][3];
+    auto fails = [](const double *, double *)
+    {
+        return false;
+    };
+    EXPECT_FALSE(TrackingRates::jacobian(120, 45, 0.1, fails, jacobian));
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
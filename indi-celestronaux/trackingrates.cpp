@@ -0,0 +1,99 @@
+/*
+    Celestron AUX alt-az tracking rate prediction
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#include "trackingrates.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace TrackingRates
+{
+
+void horizontalToVector(double azimuth, double altitude, double v[3])
+{
+    azimuth  *= M_PI / 180;
+    altitude *= M_PI / 180;
+    v[0] = std::cos(altitude) * std::cos(azimuth);
+    v[1] = std::cos(altitude) * std::sin(azimuth);
+    v[2] = std::sin(altitude);
+}
+
+void skyMotion(double latitude, const double v[3], double motion[3])
+{
+    latitude *= M_PI / 180;
+    double pole[3] = {std::cos(latitude), 0, std::sin(latitude)};
+    motion[0] = pole[1] * v[2] - pole[2] * v[1];
+    motion[1] = pole[2] * v[0] - pole[0] * v[2];
+    motion[2] = pole[0] * v[1] - pole[1] * v[0];
+}
+
+void mountRates(const double m[3], const double motion[3], double omega, double rates[2])
+{
+    double horizontal = std::max(m[0] * m[0] + m[1] * m[1], 1e-12);
+    rates[0] = omega * (m[0] * motion[1] - m[1] * motion[0]) / horizontal;
+    rates[1] = omega * motion[2] / std::sqrt(horizontal);
+}
+
+bool jacobian(double azimuth, double altitude, double step,
+              const std::function<bool(const double *sky, double *mount)> &toMount, double jacobian[3][3])
+{
+    double v[3];
+    horizontalToVector(azimuth, altitude, v);
+    azimuth  *= M_PI / 180;
+    altitude *= M_PI / 180;
+    step     *= M_PI / 180;
+    const double tangent[2][3] =
+    {
+        { -std::sin(azimuth), std::cos(azimuth), 0 },
+        { -std::sin(altitude) * std::cos(azimuth), -std::sin(altitude) * std::sin(azimuth), std::cos(altitude) }
+    };
+
+    double result[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    for (int k = 0; k < 2; k++)
+    {
+        double plus[3], minus[3], mountPlus[3], mountMinus[3];
+        for (int i = 0; i < 3; i++)
+        {
+            plus[i]  = std::cos(step) * v[i] + std::sin(step) * tangent[k][i];
+            minus[i] = std::cos(step) * v[i] - std::sin(step) * tangent[k][i];
+        }
+        if (!toMount(plus, mountPlus) || !toMount(minus, mountMinus))
+            return false;
+
+        for (int i = 0; i < 3; i++)
+        {
+            double column = (mountPlus[i] - mountMinus[i]) / (2 * std::sin(step));
+            for (int j = 0; j < 3; j++)
+                result[i][j] += column * tangent[k][j];
+            if (k == 0)
+            {
+                double radial = (mountPlus[i] + mountMinus[i]) / (2 * std::cos(step));
+                for (int j = 0; j < 3; j++)
+                    result[i][j] += radial * v[j];
+            }
+        }
+    }
+
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            jacobian[i][j] = result[i][j];
+    return true;
+}
+
+}
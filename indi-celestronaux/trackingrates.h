@@ -0,0 +1,66 @@
+/*
+    Celestron AUX alt-az tracking rate prediction
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+*/
+
+#pragma once
+
+#include <functional>
+
+/**
+ * Direction vectors are (north, east, zenith), azimuth is measured from north through east and
+ * all angles are in degrees. Kept free of the driver so the tests can check them against
+ * numerical rates without a mount or an alignment database.
+ */
+namespace TrackingRates
+{
+
+void horizontalToVector(double azimuth, double altitude, double v[3]);
+
+/**
+ * @brief skyMotion A fixed target turns about the celestial pole P at the sidereal rate, so its
+ * direction v moves by dv/dH = P x v.
+ * @param latitude of the observer.
+ * @param v target direction.
+ * @param motion filled with dv/dH, per radian of hour angle.
+ */
+void skyMotion(double latitude, const double v[3], double motion[3]);
+
+/**
+ * @brief mountRates Alt-Az rates of a direction moving with the sky.
+ * @param m mount direction.
+ * @param motion dm/dH, per radian of hour angle.
+ * @param omega hour angle rate in degrees/s.
+ * @param rates filled with AZ and ALT rates in degrees/s.
+ */
+void mountRates(const double m[3], const double motion[3], double omega, double rates[2]);
+
+/**
+ * @brief jacobian Central differences of a sky to mount transform along two tangent directions
+ * at the sky position. The radial column is the mount direction itself, so that the sky can
+ * drift away from the reference point without losing accuracy.
+ * @param azimuth sky position.
+ * @param altitude sky position.
+ * @param step finite difference step in degrees.
+ * @param toMount maps a sky direction vector to a mount direction vector, false if it can't.
+ * @param jacobian filled on success.
+ * @return false if toMount failed.
+ */
+bool jacobian(double azimuth, double altitude, double step,
+              const std::function<bool(const double *sky, double *mount)> &toMount, double jacobian[3][3]);
+
+}
@@ -190,8 +190,7 @@ void Align::AlignNStar(double jd, IGeographicCoordinates *position, double curre
     pointset->AltAzFromRaDec(currentRA, currentDEC, jd, &pointalt, &pointaz, position);
     //sortedpoints=pointset->ComputeDistances(pointalt, pointaz, PointSet::None, ingoto);
 
-    std::vector<HtmID> face;
-    face = pointset->findFace(currentRA, currentDEC, jd, pointalt, pointaz, position, ingoto);
+    const std::vector<HtmID> &face = pointset->findFace(currentRA, currentDEC, jd, pointalt, pointaz, position, ingoto);
 
     //if (sortedpoints->size() < 2) {
     if (face.size() < 3)
@@ -204,8 +203,8 @@ void Align::AlignNStar(double jd, IGeographicCoordinates *position, double curre
         /* Taki's Algorithm (p33): http://www.geocities.jp/toshimi_taki/matrix/matrix_method_rev_e.pdf */
         //std::set<PointSet::Distance>::iterator it = sortedpoints->begin();
         //PointSet::Point *point = pointset->getPoint(it->htmID);
-        std::vector<HtmID>::iterator it = face.begin();
-        PointSet::Point *point          = pointset->getPoint(*it);
+        std::vector<HtmID>::const_iterator it = face.begin();
+        PointSet::Point *point                = pointset->getPoint(*it);
         double celestialMatrix[3][3];
         double invcelestialMatrix[3][3];
         double telescopeMatrix[3][3];
@@ -397,10 +396,9 @@ void Align::AlignNearest(double jd, INDI::IGeographicCoordinates *position, doub
     //double pointaz = (pointset->range24(lst - currentRA - 12.0) * 360.0) / 24.0;
     //double pointalt = currentDEC + pointset->lat;
     double pointaz, pointalt;
-    std::set<PointSet::Distance, bool (*)(PointSet::Distance, PointSet::Distance)> *sortedpoints;
+    HtmID nearest;
     pointset->AltAzFromRaDec(currentRA, currentDEC, jd, &pointalt, &pointaz, position);
-    sortedpoints = pointset->ComputeDistances(pointalt, pointaz, PointSet::None, ingoto);
-    if (sortedpoints->empty())
+    if (pointset->NearestPoints(pointalt, pointaz, ingoto, &nearest, 1) == 0)
     {
         *alignedRA  = currentRA;
         *alignedDEC = currentDEC;
@@ -408,7 +406,7 @@ void Align::AlignNearest(double jd, INDI::IGeographicCoordinates *position, doub
     }
     else
     {
-        PointSet::Point *point = pointset->getPoint(sortedpoints->begin()->htmID);
+        PointSet::Point *point = pointset->getPoint(nearest);
         if (lastnearestindex != point->index)
             LOGF_INFO("Align: current point is %d\n", point->index);
         lastnearestindex = point->index;
@@ -106,6 +106,8 @@ extern void PrintEdges(void);
 extern void PrintFaces(void);
 extern void CheckEndpts(void);
 extern void EdgeOrderOnFaces(void);
+extern void AddVertex(tVertex v);
+extern void FreeHull(void);
 
 #ifdef __cplusplus
 }
@@ -84,6 +84,11 @@ tFace faces      = NULL;
 bool debug       = FALSE;
 bool check       = FALSE;
 
+/* Geehalel: edges and faces deleted by CleanUp are kept here and reused by the next AddOne,
+   so that adding a point to a large hull does not go through malloc/free for every cone face */
+static tEdge freeedges = NULL;
+static tFace freefaces = NULL;
+
 /* Function declarations */
 tVertex MakeNullVertex(void);
 void ReadVertices(void);
@@ -115,6 +120,8 @@ void PrintEdges(void);
 void PrintFaces(void);
 void CheckEndpts(void);
 void EdgeOrderOnFaces(void);
+void AddVertex(tVertex v);
+void FreeHull(void);
 
 /*-------------------------------------------------------------------*/
 /* Geehalel: Use as a library */
@@ -406,6 +413,47 @@ void ConstructHull(void)
     } while (v != vertices);
 }
 
+/*---------------------------------------------------------------------
+Geehalel: AddVertex adds a single new vertex to an existing hull, as
+ConstructHull would do for it. Only the faces visible from v are
+replaced.
+---------------------------------------------------------------------*/
+void AddVertex(tVertex v)
+{
+    tVertex vnext = v->next;
+
+    v->mark = PROCESSED;
+    AddOne(v);
+    CleanUp(&vnext);
+}
+
+/*---------------------------------------------------------------------
+Geehalel: FreeHull releases all vertices and moves the edges and faces
+to the free lists, leaving an empty hull.
+---------------------------------------------------------------------*/
+void FreeHull(void)
+{
+    tVertex v;
+    tEdge e;
+    tFace f;
+
+    while (vertices)
+    {
+        v = vertices;
+        DELETE(vertices, v);
+    }
+    while (edges)
+    {
+        e = edges;
+        RECYCLE(edges, e, freeedges);
+    }
+    while (faces)
+    {
+        f = faces;
+        RECYCLE(faces, f, freefaces);
+    }
+}
+
 /*---------------------------------------------------------------------
 AddOne is passed a vertex.  It first determines all faces visible from 
 that point.  If none are visible then the point is marked as not 
@@ -634,7 +682,13 @@ tEdge MakeNullEdge(void)
 {
     tEdge e;
 
-    NEW(e, tsEdge);
+    if (freeedges)
+    {
+        e         = freeedges;
+        freeedges = freeedges->next;
+    }
+    else
+        NEW(e, tsEdge);
     e->adjface[0] = e->adjface[1] = e->newface = NULL;
     e->endpts[0] = e->endpts[1] = NULL;
     e->delete                   = !REMOVED;
@@ -652,7 +706,13 @@ tFace MakeNullFace(void)
     tFace f;
     int i;
 
-    NEW(f, tsFace);
+    if (freefaces)
+    {
+        f         = freefaces;
+        freefaces = freefaces->next;
+    }
+    else
+        NEW(f, tsFace);
     for (i = 0; i < 3; ++i)
     {
         f->edge[i]   = NULL;
@@ -749,7 +809,7 @@ void CleanEdges(void)
     while (edges && edges->delete)
     {
         e = edges;
-        DELETE(edges, e);
+        RECYCLE(edges, e, freeedges);
     }
     e = edges->next;
     do
@@ -758,7 +818,7 @@ void CleanEdges(void)
         {
             t = e;
             e = e->next;
-            DELETE(edges, t);
+            RECYCLE(edges, t, freeedges);
         }
         else
             e = e->next;
@@ -776,7 +836,7 @@ void CleanFaces(void)
     while (faces && faces->visible)
     {
         f = faces;
-        DELETE(faces, f);
+        RECYCLE(faces, f, freefaces);
     }
     f = faces->next;
     do
@@ -785,7 +845,7 @@ void CleanFaces(void)
         {
             t = f;
             f = f->next;
-            DELETE(faces, t);
+            RECYCLE(faces, t, freefaces);
         }
         else
             f = f->next;
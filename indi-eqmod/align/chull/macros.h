@@ -58,3 +58,16 @@
         p->prev->next = p->next; \
         FREE(p);                 \
     }
+/* Geehalel: unlink like DELETE but keep the cell on a free list for reuse */
+#define RECYCLE(head, p, freelist) \
+    if (head)                      \
+    {                              \
+        if (head == head->next)    \
+            head = NULL;           \
+        else if (p == head)        \
+            head = head->next;     \
+        p->next->prev = p->prev;   \
+        p->prev->next = p->next;   \
+        p->next       = freelist;  \
+        freelist      = p;         \
+    }
@@ -0,0 +1,250 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "pointindex.h"
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+/* Same expression as PointSet::scalarTripleProduct so that both agree on points lying on an edge */
+static inline double tripleProduct(const double *p, const double *e1, const double *e2)
+{
+    return (p[0] * e1[1] * e2[2]) + (p[2] * e1[0] * e2[1]) + (p[1] * e1[2] * e2[0]) - (p[2] * e1[1] * e2[0]) -
+           (p[0] * e1[2] * e2[1]) - (p[1] * e1[0] * e2[2]);
+}
+
+/* PointIndex */
+
+void PointIndex::clear()
+{
+    nodes.clear();
+}
+
+void PointIndex::addPoint(HtmID id, double x, double y, double z)
+{
+    Node n;
+    n.v[0] = x;
+    n.v[1] = y;
+    n.v[2] = z;
+    n.id   = id;
+    n.axis = 0;
+    nodes.push_back(n);
+}
+
+size_t PointIndex::size() const
+{
+    return nodes.size();
+}
+
+void PointIndex::build()
+{
+    buildRange(0, nodes.size());
+}
+
+void PointIndex::buildRange(size_t lo, size_t hi)
+{
+    if (hi - lo < 2)
+        return;
+
+    // Split along the axis with the widest spread, points on a sphere cap are far from uniform
+    double vmin[3] = { 2, 2, 2 }, vmax[3] = { -2, -2, -2 };
+    for (size_t i = lo; i < hi; i++)
+    {
+        for (int a = 0; a < 3; a++)
+        {
+            vmin[a] = std::min(vmin[a], nodes[i].v[a]);
+            vmax[a] = std::max(vmax[a], nodes[i].v[a]);
+        }
+    }
+    uint8_t axis = 0;
+    for (uint8_t a = 1; a < 3; a++)
+        if (vmax[a] - vmin[a] > vmax[axis] - vmin[axis])
+            axis = a;
+
+    size_t mid = lo + (hi - lo) / 2;
+    std::nth_element(nodes.begin() + lo, nodes.begin() + mid, nodes.begin() + hi, [axis](const Node & a, const Node & b)
+    {
+        return a.v[axis] < b.v[axis];
+    });
+    nodes[mid].axis = axis;
+
+    buildRange(lo, mid);
+    buildRange(mid + 1, hi);
+}
+
+int PointIndex::nearest(double x, double y, double z, HtmID *ids, double *chord2, int k) const
+{
+    Result r;
+    const double q[3] = { x, y, z };
+
+    r.count = 0;
+    r.k     = std::min(std::max(k, 0), static_cast<int>(MAX_NEAREST));
+    if (r.k > 0)
+        searchRange(0, nodes.size(), q, &r);
+
+    for (int i = 0; i < r.count; i++)
+    {
+        if (ids)
+            ids[i] = r.ids[i];
+        if (chord2)
+            chord2[i] = r.chord2[i];
+    }
+    return r.count;
+}
+
+void PointIndex::searchRange(size_t lo, size_t hi, const double *q, Result *r) const
+{
+    if (lo >= hi)
+        return;
+
+    size_t mid    = lo + (hi - lo) / 2;
+    const Node &n = nodes[mid];
+    double dx = q[0] - n.v[0], dy = q[1] - n.v[1], dz = q[2] - n.v[2];
+    double d2 = dx * dx + dy * dy + dz * dz;
+
+    // Insert into the sorted result list
+    if (r->count < r->k || d2 < r->chord2[r->count - 1] || (d2 == r->chord2[r->count - 1] && n.id < r->ids[r->count - 1]))
+    {
+        int i = (r->count < r->k) ? r->count++ : r->count - 1;
+        while (i > 0 && (d2 < r->chord2[i - 1] || (d2 == r->chord2[i - 1] && n.id < r->ids[i - 1])))
+        {
+            r->chord2[i] = r->chord2[i - 1];
+            r->ids[i]    = r->ids[i - 1];
+            i--;
+        }
+        r->chord2[i] = d2;
+        r->ids[i]    = n.id;
+    }
+
+    if (hi - lo == 1)
+        return;
+
+    double delta = q[n.axis] - n.v[n.axis];
+    bool left    = delta < 0;
+    searchRange(left ? lo : mid + 1, left ? mid : hi, q, r);
+    // Other side only if it can hold something at least as close as the current worst
+    if (r->count < r->k || delta * delta <= r->chord2[r->count - 1])
+        searchRange(left ? mid + 1 : lo, left ? hi : mid, q, r);
+}
+
+/* FaceLocator */
+
+void FaceLocator::clear()
+{
+    faces.clear();
+}
+
+void FaceLocator::addFace(const HtmID *ids, const double *v0, const double *v1, const double *v2)
+{
+    FaceData f;
+    for (int i = 0; i < 3; i++)
+    {
+        f.ids[i]       = ids[i];
+        f.v[0][i]      = v0[i];
+        f.v[1][i]      = v1[i];
+        f.v[2][i]      = v2[i];
+        f.neighbour[i] = -1;
+    }
+    f.ccw = tripleProduct(f.v[0], f.v[1], f.v[2]) > 0;
+    faces.push_back(f);
+}
+
+size_t FaceLocator::size() const
+{
+    return faces.size();
+}
+
+const HtmID *FaceLocator::vertices(int face) const
+{
+    return faces[face].ids;
+}
+
+void FaceLocator::build()
+{
+    // Edge i of a face joins vertices (i + 2) % 3 and i, matching the order of the inside() tests
+    std::map<std::pair<HtmID, HtmID>, std::pair<int, int>> edges;
+    for (size_t fi = 0; fi < faces.size(); fi++)
+    {
+        for (int e = 0; e < 3; e++)
+        {
+            HtmID a = faces[fi].ids[(e + 2) % 3], b = faces[fi].ids[e];
+            std::pair<HtmID, HtmID> key(std::min(a, b), std::max(a, b));
+            auto it = edges.find(key);
+            if (it == edges.end())
+            {
+                edges.emplace(key, std::make_pair(static_cast<int>(fi), e));
+                continue;
+            }
+            faces[fi].neighbour[e]                          = it->second.first;
+            faces[it->second.first].neighbour[it->second.second] = static_cast<int>(fi);
+        }
+    }
+}
+
+bool FaceLocator::inside(const FaceData &f, const double *p, double *r) const
+{
+    r[0] = tripleProduct(p, f.v[2], f.v[0]);
+    r[1] = tripleProduct(p, f.v[0], f.v[1]);
+    r[2] = tripleProduct(p, f.v[1], f.v[2]);
+    bool left  = r[0] < 0 || r[1] < 0 || r[2] < 0;
+    bool right = r[0] >= 0 || r[1] >= 0 || r[2] >= 0;
+    return !(left && right);
+}
+
+int FaceLocator::scan(const double *p) const
+{
+    double r[3];
+    for (size_t i = 0; i < faces.size(); i++)
+        if (inside(faces[i], p, r))
+            return static_cast<int>(i);
+    return -1;
+}
+
+int FaceLocator::locate(const double *p, int start) const
+{
+    if (faces.empty())
+        return -1;
+    if (start < 0 || start >= static_cast<int>(faces.size()))
+        return scan(p);
+
+    double r[3];
+    int current = start;
+    for (size_t steps = 0; steps < faces.size(); steps++)
+    {
+        const FaceData &f = faces[current];
+        if (inside(f, p, r))
+            return current;
+
+        // Cross the edge that p is furthest beyond
+        int edge     = -1;
+        double worst = 0;
+        for (int e = 0; e < 3; e++)
+        {
+            double score = f.ccw ? r[e] : -r[e];
+            if (score < worst)
+            {
+                worst = score;
+                edge  = e;
+            }
+        }
+        if (edge < 0 || f.neighbour[edge] < 0)
+            break;
+        current = f.neighbour[edge];
+    }
+
+    return scan(p);
+}
@@ -0,0 +1,95 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "htm.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*
+ * Lookup structures for the alignment point set. Both are built once after the point set changes
+ * and are then queried on every coordinate conversion without allocating.
+ */
+
+/* kd-tree on the unit-sphere vectors of the alignment points, keyed by their htmID. The chord length
+   between unit vectors grows with the great circle distance, so the nearest neighbours are the same. */
+class PointIndex
+{
+    public:
+        static const int MAX_NEAREST = 8;
+
+        void clear();
+        void addPoint(HtmID id, double x, double y, double z);
+        void build();
+        size_t size() const;
+
+        /* k nearest points to (x, y, z), closest first, ties broken by htmID.
+           Returns the number of points found, at most k and MAX_NEAREST. */
+        int nearest(double x, double y, double z, HtmID *ids, double *chord2, int k) const;
+
+    private:
+        typedef struct Node
+        {
+            double v[3];
+            HtmID id;
+            uint8_t axis;
+        } Node;
+        typedef struct Result
+        {
+            double chord2[MAX_NEAREST];
+            HtmID ids[MAX_NEAREST];
+            int count;
+            int k;
+        } Result;
+
+        void buildRange(size_t lo, size_t hi);
+        void searchRange(size_t lo, size_t hi, const double *q, Result *r) const;
+
+        std::vector<Node> nodes;
+};
+
+/* Faces of the triangulation with their unit-sphere vertices and edge adjacency. A lookup first walks
+   from the last face that contained a point towards the new one, which is a few steps when the
+   mount moves smoothly, and only falls back to scanning all faces when the walk gets lost. */
+class FaceLocator
+{
+    public:
+        void clear();
+        void addFace(const HtmID *ids, const double *v0, const double *v1, const double *v2);
+        void build();
+        size_t size() const;
+
+        /* Face containing direction p, in the sense of PointSet::isPointInside, or -1. */
+        int locate(const double *p, int start) const;
+        const HtmID *vertices(int face) const;
+
+    private:
+        typedef struct FaceData
+        {
+            HtmID ids[3];
+            double v[3][3];
+            int neighbour[3]; // across edge (v2,v0), (v0,v1), (v1,v2), -1 if none
+            bool ccw;         // orientation of v0, v1, v2 seen from the origin
+        } FaceData;
+
+        bool inside(const FaceData &f, const double *p, double *r) const;
+        int scan(const double *p) const;
+
+        std::vector<FaceData> faces;
+};
@@ -161,6 +161,14 @@ PointSet::ComputeDistances(double alt, double az, PointFilter filter, bool ingot
 }
 
 void PointSet::AddPoint(AlignData aligndata, INDI::IGeographicCoordinates *pos)
+{
+    HtmID id = InsertPoint(aligndata, pos);
+    Triangulation->AddPoint(id);
+    IndexValid = false;
+    LOGF_INFO("Align Triangulate: number of faces is %d\n", Triangulation->getFaces().size());
+}
+
+HtmID PointSet::InsertPoint(AlignData aligndata, INDI::IGeographicCoordinates *pos)
 {
     Point point;
     point.aligndata = aligndata;
@@ -197,10 +205,9 @@ void PointSet::AddPoint(AlignData aligndata, INDI::IGeographicCoordinates *pos)
     cc_ID2name(point.htmname, point.htmID);
     point.index = getNbPoints();
     PointSetMap->insert(std::pair<HtmID, Point>(point.htmID, point));
-    Triangulation->AddPoint(point.htmID);
     LOGF_INFO("Align Pointset: added point %d alt = %g az = %g\n", point.index,
               point.celestialALT, point.celestialAZ);
-    LOGF_INFO("Align Triangulate: number of faces is %d\n", Triangulation->getFaces().size());
+    return point.htmID;
 }
 
 PointSet::Point *PointSet::getPoint(HtmID htmid)
@@ -230,6 +237,7 @@ void PointSet::Init()
     Triangulation   = new TriangulateCHull(PointSetMap);
     PointSetXmlRoot = nullptr;
     PointSetInitialized = true;
+    IndexValid = false;
 }
 
 void PointSet::Reset()
@@ -248,6 +256,7 @@ void PointSet::Reset()
         free(lnalignpos);
     lnalignpos = nullptr;
     Triangulation->Reset();
+    IndexValid = false;
 }
 
 char *PointSet::LoadDataFile(const char *filename)
@@ -261,6 +270,7 @@ char *PointSet::LoadDataFile(const char *filename)
     XMLAtt *ap;
     char *sitename;
     std::map<HtmID, Point>::iterator it;
+    std::vector<HtmID> ids;
 
     if (wordexp(filename, &wexp, 0))
     {
@@ -317,6 +327,7 @@ char *PointSet::LoadDataFile(const char *filename)
     PointSetMap->clear();
     alignxml     = nextXMLEle(sitexml, 1);
     aligndata.jd = -1.0;
+    ids.reserve(nXMLEle(sitexml));
     while (alignxml)
     {
         if (strcmp(tagXMLEle(alignxml), "point") != 0)
@@ -329,9 +340,13 @@ char *PointSet::LoadDataFile(const char *filename)
         sscanf(pcdataXMLEle(findXMLEle(alignxml, "telescopede")), "%lf", &aligndata.telescopeDEC);
         //IDLog("Load alignment point: %f %f %f %f %f\n", aligndata.lst, aligndata.targetRA, aligndata.targetDEC,
         //  aligndata.telescopeRA, aligndata.telescopeDEC);
-        AddPoint(aligndata, lnalignpos);
+        ids.push_back(InsertPoint(aligndata, lnalignpos));
         alignxml = nextXMLEle(sitexml, 0);
     }
+    // Build the hull once for the whole file rather than once per point
+    Triangulation->AddPoints(ids);
+    IndexValid = false;
+    LOGF_INFO("Align Triangulate: number of faces is %d\n", Triangulation->getFaces().size());
     /*
     IDLog("Resulting Alignment map;\n");
     for ( it=PointSetMap->begin() ; it != PointSetMap->end(); it++ )
@@ -491,7 +506,7 @@ double PointSet::scalarTripleProduct(Point *p, Point *e1, Point *e2, bool ingoto
     return res;
 }
 
-bool PointSet::isPointInside(Point *p, std::vector<HtmID> f, bool ingoto)
+bool PointSet::isPointInside(Point *p, const std::vector<HtmID> &f, bool ingoto)
 {
     double r;
     bool left  = false;
@@ -520,46 +535,87 @@ bool PointSet::isPointInside(Point *p, std::vector<HtmID> f, bool ingoto)
     return true;
 }
 
-std::vector<HtmID> PointSet::findFace(double currentRA, double currentDEC, double jd, double pointalt, double pointaz,
-                                      INDI::IGeographicCoordinates *position, bool ingoto)
+void PointSet::BuildIndex()
 {
-    INDI_UNUSED(pointalt);
-    INDI_UNUSED(pointaz);
-    Point point;
-    double horangle = 0, altangle = 0;
-    std::vector<Face *> faces;
-    std::vector<Face *>::iterator it;
-
-    point.aligndata.jd        = jd;
-    point.aligndata.targetRA  = currentRA;
-    point.aligndata.targetDEC = currentDEC;
-    AltAzFromRaDec(point.aligndata.targetRA, point.aligndata.targetDEC, point.aligndata.jd, &point.celestialALT,
-                   &point.celestialAZ, position);
-
-    horangle = range360(-180.0 - point.celestialAZ) * M_PI / 180.0;
-    altangle = point.celestialALT * M_PI / 180.0;
-    point.cx = cos(altangle) * cos(horangle);
-    point.cy = cos(altangle) * sin(horangle);
-    point.cz = sin(altangle);
-
-    if (Triangulation->isValid() && isPointInside(&point, current, ingoto))
+    CelestialIndex.clear();
+    TelescopeIndex.clear();
+    CelestialFaces.clear();
+    TelescopeFaces.clear();
+
+    for (auto &it : *PointSetMap)
+    {
+        const Point &p = it.second;
+        CelestialIndex.addPoint(it.first, p.cx, p.cy, p.cz);
+        TelescopeIndex.addPoint(it.first, p.tx, p.ty, p.tz);
+    }
+    CelestialIndex.build();
+    TelescopeIndex.build();
+
+    const std::vector<Face *> &faces = Triangulation->getFaces();
+    for (Face *f : faces)
+    {
+        const Point &a = PointSetMap->at(f->v[0]);
+        const Point &b = PointSetMap->at(f->v[1]);
+        const Point &c = PointSetMap->at(f->v[2]);
+        const double ca[3] = { a.cx, a.cy, a.cz }, cb[3] = { b.cx, b.cy, b.cz }, cc[3] = { c.cx, c.cy, c.cz };
+        const double ta[3] = { a.tx, a.ty, a.tz }, tb[3] = { b.tx, b.ty, b.tz }, tc[3] = { c.tx, c.ty, c.tz };
+        CelestialFaces.addFace(f->v.data(), ca, cb, cc);
+        TelescopeFaces.addFace(f->v.data(), ta, tb, tc);
+    }
+    CelestialFaces.build();
+    TelescopeFaces.build();
+
+    LastFace[0] = LastFace[1] = -1;
+    IndexValid  = true;
+}
+
+int PointSet::NearestPoints(double alt, double az, bool ingoto, HtmID *ids, int k)
+{
+    if (!IndexValid)
+        BuildIndex();
+
+    double horangle = range360(-180.0 - az) * M_PI / 180.0;
+    double altangle = alt * M_PI / 180.0;
+    return (ingoto ? CelestialIndex : TelescopeIndex).nearest(cos(altangle) * cos(horangle), cos(altangle) * sin(horangle),
+            sin(altangle), ids, nullptr, k);
+}
+
+const std::vector<HtmID> &PointSet::findFace(double currentRA, double currentDEC, double jd, double pointalt,
+        double pointaz, INDI::IGeographicCoordinates *position, bool ingoto)
+{
+    INDI_UNUSED(currentRA);
+    INDI_UNUSED(currentDEC);
+    INDI_UNUSED(jd);
+    INDI_UNUSED(position);
+    double p[3];
+    double horangle = range360(-180.0 - pointaz) * M_PI / 180.0;
+    double altangle = pointalt * M_PI / 180.0;
+    p[0] = cos(altangle) * cos(horangle);
+    p[1] = cos(altangle) * sin(horangle);
+    p[2] = sin(altangle);
+
+    if (!IndexValid)
+        BuildIndex();
+
+    // Walk from the last face found, a full scan is only needed when the walk gets lost
+    int &last = LastFace[ingoto ? 1 : 0];
+    FaceLocator &faces = ingoto ? CelestialFaces : TelescopeFaces;
+    int face = faces.locate(p, Triangulation->isValid() ? last : -1);
+    last     = face;
+    if (face < 0)
+    {
+        if (current.size() > 0)
+            LOG_INFO("Align: current face is empty");
+        current.clear();
         return current;
-    faces = Triangulation->getFaces();
-    it    = faces.begin();
-    while (it < faces.end())
+    }
+
+    const HtmID *v = faces.vertices(face);
+    if (current.size() != 3 || current[0] != v[0] || current[1] != v[1] || current[2] != v[2])
     {
-        if (isPointInside(&point, (*it)->v, ingoto))
-        {
-            currentFace = *it;
-            current     = (*it)->v;
-            LOGF_INFO("Align: current face is {%d, %d, %d}", PointSetMap->at(current[0]).index,
-                      PointSetMap->at(current[1]).index, PointSetMap->at(current[2]).index);
-            return current;
-        }
-        it++;
+        current.assign(v, v + 3);
+        LOGF_INFO("Align: current face is {%d, %d, %d}", PointSetMap->at(current[0]).index,
+                  PointSetMap->at(current[1]).index, PointSetMap->at(current[2]).index);
     }
-    if (current.size() > 0)
-        LOG_INFO("Align: current face is empty");
-    current.clear();
     return current;
 }
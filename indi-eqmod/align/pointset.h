@@ -18,6 +18,7 @@
 #pragma once
 
 #include "htm.h"
+#include "pointindex.h"
 
 #include <map>
 #include <set>
@@ -77,14 +78,17 @@ class PointSet
         void setTriangulationBlobData(IBLOB *blob);
         std::set<Distance, bool (*)(Distance, Distance)> *ComputeDistances(double alt, double az, PointFilter filter,
                 bool ingoto);
-        std::vector<HtmID> findFace(double currentRA, double currentDEC, double jd, double pointalt, double pointaz,
-                                    INDI::IGeographicCoordinates *position, bool ingoto);
+        // Up to k points closest to alt/az, closest first, without scanning the whole set
+        int NearestPoints(double alt, double az, bool ingoto, HtmID *ids, int k);
+        // pointalt/pointaz must be the alt/az of currentRA/currentDEC at jd
+        const std::vector<HtmID> &findFace(double currentRA, double currentDEC, double jd, double pointalt, double pointaz,
+                                           INDI::IGeographicCoordinates *position, bool ingoto);
         double lat, lon, alt;
         void AltAzFromRaDec(double ra, double dec, double jd, double *alt, double *az, INDI::IGeographicCoordinates *pos);
         void AltAzFromRaDecSidereal(double ra, double dec, double lst, double *alt, double *az, INDI::IGeographicCoordinates *pos);
         void RaDecFromAltAz(double alt, double az, double jd, double *ra, double *dec, INDI::IGeographicCoordinates *pos);
         double scalarTripleProduct(Point *p, Point *e1, Point *e2, bool ingoto);
-        bool isPointInside(Point *p, std::vector<HtmID> f, bool ingoto);
+        bool isPointInside(Point *p, const std::vector<HtmID> &f, bool ingoto);
 
     protected:
     private:
@@ -94,6 +98,14 @@ class PointSet
         TriangulateCHull *Triangulation;
         Face *currentFace;
         std::vector<HtmID> current;
+        // Compute a point and add it to the map, without updating the triangulation
+        HtmID InsertPoint(AlignData aligndata, INDI::IGeographicCoordinates *pos);
+        // Lookup structures, rebuilt on the first query after the point set changed
+        void BuildIndex();
+        bool IndexValid {false};
+        PointIndex CelestialIndex, TelescopeIndex;
+        FaceLocator CelestialFaces, TelescopeFaces;
+        int LastFace[2] {-1, -1};
         // to get access to lat/long data
         INDI::Telescope *telescope;
         // from align data file
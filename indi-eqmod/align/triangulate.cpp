@@ -26,13 +26,51 @@ void Triangulate::Reset()
 {
     isvalid = false;
     vvertices.clear();
-    vfaces.clear();
+    ClearFaces();
+    facesdirty = false;
 }
 
 void Triangulate::AddPoint(HtmID id)
 {
     INDI_UNUSED(id);
-    isvalid = false;
+    isvalid    = false;
+    facesdirty = true;
+}
+
+void Triangulate::AddPoints(const std::vector<HtmID> &ids)
+{
+    for (HtmID id : ids)
+        AddPoint(id);
+}
+
+void Triangulate::UpdateFaces()
+{
+    facesdirty = false;
+}
+
+void Triangulate::ClearFaces()
+{
+    vfaces.clear();
+    facesused = 0;
+}
+
+void Triangulate::AddFace(HtmID v0, HtmID v1, HtmID v2)
+{
+    Face *f;
+    if (facesused < facepool.size())
+    {
+        f       = &facepool[facesused];
+        f->v[0] = v0;
+        f->v[1] = v1;
+        f->v[2] = v2;
+    }
+    else
+    {
+        facepool.emplace_back(v0, v1, v2);
+        f = &facepool.back();
+    }
+    facesused++;
+    vfaces.push_back(f);
 }
 
 XMLEle *Triangulate::toXML()
@@ -40,6 +78,9 @@ XMLEle *Triangulate::toXML()
     XMLEle *root;
     std::vector<Face *>::iterator it;
 
+    if (facesdirty)
+        UpdateFaces();
+
     root = addXMLEle(nullptr, "triangulation");
 
     for (it = vfaces.begin(); it != vfaces.end(); it++)
@@ -62,8 +103,10 @@ XMLEle *Triangulate::toXML()
     return (root);
 }
 
-std::vector<Face *> Triangulate::getFaces()
+const std::vector<Face *> &Triangulate::getFaces()
 {
+    if (facesdirty)
+        UpdateFaces();
     isvalid = true;
     return vfaces;
 }
@@ -19,6 +19,8 @@
 
 #include "pointset.h"
 
+#include <deque>
+
 class Face
 {
   public:
@@ -40,13 +42,27 @@ class Triangulate
     Triangulate(std::map<HtmID, PointSet::Point> *p);
     virtual void Reset();
     virtual void AddPoint(HtmID id);
+    // Same as calling AddPoint for each id, the faces are only computed once at the end
+    virtual void AddPoints(const std::vector<HtmID> &ids);
     virtual XMLEle *toXML();
-    virtual std::vector<Face *> getFaces();
+    // Faces stay owned by the triangulation and are reused once points are added
+    virtual const std::vector<Face *> &getFaces();
     virtual bool isValid();
 
   protected:
+    // Refill vfaces after points were added, called on the first getFaces()/toXML()
+    virtual void UpdateFaces();
+    void ClearFaces();
+    void AddFace(HtmID v0, HtmID v1, HtmID v2);
+
     std::map<HtmID, PointSet::Point> *pmap;
     std::vector<HtmID> vvertices;
     std::vector<Face *> vfaces;
     bool isvalid {false};
+    bool facesdirty {false};
+
+  private:
+    // Faces handed out in vfaces, deque so that pointers survive growing the pool
+    std::deque<Face> facepool;
+    size_t facesused {0};
 };
@@ -38,61 +38,81 @@ void TriangulateCHull::Reset()
     tVertex v;
     Triangulate::Reset();
     vnum = 0;
-    //SHOULD Free everything
-    vertices = nullptr;
-    edges    = nullptr;
-    faces    = nullptr;
-    v        = MakeNullVertex();
-    v->v[X]  = 0;
-    v->v[Y]  = 0;
-    v->v[Z]  = 0;
-    v->vnum  = vnum++;
+    FreeHull();
+    hullbuilt = false;
+    v         = MakeNullVertex();
+    v->v[X]   = 0;
+    v->v[Y]   = 0;
+    v->v[Z]   = 0;
+    v->vnum   = vnum++;
 }
 
-void TriangulateCHull::AddPoint(HtmID id)
+tVertex TriangulateCHull::MakeVertex(HtmID id)
 {
-    tVertex v, vnext;
+    tVertex v;
     PointSet::Point p;
-    tFace f;
-    Triangulate::AddPoint(id);
-    //fprintf(stderr, "Triangulate addpoint: %ld\n", id);
-    p = pmap->at(id);
-    //fprintf(stderr, "Triangulate addpoint: point retrieved %d\n", p.index);
+    p       = pmap->at(id);
     v       = MakeNullVertex();
     v->v[X] = (int)(p.cx * 1000000);
     v->v[Y] = (int)(p.cy * 1000000);
     v->v[Z] = (int)(p.cz * 1000000);
     v->vnum = vnum++;
-    //fprintf(stderr, "Triangulate addpoint: vertex created %d\n", v->vnum);
     vvertices.push_back(id);
-    //fprintf(stderr, "Triangulate addpoint: vertex added (%d total)\n", vvertices.size());
+    return v;
+}
+
+void TriangulateCHull::AddPoint(HtmID id)
+{
+    tVertex v;
+    Triangulate::AddPoint(id);
+    v = MakeVertex(id);
     if (vnum < 4)
         return;
-    if (vnum == 4)
+    if (!hullbuilt)
     {
         DoubleTriangle();
         ConstructHull();
+        hullbuilt = true;
+        return;
     }
-    if (vnum > 4)
-    {
-        vnext = v->next;
-        AddOne(v);
-        CleanUp(&vnext);
-    }
-    vfaces.clear();
+    // Only the faces visible from the new vertex change, vfaces is refreshed on the next getFaces()
+    AddVertex(v);
+}
+
+void TriangulateCHull::AddPoints(const std::vector<HtmID> &ids)
+{
+    if (ids.empty())
+        return;
+    Triangulate::AddPoint(ids.front());
+    for (HtmID id : ids)
+        MakeVertex(id);
+    if (vnum < 4)
+        return;
+    // ConstructHull adds the unprocessed vertices in list order, as many AddPoint calls would
+    if (!hullbuilt)
+        DoubleTriangle();
+    ConstructHull();
+    hullbuilt = true;
+}
+
+void TriangulateCHull::UpdateFaces()
+{
+    tFace f;
+    Triangulate::UpdateFaces();
+    ClearFaces();
+    if (!hullbuilt)
+        return;
     f = faces;
     do
     {
-        //fprintf(stderr, "Triangulate addpoint: adding face (%d total)\n", vfaces.size());
         //skip faces containing the origin vertex
         if ((f->vertex[0]->vnum == 0) || (f->vertex[1]->vnum == 0) || (f->vertex[2]->vnum == 0))
         {
             f = f->next;
             continue;
         }
-        vfaces.push_back(new Face(vvertices.at(f->vertex[0]->vnum - 1), vvertices.at(f->vertex[1]->vnum - 1),
-                                  vvertices.at(f->vertex[2]->vnum - 1)));
-        //fprintf(stderr, "Triangulate addpoint: added face (%d total)\n", vfaces.size());
+        AddFace(vvertices.at(f->vertex[0]->vnum - 1), vvertices.at(f->vertex[1]->vnum - 1),
+                vvertices.at(f->vertex[2]->vnum - 1));
         f = f->next;
     } while (f != faces);
 }
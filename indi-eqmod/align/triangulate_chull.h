@@ -19,14 +19,22 @@
 
 #include "triangulate.h"
 
+struct tVertexStructure;
+
 class TriangulateCHull : public Triangulate
 {
   public:
     TriangulateCHull(std::map<HtmID, PointSet::Point> *p);
     void Reset();
     void AddPoint(HtmID id);
+    void AddPoints(const std::vector<HtmID> &ids);
     //XMLEle *toXML();
 
+  protected:
+    void UpdateFaces();
+
   private:
+    struct tVertexStructure *MakeVertex(HtmID id);
     int vnum;
+    bool hullbuilt {false};
 };
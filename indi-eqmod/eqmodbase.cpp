@@ -339,6 +339,9 @@ void EQMod::ISGetProperties(const char *dev)
         defineProperty(SteppersNP);
         defineProperty(CurrentSteppersNP);
         defineProperty(PeriodsNP);
+#ifndef _KOHERON
+        defineProperty(CommandQueueNP);
+#endif
         defineProperty(JulianNP);
         defineProperty(TimeLSTNP);
         defineProperty(RAStatusLP);
@@ -419,6 +422,7 @@ bool EQMod::loadProperties()
     SteppersNP         = getNumber("STEPPERS");
     CurrentSteppersNP  = getNumber("CURRENTSTEPPERS");
     PeriodsNP          = getNumber("PERIODS");
+    CommandQueueNP     = getNumber("COMMANDQUEUE");
     JulianNP           = getNumber("JULIAN");
     TimeLSTNP          = getNumber("TIME_LST");
     RAStatusLP         = getLight("RASTATUS");
@@ -647,6 +651,9 @@ bool EQMod::updateProperties()
         defineProperty(SteppersNP);
         defineProperty(CurrentSteppersNP);
         defineProperty(PeriodsNP);
+#ifndef _KOHERON
+        defineProperty(CommandQueueNP);
+#endif
         defineProperty(JulianNP);
         defineProperty(TimeLSTNP);
         defineProperty(RAStatusLP);
@@ -778,6 +785,9 @@ bool EQMod::updateProperties()
         deleteProperty(SteppersNP);
         deleteProperty(CurrentSteppersNP);
         deleteProperty(PeriodsNP);
+#ifndef _KOHERON
+        deleteProperty(CommandQueueNP);
+#endif
         deleteProperty(JulianNP);
         deleteProperty(TimeLSTNP);
         deleteProperty(RAStatusLP);
@@ -1014,6 +1024,7 @@ bool EQMod::ReadScopeStatus()
     try
     {
         TelescopePierSide pierSide;
+        mount->ReadStatus();
         currentRAEncoder = mount->GetRAEncoder();
         currentDEEncoder = mount->GetDEEncoder();
         DEBUGF(DBG_SCOPE_STATUS, "Current encoders RA=%ld DE=%ld", static_cast<long>(currentRAEncoder),
@@ -1125,6 +1136,11 @@ bool EQMod::ReadScopeStatus()
         PeriodsNP.update(periods, (char **)periodsnames, 2);
         PeriodsNP.apply();
 
+#ifndef _KOHERON
+        mount->GetQueueStatistics(CommandQueueNP);
+        CommandQueueNP.apply();
+#endif
+
         // Log all coords
         {
             char CurrentRAString[64] = {0}, CurrentDEString[64] = {0},
@@ -2006,6 +2022,12 @@ bool EQMod::Goto(double r, double d)
             //            return true;
             return false;
         }
+        // The mount does not follow a great circle, so a crossing only warns
+        INDI::IEquatorialCoordinates currentradec { currentRA, currentDEC };
+        INDI::IHorizontalCoordinates currentaltaz;
+        INDI::EquatorialToHorizontal(&currentradec, &m_Location, juliandate, &currentaltaz);
+        if (!horizon->inGotoPathLimits(currentaltaz.azimuth, currentaltaz.altitude, gotoaz, gotoalt))
+            LOG_WARN("Goto path may cross Horizon Limits.");
     }
 #endif
 
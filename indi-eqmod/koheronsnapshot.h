@@ -0,0 +1,164 @@
+/* Copyright 2012 Geehalel (geehalel AT gmail DOT com) */
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <array>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+
+// Status of one axis as read from the FPGA in one ReadStatus() tick
+typedef struct KoheronAxisSnapshot
+{
+    uint32_t position;
+    uint32_t period;
+    uint16_t status;   // SwpGetAxisStatus() flags, bit n is element n
+    uint16_t pecindex; // I2C encoder position, RA only
+    uint16_t pecflags; // I2C encoder flags, RA only
+} KoheronAxisSnapshot;
+
+// Fixed layout of the reply to SwpGetStatusSnapshot(), four words per axis, RA first
+enum
+{
+    KOHERON_SNAPSHOT_POSITION = 0,
+    KOHERON_SNAPSHOT_PERIOD,
+    KOHERON_SNAPSHOT_STATUS,
+    KOHERON_SNAPSHOT_PEC, // encoder position in the high half, flags in the low half
+    KOHERON_SNAPSHOT_WORDS
+};
+typedef std::array<uint32_t, 2 * KOHERON_SNAPSHOT_WORDS> KoheronSnapshotWords;
+
+inline void UnpackKoheronSnapshot(const KoheronSnapshotWords &words, KoheronAxisSnapshot snapshot[2])
+{
+    for (int axis = 0; axis < 2; axis++)
+    {
+        const uint32_t *word = &words[axis * KOHERON_SNAPSHOT_WORDS];
+        snapshot[axis].position = word[KOHERON_SNAPSHOT_POSITION];
+        snapshot[axis].period   = word[KOHERON_SNAPSHOT_PERIOD];
+        snapshot[axis].status   = static_cast<uint16_t>(word[KOHERON_SNAPSHOT_STATUS]);
+        snapshot[axis].pecindex = static_cast<uint16_t>(word[KOHERON_SNAPSHOT_PEC] >> 16);
+        snapshot[axis].pecflags = static_cast<uint16_t>(word[KOHERON_SNAPSHOT_PEC]);
+    }
+}
+
+// Whether the FPGA server interface has the single snapshot request
+template <class Interface, class = void>
+struct KoheronHasSnapshot : std::false_type {};
+template <class Interface>
+struct KoheronHasSnapshot<Interface, decltype(void(std::declval<Interface &>().SwpGetStatusSnapshot()))> : std::true_type {};
+
+// Requests the FPGA server answers for one axis, one round trip each, for servers without the
+// snapshot request
+template <class Interface, typename Axis>
+void ReadKoheronAxisSnapshot(Interface &koheron, Axis axis, bool position, bool status, bool encoder,
+                             KoheronAxisSnapshot *snapshot)
+{
+    if (position)
+        snapshot->position = koheron.SwpGetAxisPosition(axis);
+    if (status)
+    {
+        auto response = koheron.SwpGetAxisStatus(axis);
+        uint16_t bits = 0;
+        for (size_t i = 0; i < response.size(); i++)
+            bits |= response[i] ? (1 << i) : 0;
+        snapshot->status = bits;
+    }
+    if (encoder)
+    {
+        std::array<uint16_t, 2> readback = koheron.get_iic_encoder();
+        snapshot->pecindex = readback[0];
+        snapshot->pecflags = readback[1];
+    }
+}
+
+template <class Interface>
+bool ReadKoheronSnapshot(Interface &koheron, bool, KoheronAxisSnapshot snapshot[2], std::true_type)
+{
+    UnpackKoheronSnapshot(koheron.SwpGetStatusSnapshot(), snapshot);
+    return true;
+}
+
+template <class Interface>
+bool ReadKoheronSnapshot(Interface &koheron, bool status, KoheronAxisSnapshot snapshot[2], std::false_type)
+{
+    for (int axis = 0; axis < 2; axis++)
+        ReadKoheronAxisSnapshot(koheron, axis, true, status, status && axis == 0, &snapshot[axis]);
+    return false;
+}
+
+/**
+ * @brief ReadKoheronSnapshot Read both axes for one status tick: one round trip when the server
+ * has the snapshot request, otherwise the positions, and the status words and RA encoder when
+ * status is set.
+ * @return true if the snapshot is complete, periods included, false if the periods were not read.
+ */
+template <class Interface>
+bool ReadKoheronSnapshot(Interface &koheron, bool status, KoheronAxisSnapshot snapshot[2])
+{
+    return ReadKoheronSnapshot(koheron, status, snapshot, KoheronHasSnapshot<Interface>());
+}
+
+// Tells which Koheron properties changed since they were last published
+class KoheronPublished
+{
+    public:
+        enum
+        {
+            MOTOR_STATUS = 1 << 0, // motor type and PEC enabled flags
+            PEC_POSITION = 1 << 1,
+            PEC_ERROR    = 1 << 2
+        };
+
+        static const uint16_t PUBLISHED_STATUS = (1 << 9) | (1 << 8); // TMC motor, PEC enabled
+        static const uint16_t PEC_ERROR_FLAG   = 0x1;
+
+        // Forget what was published, the next snapshot of each axis publishes everything
+        void reset()
+        {
+            valid[0] = valid[1] = pecvalid = false;
+        }
+
+        // Bit mask of what to publish for the axis, RA also carries the PEC encoder
+        int update(int axis, const KoheronAxisSnapshot &snapshot, bool pec)
+        {
+            int changed = 0;
+            if (!valid[axis] || ((snapshot.status ^ status[axis]) & PUBLISHED_STATUS))
+                changed |= MOTOR_STATUS;
+            valid[axis]  = true;
+            status[axis] = snapshot.status;
+
+            if (pec)
+            {
+                if (!pecvalid || snapshot.pecindex != pecindex || snapshot.pecflags != pecflags)
+                    changed |= PEC_POSITION;
+                if (!pecvalid || ((snapshot.pecflags ^ pecflags) & PEC_ERROR_FLAG))
+                    changed |= PEC_ERROR;
+                pecvalid = true;
+                pecindex = snapshot.pecindex;
+                pecflags = snapshot.pecflags;
+            }
+            return changed;
+        }
+
+    private:
+        bool valid[2] { false, false };
+        uint16_t status[2] { 0, 0 };
+        bool pecvalid { false };
+        uint16_t pecindex { 0 };
+        uint16_t pecflags { 0 };
+};
@@ -21,6 +21,7 @@
 
 #include <indicom.h>
 
+#include <cmath>
 #include <cstring>
 
 #include <algorithm> // std::sort
@@ -40,6 +41,7 @@ HorizonLimits::HorizonLimits(INDI::Telescope *t)
     strcpy(errorline, "Bad number format line     ");
     sline = errorline + 23;
     HorizonInitialized = false;
+    UpdateLookup();
 }
 
 HorizonLimits::~HorizonLimits()
@@ -57,6 +59,7 @@ void HorizonLimits::Reset()
 {
     if (horizon)
         horizon->erase(horizon->begin(), horizon->end());
+    UpdateLookup();
 }
 void HorizonLimits::Init()
 {
@@ -166,6 +169,7 @@ bool HorizonLimits::ISNewNumber(const char *dev, const char *name, double values
             }
             horizon->push_back(hp);
             std::sort(horizon->begin(), horizon->end(), HorizonLimits::cmp);
+            UpdateLookup();
             low          = std::lower_bound(horizon->begin(), horizon->end(), hp, HorizonLimits::cmp);
             horizonindex = std::distance(horizon->begin(), low);
             DEBUGF(INDI::Logger::DBG_SESSION,
@@ -265,6 +269,7 @@ bool HorizonLimits::ISNewSwitch(const char *dev, const char *name, ISState *stat
                 }
                 horizon->push_back(hp);
                 std::sort(horizon->begin(), horizon->end(), HorizonLimits::cmp);
+                UpdateLookup();
                 low          = std::lower_bound(horizon->begin(), horizon->end(), hp, HorizonLimits::cmp);
                 horizonindex = std::distance(horizon->begin(), low);
                 DEBUGF(INDI::Logger::DBG_SESSION,
@@ -289,6 +294,7 @@ bool HorizonLimits::ISNewSwitch(const char *dev, const char *name, ISState *stat
                 LOGF_INFO("Horizon Limits: Deleted point Az = %f, Alt  = %f, Rank=%d",
                           horizon->at(horizonindex).azimuth, horizon->at(horizonindex).altitude, horizonindex);
                 horizon->erase(horizon->begin() + horizonindex);
+                UpdateLookup();
                 if (horizonindex >= (int)horizon->size())
                     horizonindex = horizon->size() - 1;
                 az->setValue(horizon->at(horizonindex).azimuth);
@@ -304,6 +310,7 @@ bool HorizonLimits::ISNewSwitch(const char *dev, const char *name, ISState *stat
                 LOG_INFO("Horizon Limits: List cleared");
                 if (horizon)
                     horizon->erase(horizon->begin(), horizon->end());
+                UpdateLookup();
                 horizonindex            = -1;
                 az->setValue(0.0);
                 alt->setValue(0.0);
@@ -471,6 +478,7 @@ char *HorizonLimits::LoadDataFile(const char *filename)
     size_t len = 0;
     ssize_t read;
     int nline = 0, pos = 0;
+    char *result = nullptr;
     auto az  = HorizonLimitsPointNP.findWidgetByName("HORIZONLIMITS_POINT_AZ");
     auto alt = HorizonLimitsPointNP.findWidgetByName("HORIZONLIMITS_POINT_ALT");
 
@@ -486,7 +494,9 @@ char *HorizonLimits::LoadDataFile(const char *filename)
         return strerror(errno);
     }
     wordfree(&wexp);
-    Reset();
+    // The lookup is rebuilt once the file is read, whether it is read to the end or not
+    if (horizon)
+        horizon->clear();
     setlocale(LC_NUMERIC, "C");
 
     while ((read = getline(&line, &len, fp)) != -1)
@@ -499,26 +509,28 @@ char *HorizonLimits::LoadDataFile(const char *filename)
         double az, alt;
         if (sscanf(s, "%lg%n", &az, &pos) != 1)
         {
-            fclose(fp);
             snprintf((char *)sline, 4, "%d", nline);
-            setlocale(LC_NUMERIC, "");
-            return (char *)errorline;
+            result = (char *)errorline;
+            break;
         }
         s += pos;
         while ((*s == ' ') || (*s == '\t'))
             s++;
         if (sscanf(s, "%lg%n", &alt, &pos) != 1)
         {
-            fclose(fp);
             snprintf((char *)sline, 4, "%d", nline);
-            setlocale(LC_NUMERIC, "");
-            return (char *)errorline;
+            result = (char *)errorline;
+            break;
         }
         INDI::IHorizontalCoordinates one{az, alt};
         horizon->push_back(one);
         nline++;
         pos = 0;
     }
+    // Files written by hand may not be ordered, inLimits expects increasing azimuths. The points read
+    // before a malformed line are kept.
+    std::sort(horizon->begin(), horizon->end(), HorizonLimits::cmp);
+    UpdateLookup();
 
     horizonindex            = -1;
     az->setValue(0.0);
@@ -531,7 +543,43 @@ char *HorizonLimits::LoadDataFile(const char *filename)
 
     fclose(fp);
     setlocale(LC_NUMERIC, "");
-    return nullptr;
+    return result;
+}
+
+void HorizonLimits::UpdateLookup()
+{
+    lookup.assign(LOOKUP_SIZE + 1, 0);
+    if (horizon == nullptr)
+        return;
+
+    // Single merge pass over the sorted horizon, each entry is std::lower_bound of the cell start
+    uint32_t next = 0;
+    for (int cell = 0; cell <= LOOKUP_SIZE; cell++)
+    {
+        double const start = cell * LOOKUP_RESOLUTION;
+        while (next < horizon->size() && (*horizon)[next].azimuth < start)
+            next++;
+        lookup[cell] = next;
+    }
+}
+
+std::vector<INDI::IHorizontalCoordinates>::const_iterator HorizonLimits::findNext(double az) const
+{
+    INDI::IHorizontalCoordinates const scope{az, 0.0};
+
+    if (!(az >= 0.0 && az < 360.0))
+        return std::lower_bound(horizon->cbegin(), horizon->cend(), scope, HorizonLimits::cmp);
+
+    // The cell bounds must be the ones computed by UpdateLookup, the division may round to a neighbour
+    int cell = std::min(static_cast<int>(az / LOOKUP_RESOLUTION), LOOKUP_SIZE - 1);
+    if (az < cell * LOOKUP_RESOLUTION)
+        cell--;
+    else if (cell < LOOKUP_SIZE - 1 && az >= (cell + 1) * LOOKUP_RESOLUTION)
+        cell++;
+
+    // lower_bound of az lies between those of the cell bounds
+    return std::lower_bound(horizon->cbegin() + lookup[cell], horizon->cbegin() + lookup[cell + 1], scope,
+                            HorizonLimits::cmp);
 }
 
 bool HorizonLimits::inLimits(double raw_az, double raw_alt)
@@ -547,19 +595,18 @@ bool HorizonLimits::inLimits(double raw_az, double raw_alt)
         return scope.altitude >= horizon->begin()->altitude;
 
     // Search for the horizon point just after which the tested point may be inserted - see std::lower_bound documentation
-    std::vector<INDI::IHorizontalCoordinates>::iterator next = std::lower_bound(horizon->begin(), horizon->end(), scope,
-            HorizonLimits::cmp);
+    std::vector<INDI::IHorizontalCoordinates>::const_iterator next = findNext(scope.azimuth);
 
     // If the tested point would be inserted at the end of the horizon list, loop next point back to first
-    if (next == horizon->end())
-        next = horizon->begin();
+    if (next == horizon->cend())
+        next = horizon->cbegin();
 
     // If the tested azimuth is identical to the next point, test altitude directly
     if (next->azimuth == scope.azimuth)
         return (scope.altitude >= next->altitude);
 
     // Grab the previous horizon point - the one after which inserting the tested point does not alter horizon ordering
-    std::vector<INDI::IHorizontalCoordinates>::iterator const prev = ((next == horizon->begin()) ? horizon->end() : next) - 1;
+    std::vector<INDI::IHorizontalCoordinates>::const_iterator const prev = ((next == horizon->cbegin()) ? horizon->cend() : next) - 1;
 
     // If the altitude is identical between the two horizon siblings, test altitude directly
     if (prev->altitude == next->altitude)
@@ -582,6 +629,50 @@ bool HorizonLimits::inGotoLimits(double az, double alt)
     return (inLimits(az, alt) || (swlimitgotodisable->getState() == ISS_ON));
 }
 
+bool HorizonLimits::inGotoPathLimits(double fromaz, double fromalt, double toaz, double toalt)
+{
+    auto swlimitgotodisable = HorizonLimitsLimitGotoSP.findWidgetByName("HORIZONLIMITSLIMITGOTODISABLE");
+    if (swlimitgotodisable->getState() == ISS_ON)
+        return true;
+
+    double const from[3] = { cos(fromalt * M_PI / 180.0) * cos(fromaz * M_PI / 180.0),
+                             cos(fromalt * M_PI / 180.0) * sin(fromaz * M_PI / 180.0), sin(fromalt * M_PI / 180.0)
+                           };
+    double const to[3] = { cos(toalt * M_PI / 180.0) * cos(toaz * M_PI / 180.0),
+                           cos(toalt * M_PI / 180.0) * sin(toaz * M_PI / 180.0), sin(toalt * M_PI / 180.0)
+                         };
+    double const cosangle = std::max(-1.0, std::min(1.0, from[0] * to[0] + from[1] * to[1] + from[2] * to[2]));
+    double const angle    = acos(cosangle);
+    double const sinangle = sin(angle);
+
+    // Same or opposite positions: no single great circle, only the target can be checked
+    if (sinangle < 1e-9)
+        return inLimits(toaz, toalt);
+
+    // Sample the whole path first, one point per lookup cell, then test the samples. The start
+    // position is not tested, the scope may legitimately start from outside the limits.
+    int const n = std::min(static_cast<int>(ceil(angle * 180.0 / M_PI / LOOKUP_RESOLUTION)), LOOKUP_SIZE) + 1;
+    std::vector<double> az(n), alt(n);
+    for (int i = 0; i < n; i++)
+    {
+        double const t  = static_cast<double>(i) / (n - 1);
+        double const w0 = sin((1.0 - t) * angle) / sinangle;
+        double const w1 = sin(t * angle) / sinangle;
+        double const x  = w0 * from[0] + w1 * to[0];
+        double const y  = w0 * from[1] + w1 * to[1];
+        double const z  = w0 * from[2] + w1 * to[2];
+        alt[i] = asin(std::max(-1.0, std::min(1.0, z))) * 180.0 / M_PI;
+        az[i]  = atan2(y, x) * 180.0 / M_PI + 360.0 * (y < 0.0);
+    }
+    az[n - 1]  = toaz;
+    alt[n - 1] = toalt;
+
+    for (int i = 1; i < n; i++)
+        if (!inLimits(az[i], alt[i]))
+            return false;
+    return true;
+}
+
 bool HorizonLimits::checkLimits(double az, double alt, INDI::Telescope::TelescopeStatus status, bool ingoto)
 {
     static bool warningMessageDispatched = false;
@@ -19,6 +19,7 @@
 
 #include <inditelescope.h>
 
+#include <cstdint>
 #include <vector>
 
 class HorizonLimits
@@ -38,6 +39,14 @@ class HorizonLimits
     std::vector<INDI::IHorizontalCoordinates> *horizon;
     int horizonindex;
 
+    // For each azimuth cell of LOOKUP_RESOLUTION degrees, index of the first horizon point at or after
+    // the cell start, so that inLimits only searches the points inside one cell
+    static constexpr double LOOKUP_RESOLUTION = 0.05;
+    static constexpr int LOOKUP_SIZE          = 7200; // 360 / LOOKUP_RESOLUTION
+    std::vector<uint32_t> lookup;
+    void UpdateLookup();
+    std::vector<INDI::IHorizontalCoordinates>::const_iterator findNext(double az) const;
+
     char *WriteDataFile(const char *filename);
     char *LoadDataFile(const char *filename);
     char errorline[128];
@@ -63,6 +72,8 @@ class HorizonLimits
     virtual void Reset();
     virtual bool inLimits(double az, double alt);
     virtual bool inGotoLimits(double az, double alt);
+    // Check the great circle from one position to another, sampled at the lookup resolution
+    virtual bool inGotoPathLimits(double fromaz, double fromalt, double toaz, double toalt);
     virtual bool checkLimits(double az, double alt, INDI::Telescope::TelescopeStatus status, bool ingoto);
     virtual bool saveConfigItems(FILE *fp);
 
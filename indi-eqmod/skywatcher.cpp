@@ -75,6 +75,9 @@ bool Skywatcher::setKoheronInfo(const char * ip, int port)
 void Skywatcher::setPortFD(int value)
 {
     PortFD = value;
+#ifndef _KOHERON
+    cmdqueue.setPortFD(value);
+#endif
 }
 
 void Skywatcher::setSimulation(bool enable)
@@ -113,6 +116,8 @@ bool Skywatcher::Handshake()
                        return false;
     }
 
+    koheronpublished.reset();
+
     MCVersion = koheron_interface->SwpGetBoardVersion();
     MountCode    = MCVersion & 0xFF;
     LOGF_INFO("%s(): Board Version: %u", __func__, MCVersion);
@@ -156,21 +161,136 @@ bool Skywatcher::Disconnect()
     return true;
 }
 
-uint32_t Skywatcher::GetRAEncoder()
+void Skywatcher::ReadStatus()
 {
-    // Axis Position
 #ifdef _KOHERON
-    RAStep = koheron_interface->SwpGetAxisPosition(Axis1);
+    bool statusdue = IsMotorStatusDue(Axis1) || IsMotorStatusDue(Axis2);
+
+    ReadKoheronSnapshot(statusdue);
+    RAStep = snapshot[Axis1].position;
+    DEStep = snapshot[Axis2].position;
+    for (int i = Axis1; i < NUMBER_OF_SKYWATCHERAXIS; i++)
+    {
+        SkywatcherAxis axis = static_cast<SkywatcherAxis>(i);
+        gettimeofday(&lastreadmotorposition[axis], nullptr);
+        positionprefetched[axis] = true;
+        if (statusdue)
+        {
+            ApplyKoheronStatus(axis);
+            gettimeofday(&lastreadmotorstatus[axis], nullptr);
+        }
+    }
 #else
-    dispatch_command(GetAxisPosition, Axis1, nullptr);
+    if (isSimulation())
+        return;
 
-    uint32_t steps = Revu24str2long(response + 1);
-    if (steps & 0x80000000)
-        DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = Ignoring invalid response %s", __FUNCTION__, response);
-    else
-        RAStep = steps;
+    int position[NUMBER_OF_SKYWATCHERAXIS], status[NUMBER_OF_SKYWATCHERAXIS];
+    char cmd[SKYWATCHER_MAX_CMD];
+
+    positionprefetched[Axis1] = positionprefetched[Axis2] = false;
+    cmdqueue.clear();
+    for (int i = Axis1; i < NUMBER_OF_SKYWATCHERAXIS; i++)
+    {
+        SkywatcherAxis axis = static_cast<SkywatcherAxis>(i);
+        format_command(cmd, GetAxisPosition, axis, nullptr);
+        position[axis] = cmdqueue.enqueue(cmd, true);
+        status[axis]   = -1;
+        if (IsMotorStatusDue(axis))
+        {
+            format_command(cmd, GetAxisStatus, axis, nullptr);
+            status[axis] = cmdqueue.enqueue(cmd, true);
+        }
+    }
+
+    if (needflush)
+    {
+        tcflush(PortFD, TCIOFLUSH);
+        needflush = false;
+    }
+
+    if (!cmdqueue.submit(EQMOD_TIMEOUT))
+    {
+        // Leave it to the lock-step commands, which have their own retries
+        DEBUGF(telescope->DBG_COMM, "%s(): pipelined read failed: %s", __FUNCTION__, cmdqueue.getErrorMessage());
+        cmdqueue.recover();
+        queuefallbacks++;
+        return;
+    }
+
+    // Replies are checked and parsed exactly as read_eqmod() would have done. A failed reply is
+    // asked again in lock-step, with the flush and retries dispatch_command() gives a read error.
+    auto parsereply = [this](int ticket, SkywatcherCommand cmd, SkywatcherAxis axis)
+    {
+        const char *queued = cmdqueue.getCommand(ticket);
+        snprintf(command, SKYWATCHER_MAX_CMD, "%.*s", static_cast<int>(strlen(queued)) - 1, queued);
+        snprintf(response, SKYWATCHER_MAX_CMD, "%s", cmdqueue.getReply(ticket));
+        try
+        {
+            check_response();
+        }
+        catch (EQModError &ex)
+        {
+            DEBUGF(telescope->DBG_COMM, "%s(): pipelined reply failed: %s", __FUNCTION__, ex.message);
+            needflush = true;
+            queuefallbacks++;
+            dispatch_command(cmd, axis, nullptr);
+        }
+    };
+
+    for (int i = Axis1; i < NUMBER_OF_SKYWATCHERAXIS; i++)
+    {
+        SkywatcherAxis axis = static_cast<SkywatcherAxis>(i);
+
+        parsereply(position[axis], GetAxisPosition, axis);
+        ParseAxisPosition(axis);
+        gettimeofday(&lastreadmotorposition[axis], nullptr);
+        positionprefetched[axis] = true;
+
+        if (status[axis] >= 0)
+        {
+            parsereply(status[axis], GetAxisStatus, axis);
+            ParseMotorStatus(axis);
+            gettimeofday(&lastreadmotorstatus[axis], nullptr);
+        }
+    }
 
+    const SkywatcherCommandQueue::Statistics &stats = cmdqueue.getStatistics();
+    DEBUGF(telescope->DBG_COMM, "%s(): %zu commands, latency avg %.1fms min %.1fms max %.1fms (%llu replies, %llu coalesced)",
+           __FUNCTION__, cmdqueue.size(), stats.averageMS(), stats.minMS, stats.maxMS,
+           static_cast<unsigned long long>(stats.replies), static_cast<unsigned long long>(stats.coalesced));
 #endif
+}
+
+void Skywatcher::GetQueueStatistics(INDI::PropertyNumber queueNP)
+{
+#ifndef _KOHERON
+    const SkywatcherCommandQueue::Statistics &stats = cmdqueue.getStatistics();
+    queueNP.findWidgetByName("COMMANDS")->setValue(stats.commands);
+    queueNP.findWidgetByName("REPLIES")->setValue(stats.replies);
+    queueNP.findWidgetByName("COALESCED")->setValue(stats.coalesced);
+    queueNP.findWidgetByName("FALLBACKS")->setValue(queuefallbacks);
+    queueNP.findWidgetByName("LATENCYAVG")->setValue(stats.averageMS());
+    queueNP.findWidgetByName("LATENCYMIN")->setValue(stats.minMS);
+    queueNP.findWidgetByName("LATENCYMAX")->setValue(stats.maxMS);
+#else
+    INDI_UNUSED(queueNP);
+#endif
+}
+
+uint32_t Skywatcher::GetRAEncoder()
+{
+    // Axis Position
+    if (positionprefetched[Axis1])
+        positionprefetched[Axis1] = false;
+    else
+    {
+#ifdef _KOHERON
+        RAStep = koheron_interface->SwpGetAxisPosition(Axis1);
+#else
+        dispatch_command(GetAxisPosition, Axis1, nullptr);
+        ParseAxisPosition(Axis1);
+#endif
+    }
     gettimeofday(&lastreadmotorposition[Axis1], nullptr);
     if (RAStep != lastRAStep)
     {
@@ -183,17 +303,17 @@ uint32_t Skywatcher::GetRAEncoder()
 uint32_t Skywatcher::GetDEEncoder()
 {
     // Axis Position
+    if (positionprefetched[Axis2])
+        positionprefetched[Axis2] = false;
+    else
+    {
 #ifdef _KOHERON
-    DEStep = koheron_interface->SwpGetAxisPosition(Axis2);
+        DEStep = koheron_interface->SwpGetAxisPosition(Axis2);
 #else
-    dispatch_command(GetAxisPosition, Axis2, nullptr);
-
-    uint32_t steps = Revu24str2long(response + 1);
-    if (steps & 0x80000000)
-        DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = Ignoring invalid response %s", __FUNCTION__, response);
-    else
-        DEStep = steps;
+        dispatch_command(GetAxisPosition, Axis2, nullptr);
+        ParseAxisPosition(Axis2);
 #endif
+    }
     gettimeofday(&lastreadmotorposition[Axis2], nullptr);
     if (DEStep != lastDEStep)
     {
@@ -945,65 +1065,112 @@ bool Skywatcher::IsDERunning()
 void Skywatcher::ReadMotorStatus(SkywatcherAxis axis)
 {
 #ifdef _KOHERON
-    // Initialized, running, direction, speedmode, isGoto, isSlew
+    ReadKoheronAxisStatus(axis);
+    ApplyKoheronStatus(axis);
+#else
+    dispatch_command(GetAxisStatus, axis, nullptr);
+    //read_eqmod();
+    ParseMotorStatus(axis);
+#endif
+    gettimeofday(&lastreadmotorstatus[axis], nullptr);
+}
+
+#ifdef _KOHERON
+void Skywatcher::ReadKoheronAxisStatus(SkywatcherAxis axis)
+{
+    // The snapshot request costs one round trip, as much as the status word alone
+    if (KoheronHasSnapshot<ASCOM_sky_interface>::value)
+        ReadKoheronSnapshot(true);
+    else
+        ReadKoheronAxisSnapshot(*koheron_interface, axis, false, true, axis == Axis1, &snapshot[axis]);
+    if (axis == Axis1)
+        encoder_readback = { snapshot[Axis1].pecindex, snapshot[Axis1].pecflags };
+}
+
+// All the FPGA requests of one status tick, everything else works on the snapshot
+void Skywatcher::ReadKoheronSnapshot(bool status)
+{
+    if (::ReadKoheronSnapshot(*koheron_interface, status, snapshot))
+    {
+        RAPeriod = snapshot[Axis1].period;
+        DEPeriod = snapshot[Axis2].period;
+    }
+    else
+    {
+        // The server can't tell, keep the periods last set
+        snapshot[Axis1].period = RAPeriod;
+        snapshot[Axis2].period = DEPeriod;
+    }
+    if (status)
+        encoder_readback = { snapshot[Axis1].pecindex, snapshot[Axis1].pecflags };
+}
+
+void Skywatcher::ApplyKoheronStatus(SkywatcherAxis axis)
+{
     const char *propnames[] = {"VALUE" };
     const char *tmc[] = {"TMC2666" };
     const char *drv[] = {"DRV8825" };
     const char *en[] = {"Active" };
     const char *dis[] = {"Inactive" };
     const char *err[] = {"Error" };
-    std::array<bool, 10> response = koheron_interface->SwpGetAxisStatus(axis);
-    switch (axis)
+    const uint16_t bits = snapshot[axis].status;
+    auto flag = [bits](KoheronStatusBit bit)
     {
-        case Axis1:
-            RAInitialized      = response[0];
-            RARunning          = response[1];
-            RAStatus.direction = (response[2]) ? FORWARD : BACKWARD;
-            RAStatus.speedmode = LOWSPEED;//(response[3]) ? HIGHSPEED : LOWSPEED;
-            RAStatus.slewmode = SLEW;
-            if (response[5])
-                RAStatus.slewmode = SLEW;
-            if (response[4])
-                RAStatus.slewmode = GOTO;
-            telescope->MotorTypeRATP.update(response[9] ? tmc : drv, (char **)propnames, 1);
-            telescope->MotorTypeRATP.apply();
-            telescope->PECTP.update(response[8] ? en : dis, (char **)propnames, 1);
-            telescope->PECTP.apply();
-
-            encoder_readback = koheron_interface->get_iic_encoder();
-            telescope->PECErrorTP.update(encoder_readback[1] & 0x1 ? err : en, (char **)propnames, 1);
-            telescope->PECErrorTP.apply();
+        return (bits & (1 << bit)) != 0;
+    };
 
+    SkywatcherAxisStatus *axisstatus = (axis == Axis1) ? &RAStatus : &DEStatus;
+    if (axis == Axis1)
+    {
+        RAInitialized = flag(KOHERON_INITIALIZED);
+        RARunning     = flag(KOHERON_RUNNING);
+    }
+    else
+    {
+        DEInitialized = flag(KOHERON_INITIALIZED);
+        DERunning     = flag(KOHERON_RUNNING);
+    }
+    axisstatus->direction = flag(KOHERON_FORWARD) ? FORWARD : BACKWARD;
+    axisstatus->speedmode = LOWSPEED;
+    axisstatus->slewmode  = flag(KOHERON_GOTO) ? GOTO : SLEW;
 
-	          telescope->PECPositionNP.s=IPS_OK;
-            IDSetNumber(&(telescope->PECPositionNP), nullptr);
-            telescope->PECPosition[0].value = encoder_readback[0];
-            telescope->PECPosition[1].value = encoder_readback[1];
-	          telescope->PECPositionNP.s=IPS_BUSY;
-            IDSetNumber(&(telescope->PECPositionNP), nullptr);
-            break;
-                
-        case Axis2:
-            DEInitialized      = response[0];
-            DERunning          = response[1];
-            DEStatus.direction = (response[2]) ? FORWARD : BACKWARD;
-            DEStatus.speedmode = LOWSPEED; //(response[3]) ? HIGHSPEED : LOWSPEED;
-            DEStatus.slewmode = SLEW;
-            if (response[5])
-                DEStatus.slewmode = SLEW;
-            if (response[4])
-                DEStatus.slewmode = GOTO;
-            telescope->MotorTypeDETP.update(response[9] ? tmc : drv, (char **)propnames, 1);
+    // Motor type and PEC status rarely change, only publish them when they do
+    const int changed = koheronpublished.update(axis, snapshot[axis], axis == Axis1);
+    if (changed & KoheronPublished::MOTOR_STATUS)
+    {
+        if (axis == Axis1)
+        {
+            telescope->MotorTypeRATP.update(flag(KOHERON_TMC_MOTOR) ? tmc : drv, (char **)propnames, 1);
+            telescope->MotorTypeRATP.apply();
+            telescope->PECTP.update(flag(KOHERON_PEC_ENABLED) ? en : dis, (char **)propnames, 1);
+            telescope->PECTP.apply();
+        }
+        else
+        {
+            telescope->MotorTypeDETP.update(flag(KOHERON_TMC_MOTOR) ? tmc : drv, (char **)propnames, 1);
             telescope->MotorTypeDETP.apply();
-            break;
-        default:
-            break;
+        }
+    }
 
+    if (changed & KoheronPublished::PEC_ERROR)
+    {
+        telescope->PECErrorTP.update(snapshot[Axis1].pecflags & KoheronPublished::PEC_ERROR_FLAG ? err : en,
+                                     (char **)propnames, 1);
+        telescope->PECErrorTP.apply();
+    }
+    if (changed & KoheronPublished::PEC_POSITION)
+    {
+        telescope->PECPosition[0].value = snapshot[Axis1].pecindex;
+        telescope->PECPosition[1].value = snapshot[Axis1].pecflags;
+        telescope->PECPositionNP.s      = IPS_BUSY;
+        IDSetNumber(&(telescope->PECPositionNP), nullptr);
     }
+}
+#endif
 
-#else
-    dispatch_command(GetAxisStatus, axis, nullptr);
-    //read_eqmod();
+#ifndef _KOHERON
+void Skywatcher::ParseMotorStatus(SkywatcherAxis axis)
+{
     switch (axis)
     {
         case Axis1:
@@ -1041,10 +1208,20 @@ void Skywatcher::ReadMotorStatus(SkywatcherAxis axis)
         default:
             break;
     }
-#endif
-    gettimeofday(&lastreadmotorstatus[axis], nullptr);
 }
 
+void Skywatcher::ParseAxisPosition(SkywatcherAxis axis)
+{
+    uint32_t steps = Revu24str2long(response + 1);
+    if (steps & 0x80000000)
+        DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() = Ignoring invalid response %s", __FUNCTION__, response);
+    else if (axis == Axis1)
+        RAStep = steps;
+    else
+        DEStep = steps;
+}
+#endif
+
 void Skywatcher::SlewRA(double rate)
 {
     double absrate    = fabs(rate);
@@ -2194,14 +2371,19 @@ void Skywatcher::StopWaitMotor(SkywatcherAxis axis)
 
 void Skywatcher::CheckMotorStatus(SkywatcherAxis axis)
 {
-    struct timeval now;
     DEBUGF(telescope->DBG_SCOPE_STATUS, "%s() : Axis = %c", __FUNCTION__, AxisCmd[axis]);
-    gettimeofday(&now, nullptr);
-    if (((now.tv_sec - lastreadmotorstatus[axis].tv_sec) + ((now.tv_usec - lastreadmotorstatus[axis].tv_usec) / 1e6)) >
-        SKYWATCHER_MAXREFRESH)
+    if (IsMotorStatusDue(axis))
         ReadMotorStatus(axis);
 }
 
+bool Skywatcher::IsMotorStatusDue(SkywatcherAxis axis)
+{
+    struct timeval now;
+    gettimeofday(&now, nullptr);
+    return ((now.tv_sec - lastreadmotorstatus[axis].tv_sec) + ((now.tv_usec - lastreadmotorstatus[axis].tv_usec) / 1e6)) >
+           SKYWATCHER_MAXREFRESH;
+}
+
 double Skywatcher::get_min_rate()
 {
     return MIN_RATE;
@@ -2216,21 +2398,18 @@ bool Skywatcher::dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, ch
 {
     for (uint8_t i = 0; i < EQMOD_MAX_RETRY; i++)
     {
-        // Clear string
-        command[0] = '\0';
-
-        if (command_arg == nullptr)
-            snprintf(command, SKYWATCHER_MAX_CMD, "%c%c%c%c", SkywatcherLeadingChar, cmd, AxisCmd[axis],
-                     SkywatcherTrailingChar);
-        else
-            snprintf(command, SKYWATCHER_MAX_CMD, "%c%c%c%s%c", SkywatcherLeadingChar, cmd, AxisCmd[axis], command_arg,
-                     SkywatcherTrailingChar);
+        format_command(command, cmd, axis, command_arg);
 
         int nbytes_written = 0;
         if (!isSimulation())
         {
             int err_code = 0;
-            tcflush(PortFD, TCIOFLUSH);
+            // Only flush when recovering from an error, there is nothing to discard otherwise
+            if (i > 0 || needflush)
+            {
+                tcflush(PortFD, TCIOFLUSH);
+                needflush = false;
+            }
 
             if ((err_code = tty_write_string(PortFD, command, &nbytes_written)) != TTY_OK)
             {
@@ -2275,6 +2454,7 @@ bool Skywatcher::dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, ch
         catch (EQModError ex)
         {
             DEBUGF(telescope->DBG_COMM, "read_eqmod() failed: %s (attempt %i)", ex.message, i);
+            needflush = true;
             // By this time, we just rethrow the error
             // JM 2018-05-07 immediately rethrow if GET_FEATURES_CMD
             if (i == EQMOD_MAX_RETRY - 1 || cmd == GetFeatureCmd)
@@ -2287,6 +2467,15 @@ bool Skywatcher::dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, ch
     return true;
 }
 
+void Skywatcher::format_command(char *buf, SkywatcherCommand cmd, SkywatcherAxis axis, const char *arg)
+{
+    if (arg == nullptr)
+        snprintf(buf, SKYWATCHER_MAX_CMD, "%c%c%c%c", SkywatcherLeadingChar, cmd, AxisCmd[axis], SkywatcherTrailingChar);
+    else
+        snprintf(buf, SKYWATCHER_MAX_CMD, "%c%c%c%s%c", SkywatcherLeadingChar, cmd, AxisCmd[axis], arg,
+                 SkywatcherTrailingChar);
+}
+
 bool Skywatcher::read_eqmod()
 {
     int err_code = 0, nbytes_read = 0;
@@ -2317,6 +2506,12 @@ bool Skywatcher::read_eqmod()
         DEBUGF(telescope->DBG_COMM, "read_eqmod: \"%s\", %d bytes read", response, nbytes_read);
         debugnextread = false;
     }
+    check_response();
+    return true;
+}
+
+void Skywatcher::check_response()
+{
     switch (response[0])
     {
         case '=':
@@ -2335,8 +2530,6 @@ bool Skywatcher::read_eqmod()
         default:
             throw EQModError(EQModError::ErrInvalidCmd, "Invalid response to command %s - Reply %s", command, response);
     }
-
-    return true;
 }
 #endif
 uint32_t Skywatcher::Revu24str2long(char *s)
@@ -18,6 +18,7 @@
 #pragma once
 
 #include "eqmoderror.h"
+#include "skywatcherqueue.h"
 
 #include <inditelescope.h>
 
@@ -31,9 +32,11 @@ class EQMod; // TODO
 #include "simulator/simulator.h"
 #include <memory>
 #include <fpgaskytracker.hpp>
+#include "koheronsnapshot.h"
 
 #define SKYWATCHER_MAX_CMD      16
 #define SKYWATCHER_MAX_TRIES    3
+#define SKYWATCHER_MAX_INFLIGHT 4
 #define SKYWATCHER_ERROR_BUFFER 1024
 
 #define SKYWATCHER_SIDEREAL_DAY   86164.09053083288
@@ -67,6 +70,11 @@ class Skywatcher
         bool HasSnapPort2();
         bool HasPolarLed();
 
+        // Read both axis positions, and motor status when it is due, in one pipelined exchange.
+        // The following GetRAEncoder()/GetDEEncoder() calls return the positions read here.
+        void ReadStatus();
+        // Round-trip latency and counters of the pipelined status reads
+        void GetQueueStatistics(INDI::PropertyNumber queueNP);
         uint32_t GetRAEncoder();
         uint32_t GetDEEncoder();
         uint32_t GetRAEncoderZero();
@@ -154,6 +162,7 @@ class Skywatcher
 #ifdef _KOHERON
         std::array<uint16_t, 2> encoder_readback;
         std::unique_ptr<ASCOM_sky_interface> koheron_interface;
+        KoheronAxisSnapshot snapshot[2];
         bool setKoheronInfo(const char * ip, int port);
         void UpdateMinPeriod();
 #endif
@@ -276,7 +285,10 @@ class Skywatcher
         // Functions
         void InquireEncoderInfo(SkywatcherAxis axis, double *steppersvalues);
         void CheckMotorStatus(SkywatcherAxis axis);
+        bool IsMotorStatusDue(SkywatcherAxis axis);
         void ReadMotorStatus(SkywatcherAxis axis);
+        void ParseMotorStatus(SkywatcherAxis axis);
+        void ParseAxisPosition(SkywatcherAxis axis);
         void SetMotion(SkywatcherAxis axis, SkywatcherAxisStatus newstatus);
         void SetSpeed(SkywatcherAxis axis, uint32_t period, SkywatcherAxisStatus *cstate);
         void SetTarget(SkywatcherAxis axis, uint32_t increment);
@@ -302,10 +314,27 @@ class Skywatcher
 
 #ifndef _KOHERON
         bool read_eqmod();
+        void check_response();
         bool dispatch_command(SkywatcherCommand cmd, SkywatcherAxis axis, char *arg);
+        void format_command(char *buf, SkywatcherCommand cmd, SkywatcherAxis axis, const char *arg);
 #else
         uint32_t koheron_server_port;
         std::string koheron_server_ip;
+
+        enum KoheronStatusBit
+        {
+            KOHERON_INITIALIZED = 0,
+            KOHERON_RUNNING     = 1,
+            KOHERON_FORWARD     = 2,
+            KOHERON_GOTO        = 4,
+            KOHERON_PEC_ENABLED = 8,
+            KOHERON_TMC_MOTOR   = 9
+        };
+        void ReadKoheronSnapshot(bool status);
+        void ReadKoheronAxisStatus(SkywatcherAxis axis);
+        void ApplyKoheronStatus(SkywatcherAxis axis);
+        // Koheron properties are only sent again on change
+        KoheronPublished koheronpublished;
 #endif
         uint32_t minperiods[2];
 
@@ -357,6 +386,13 @@ class Skywatcher
 
         bool debug;
         bool debugnextread;
+        // Input may hold a late reply after a read error, flush before the next command
+        bool needflush {false};
+        // Position read by ReadStatus() not yet returned by GetRAEncoder()/GetDEEncoder()
+        bool positionprefetched[NUMBER_OF_SKYWATCHERAXIS] {false, false};
+        SkywatcherCommandQueue cmdqueue {SKYWATCHER_MAX_INFLIGHT};
+        // Pipelined replies that failed and were asked again in lock-step
+        uint64_t queuefallbacks {0};
         EQMod *telescope;
         bool reconnect;
 
@@ -0,0 +1,256 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "skywatcherqueue.h"
+
+#include "mach_gettime.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+SkywatcherCommandQueue::SkywatcherCommandQueue(size_t depth) : Depth(std::max<size_t>(depth, 1))
+{
+}
+
+void SkywatcherCommandQueue::setPortFD(int fd)
+{
+    PortFD = fd;
+}
+
+void SkywatcherCommandQueue::setDepth(size_t depth)
+{
+    Depth = std::max<size_t>(depth, 1);
+}
+
+size_t SkywatcherCommandQueue::getDepth() const
+{
+    return Depth;
+}
+
+int SkywatcherCommandQueue::enqueue(const char *command, bool coalesce)
+{
+    if (coalesce)
+    {
+        for (size_t i = 0; i < Entries.size(); i++)
+        {
+            if (Entries[i].command == command)
+            {
+                Stats.coalesced++;
+                return static_cast<int>(i);
+            }
+        }
+    }
+
+    Entry entry;
+    entry.command     = command;
+    entry.reply[0]    = '\0';
+    entry.replyLength = 0;
+    entry.sentMS      = 0;
+    Entries.push_back(entry);
+    return static_cast<int>(Entries.size() - 1);
+}
+
+bool SkywatcherCommandQueue::submit(long timeoutUS)
+{
+    size_t sent = 0, received = 0;
+
+    ErrorMessage[0] = '\0';
+    if (PortFD < 0)
+    {
+        setError("port is not open");
+        return false;
+    }
+
+    while (received < Entries.size())
+    {
+        // Keep the pipe full: the controller answers in order, so everything between
+        // received and sent is in flight.
+        while (sent < Entries.size() && sent - received < Depth)
+        {
+            if (!writeCommand(Entries[sent], timeoutUS))
+                return false;
+            sent++;
+        }
+
+        if (!readReplies(received, timeoutUS))
+            return false;
+    }
+
+    return true;
+}
+
+bool SkywatcherCommandQueue::writeCommand(Entry &entry, long timeoutUS)
+{
+    const char *buf = entry.command.c_str();
+    size_t remaining = entry.command.size();
+
+    entry.sentMS = nowMS();
+    while (remaining > 0)
+    {
+        ssize_t n = write(PortFD, buf, remaining);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                setError("write failed: %s", strerror(errno));
+                return false;
+            }
+
+            struct pollfd pfd = { PortFD, POLLOUT, 0 };
+            if (poll(&pfd, 1, timeoutUS / 1000) <= 0)
+            {
+                setError("write timeout");
+                return false;
+            }
+            continue;
+        }
+        buf += n;
+        remaining -= n;
+    }
+
+    Stats.commands++;
+    return true;
+}
+
+bool SkywatcherCommandQueue::readReplies(size_t &received, long timeoutUS)
+{
+    char buf[64];
+    struct pollfd pfd = { PortFD, POLLIN, 0 };
+
+    int rc = poll(&pfd, 1, timeoutUS / 1000);
+    if (rc < 0 && errno == EINTR)
+        return true;
+    if (rc <= 0)
+    {
+        setError("timeout waiting for reply to %.*s (%zu of %zu received)",
+                 static_cast<int>(Entries[received].command.size() - 1), Entries[received].command.c_str(), received,
+                 Entries.size());
+        return false;
+    }
+
+    ssize_t n = read(PortFD, buf, sizeof(buf));
+    if (n < 0)
+    {
+        if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+            return true;
+        setError("read failed: %s", strerror(errno));
+        return false;
+    }
+    if (n == 0)
+    {
+        setError("connection closed");
+        return false;
+    }
+
+    for (ssize_t i = 0; i < n; i++)
+    {
+        if (received >= Entries.size())
+        {
+            setError("unexpected data after last reply");
+            return false;
+        }
+
+        Entry &entry = Entries[received];
+        if (buf[i] == 0x0D)
+        {
+            entry.reply[entry.replyLength] = '\0';
+
+            double latency = nowMS() - entry.sentMS;
+            Stats.minMS = (Stats.replies == 0) ? latency : std::min(Stats.minMS, latency);
+            Stats.maxMS = std::max(Stats.maxMS, latency);
+            Stats.totalMS += latency;
+            Stats.replies++;
+
+            received++;
+            continue;
+        }
+
+        if (entry.replyLength >= MAX_REPLY - 1)
+        {
+            setError("reply to %.*s too long", static_cast<int>(entry.command.size() - 1), entry.command.c_str());
+            return false;
+        }
+        entry.reply[entry.replyLength++] = buf[i];
+    }
+
+    return true;
+}
+
+const char *SkywatcherCommandQueue::getReply(int ticket) const
+{
+    return Entries[ticket].reply;
+}
+
+const char *SkywatcherCommandQueue::getCommand(int ticket) const
+{
+    return Entries[ticket].command.c_str();
+}
+
+size_t SkywatcherCommandQueue::size() const
+{
+    return Entries.size();
+}
+
+void SkywatcherCommandQueue::clear()
+{
+    Entries.clear();
+}
+
+void SkywatcherCommandQueue::recover()
+{
+    if (PortFD >= 0)
+        tcflush(PortFD, TCIOFLUSH);
+    Entries.clear();
+}
+
+const char *SkywatcherCommandQueue::getErrorMessage() const
+{
+    return ErrorMessage;
+}
+
+const SkywatcherCommandQueue::Statistics &SkywatcherCommandQueue::getStatistics() const
+{
+    return Stats;
+}
+
+void SkywatcherCommandQueue::resetStatistics()
+{
+    Stats = Statistics();
+}
+
+void SkywatcherCommandQueue::setError(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(ErrorMessage, sizeof(ErrorMessage), fmt, ap);
+    va_end(ap);
+}
+
+double SkywatcherCommandQueue::nowMS()
+{
+    struct timespec ts;
+    get_utc_time(&ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
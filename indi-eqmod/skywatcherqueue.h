@@ -0,0 +1,111 @@
+/* This file is part of the Skywatcher Protocol INDI driver.
+
+    The Skywatcher Protocol INDI driver is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    The Skywatcher Protocol INDI driver is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with the Skywatcher Protocol INDI driver.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Pipelined command queue for the Skywatcher motor controller protocol.
+ *
+ * Commands are collected with enqueue() during one status tick and sent with submit(), which keeps
+ * up to depth commands in flight on the serial link. The motor controller answers commands in the
+ * order it receives them, so replies are matched to commands in FIFO order. Identical queries
+ * enqueued in the same tick are coalesced and share a single reply.
+ *
+ * The queue does not interpret replies. It only splits the byte stream at the trailing CR, leaving
+ * reply validation to the caller. On failure the link state is unknown: call recover() to drop
+ * any late replies before the port is used again.
+ */
+class SkywatcherCommandQueue
+{
+    public:
+        static constexpr size_t DEFAULT_DEPTH = 4;
+        static constexpr size_t MAX_REPLY     = 16;
+
+        typedef struct Statistics
+        {
+            uint64_t commands  = 0; // Commands sent
+            uint64_t replies   = 0; // Replies received
+            uint64_t coalesced = 0; // Duplicate queries answered by an already queued command
+            double minMS       = 0; // Round-trip latency, command written to reply complete
+            double maxMS       = 0;
+            double totalMS     = 0;
+            double averageMS() const
+            {
+                return replies ? totalMS / replies : 0;
+            }
+        } Statistics;
+
+        explicit SkywatcherCommandQueue(size_t depth = DEFAULT_DEPTH);
+
+        void setPortFD(int fd);
+        void setDepth(size_t depth);
+        size_t getDepth() const;
+
+        /**
+         * @brief enqueue Add a command to the current tick.
+         * @param command Full command including the leading ':' and the trailing CR.
+         * @param coalesce If true and the same command is already queued, reuse its reply.
+         * @return ticket to retrieve the reply after submit().
+         */
+        int enqueue(const char *command, bool coalesce = false);
+
+        /**
+         * @brief submit Send all queued commands and collect their replies.
+         * @param timeoutUS Maximum time to wait for each reply, in microseconds.
+         * @return true if every command got a reply, false otherwise, see getErrorMessage().
+         */
+        bool submit(long timeoutUS);
+
+        /** @return reply to the command identified by ticket, without the trailing CR. */
+        const char *getReply(int ticket) const;
+        const char *getCommand(int ticket) const;
+        size_t size() const;
+
+        /** Start a new tick, forgetting queued commands and their replies. */
+        void clear();
+
+        /** Drop any pending input and output after a failed submit(). */
+        void recover();
+
+        const char *getErrorMessage() const;
+        const Statistics &getStatistics() const;
+        void resetStatistics();
+
+    private:
+        typedef struct Entry
+        {
+            std::string command;
+            char reply[MAX_REPLY];
+            size_t replyLength;
+            double sentMS;
+        } Entry;
+
+        bool writeCommand(Entry &entry, long timeoutUS);
+        bool readReplies(size_t &received, long timeoutUS);
+        void setError(const char *fmt, ...);
+        static double nowMS();
+
+        int PortFD { -1 };
+        size_t Depth;
+        std::vector<Entry> Entries;
+        Statistics Stats;
+        char ErrorMessage[128] { 0 };
+};
@@ -0,0 +1,512 @@
+/*
+    Hardware-free EQMod benchmark
+
+    The driver talks to the Skywatcher simulator through a pty. The server side of the pty emulates
+    the line rate and the round trip latency of the link, so the status loop and goto timings are
+    comparable between runs without a mount. Results are written as a single JSON object.
+
+    bench_eqmod [--baud N] [--latency-ms X] [--ticks N] [--period-ms N] [--align-mode none|nearest|nstar]
+                [--align-points N] [--horizon-points N] [--goto] [--goto-timeout-s N] [--output FILE]
+
+    --baud 0 disables the line rate emulation, --latency-ms is the full round trip.
+*/
+
+#include "config.h"
+#include "eqmodbase.h"
+#include "simulator/skywatcher-simulator.h"
+#ifdef WITH_SCOPE_LIMITS
+#include "scope-limits/scope-limits.h"
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// Skywatcher simulator behind an emulated serial link. Commands are timestamped as they are written
+// by the driver, each one reaches the mount after its own transmission time plus half the latency,
+// replies leave the mount one after the other and reach the driver after the other half.
+class EmulatedLink
+{
+public:
+    EmulatedLink(uint32_t baud, double latencyMS) : Baud(baud), HalfLatency(latencyMS / 2)
+    {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+            return;
+        slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        if (slave < 0)
+            return;
+
+        struct termios tio;
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+
+        simulator.setupVersion("020300");
+        simulator.setupRA(180, 47, 12, 200, 64, 2);
+        simulator.setupDE(180, 47, 12, 200, 64, 2);
+
+        reader = std::thread(&EmulatedLink::readLoop, this);
+        writer = std::thread(&EmulatedLink::writeLoop, this);
+    }
+
+    ~EmulatedLink()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        pending.notify_all();
+        // Closing the slave side makes the reader fail
+        if (slave >= 0)
+            close(slave);
+        if (reader.joinable())
+            reader.join();
+        if (writer.joinable())
+            writer.join();
+        if (master >= 0)
+            close(master);
+    }
+
+    int master { -1 };
+    int slave { -1 };
+    std::atomic<uint64_t> bytesToMount { 0 };
+    std::atomic<uint64_t> bytesFromMount { 0 };
+
+private:
+    typedef struct Reply
+    {
+        Clock::time_point delivery;
+        std::string data;
+    } Reply;
+
+    Clock::duration byteTime(size_t bytes) const
+    {
+        // 8N1, 10 bits per byte
+        if (Baud == 0)
+            return Clock::duration::zero();
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(bytes * 10.0 / Baud));
+    }
+
+    void readLoop()
+    {
+        char cmd[32], reply[32], c;
+        size_t len = 0;
+        Clock::time_point rxFree = Clock::now(), txFree = rxFree;
+        auto half = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(HalfLatency));
+
+        while (read(master, &c, 1) == 1)
+        {
+            bytesToMount++;
+            if (len < sizeof(cmd) - 1)
+                cmd[len++] = c;
+            if (c != 0x0D)
+                continue;
+            cmd[len] = '\0';
+
+            // Command complete at the mount, then the reply is sent once the mount side of the line is free
+            Clock::time_point now = Clock::now();
+            rxFree = std::max(now, rxFree) + byteTime(len);
+            len    = 0;
+
+            int n = 0;
+            simulator.process_command(cmd, &n);
+            simulator.get_reply(reply, &n);
+
+            Clock::time_point start = std::max(rxFree + half, txFree);
+            txFree = start + byteTime(n);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            replies.push_back({ txFree + half, std::string(reply, n) });
+            pending.notify_all();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        pending.notify_all();
+    }
+
+    void writeLoop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            pending.wait(lock, [this]()
+            {
+                return !running || !replies.empty();
+            });
+            if (replies.empty())
+                return;
+
+            Reply r = replies.front();
+            replies.pop_front();
+            lock.unlock();
+            std::this_thread::sleep_until(r.delivery);
+            if (write(master, r.data.data(), r.data.size()) == static_cast<ssize_t>(r.data.size()))
+                bytesFromMount += r.data.size();
+            lock.lock();
+        }
+    }
+
+    uint32_t Baud;
+    double HalfLatency;
+    SkywatcherSimulator simulator;
+    std::thread reader, writer;
+    std::mutex mutex;
+    std::condition_variable pending;
+    std::deque<Reply> replies;
+    bool running { true };
+};
+
+class BenchEQMod : public EQMod
+{
+public:
+    BenchEQMod()
+    {
+        initProperties();
+        updateLocation(50.0, 15.0, 0);
+    }
+
+    bool attach(int fd)
+    {
+        PortFD = fd;
+        try
+        {
+            mount->setPortFD(fd);
+            mount->Handshake();
+        }
+        catch (EQModError &e)
+        {
+            fprintf(stderr, "Handshake failed: %s\n", e.message);
+            return false;
+        }
+        setConnected(true, IPS_OK);
+        return updateProperties();
+    }
+
+    bool setAlignMode(const char *mode)
+    {
+#ifdef WITH_ALIGN_GEEHALEL
+        ISState on[] = { ISS_ON };
+        const char *names[] = { mode };
+        return align->ISNewSwitch(getDeviceName(), "ALIGNMODE", on, (char **)names, 1);
+#else
+        INDI_UNUSED(mode);
+        return false;
+#endif
+    }
+
+    // Synthetic sync points spread over the sky above the horizon, same set on every run
+    void addAlignPoints(int count)
+    {
+#ifdef WITH_ALIGN_GEEHALEL
+        uint32_t seed = 1;
+        auto next = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return (seed >> 8) / 16777216.0;
+        };
+        double jd  = getJulianDate();
+        double lst = getLst(jd, getLongitude());
+        for (int i = 0; i < count; i++)
+        {
+            SyncData point;
+            memset(&point, 0, sizeof(point));
+            point.lst          = lst;
+            point.jd           = jd;
+            point.targetRA     = 24.0 * next();
+            point.targetDEC    = -10.0 + 99.0 * next();
+            point.telescopeRA  = point.targetRA + (next() - 0.5) / 60.0;
+            point.telescopeDEC = point.targetDEC + (next() - 0.5) / 4.0;
+            align->AlignSync(syncdata, point);
+        }
+#else
+        INDI_UNUSED(count);
+#endif
+    }
+
+    void addHorizonPoints(int count)
+    {
+#ifdef WITH_SCOPE_LIMITS
+        auto point = getNumber("HORIZONTAL_COORD");
+        ISState on[] = { ISS_ON };
+        const char *add[] = { "HORIZONLIMITSLISTADDCURRENT" };
+        for (int i = 0; i < count; i++)
+        {
+            point.findWidgetByName("AZ")->value  = 360.0 * i / count;
+            point.findWidgetByName("ALT")->value = 10.0 + 10.0 * sin(6.0 * M_PI * i / count);
+            horizon->ISNewSwitch(getDeviceName(), "HORIZONLIMITSMANAGE", on, (char **)add, 1);
+        }
+#else
+        INDI_UNUSED(count);
+#endif
+    }
+
+    // Alignment and limit checks are replayed with the coordinates of the last status read, on the
+    // same thread, to time them apart from the serial exchange.
+    double alignCPU()
+    {
+        double t0 = threadCPU();
+#ifdef WITH_ALIGN_GEEHALEL
+        double ra, dec;
+        if (align)
+            align->GetAlignedCoords(syncdata, getJulianDate(), &m_Location, currentRA, currentDEC, &ra, &dec);
+#endif
+        return threadCPU() - t0;
+    }
+
+    double limitsCPU()
+    {
+        double t0 = threadCPU();
+#ifdef WITH_SCOPE_LIMITS
+        if (horizon)
+            horizon->inLimits(lnaltaz.azimuth, lnaltaz.altitude);
+#endif
+        return threadCPU() - t0;
+    }
+
+    double gotoLimitsCPU(double toaz, double toalt)
+    {
+        double t0 = threadCPU();
+#ifdef WITH_SCOPE_LIMITS
+        if (horizon)
+        {
+            horizon->inGotoLimits(toaz, toalt);
+            horizon->inGotoPathLimits(lnaltaz.azimuth, lnaltaz.altitude, toaz, toalt);
+        }
+#else
+        INDI_UNUSED(toaz);
+        INDI_UNUSED(toalt);
+#endif
+        return threadCPU() - t0;
+    }
+
+    bool startTracking()
+    {
+        return SetTrackEnabled(true);
+    }
+
+    bool isSlewing()
+    {
+        return gotoInProgress();
+    }
+
+    double getRA() const
+    {
+        return currentRA;
+    }
+
+    double getDEC() const
+    {
+        return currentDEC;
+    }
+
+    // Microseconds of CPU time used by the calling thread
+    static double threadCPU()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+    }
+};
+
+class Series
+{
+public:
+    void add(double v)
+    {
+        values.push_back(v);
+    }
+
+    void print(FILE *out, const char *name, bool last = false)
+    {
+        std::vector<double> v = values;
+        std::sort(v.begin(), v.end());
+        double sum = 0;
+        for (double x : v)
+            sum += x;
+        auto pct = [&v](double p)
+        {
+            return v.empty() ? 0 : v[std::min(v.size() - 1, static_cast<size_t>(p * v.size()))];
+        };
+        fprintf(out, "    \"%s\": {\"count\": %zu, \"min\": %.3f, \"mean\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"max\": %.3f}%s\n",
+                name, v.size(), v.empty() ? 0 : v.front(), v.empty() ? 0 : sum / v.size(), pct(0.5), pct(0.95),
+                v.empty() ? 0 : v.back(), last ? "" : ",");
+    }
+
+private:
+    std::vector<double> values;
+};
+
+static double elapsedMS(Clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t baud      = 9600;
+    double latencyMS   = 2.0;
+    int ticks          = 200;
+    int periodMS       = 0;
+    int alignPoints    = 0;
+    int horizonPoints  = 0;
+    int gotoTimeoutS   = 120;
+    bool doGoto        = false;
+    const char *mode   = "nearest";
+    const char *output = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--baud"))
+            baud = atoi(argv[++i]);
+        else if (arg("--latency-ms"))
+            latencyMS = atof(argv[++i]);
+        else if (arg("--ticks"))
+            ticks = atoi(argv[++i]);
+        else if (arg("--period-ms"))
+            periodMS = atoi(argv[++i]);
+        else if (arg("--align-mode"))
+            mode = argv[++i];
+        else if (arg("--align-points"))
+            alignPoints = atoi(argv[++i]);
+        else if (arg("--horizon-points"))
+            horizonPoints = atoi(argv[++i]);
+        else if (arg("--goto-timeout-s"))
+            gotoTimeoutS = atoi(argv[++i]);
+        else if (arg("--output"))
+            output = argv[++i];
+        else if (!strcmp(argv[i], "--goto"))
+            doGoto = true;
+        else
+        {
+            fprintf(stderr, "Usage: %s [--baud N] [--latency-ms X] [--ticks N] [--period-ms N] [--align-mode none|nearest|nstar]\n"
+                    "       [--align-points N] [--horizon-points N] [--goto] [--goto-timeout-s N] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    INDI::Logger::getInstance().configure("", INDI::Logger::file_off, INDI::Logger::DBG_ERROR, INDI::Logger::DBG_ERROR);
+    me = strdup("indi_eqmod_bench");
+
+    EmulatedLink link(baud, latencyMS);
+    if (link.slave < 0)
+    {
+        fprintf(stderr, "Unable to open a pty\n");
+        return 1;
+    }
+
+    BenchEQMod eqmod;
+    Clock::time_point start = Clock::now();
+    if (!eqmod.attach(link.slave))
+        return 1;
+    double connectMS = elapsedMS(start);
+
+    const char *modeSwitch = !strcmp(mode, "nstar") ? "ALIGNNSTAR" : !strcmp(mode, "none") ? "NOALIGN" : "ALIGNNEAREST";
+    eqmod.setAlignMode(modeSwitch);
+    eqmod.addAlignPoints(alignPoints);
+    eqmod.addHorizonPoints(horizonPoints);
+    eqmod.startTracking();
+
+    // Status loop
+    Series statusMS, statusCPU, alignCPU, limitsCPU, bytesOut, bytesIn;
+    int failures = 0;
+    for (int i = 0; i < ticks; i++)
+    {
+        uint64_t out = link.bytesToMount, in = link.bytesFromMount;
+        double cpu   = BenchEQMod::threadCPU();
+        Clock::time_point t0 = Clock::now();
+
+        if (!eqmod.ReadScopeStatus())
+            failures++;
+
+        statusMS.add(elapsedMS(t0));
+        statusCPU.add(BenchEQMod::threadCPU() - cpu);
+        // Replies still in flight are counted with the next tick, wait for the line to settle
+        usleep(1000);
+        bytesOut.add(link.bytesToMount - out);
+        bytesIn.add(link.bytesFromMount - in);
+        alignCPU.add(eqmod.alignCPU());
+        limitsCPU.add(eqmod.limitsCPU());
+
+        if (periodMS > 0)
+            std::this_thread::sleep_until(t0 + std::chrono::milliseconds(periodMS));
+    }
+
+    // Goto to a fixed offset from the current position, then status reads until the slew completes
+    double gotoCallMS = 0, gotoMS = 0, gotoLimitsCPU = 0;
+    int gotoTicks     = 0;
+    bool gotoDone     = false;
+    if (doGoto)
+    {
+        double ra  = fmod(eqmod.getRA() + 2.0, 24.0);
+        double dec = std::min(eqmod.getDEC() + 20.0, 80.0);
+
+        gotoLimitsCPU = eqmod.gotoLimitsCPU(90.0, 45.0);
+        Clock::time_point t0 = Clock::now();
+        bool accepted = eqmod.Goto(ra, dec);
+        gotoCallMS    = elapsedMS(t0);
+
+        while (accepted && elapsedMS(t0) < gotoTimeoutS * 1000.0)
+        {
+            eqmod.ReadScopeStatus();
+            gotoTicks++;
+            if (!eqmod.isSlewing())
+            {
+                gotoDone = true;
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(std::max(periodMS, 100)));
+        }
+        gotoMS = elapsedMS(t0);
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"eqmod\",\n");
+    fprintf(out, "  \"config\": {\"baud\": %u, \"latency_ms\": %.3f, \"ticks\": %d, \"period_ms\": %d, \"align_mode\": \"%s\", "
+            "\"align_points\": %d, \"horizon_points\": %d, \"goto\": %s},\n",
+            baud, latencyMS, ticks, periodMS, mode, alignPoints, horizonPoints, doGoto ? "true" : "false");
+    fprintf(out, "  \"connect_ms\": %.3f,\n", connectMS);
+    fprintf(out, "  \"status_failures\": %d,\n", failures);
+    fprintf(out, "  \"status\": {\n");
+    statusMS.print(out, "read_scope_status_ms");
+    statusCPU.print(out, "read_scope_status_cpu_us");
+    alignCPU.print(out, "align_cpu_us");
+    limitsCPU.print(out, "limits_cpu_us");
+    bytesOut.print(out, "bytes_to_mount_per_tick");
+    bytesIn.print(out, "bytes_from_mount_per_tick", true);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"goto\": {\"call_ms\": %.3f, \"limits_cpu_us\": %.3f, \"ticks\": %d, \"duration_ms\": %.3f, \"completed\": %s}\n",
+            gotoCallMS, gotoLimitsCPU, gotoTicks, gotoMS, gotoDone ? "true" : "false");
+    fprintf(out, "}\n");
+    if (output)
+        fclose(out);
+
+    return failures ? 1 : 0;
+}
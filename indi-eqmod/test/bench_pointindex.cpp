@@ -0,0 +1,244 @@
+/*
+    Alignment point index benchmark
+
+    Builds a synthetic model of random points above the horizon, triangulated as the driver does,
+    and follows a tracking path through it. Each query is answered with PointIndex and FaceLocator,
+    and with the full scans they replaced: distance to every point, and every face tested in turn
+    from the last one found. Mismatches and the time per query are written as a single JSON object.
+
+    bench_pointindex [--points N] [--queries N] [--nearest N] [--seed N] [--output FILE]
+*/
+
+#include "align/pointindex.h"
+#include "align/triangulate_chull.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <utility>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double range360(double r)
+{
+    r = fmod(r, 360.0);
+    return r < 0 ? r + 360.0 : r;
+}
+
+// Unit vector of an alt/az direction, as in PointSet::NearestPoints()
+static void direction(double alt, double az, double *v)
+{
+    double horangle = range360(-180.0 - az) * M_PI / 180.0;
+    double altangle = alt * M_PI / 180.0;
+    v[0] = cos(altangle) * cos(horangle);
+    v[1] = cos(altangle) * sin(horangle);
+    v[2] = sin(altangle);
+}
+
+static double scalarTripleProduct(const double *p, const PointSet::Point &e1, const PointSet::Point &e2)
+{
+    return (p[0] * e1.cy * e2.cz) + (p[2] * e1.cx * e2.cy) + (p[1] * e1.cz * e2.cx) -
+           (p[2] * e1.cy * e2.cx) - (p[0] * e1.cz * e2.cy) - (p[1] * e1.cx * e2.cz);
+}
+
+// PointSet::isPointInside() on the celestial coordinates
+static bool isPointInside(const double *p, const std::vector<HtmID> &f, std::map<HtmID, PointSet::Point> &points)
+{
+    bool left = false, right = false;
+    const int edges[3][2] = { { 2, 0 }, { 0, 1 }, { 1, 2 } };
+    for (int e = 0; e < 3; e++)
+    {
+        if (scalarTripleProduct(p, points.at(f[edges[e][0]]), points.at(f[edges[e][1]])) < 0)
+            left = true;
+        else
+            right = true;
+        if (left && right)
+            return false;
+    }
+    return true;
+}
+
+static double elapsedUS(Clock::time_point start, int count)
+{
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / count;
+}
+
+int main(int argc, char **argv)
+{
+    int npoints   = 1000;
+    int nqueries  = 20000;
+    int nnearest  = 1;
+    int seed      = 1;
+    const char *output = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--points"))
+            npoints = atoi(argv[++i]);
+        else if (arg("--queries"))
+            nqueries = atoi(argv[++i]);
+        else if (arg("--nearest"))
+            nnearest = atoi(argv[++i]);
+        else if (arg("--seed"))
+            seed = atoi(argv[++i]);
+        else if (arg("--output"))
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--points N] [--queries N] [--nearest N] [--seed N] [--output FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (npoints < 4 || nqueries < 1 || nnearest < 1 || nnearest > PointIndex::MAX_NEAREST)
+    {
+        fprintf(stderr, "At least 4 points and 1 query, and 1 to %d nearest points\n", PointIndex::MAX_NEAREST);
+        return 1;
+    }
+
+    // Synthetic model, 5 to 85 degrees of altitude
+    std::map<HtmID, PointSet::Point> points;
+    std::vector<HtmID> ids;
+    srand(seed);
+    for (int i = 0; i < npoints; i++)
+    {
+        PointSet::Point p {};
+        p.index = i;
+        p.htmID = 1000 + i;
+        p.celestialALT = 5.0 + 80.0 * rand() / RAND_MAX;
+        p.celestialAZ  = 360.0 * rand() / RAND_MAX;
+        double v[3];
+        direction(p.celestialALT, p.celestialAZ, v);
+        p.cx = v[0];
+        p.cy = v[1];
+        p.cz = v[2];
+        points[p.htmID] = p;
+        ids.push_back(p.htmID);
+    }
+
+    auto start = Clock::now();
+    TriangulateCHull triangulation(&points);
+    triangulation.AddPoints(ids);
+    std::vector<std::vector<HtmID>> faces;
+    for (Face *f : triangulation.getFaces())
+        faces.push_back(f->v);
+    double triangulateMS = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    start = Clock::now();
+    PointIndex index;
+    FaceLocator locator;
+    for (auto &it : points)
+        index.addPoint(it.first, it.second.cx, it.second.cy, it.second.cz);
+    index.build();
+    for (auto &f : faces)
+    {
+        const PointSet::Point &a = points.at(f[0]), &b = points.at(f[1]), &c = points.at(f[2]);
+        const double va[3] = { a.cx, a.cy, a.cz }, vb[3] = { b.cx, b.cy, b.cz }, vc[3] = { c.cx, c.cy, c.cz };
+        locator.addFace(f.data(), va, vb, vc);
+    }
+    locator.build();
+    double buildMS = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    // Tracking path, slow in altitude, a full turn in azimuth every 7200 queries
+    std::vector<std::array<double, 3>> path(nqueries);
+    for (int i = 0; i < nqueries; i++)
+        direction(20.0 + 50.0 * sin(i * 1e-3), range360(i * 0.05), path[i].data());
+
+    std::vector<HtmID> scanNearest(nqueries * nnearest), indexNearest(nqueries * nnearest);
+    start = Clock::now();
+    std::vector<std::pair<double, HtmID>> all(points.size());
+    for (int i = 0; i < nqueries; i++)
+    {
+        const double *q = path[i].data();
+        size_t n = 0;
+        for (auto &it : points)
+        {
+            double dx = q[0] - it.second.cx, dy = q[1] - it.second.cy, dz = q[2] - it.second.cz;
+            all[n++] = std::make_pair(dx * dx + dy * dy + dz * dz, it.first);
+        }
+        std::partial_sort(all.begin(), all.begin() + nnearest, all.end());
+        for (int k = 0; k < nnearest; k++)
+            scanNearest[i * nnearest + k] = all[k].second;
+    }
+    double scanNearestUS = elapsedUS(start, nqueries);
+
+    start = Clock::now();
+    for (int i = 0; i < nqueries; i++)
+        index.nearest(path[i][0], path[i][1], path[i][2], &indexNearest[i * nnearest], nullptr, nnearest);
+    double indexNearestUS = elapsedUS(start, nqueries);
+
+    std::vector<int> scanFace(nqueries), indexFace(nqueries);
+    start = Clock::now();
+    int last = -1;
+    for (int i = 0; i < nqueries; i++)
+    {
+        if (last < 0 || !isPointInside(path[i].data(), faces[last], points))
+        {
+            last = -1;
+            for (size_t f = 0; f < faces.size(); f++)
+            {
+                if (isPointInside(path[i].data(), faces[f], points))
+                {
+                    last = f;
+                    break;
+                }
+            }
+        }
+        scanFace[i] = last;
+    }
+    double scanFaceUS = elapsedUS(start, nqueries);
+
+    start = Clock::now();
+    last = -1;
+    for (int i = 0; i < nqueries; i++)
+    {
+        last         = locator.locate(path[i].data(), last);
+        indexFace[i] = last;
+    }
+    double indexFaceUS = elapsedUS(start, nqueries);
+
+    int nearestMismatches = 0, faceMismatches = 0, faceInvalid = 0;
+    for (int i = 0; i < nqueries * nnearest; i++)
+        nearestMismatches += scanNearest[i] != indexNearest[i];
+    for (int i = 0; i < nqueries; i++)
+    {
+        if (scanFace[i] == indexFace[i])
+            continue;
+        // Faces overlap on their edges, another face is fine as long as it holds the point
+        faceMismatches++;
+        if (indexFace[i] < 0 || !isPointInside(path[i].data(), faces[indexFace[i]], points))
+            faceInvalid++;
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"pointindex\",\n");
+    fprintf(out, "  \"config\": {\"points\": %d, \"queries\": %d, \"nearest\": %d, \"seed\": %d},\n",
+            npoints, nqueries, nnearest, seed);
+    fprintf(out, "  \"faces\": %zu,\n", faces.size());
+    fprintf(out, "  \"triangulate_ms\": %.3f,\n", triangulateMS);
+    fprintf(out, "  \"build_ms\": %.3f,\n", buildMS);
+    fprintf(out, "  \"nearest\": {\"scan_us\": %.3f, \"index_us\": %.3f, \"mismatches\": %d},\n",
+            scanNearestUS, indexNearestUS, nearestMismatches);
+    fprintf(out, "  \"face\": {\"scan_us\": %.3f, \"walk_us\": %.3f, \"differ\": %d, \"invalid\": %d}\n",
+            scanFaceUS, indexFaceUS, faceMismatches, faceInvalid);
+    fprintf(out, "}\n");
+    if (output)
+        fclose(out);
+
+    return nearestMismatches == 0 && faceInvalid == 0 ? 0 : 2;
+}
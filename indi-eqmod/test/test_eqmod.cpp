@@ -3,6 +3,27 @@
 
 #include "config.h"
 #include "eqmodbase.h"
+#include "skywatcherqueue.h"
+#include "koheronsnapshot.h"
+#include "simulator/skywatcher-simulator.h"
+#ifdef WITH_ALIGN_GEEHALEL
+#include "align/pointindex.h"
+#include "align/triangulate_chull.h"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
 
 
 using ::testing::_;
@@ -451,6 +472,676 @@ TEST(EqmodTest, scope_limits_altaz)
 
     ASSERT_TRUE(hl->ISNewSwitch(eqmod.getDeviceName(), "HORIZONLIMITSMANAGE", iss_on, (char**) manage_clear, 1));
 }
+
+TEST(EqmodTest, scope_limits_lookup)
+{
+    TestEQMod eqmod;
+    eqmod.updateLocation(50.0, 15.0, 0);
+
+    HorizonLimits * const hl = eqmod.horizon;
+    ASSERT_NE(hl, nullptr);
+
+    auto pmanage = eqmod.getSwitch("HORIZONLIMITSMANAGE");
+    ASSERT_TRUE(pmanage.isValid());
+    ISState iss_on[] = { ISS_ON };
+    const char * manage_clear[] = { "HORIZONLIMITSLISTCLEAR" };
+    const char * point_names[] = { "HORIZONLIMITS_POINT_AZ", "HORIZONLIMITS_POINT_ALT" };
+
+    // Irregular horizon, some points sitting exactly on lookup cell boundaries, added out of order
+    std::vector<std::array<double, 2>> points;
+    srand(3);
+    for (int i = 0; i < 40; i++)
+    {
+        double az = (i % 4 == 0) ? 0.05 * (rand() % 7200) : 360.0 * rand() / RAND_MAX;
+        points.push_back({ az, 40.0 * rand() / RAND_MAX });
+    }
+    for (auto &p : points)
+    {
+        double values[2] = { p[0], p[1] };
+        ASSERT_TRUE(hl->ISNewNumber(eqmod.getDeviceName(), "HORIZONLIMITSPOINT", values, (char**) point_names, 2));
+    }
+    std::sort(points.begin(), points.end());
+
+    // Reference linear interpolation between the two horizon points around az
+    auto horizonAt = [&points](double az)
+    {
+        size_t next = std::lower_bound(points.begin(), points.end(), std::array<double, 2> { az, -100.0 }) - points.begin();
+        const std::array<double, 2> &n = points[next % points.size()];
+        const std::array<double, 2> &p = points[(next + points.size() - 1) % points.size()];
+        if (n[0] == az)
+            return n[1];
+        double span = fmod(n[0] - p[0] + 360.0, 360.0), offset = fmod(az - p[0] + 360.0, 360.0);
+        return p[1] + (n[1] - p[1]) * offset / span;
+    };
+
+    for (int i = 0; i < 72000; i++)
+    {
+        double az = (i % 2) ? i * 0.005 : 360.0 * rand() / RAND_MAX;
+        double h  = horizonAt(az);
+        ASSERT_TRUE(hl->inLimits(az, h + 1e-6)) << "az " << az;
+        ASSERT_FALSE(hl->inLimits(az, h - 1e-6)) << "az " << az;
+    }
+    for (auto &p : points)
+    {
+        ASSERT_TRUE(hl->inLimits(p[0], p[1]));
+        ASSERT_FALSE(hl->inLimits(p[0], p[1] - 1e-6));
+    }
+    ASSERT_TRUE(hl->ISNewSwitch(eqmod.getDeviceName(), "HORIZONLIMITSMANAGE", iss_on, (char**) manage_clear, 1));
+
+    // Flat 10 degree horizon with a 60 degree obstacle around az 90
+    for (double az = 0; az < 360; az += 30)
+    {
+        double values[2] = { az, (az == 90) ? 60.0 : 10.0 };
+        ASSERT_TRUE(hl->ISNewNumber(eqmod.getDeviceName(), "HORIZONLIMITSPOINT", values, (char**) point_names, 2));
+    }
+    EXPECT_FALSE(hl->inGotoPathLimits(60, 30, 120, 30));
+    EXPECT_TRUE(hl->inGotoPathLimits(240, 30, 300, 30));
+    EXPECT_TRUE(hl->inGotoPathLimits(60, 80, 120, 80));
+    EXPECT_FALSE(hl->inGotoPathLimits(240, 30, 300, 5));
+    ASSERT_TRUE(hl->ISNewSwitch(eqmod.getDeviceName(), "HORIZONLIMITSMANAGE", iss_on, (char**) manage_clear, 1));
+}
+
+TEST(EqmodTest, scope_limits_load_bad_line)
+{
+    TestEQMod eqmod;
+    eqmod.updateLocation(50.0, 15.0, 0);
+
+    HorizonLimits * const hl = eqmod.horizon;
+    ASSERT_NE(hl, nullptr);
+
+    // Hand written file, out of order, with a malformed fourth point
+    char filename[] = "/tmp/test_eqmod_horizon_XXXXXX";
+    int fd = mkstemp(filename);
+    ASSERT_GE(fd, 0);
+    const char data[] = "# Horizon\n270 20\n90 40\n180 10\n0 30\n45 twenty\n135 80\n";
+    ASSERT_EQ(write(fd, data, sizeof(data) - 1), static_cast<ssize_t>(sizeof(data) - 1));
+    close(fd);
+
+    ISState iss_on[] = { ISS_ON };
+    const char * file_names[] = { "HORIZONLIMITSFILENAME" };
+    char * file_texts[] = { filename };
+    const char * load_names[] = { "HORIZONLIMITSLOADFILE" };
+    ASSERT_TRUE(hl->ISNewText(eqmod.getDeviceName(), "HORIZONLIMITSDATAFILE", file_texts, (char**) file_names, 1));
+    hl->ISNewSwitch(eqmod.getDeviceName(), "HORIZONLIMITSFILEOPERATION", iss_on, (char**) load_names, 1);
+    unlink(filename);
+    EXPECT_EQ(eqmod.getSwitch("HORIZONLIMITSFILEOPERATION").getState(), IPS_ALERT);
+
+    // The four points before the bad line are sorted and searchable, the ones after it are dropped
+    const double horizon[4][2] = { { 0, 30 }, { 90, 40 }, { 180, 10 }, { 270, 20 } };
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_TRUE(hl->inLimits(horizon[i][0], horizon[i][1])) << "az " << horizon[i][0];
+        EXPECT_FALSE(hl->inLimits(horizon[i][0], horizon[i][1] - 1e-6)) << "az " << horizon[i][0];
+    }
+    EXPECT_TRUE(hl->inLimits(135, 25 + 1e-6));
+    EXPECT_FALSE(hl->inLimits(135, 25 - 1e-6));
+    EXPECT_TRUE(hl->inLimits(315, 25 + 1e-6));
+    EXPECT_FALSE(hl->inLimits(315, 25 - 1e-6));
+
+    const char * manage_clear[] = { "HORIZONLIMITSLISTCLEAR" };
+    ASSERT_TRUE(hl->ISNewSwitch(eqmod.getDeviceName(), "HORIZONLIMITSMANAGE", iss_on, (char**) manage_clear, 1));
+}
+#endif
+
+// Skywatcher simulator served on the master side of a pty pair, answering one command per CR
+class SkywatcherPtyMount
+{
+public:
+    SkywatcherPtyMount()
+    {
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+            return;
+        slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+        if (slave < 0)
+            return;
+
+        struct termios tio;
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+
+        simulator.setupVersion("020300");
+        simulator.setupRA(180, 47, 12, 200, 64, 2);
+        simulator.setupDE(180, 47, 12, 200, 64, 2);
+    }
+
+    ~SkywatcherPtyMount()
+    {
+        // Closing the slave side makes the server read fail
+        if (slave >= 0)
+            close(slave);
+        if (server.joinable())
+            server.join();
+        if (master >= 0)
+            close(master);
+    }
+
+    void serve()
+    {
+        server = std::thread([this]()
+        {
+            char cmd[32], reply[32], c;
+            size_t len = 0;
+            while (read(master, &c, 1) == 1)
+            {
+                if (len < sizeof(cmd) - 1)
+                    cmd[len++] = c;
+                if (c != 0x0D)
+                    continue;
+                cmd[len] = '\0';
+                len = 0;
+
+                int n = 0;
+                simulator.process_command(cmd, &n);
+                simulator.get_reply(reply, &n);
+                if (badreply != nullptr)
+                {
+                    // Answer this command with the injected reply instead
+                    n = snprintf(reply, sizeof(reply), "%s", badreply.exchange(nullptr));
+                }
+                if (write(master, reply, n) != n)
+                    break;
+            }
+        });
+    }
+
+    int master { -1 };
+    int slave { -1 };
+    // Reply to the next command, for example an error or a garbled one
+    std::atomic<const char *> badreply { nullptr };
+    SkywatcherSimulator simulator;
+    std::thread server;
+};
+
+TEST(EqmodTest, command_queue_pty)
+{
+    SkywatcherPtyMount mount;
+    ASSERT_GE(mount.slave, 0);
+    mount.serve();
+
+    const char *commands[] = { ":e1\r", ":a1\r", ":a2\r", ":e2\r", ":j1\r", ":j2\r", ":f1\r", ":f2\r" };
+    const size_t count = sizeof(commands) / sizeof(commands[0]);
+    std::string lockstep[count];
+
+    // Depth 1 is the old lock-step exchange, used as reference
+    SkywatcherCommandQueue queue(1);
+    queue.setPortFD(mount.slave);
+    for (size_t i = 0; i < count; i++)
+        queue.enqueue(commands[i]);
+    ASSERT_TRUE(queue.submit(200000)) << queue.getErrorMessage();
+    for (size_t i = 0; i < count; i++)
+        lockstep[i] = queue.getReply(i);
+    EXPECT_EQ(lockstep[0], "=020300");
+    EXPECT_EQ(lockstep[3], "!");
+
+    // Pipelined, replies must still match their commands
+    queue.setDepth(4);
+    queue.clear();
+    queue.resetStatistics();
+    int tickets[count];
+    for (size_t i = 0; i < count; i++)
+        tickets[i] = queue.enqueue(commands[i], true);
+    EXPECT_EQ(queue.enqueue(":j1\r", true), tickets[4]);
+    EXPECT_EQ(queue.size(), count);
+    ASSERT_TRUE(queue.submit(200000)) << queue.getErrorMessage();
+    for (size_t i = 0; i < count; i++)
+        EXPECT_EQ(lockstep[i], queue.getReply(tickets[i])) << commands[i];
+
+    const SkywatcherCommandQueue::Statistics &stats = queue.getStatistics();
+    EXPECT_EQ(stats.commands, count);
+    EXPECT_EQ(stats.replies, count);
+    EXPECT_EQ(stats.coalesced, 1u);
+    EXPECT_LE(stats.minMS, stats.averageMS());
+    EXPECT_LE(stats.averageMS(), stats.maxMS);
+}
+
+TEST(EqmodTest, command_queue_timeout)
+{
+    // Nobody answers on the master side
+    SkywatcherPtyMount mount;
+    ASSERT_GE(mount.slave, 0);
+
+    SkywatcherCommandQueue queue;
+    queue.setPortFD(mount.slave);
+    queue.enqueue(":j1\r");
+    queue.enqueue(":j2\r");
+    EXPECT_FALSE(queue.submit(20000));
+    EXPECT_STRNE(queue.getErrorMessage(), "");
+    queue.recover();
+    EXPECT_EQ(queue.size(), 0u);
+}
+
+TEST(EqmodTest, read_status_bad_reply)
+{
+    SkywatcherPtyMount mount;
+    ASSERT_GE(mount.slave, 0);
+    mount.serve();
+
+    TestEQMod eqmod;
+    Skywatcher skywatcher(&eqmod);
+    skywatcher.setPortFD(mount.slave);
+
+    // Lock-step reference
+    uint32_t ra = skywatcher.GetRAEncoder();
+    uint32_t de = skywatcher.GetDEEncoder();
+
+    // The first pipelined query of the tick gets an error, then a non-hex reply. The tick goes on
+    // with that query asked again in lock-step.
+    const char *replies[] = { "!0\r", "=12G456\r" };
+    for (const char *reply : replies)
+    {
+        mount.badreply = reply;
+        EXPECT_NO_THROW(skywatcher.ReadStatus()) << reply;
+        EXPECT_EQ(mount.badreply.load(), nullptr);
+        EXPECT_EQ(skywatcher.GetRAEncoder(), ra) << reply;
+        EXPECT_EQ(skywatcher.GetDEEncoder(), de) << reply;
+    }
+
+    // And the next tick is pipelined again
+    EXPECT_NO_THROW(skywatcher.ReadStatus());
+    EXPECT_EQ(skywatcher.GetRAEncoder(), ra);
+
+    INDI::PropertyNumber queueNP = eqmod.getNumber("COMMANDQUEUE");
+    ASSERT_TRUE(queueNP.isValid());
+    skywatcher.GetQueueStatistics(queueNP);
+    EXPECT_EQ(queueNP.findWidgetByName("FALLBACKS")->getValue(), 2);
+    EXPECT_GE(queueNP.findWidgetByName("REPLIES")->getValue(), 6);
+    EXPECT_GT(queueNP.findWidgetByName("LATENCYAVG")->getValue(), 0);
+}
+
+// FPGA status server on a loopback socket, one reply per two byte request: four bytes, or the
+// whole KoheronSnapshotWords for SNAPSHOT
+class KoheronStubServer
+{
+public:
+    enum { POSITION, STATUS, ENCODER, SNAPSHOT };
+
+    KoheronStubServer()
+    {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len        = sizeof(addr);
+        if (listener < 0 || bind(listener, (struct sockaddr *)&addr, len) != 0 || listen(listener, 1) != 0 ||
+                getsockname(listener, (struct sockaddr *)&addr, &len) != 0)
+            return;
+        port = ntohs(addr.sin_port);
+
+        server = std::thread([this]()
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            uint8_t request[2];
+            while (fd >= 0 && recv(fd, request, sizeof(request), MSG_WAITALL) == sizeof(request))
+            {
+                uint8_t reply[sizeof(KoheronSnapshotWords)] = {};
+                size_t size = 4;
+                int axis = request[1] & 1;
+                uint32_t value32;
+                uint16_t value16[2];
+                KoheronSnapshotWords words;
+                switch (request[0])
+                {
+                    case POSITION:
+                        value32 = position[axis];
+                        memcpy(reply, &value32, 4);
+                        break;
+                    case STATUS:
+                        value16[0] = status[axis];
+                        memcpy(reply, value16, 2);
+                        break;
+                    case ENCODER:
+                        value16[0] = pecindex;
+                        value16[1] = pecflags;
+                        memcpy(reply, value16, 4);
+                        break;
+                    case SNAPSHOT:
+                        for (int i = 0; i < 2; i++)
+                        {
+                            uint32_t *word = &words[i * KOHERON_SNAPSHOT_WORDS];
+                            word[KOHERON_SNAPSHOT_POSITION] = position[i];
+                            word[KOHERON_SNAPSHOT_PERIOD]   = period[i];
+                            word[KOHERON_SNAPSHOT_STATUS]   = status[i];
+                            word[KOHERON_SNAPSHOT_PEC]      = i == 0 ? (pecindex << 16) | pecflags : 0;
+                        }
+                        memcpy(reply, words.data(), sizeof(words));
+                        size = sizeof(words);
+                        break;
+                }
+                if (send(fd, reply, size, 0) != static_cast<ssize_t>(size))
+                    break;
+            }
+            if (fd >= 0)
+                close(fd);
+        });
+    }
+
+    ~KoheronStubServer()
+    {
+        if (listener >= 0)
+            shutdown(listener, SHUT_RDWR);
+        if (server.joinable())
+            server.join();
+        if (listener >= 0)
+            close(listener);
+    }
+
+    int listener { -1 };
+    int port { 0 };
+    std::atomic<uint32_t> position[2] { { 0 }, { 0 } };
+    std::atomic<uint32_t> period[2] { { 0 }, { 0 } };
+    std::atomic<uint16_t> status[2] { { 0 }, { 0 } };
+    std::atomic<uint16_t> pecindex { 0 };
+    std::atomic<uint16_t> pecflags { 0 };
+    std::thread server;
+};
+
+// The calls ReadKoheronAxisSnapshot() makes on ASCOM_sky_interface, one round trip each, for a
+// server without the snapshot request
+class KoheronStubClient
+{
+public:
+    explicit KoheronStubClient(int port)
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = htons(port);
+        int nodelay          = 1;
+        if (fd >= 0 && (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+                        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) != 0))
+        {
+            close(fd);
+            fd = -1;
+        }
+    }
+
+    ~KoheronStubClient()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    uint32_t SwpGetAxisPosition(int axis)
+    {
+        uint32_t position = 0;
+        request(KoheronStubServer::POSITION, axis, &position, 4);
+        return position;
+    }
+
+    std::array<bool, 10> SwpGetAxisStatus(int axis)
+    {
+        uint16_t bits = 0;
+        request(KoheronStubServer::STATUS, axis, &bits, 2);
+        std::array<bool, 10> flags;
+        for (size_t i = 0; i < flags.size(); i++)
+            flags[i] = bits & (1 << i);
+        return flags;
+    }
+
+    std::array<uint16_t, 2> get_iic_encoder()
+    {
+        std::array<uint16_t, 2> readback;
+        request(KoheronStubServer::ENCODER, 0, readback.data(), 4);
+        return readback;
+    }
+
+    int fd { -1 };
+    int roundtrips { 0 };
+
+protected:
+    // Copies the first size bytes of the reply into value
+    void request(uint8_t op, int axis, void *value, size_t size)
+    {
+        uint8_t reply[sizeof(KoheronSnapshotWords)] = {};
+        size_t length = op == KoheronStubServer::SNAPSHOT ? sizeof(KoheronSnapshotWords) : 4;
+        uint8_t buf[2] = { op, static_cast<uint8_t>(axis) };
+        roundtrips++;
+        if (send(fd, buf, sizeof(buf), 0) != sizeof(buf) ||
+                recv(fd, reply, length, MSG_WAITALL) != static_cast<ssize_t>(length))
+            ADD_FAILURE() << "Koheron stub request failed";
+        memcpy(value, reply, size);
+    }
+};
+
+// A server with the snapshot request, both axes in one round trip
+class KoheronSnapshotStubClient : public KoheronStubClient
+{
+public:
+    using KoheronStubClient::KoheronStubClient;
+
+    KoheronSnapshotWords SwpGetStatusSnapshot()
+    {
+        KoheronSnapshotWords words;
+        request(KoheronStubServer::SNAPSHOT, 0, words.data(), sizeof(words));
+        return words;
+    }
+};
+
+static void setKoheronStubMount(KoheronStubServer &server)
+{
+    server.position[0] = 0x800000;
+    server.position[1] = 0x812345;
+    server.period[0]   = 2311;
+    server.period[1]   = 0;
+    server.status[0]   = 0x303;
+    server.status[1]   = 0x005;
+    server.pecindex    = 1234;
+    server.pecflags    = 0x1;
+}
+
+static void expectKoheronStubMount(const KoheronAxisSnapshot snapshot[2])
+{
+    EXPECT_EQ(snapshot[0].position, 0x800000u);
+    EXPECT_EQ(snapshot[1].position, 0x812345u);
+    EXPECT_EQ(snapshot[0].status, 0x303);
+    EXPECT_EQ(snapshot[1].status, 0x005);
+    EXPECT_EQ(snapshot[0].pecindex, 1234);
+    EXPECT_EQ(snapshot[0].pecflags, 0x1);
+}
+
+TEST(EqmodTest, koheron_snapshot_roundtrips)
+{
+    KoheronStubServer server;
+    ASSERT_GT(server.port, 0);
+    KoheronSnapshotStubClient client(server.port);
+    ASSERT_GE(client.fd, 0);
+    setKoheronStubMount(server);
+
+    KoheronAxisSnapshot snapshot[2] = {};
+    // Both axes, the periods included, in one request
+    EXPECT_TRUE(ReadKoheronSnapshot(client, true, snapshot));
+    EXPECT_EQ(client.roundtrips, 1);
+    expectKoheronStubMount(snapshot);
+    EXPECT_EQ(snapshot[0].period, 2311u);
+    EXPECT_EQ(snapshot[1].period, 0u);
+
+    // The periods follow the FPGA, not what the driver last set
+    client.roundtrips = 0;
+    server.position[0] = 0x800010;
+    server.period[1]   = 89;
+    EXPECT_TRUE(ReadKoheronSnapshot(client, false, snapshot));
+    EXPECT_EQ(client.roundtrips, 1);
+    EXPECT_EQ(snapshot[0].position, 0x800010u);
+    EXPECT_EQ(snapshot[1].period, 89u);
+
+    const int ticks = 200;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ticks; i++)
+        ReadKoheronSnapshot(client, true, snapshot);
+    double tickMS = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / ticks;
+    RecordProperty("koheron_tick_us", static_cast<int>(tickMS * 1000));
+    EXPECT_EQ(client.roundtrips, 1 + ticks);
+    EXPECT_LT(tickMS, 50.0);
+}
+
+TEST(EqmodTest, koheron_snapshot_without_server_support)
+{
+    KoheronStubServer server;
+    ASSERT_GT(server.port, 0);
+    KoheronStubClient client(server.port);
+    ASSERT_GE(client.fd, 0);
+    setKoheronStubMount(server);
+
+    KoheronAxisSnapshot snapshot[2] = {};
+    // Two positions, two status words and the RA encoder, the periods are left to the driver
+    EXPECT_FALSE(ReadKoheronSnapshot(client, true, snapshot));
+    EXPECT_EQ(client.roundtrips, 5);
+    expectKoheronStubMount(snapshot);
+    EXPECT_EQ(snapshot[0].period, 0u);
+
+    // Positions only between status ticks
+    client.roundtrips = 0;
+    EXPECT_FALSE(ReadKoheronSnapshot(client, false, snapshot));
+    EXPECT_EQ(client.roundtrips, 2);
+}
+
+TEST(EqmodTest, koheron_publish_on_change)
+{
+    KoheronPublished published;
+    KoheronAxisSnapshot ra = {}, de = {};
+
+    // A PEC error already present on the first snapshot must be published
+    ra.status   = 0x300;
+    ra.pecindex = 10;
+    ra.pecflags = KoheronPublished::PEC_ERROR_FLAG;
+    EXPECT_EQ(published.update(0, ra, true),
+              KoheronPublished::MOTOR_STATUS | KoheronPublished::PEC_POSITION | KoheronPublished::PEC_ERROR);
+    EXPECT_EQ(published.update(1, de, false), KoheronPublished::MOTOR_STATUS);
+
+    // Unchanged, or only running and direction flags changed
+    EXPECT_EQ(published.update(0, ra, true), 0);
+    de.status = 0x007;
+    EXPECT_EQ(published.update(1, de, false), 0);
+
+    ra.pecindex = 11;
+    EXPECT_EQ(published.update(0, ra, true), KoheronPublished::PEC_POSITION);
+    ra.pecflags = 0;
+    EXPECT_EQ(published.update(0, ra, true), KoheronPublished::PEC_POSITION | KoheronPublished::PEC_ERROR);
+    ra.status = 0x200;
+    EXPECT_EQ(published.update(0, ra, true), KoheronPublished::MOTOR_STATUS);
+
+    // Reconnecting publishes everything again
+    published.reset();
+    EXPECT_EQ(published.update(0, ra, true),
+              KoheronPublished::MOTOR_STATUS | KoheronPublished::PEC_POSITION | KoheronPublished::PEC_ERROR);
+}
+
+#ifdef WITH_ALIGN_GEEHALEL
+TEST(EqmodTest, align_point_index)
+{
+    // Synthetic 1000 point model above the horizon, checked against a full scan
+    std::vector<std::array<double, 3>> points;
+    PointIndex index;
+    srand(1);
+    for (int i = 0; i < 1000; i++)
+    {
+        double alt = (5.0 + 80.0 * rand() / RAND_MAX) * M_PI / 180.0;
+        double az  = (360.0 * rand() / RAND_MAX) * M_PI / 180.0;
+        points.push_back({ cos(alt) * cos(az), cos(alt) * sin(az), sin(alt) });
+        index.addPoint(i, points[i][0], points[i][1], points[i][2]);
+    }
+    index.build();
+
+    for (int q = 0; q < 100; q++)
+    {
+        double alt = (90.0 * q / 100) * M_PI / 180.0, az = (7.3 * q) * M_PI / 180.0;
+        double v[3] = { cos(alt) * cos(az), cos(alt) * sin(az), sin(alt) };
+        std::vector<std::pair<double, HtmID>> all;
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            double dx = v[0] - points[i][0], dy = v[1] - points[i][1], dz = v[2] - points[i][2];
+            all.push_back(std::make_pair(dx * dx + dy * dy + dz * dz, i));
+        }
+        std::sort(all.begin(), all.end());
+
+        HtmID ids[5];
+        ASSERT_EQ(index.nearest(v[0], v[1], v[2], ids, nullptr, 5), 5);
+        for (int k = 0; k < 5; k++)
+            EXPECT_EQ(ids[k], all[k].second) << "query " << q << " rank " << k;
+    }
+}
+
+TEST(EqmodTest, align_face_walk)
+{
+    // Octahedron: eight faces, one per octant, walk from every face to every octant
+    const double axes[6][3] = { {1, 0, 0}, {0, 1, 0}, {-1, 0, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+    FaceLocator locator;
+    for (int pole = 4; pole < 6; pole++)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            HtmID ids[3] = { static_cast<HtmID>(i), static_cast<HtmID>((i + 1) % 4), static_cast<HtmID>(pole) };
+            locator.addFace(ids, axes[ids[0]], axes[ids[1]], axes[ids[2]]);
+        }
+    }
+    locator.build();
+
+    for (int start = -1; start < 8; start++)
+    {
+        for (int octant = 0; octant < 8; octant++)
+        {
+            double angle = (45.0 + 90.0 * (octant % 4)) * M_PI / 180.0;
+            double p[3]  = { cos(angle), sin(angle), octant < 4 ? 0.5 : -0.5 };
+            int face = locator.locate(p, start);
+            ASSERT_GE(face, 0);
+            // Faces accept their antipodal direction too, both octants are valid answers
+            EXPECT_TRUE(face == octant || face == (octant < 4 ? (octant + 2) % 4 + 4 : (octant + 2) % 4))
+                    << "start " << start << " octant " << octant << " face " << face;
+        }
+    }
+}
+
+TEST(EqmodTest, align_triangulation_bulk)
+{
+    // A saved model loaded in one pass must give the faces built point by point
+    std::map<HtmID, PointSet::Point> points;
+    std::vector<HtmID> ids;
+    srand(7);
+    for (int i = 0; i < 500; i++)
+    {
+        double alt = (5.0 + 80.0 * rand() / RAND_MAX) * M_PI / 180.0;
+        double az  = (360.0 * rand() / RAND_MAX) * M_PI / 180.0;
+        PointSet::Point p {};
+        p.index = i;
+        p.htmID = 1000 + i;
+        p.cx    = cos(alt) * cos(az);
+        p.cy    = cos(alt) * sin(az);
+        p.cz    = sin(alt);
+        points[p.htmID] = p;
+        ids.push_back(p.htmID);
+    }
+
+    auto faceList = [](Triangulate & t)
+    {
+        std::vector<std::vector<HtmID>> list;
+        for (Face *f : t.getFaces())
+            list.push_back(f->v);
+        return list;
+    };
+
+    TriangulateCHull triangulation(&points);
+    for (HtmID id : ids)
+    {
+        triangulation.AddPoint(id);
+        triangulation.getFaces();
+    }
+    std::vector<std::vector<HtmID>> incremental = faceList(triangulation);
+    ASSERT_GT(incremental.size(), 0u);
+
+    triangulation.Reset();
+    triangulation.AddPoints(ids);
+    EXPECT_EQ(faceList(triangulation), incremental);
+
+    // Bulk load followed by single points, as when aligning after loading a file
+    triangulation.Reset();
+    triangulation.AddPoints(std::vector<HtmID>(ids.begin(), ids.begin() + 250));
+    for (size_t i = 250; i < ids.size(); i++)
+        triangulation.AddPoint(ids[i]);
+    EXPECT_EQ(faceList(triangulation), incremental);
+}
 #endif
 
 int main(int argc, char **argv)
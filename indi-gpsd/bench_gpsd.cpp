@@ -0,0 +1,413 @@
+/*******************************************************************************
+  Copyright(c) 2015-2023 Jasem Mutlaq. All rights reserved.
+
+  INDI GPSD Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+/*
+    gpsd pump benchmark
+
+    Runs a fake gpsd on a local TCP port, which answers the WATCH command and streams JSON reports:
+    a 10 Hz 3D fix wandering within half a meter, moving 10 meters every 100 reports, with the
+    satellite count changing halfway and the fix lost for the last 10 reports of every 100. SKY,
+    DEVICE and PPS reports and repeated TPV reports are mixed in.
+
+    GPSDPump reads them through libgps. First as fast as the server can send, to check that every
+    fix is counted, that exactly the expected changes are, and for the throughput. Then paced at
+    10 Hz, to measure how long a report takes to reach the snapshot. Last, how long the pump takes
+    to notice the server closing, and how long stop() takes while nothing comes in.
+
+    bench_gpsd [--reports N]
+*/
+
+#include "gpsdpump.h"
+
+#include <arpa/inet.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <libgpsmm.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// 2023-01-01T00:00:00Z
+static const time_t START = 1672531200;
+static const double LATITUDE = 45.5;
+static const double LONGITUDE = -73.5;
+static const double ALTITUDE = 120;
+
+static double seconds(Clock::time_point from)
+{
+    return std::chrono::duration<double>(Clock::now() - from).count();
+}
+
+typedef struct
+{
+    std::string json;
+    // Whether the pump should count it as a new fix
+    bool report;
+} Message;
+
+typedef struct
+{
+    std::vector<Message> messages;
+    uint64_t reports;
+    uint64_t changes;
+    GPSDPump::Fix last;
+} Stream;
+
+static Stream generate(int count)
+{
+    Stream stream {};
+    char json[512];
+    unsigned seed = 1;
+    auto noise = [&seed]()
+    {
+        // Within +-0.25
+        seed = seed * 1103515245 + 12345;
+        return ((seed >> 16) % 1001) / 2000.0 - 0.25;
+    };
+
+    for (int i = 0; i < count; i++)
+    {
+        int block = i / 100, step = i % 100;
+        int satellites = step < 50 ? 9 : 11;
+
+        if (step == 0 || step == 50)
+        {
+            snprintf(json, sizeof(json), "{\"class\":\"SKY\",\"device\":\"/dev/ttyACM0\",\"hdop\":0.9,"
+                     "\"nSat\":14,\"uSat\":%d}\n", satellites);
+            stream.messages.push_back({ json, false });
+            // The satellites, then the mode and the move with the TPV report after
+            stream.changes += step == 0 ? 2 : 1;
+        }
+        if (step == 90)
+            stream.changes++;
+
+        double latitude  = LATITUDE + (block * 10 + noise()) / (6371008.8 * M_PI / 180);
+        double longitude = LONGITUDE + noise() / (6371008.8 * M_PI / 180 * cos(LATITUDE * M_PI / 180));
+        double altitude  = ALTITUDE + noise();
+        int mode = step < 90 ? 3 : 1;
+
+        time_t time = START + i / 10;
+        struct tm *utc = gmtime(&time);
+        char iso[32];
+        strftime(iso, sizeof(iso), "%Y-%m-%dT%H:%M:%S", utc);
+
+        if (mode == 3)
+            snprintf(json, sizeof(json), "{\"class\":\"TPV\",\"device\":\"/dev/ttyACM0\",\"status\":1,\"mode\":3,"
+                     "\"time\":\"%s.%03dZ\",\"ept\":0.005,\"lat\":%.9f,\"lon\":%.9f,\"altHAE\":%.3f,\"alt\":%.3f,"
+                     "\"epx\":2.1,\"epy\":2.9,\"epv\":5.1,\"track\":0.0,\"speed\":0.02,\"climb\":0.0}\n",
+                     iso, (i % 10) * 100, latitude, longitude, altitude, altitude);
+        else
+            snprintf(json, sizeof(json), "{\"class\":\"TPV\",\"device\":\"/dev/ttyACM0\",\"status\":0,\"mode\":1,"
+                     "\"time\":\"%s.%03dZ\",\"ept\":0.005}\n", iso, (i % 10) * 100);
+        stream.messages.push_back({ json, true });
+        stream.reports++;
+
+        // gpsd repeats itself when more than one client device reports the same fix
+        if (i % 7 == 3)
+            stream.messages.push_back({ json, false });
+        if (i % 10 == 5)
+        {
+            snprintf(json, sizeof(json), "{\"class\":\"PPS\",\"device\":\"/dev/pps0\",\"real_sec\":%ld,"
+                     "\"real_nsec\":0,\"clock_sec\":%ld,\"clock_nsec\":120,\"precision\":-20}\n",
+                     static_cast<long>(time) + 1, static_cast<long>(time) + 1);
+            stream.messages.push_back({ json, false });
+        }
+        if (i % 50 == 25)
+            stream.messages.push_back({ "{\"class\":\"DEVICE\",\"path\":\"/dev/ttyACM0\",\"activated\":\"2023-01-01T00:00:00.000Z\","
+                                        "\"native\":0,\"bps\":9600,\"parity\":\"N\",\"stopbits\":1,\"cycle\":1.00}\n", false });
+
+        stream.last.mode       = mode;
+        stream.last.satellites = satellites;
+        stream.last.time.tv_sec  = time;
+        stream.last.time.tv_nsec = (i % 10) * 100000000L;
+        if (mode == 3)
+        {
+            stream.last.latitude  = latitude;
+            stream.last.longitude = longitude;
+            stream.last.altitude  = altitude;
+        }
+    }
+
+    return stream;
+}
+
+static int listenOn()
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    struct sockaddr_in address {};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 1) < 0)
+    {
+        perror("listen");
+        exit(1);
+    }
+    return fd;
+}
+
+static int portOf(int fd)
+{
+    struct sockaddr_in address {};
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<struct sockaddr *>(&address), &length);
+    return ntohs(address.sin_port);
+}
+
+static bool sendAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t rc = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (rc <= 0)
+            return false;
+        sent += rc;
+    }
+    return true;
+}
+
+// A fake gpsd for a single client, up to the answer to ?WATCH
+static int accept_gpsd(int server)
+{
+    int fd = accept(server, nullptr, nullptr);
+    if (fd < 0)
+        return -1;
+
+    sendAll(fd, "{\"class\":\"VERSION\",\"release\":\"3.22\",\"rev\":\"3.22\",\"proto_major\":3,\"proto_minor\":14}\n");
+
+    // ?WATCH={"enable":true,"json":true};
+    std::string command;
+    char c;
+    while (command.find(';') == std::string::npos && recv(fd, &c, 1, 0) == 1)
+        command += c;
+
+    sendAll(fd, "{\"class\":\"DEVICES\",\"devices\":[{\"class\":\"DEVICE\",\"path\":\"/dev/ttyACM0\","
+            "\"driver\":\"u-blox\",\"activated\":\"2023-01-01T00:00:00.000Z\",\"native\":1,\"bps\":9600,"
+            "\"parity\":\"N\",\"stopbits\":1,\"cycle\":1.00,\"mincycle\":0.25}]}\n");
+    sendAll(fd, "{\"class\":\"WATCH\",\"enable\":true,\"json\":true,\"nmea\":false,\"raw\":0,\"scaled\":false,"
+            "\"timing\":false,\"split24\":false,\"pps\":false}\n");
+    return fd;
+}
+
+static std::mutex sentLock;
+
+// The messages as fast as possible, or each report after the given delay, recording when it went out
+static void serve(int fd, const Stream &stream, double period, std::vector<Clock::time_point> *sent)
+{
+    if (period <= 0)
+    {
+        std::string all;
+        for (const auto &message : stream.messages)
+            all += message.json;
+        sendAll(fd, all);
+        return;
+    }
+
+    for (const auto &message : stream.messages)
+    {
+        if (message.report)
+        {
+            std::this_thread::sleep_for(std::chrono::duration<double>(period));
+            std::lock_guard<std::mutex> guard(sentLock);
+            sent->push_back(Clock::now());
+        }
+        if (!sendAll(fd, message.json))
+            return;
+    }
+}
+
+static bool same(const GPSDPump::Fix &a, const GPSDPump::Fix &b)
+{
+    return a.mode == b.mode && a.satellites == b.satellites && a.time.tv_sec == b.time.tv_sec &&
+           labs(a.time.tv_nsec - b.time.tv_nsec) < 1000000 && fabs(a.latitude - b.latitude) < 1e-8 &&
+           fabs(a.longitude - b.longitude) < 1e-8 && fabs(a.altitude - b.altitude) < 1e-3;
+}
+
+static gpsmm *open_gpsd(int port)
+{
+    gpsmm *gps = new gpsmm("127.0.0.1", std::to_string(port).c_str());
+    if (gps->stream(WATCH_ENABLE | WATCH_JSON) == nullptr)
+    {
+        fprintf(stderr, "Cannot stream from the fake gpsd\n");
+        exit(1);
+    }
+    return gps;
+}
+
+int main(int argc, char **argv)
+{
+    int count = 100000;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--reports") && i + 1 < argc)
+            count = atoi(argv[++i]);
+        else
+        {
+            fprintf(stderr, "bench_gpsd [--reports N]\n");
+            return 1;
+        }
+    }
+
+    bool ok = true;
+    int server = listenOn();
+    int port = portOf(server);
+
+    // Throughput, every fix and every change counted
+    {
+        Stream stream = generate(count);
+        int client = -1;
+        std::thread gpsd([&]()
+        {
+            client = accept_gpsd(server);
+            serve(client, stream, 0, nullptr);
+        });
+
+        gpsmm *gps = open_gpsd(port);
+        GPSDPump pump;
+        Clock::time_point start = Clock::now();
+        pump.start(gps);
+
+        GPSDPump::Fix fix;
+        do
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            fix = pump.getFix();
+        }
+        while (fix.reports < stream.reports && !pump.hasFailed() && seconds(start) < 60);
+        double elapsed = seconds(start);
+
+        gpsd.join();
+        pump.stop();
+
+        bool good = fix.reports == stream.reports && fix.changes == stream.changes && same(fix, stream.last);
+        ok = ok && good;
+        printf("throughput: %zu messages, %llu/%llu fixes, %llu/%llu changes, last fix %s, %.0f fixes/s\n",
+               stream.messages.size(), static_cast<unsigned long long>(fix.reports),
+               static_cast<unsigned long long>(stream.reports), static_cast<unsigned long long>(fix.changes),
+               static_cast<unsigned long long>(stream.changes), same(fix, stream.last) ? "matches" : "differs",
+               fix.reports / elapsed);
+        printf("            %.1f%% of the fixes are meaningful changes\n",
+               100.0 * fix.changes / fix.reports);
+
+        delete gps;
+        close(client);
+    }
+
+    // Latency, at the 10 Hz of a receiver
+    {
+        Stream stream = generate(50);
+        std::vector<Clock::time_point> sent;
+        int client = -1;
+        std::thread gpsd([&]()
+        {
+            client = accept_gpsd(server);
+            serve(client, stream, 0.1, &sent);
+        });
+
+        gpsmm *gps = open_gpsd(port);
+        GPSDPump pump;
+        pump.start(gps);
+
+        std::vector<double> latencies;
+        uint64_t seen = 0;
+        Clock::time_point start = Clock::now();
+        while (seen < stream.reports && seconds(start) < 30)
+        {
+            GPSDPump::Fix fix = pump.getFix();
+            if (fix.reports != seen)
+            {
+                Clock::time_point now = Clock::now();
+                seen = fix.reports;
+                std::lock_guard<std::mutex> guard(sentLock);
+                if (seen <= sent.size())
+                    latencies.push_back(std::chrono::duration<double>(now - sent[seen - 1]).count());
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        gpsd.join();
+
+        double total = 0, worst = 0;
+        for (double latency : latencies)
+        {
+            total += latency;
+            worst = std::max(worst, latency);
+        }
+        printf("latency: %zu fixes, mean %.3f ms, max %.3f ms from gpsd to the snapshot\n", latencies.size(),
+               latencies.empty() ? 0 : total / latencies.size() * 1000, worst * 1000);
+        ok = ok && seen == stream.reports;
+
+        // gpsd going away
+        start = Clock::now();
+        close(client);
+        while (!pump.hasFailed() && seconds(start) < 5)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        printf("closed: read error noticed after %.3f s\n", seconds(start));
+        ok = ok && pump.hasFailed();
+
+        pump.stop();
+        delete gps;
+    }
+
+    // Stopping while gpsd is silent
+    {
+        int client = -1;
+        std::thread gpsd([&]()
+        {
+            client = accept_gpsd(server);
+        });
+
+        gpsmm *gps = open_gpsd(port);
+        GPSDPump pump;
+        pump.start(gps);
+        gpsd.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+        Clock::time_point start = Clock::now();
+        pump.stop();
+        double elapsed = seconds(start);
+        printf("stop: %.3f s while waiting, at most %.3f s\n", elapsed, GPSDPump::WAIT_TIMEOUT / 1e6);
+        ok = ok && elapsed <= GPSDPump::WAIT_TIMEOUT / 1e6 + 0.1;
+
+        delete gps;
+        close(client);
+    }
+
+    close(server);
+    printf("%s\n", ok ? "OK" : "FAILED");
+    return ok ? 0 : 1;
+}
@@ -59,11 +59,15 @@ bool GPSD::Connect()
         LOG_WARN("No GPSD running.");
         return false;
     }
-    return true;
+
+    publishedReports = publishedChanges = 0;
+    publishedMode = MODE_NOT_SEEN;
+    return pump.start(gps);
 }
 
 bool GPSD::Disconnect()
 {
+    pump.stop();
     delete gps;
     gps = nullptr;
     LOG_INFO("GPS disconnected successfully.");
@@ -153,38 +157,6 @@ bool GPSD::updateProperties()
 
 IPState GPSD::updateGPS()
 {
-    // Indicate gps refresh in progress
-    if (TimeTP.getState() != IPS_BUSY)
-    {
-        TimeTP.setState(IPS_BUSY);
-        TimeTP.apply();
-    }
-
-    if (LocationNP.getState() != IPS_BUSY)
-    {
-        LocationNP.setState(IPS_BUSY);
-        LocationNP.apply();
-    }
-
-    if (GPSstatusTP.s != IPS_BUSY)
-    {
-        GPSstatusTP.s = IPS_BUSY;
-        IDSetText(&GPSstatusTP, nullptr);
-    }
-
-    if (PolarisNP.s != IPS_BUSY)
-    {
-        PolarisNP.s = IPS_BUSY;
-        IDSetNumber(&PolarisNP, nullptr);
-    }
-
-    if (RefreshSP.getState() != IPS_BUSY)
-    {
-        RefreshSP.setState(IPS_BUSY);
-        RefreshSP.apply();
-    }
-
-    struct gps_data_t *gpsData;
     time_t raw_time;
 
     if (isSimulation() || IUFindOnSwitchIndex(&TimeSourceSP) == TS_SYSTEM)
@@ -225,94 +197,77 @@ IPState GPSD::updateGPS()
         return IPS_OK;
     }
 
-    if (!gps->waiting(1000))
+    if (pump.hasFailed())
     {
-        if (GPSstatusTP.s != IPS_BUSY)
+        if (GPSstatusTP.s != IPS_ALERT)
         {
-            LOG_INFO("Waiting for gps data...");
-            GPSstatusTP.s = IPS_BUSY;
+            LOG_ERROR("GPSD read error.");
+            GPSstatusTP.s = IPS_ALERT;
+            IDSetText(&GPSstatusTP, nullptr);
         }
-        return IPS_BUSY;
+        return IPS_ALERT;
     }
 
-    // Empty the buffer and keep only the last data block
-    while (1)
+    // The latest fix the pump thread read, without waiting on gpsd here
+    GPSDPump::Fix fix = pump.getFix();
+
+    if (fix.mode == MODE_NOT_SEEN)
     {
-        if ((gpsData = gps->read()) == nullptr)
+        if (GPSstatusTP.s == IPS_IDLE)
         {
-            LOG_ERROR("GPSD read error.");
+            LOG_INFO("Waiting for gps data...");
+            GPSstatusTP.s = IPS_BUSY;
             IDSetText(&GPSstatusTP, nullptr);
-            return IPS_ALERT;
         }
-        // Exit the loop if there is no more data in the buffer
-        if (!gps->waiting(0))
-            break;
+        return IPS_BUSY;
     }
 
-#if GPSD_API_MAJOR_VERSION >= 11
-    // From gpsd v3.22 STATUS_NO_FIX may also mean unknown fix state, can
-    // only tell from the mode value
-    if (gpsData->fix.mode < MODE_2D)
-#elif GPSD_API_MAJOR_VERSION >= 10
-    if (gpsData->fix.status == STATUS_NO_FIX || gpsData->fix.mode < MODE_2D)
-#else
-    if (gpsData->status == STATUS_NO_FIX || gpsData->fix.mode < MODE_2D )
-#endif
+    // Nothing new since the last update, nothing to send
+    if (fix.reports == publishedReports && fix.changes == publishedChanges)
+        return IPS_BUSY;
+    publishedReports = fix.reports;
+
+    if (fix.mode < MODE_2D)
     {
         // We have no fix and there is no point in further processing.
-        IUSaveText(&GPSstatusT[0], "NO FIX");
-        if (GPSstatusTP.s == IPS_OK)
+        if (fix.mode != publishedMode)
         {
-            LOG_WARN("GPS fix lost.");
+            if (GPSstatusTP.s == IPS_OK)
+            {
+                LOG_WARN("GPS fix lost.");
+            }
+            publishedMode = fix.mode;
+            IUSaveText(&GPSstatusT[0], "NO FIX");
+            GPSstatusTP.s = IPS_BUSY;
+            IDSetText(&GPSstatusTP, nullptr);
         }
-        GPSstatusTP.s = IPS_BUSY;
-        IDSetText(&GPSstatusTP, nullptr);
         return IPS_BUSY;
     }
 
-    // detect gps fix showing up after not being avaliable
-    if (GPSstatusTP.s != IPS_OK)
-        LOG_INFO("GPS fix obtained.");
-
-    // update gps fix status
-    if (gpsData->fix.mode == MODE_3D)
-    {
-        IUSaveText(&GPSstatusT[0], "3D FIX");
-        GPSstatusTP.s      = IPS_OK;
-        IDSetText(&GPSstatusTP, nullptr);
-    }
-    else if (gpsData->fix.mode == MODE_2D)
+    // update gps fix status, only when it changes
+    if (fix.mode != publishedMode)
     {
-        IUSaveText(&GPSstatusT[0], "2D FIX");
+        // detect gps fix showing up after not being avaliable
+        if (GPSstatusTP.s != IPS_OK)
+            LOG_INFO("GPS fix obtained.");
+
+        publishedMode = fix.mode;
+        IUSaveText(&GPSstatusT[0], fix.mode == MODE_3D ? "3D FIX" : "2D FIX");
         GPSstatusTP.s      = IPS_OK;
         IDSetText(&GPSstatusTP, nullptr);
     }
-    else
-    {
-        IUSaveText(&GPSstatusT[0], "NO FIX");
-        GPSstatusTP.s      = IPS_BUSY;
-        IDSetText(&GPSstatusTP, nullptr);
-        return IPS_BUSY;
-    }
 
-    // update gps location
-    // we should have a gps fix data now
-    // fprintf(stderr,"Fix: %d time: %lf\n", data->fix.mode, data->fix.time);
-
-    LocationNP[LOCATION_LATITUDE].value  = gpsData->fix.latitude;
-    LocationNP[LOCATION_LONGITUDE].value = gpsData->fix.longitude;
-    // 2017-11-15 Jasem: INDI Longitude is 0 to 360 East+
-    if (LocationNP[LOCATION_LONGITUDE].value < 0)
-        LocationNP[LOCATION_LONGITUDE].value += 360;
-
-    if (gpsData->fix.mode == MODE_3D)
+    // update gps location, moves within the receiver noise are left out
+    if (fix.changes != publishedChanges)
     {
-        LocationNP[LOCATION_ELEVATION].value = gpsData->fix.altitude;
-    }
-    else
-    {
-        // Presume we are at sea level if we heve no elevation data
-        LocationNP[LOCATION_ELEVATION].value = 0;
+        publishedChanges = fix.changes;
+
+        LocationNP[LOCATION_LATITUDE].value  = fix.latitude;
+        LocationNP[LOCATION_LONGITUDE].value = fix.longitude;
+        // 2017-11-15 Jasem: INDI Longitude is 0 to 360 East+
+        if (LocationNP[LOCATION_LONGITUDE].value < 0)
+            LocationNP[LOCATION_LONGITUDE].value += 360;
+        LocationNP[LOCATION_ELEVATION].value = fix.altitude;
     }
     LocationNP.setState(IPS_OK);
 
@@ -320,17 +275,15 @@ IPState GPSD::updateGPS()
     if (IUFindOnSwitchIndex(&TimeSourceSP) == TS_GPS)
     {
         char ts[32] = {0};
-#if GPSD_API_MAJOR_VERSION < 9
-        raw_time = gpsData->fix.time;
-#else
-        raw_time = gpsData->fix.time.tv_sec;
+        raw_time = fix.time.tv_sec;
+#if GPSD_API_MAJOR_VERSION >= 9
         m_GPSTime = raw_time;
 #endif
 
 #if GPSD_API_MAJOR_VERSION < 9
-        unix_to_iso8601(gpsData->fix.time, ts, 32);
+        unix_to_iso8601(fix.time.tv_sec + fix.time.tv_nsec / 1e9, ts, 32);
 #else
-        timespec_to_iso8601(gpsData->fix.time, ts, 32);
+        timespec_to_iso8601(fix.time, ts, 32);
 #endif
         TimeTP[0].setText(ts);
 
@@ -349,15 +302,12 @@ IPState GPSD::updateGPS()
     lst = ln_get_apparent_sidereal_time(jd);
 
     // Local Hour Angle = Local Sidereal Time - Polaris Right Ascension
-    polarislsrt       = lst - 2.529722222 + (gpsData->fix.longitude / 15.0);
+    polarislsrt       = lst - 2.529722222 + (fix.longitude / 15.0);
     PolarisN[0].value = polarislsrt;
 
-    GPSstatusTP.s = IPS_OK;
-    IDSetText(&GPSstatusTP, nullptr);
+    // Location, time and refresh are sent by INDI::GPS
     PolarisNP.s = IPS_OK;
     IDSetNumber(&PolarisNP, nullptr);
-    RefreshSP.setState(IPS_OK);
-    RefreshSP.apply();
 
     return IPS_OK;
 }
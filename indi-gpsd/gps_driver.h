@@ -26,6 +26,7 @@
 #pragma once
 
 #include "indigps.h"
+#include "gpsdpump.h"
 
 class gpsmm;
 
@@ -51,6 +52,11 @@ class GPSD : public INDI::GPS
 
     private:
         gpsmm *gps = nullptr;
+        GPSDPump pump;
+        // Counters of the last fix sent to clients
+        uint64_t publishedReports { 0 };
+        uint64_t publishedChanges { 0 };
+        int publishedMode { 0 };
 
         ITextVectorProperty GPSstatusTP;
         IText GPSstatusT[1] {};
@@ -0,0 +1,173 @@
+/*******************************************************************************
+  Copyright(c) 2015-2023 Jasem Mutlaq. All rights reserved.
+
+  INDI GPSD Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "gpsdpump.h"
+
+#include <math.h>
+#include <libgpsmm.h>
+
+constexpr double GPSDPump::POSITION_CHANGE;
+
+// Mean earth radius, close enough for telling noise from moves
+#define METERS_PER_DEGREE (6371008.8 * M_PI / 180)
+
+GPSDPump::~GPSDPump()
+{
+    stop();
+}
+
+bool GPSDPump::start(gpsmm *gps)
+{
+    if (running || gps == nullptr)
+        return false;
+
+    // Left over when the thread gave up on its own
+    if (thread.joinable())
+        thread.join();
+
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        fix = Fix();
+    }
+
+    this->gps = gps;
+    failed  = false;
+    running = true;
+    thread = std::thread(&GPSDPump::loop, this);
+    return true;
+}
+
+void GPSDPump::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+}
+
+GPSDPump::Fix GPSDPump::getFix()
+{
+    std::lock_guard<std::mutex> guard(lock);
+    return fix;
+}
+
+void GPSDPump::loop()
+{
+    Fix latest, reference;
+
+    while (running)
+    {
+        if (!gps->waiting(WAIT_TIMEOUT))
+            continue;
+
+        struct gps_data_t *data = gps->read();
+        if (data == nullptr)
+        {
+            failed  = true;
+            running = false;
+            break;
+        }
+
+        struct timespec received;
+        clock_gettime(CLOCK_REALTIME, &received);
+
+        if (!update(data, &latest))
+            continue;
+        latest.received = received;
+
+        if (changed(latest, reference))
+        {
+            latest.changes++;
+            reference = latest;
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        fix = latest;
+    }
+}
+
+bool GPSDPump::update(const gps_data_t *data, Fix *fix)
+{
+    if ((data->set & (TIME_SET | MODE_SET | SATELLITE_SET)) == 0)
+        return false;
+
+    if (data->set & SATELLITE_SET)
+        fix->satellites = data->satellites_used;
+
+    if ((data->set & (TIME_SET | MODE_SET)) == 0)
+        return true;
+
+#if GPSD_API_MAJOR_VERSION >= 11
+    // From gpsd v3.22 STATUS_NO_FIX may also mean unknown fix state, can
+    // only tell from the mode value
+    bool noFix = data->fix.mode < MODE_2D;
+#elif GPSD_API_MAJOR_VERSION >= 10
+    bool noFix = data->fix.status == STATUS_NO_FIX || data->fix.mode < MODE_2D;
+#else
+    bool noFix = data->status == STATUS_NO_FIX || data->fix.mode < MODE_2D;
+#endif
+
+    int mode = noFix ? MODE_NO_FIX : data->fix.mode;
+    struct timespec time = fix->time;
+
+#if GPSD_API_MAJOR_VERSION < 9
+    if (isfinite(data->fix.time))
+    {
+        time.tv_sec  = static_cast<time_t>(data->fix.time);
+        time.tv_nsec = static_cast<long>((data->fix.time - time.tv_sec) * 1e9);
+    }
+#else
+    if (data->set & TIME_SET)
+        time = data->fix.time;
+#endif
+
+    // A report gpsd sent again, with no new fix
+    if (mode == fix->mode && time.tv_sec == fix->time.tv_sec && time.tv_nsec == fix->time.tv_nsec)
+        return true;
+
+    fix->mode = mode;
+    fix->time = time;
+    if (mode >= MODE_2D)
+    {
+        fix->latitude  = data->fix.latitude;
+        fix->longitude = data->fix.longitude;
+        // Presume we are at sea level if we have no elevation data
+        fix->altitude  = (mode == MODE_3D) ? data->fix.altitude : 0;
+    }
+    fix->reports++;
+    return true;
+}
+
+bool GPSDPump::changed(const Fix &fix, const Fix &reference)
+{
+    if (fix.mode != reference.mode || fix.satellites != reference.satellites)
+        return true;
+    if (fix.mode < MODE_2D)
+        return false;
+
+    double north = (fix.latitude - reference.latitude) * METERS_PER_DEGREE;
+    double east  = remainder(fix.longitude - reference.longitude, 360) * METERS_PER_DEGREE * cos(fix.latitude * M_PI / 180);
+    double up    = fix.altitude - reference.altitude;
+
+    return sqrt(north * north + east * east + up * up) > POSITION_CHANGE;
+}
@@ -0,0 +1,109 @@
+/*******************************************************************************
+  Copyright(c) 2015-2023 Jasem Mutlaq. All rights reserved.
+
+  INDI GPSD Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+class gpsmm;
+struct gps_data_t;
+
+/**
+ * @brief The GPSDPump class reads gpsd reports on a thread of its own.
+ *
+ * The thread blocks in gps_waiting() and gps_read(), and keeps the latest fix with the time it
+ * was read. Every new fix is counted, but only those that change the fix mode or the number of
+ * satellites used, or move the position by more than POSITION_CHANGE, count as changes. The
+ * driver compares both counters with what it published last to decide what to send.
+ */
+class GPSDPump
+{
+  public:
+    typedef struct
+    {
+        // MODE_NOT_SEEN, MODE_NO_FIX, MODE_2D or MODE_3D, MODE_NO_FIX whenever gpsd has no fix
+        int mode { 0 };
+        // Degrees, north and east positive
+        double latitude { 0 };
+        double longitude { 0 };
+        // Meters, 3D fixes only
+        double altitude { 0 };
+        int satellites { 0 };
+        // Time of the fix, from the receiver
+        struct timespec time {};
+        // System time the report was read
+        struct timespec received {};
+        // Reports with a new fix time or mode
+        uint64_t reports { 0 };
+        // Reports with a meaningful change
+        uint64_t changes { 0 };
+    } Fix;
+
+    // Meters, smaller moves are receiver noise
+    static constexpr double POSITION_CHANGE = 1.0;
+    // Microseconds each gps_waiting() blocks, and so the longest stop() takes
+    static const int WAIT_TIMEOUT = 500000;
+
+    ~GPSDPump();
+
+    /** @brief start Read from a gpsmm already streaming, on the pump thread. */
+    bool start(gpsmm *gps);
+
+    /** @brief stop Join the thread. The gpsmm is left to the caller. */
+    void stop();
+
+    bool isRunning() const
+    {
+        return running;
+    }
+
+    /** @brief hasFailed True once gps_read() failed and the thread gave up. */
+    bool hasFailed() const
+    {
+        return failed;
+    }
+
+    Fix getFix();
+
+  private:
+    void loop();
+    // Fold a report into the fix, false if it carried nothing of interest
+    static bool update(const gps_data_t *data, Fix *fix);
+    // Compared with the fix at the last change
+    static bool changed(const Fix &fix, const Fix &reference);
+
+    gpsmm *gps { nullptr };
+    std::thread thread;
+    std::atomic<bool> running { false };
+    std::atomic<bool> failed { false };
+
+    // Guarded by lock
+    std::mutex lock;
+    Fix fix;
+};
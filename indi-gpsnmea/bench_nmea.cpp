@@ -0,0 +1,359 @@
+/*******************************************************************************
+  Copyright(c) 2017 Jasem Mutlaq. All rights reserved.
+
+  INDI GPS NMEA Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+/*
+    NMEA reader benchmark
+
+    Replays an NMEA log through a pty, paced at several baud rates in 16 byte bursts like a UART
+    FIFO, and decodes it twice: one line at a time with tty_nread_section and minmea_sentence_id,
+    as the driver used to, and with NMEAReader. Both must decode the same values. Reports the CPU
+    time of the reading thread per sentence.
+
+    Without --log, a 10 Hz multi-constellation log with 1% corrupted sentences is generated.
+
+    bench_nmea [--log FILE] [--bauds 9600,38400,...] [--duration SECONDS] [--output FILE]
+*/
+
+#include "minmea.h"
+#include "nmeareader.h"
+
+#include <indicom.h>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Marks the end of the replay
+static const char *END_SENTENCE = "$GPZDA,000000.00,01,01,2099,00,00";
+
+typedef struct
+{
+    uint64_t sentences { 0 };
+    uint64_t decoded[4] { 0, 0, 0, 0 };
+    double sum { 0 };
+    double cpu { 0 };
+    bool finished { false };
+} Result;
+
+static std::string withChecksum(const std::string &body)
+{
+    char tail[8];
+    snprintf(tail, sizeof(tail), "*%02X\r\n", minmea_checksum(body.c_str()));
+    return body + tail;
+}
+
+static std::string generateLog(int epochs)
+{
+    std::string log;
+    uint32_t seed = 7;
+    auto uniform = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) / 16777216.0;
+    };
+    char s[128];
+    double lat = 4807.038, lon = 1131.000;
+    for (int e = 0; e < epochs; e++)
+    {
+        int t = e / 10, hh = (t / 3600) % 24, mm = (t / 60) % 60, ss = t % 60, cs = (e % 10) * 10;
+        lat += (uniform() - 0.5) * 0.001;
+        lon += (uniform() - 0.5) * 0.001;
+        std::vector<std::string> epoch;
+        snprintf(s, sizeof(s), "$GPRMC,%02d%02d%02d.%02d,A,%.4f,N,%08.4f,E,000.0,000.0,230394,003.1,W", hh, mm, ss, cs, lat, lon);
+        epoch.push_back(s);
+        snprintf(s, sizeof(s), "$GPGGA,%02d%02d%02d.%02d,%.4f,N,%08.4f,E,1,08,0.9,%.1f,M,46.9,M,,", hh, mm, ss, cs, lat, lon,
+                 545.4 + uniform());
+        epoch.push_back(s);
+        epoch.push_back("$GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1");
+        epoch.push_back("$GLGSA,A,3,65,66,,,,,,,,,,,2.5,1.3,2.1");
+        for (int g = 1; g <= 3; g++)
+        {
+            snprintf(s, sizeof(s), "$GPGSV,3,%d,11,%02d,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00", g, g * 3);
+            epoch.push_back(s);
+        }
+        for (int g = 1; g <= 2; g++)
+        {
+            snprintf(s, sizeof(s), "$GLGSV,2,%d,06,%02d,13,311,25,66,42,282,29,67,23,211,18,76,16,003,28", g, 64 + g);
+            epoch.push_back(s);
+        }
+        epoch.push_back("$GPVTG,054.7,T,034.4,M,005.5,N,010.2,K");
+        snprintf(s, sizeof(s), "$GPGLL,%.4f,N,%08.4f,E,%02d%02d%02d.%02d,A", lat, lon, hh, mm, ss, cs);
+        epoch.push_back(s);
+        if (cs == 0)
+        {
+            snprintf(s, sizeof(s), "$GPZDA,%02d%02d%02d.00,23,03,1994,00,00", hh, mm, ss);
+            epoch.push_back(s);
+        }
+        for (std::string &sentence : epoch)
+        {
+            std::string line = withChecksum(sentence);
+            // Line noise
+            if (uniform() < 0.01)
+                line[7 + static_cast<int>(uniform() * 10)] ^= 0x04;
+            log += line;
+        }
+    }
+    return log;
+}
+
+static void decode(enum minmea_sentence_id id, const char *line, Result &result)
+{
+    switch (id)
+    {
+        case MINMEA_SENTENCE_RMC:
+        {
+            struct minmea_sentence_rmc frame;
+            if (minmea_parse_rmc(&frame, line) && frame.valid)
+            {
+                result.decoded[0]++;
+                result.sum += minmea_tocoord(&frame.latitude) + minmea_tocoord(&frame.longitude);
+            }
+            break;
+        }
+        case MINMEA_SENTENCE_GGA:
+        {
+            struct minmea_sentence_gga frame;
+            if (minmea_parse_gga(&frame, line) && frame.fix_quality == 1)
+            {
+                result.decoded[1]++;
+                result.sum += minmea_tofloat(&frame.altitude);
+            }
+            break;
+        }
+        case MINMEA_SENTENCE_GSA:
+        {
+            struct minmea_sentence_gsa frame;
+            if (minmea_parse_gsa(&frame, line))
+            {
+                result.decoded[2]++;
+                result.sum += frame.fix_type;
+            }
+            break;
+        }
+        case MINMEA_SENTENCE_ZDA:
+        {
+            struct minmea_sentence_zda frame;
+            if (minmea_parse_zda(&frame, line))
+            {
+                if (frame.date.year == 2099)
+                    result.finished = true;
+                else
+                {
+                    result.decoded[3]++;
+                    result.sum += frame.time.seconds;
+                }
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static double threadCPU()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static Result replay(const std::string &log, int baud, bool legacy)
+{
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    grantpt(master);
+    unlockpt(master);
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    struct termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    std::thread writer([&]()
+    {
+        // 16 byte bursts, 10 bits per byte
+        const size_t burst = 16;
+        struct timespec next;
+        clock_gettime(CLOCK_MONOTONIC, &next);
+        for (size_t i = 0; i < log.size(); i += burst)
+        {
+            size_t n = std::min(burst, log.size() - i);
+            if (write(master, log.data() + i, n) < 0)
+                break;
+            next.tv_nsec += static_cast<long>(n * 10 * 1e9 / baud);
+            while (next.tv_nsec >= 1000000000)
+            {
+                next.tv_nsec -= 1000000000;
+                next.tv_sec++;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr);
+        }
+        std::string end = withChecksum(END_SENTENCE);
+        if (write(master, end.data(), end.size()) < 0)
+            return;
+    });
+
+    Result result;
+    double start = threadCPU();
+    if (legacy)
+    {
+        char line[MINMEA_MAX_LENGTH];
+        while (!result.finished)
+        {
+            int bytes_read = 0;
+            int rc = tty_nread_section(slave, line, MINMEA_MAX_LENGTH, 0xA, 3, &bytes_read);
+            if (rc == TTY_TIME_OUT)
+                break;
+            if (rc < 0)
+                continue;
+            line[bytes_read] = '\0';
+            enum minmea_sentence_id id = minmea_sentence_id(line, false);
+            if (id != MINMEA_INVALID)
+                result.sentences++;
+            decode(id, line, result);
+        }
+    }
+    else
+    {
+        NMEAReader reader;
+        while (!result.finished)
+        {
+            if (reader.fill(slave, 3) == TTY_TIME_OUT)
+                break;
+            enum minmea_sentence_id id;
+            const char *line;
+            while ((line = reader.next(&id)) != nullptr)
+                decode(id, line, result);
+        }
+        result.sentences = reader.getSentences() + reader.getSkipped();
+    }
+    result.cpu = threadCPU() - start;
+
+    writer.join();
+    close(slave);
+    close(master);
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    const char *logFile = nullptr;
+    const char *output  = nullptr;
+    std::string bauds   = "9600,38400,115200,921600";
+    double duration     = 4;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--log"))
+            logFile = argv[++i];
+        else if (arg("--bauds"))
+            bauds = argv[++i];
+        else if (arg("--duration"))
+            duration = atof(argv[++i]);
+        else if (arg("--output"))
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--log FILE] [--bauds 9600,38400,...] [--duration SECONDS] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::string log;
+    if (logFile)
+    {
+        FILE *fp = fopen(logFile, "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "Unable to read %s\n", logFile);
+            return 1;
+        }
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+            log.append(buf, n);
+        fclose(fp);
+    }
+    else
+        log = generateLog(3600);
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"gpsnmea_reader\",\n");
+    fprintf(out, "  \"config\": {\"log\": \"%s\", \"bytes\": %zu, \"duration\": %g},\n", logFile ? logFile : "generated",
+            log.size(), duration);
+    fprintf(out, "  \"runs\": [\n");
+
+    bool ok = true;
+    for (size_t pos = 0; pos < bauds.size();)
+    {
+        size_t comma = bauds.find(',', pos);
+        if (comma == std::string::npos)
+            comma = bauds.size();
+        int baud = atoi(bauds.substr(pos, comma - pos).c_str());
+        pos = comma + 1;
+        if (baud <= 0)
+            continue;
+
+        // Whole lines, as much as the port carries in the given time
+        size_t bytes = std::min(log.size(), static_cast<size_t>(baud / 10 * duration));
+        size_t cut   = log.rfind('\n', bytes);
+        std::string part = log.substr(0, cut == std::string::npos ? bytes : cut + 1);
+
+        Result legacy = replay(part, baud, true);
+        Result reader = replay(part, baud, false);
+
+        bool passed = legacy.finished && reader.finished && !memcmp(legacy.decoded, reader.decoded, sizeof(legacy.decoded))
+                      && legacy.sum == reader.sum;
+        ok = ok && passed;
+        uint64_t decoded = reader.decoded[0] + reader.decoded[1] + reader.decoded[2] + reader.decoded[3];
+        fprintf(out, "    {\"baud\": %d, \"bytes\": %zu, \"decoded\": %llu, \"legacy_us_per_sentence\": %.2f, "
+                "\"reader_us_per_sentence\": %.2f, \"speedup\": %.1f, \"passed\": %s}%s\n",
+                baud, part.size(), static_cast<unsigned long long>(decoded), legacy.cpu * 1e6 / std::max<uint64_t>(1, legacy.sentences),
+                reader.cpu * 1e6 / std::max<uint64_t>(1, reader.sentences), legacy.cpu / std::max(reader.cpu, 1e-9),
+                passed ? "true" : "false", pos < bauds.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (output)
+        fclose(out);
+
+    return ok ? 0 : 1;
+}
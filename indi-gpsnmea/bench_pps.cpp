@@ -0,0 +1,280 @@
+/*******************************************************************************
+  Copyright(c) 2017 Jasem Mutlaq. All rights reserved.
+
+  INDI GPS NMEA Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+/*
+    PPS clock benchmark
+
+    A simulated receiver on two threads: one feeds pulse edges with a known gaussian jitter to
+    PPSClock, the other hands it fixes as they would come off the serial line, 40 to 100 ms late.
+    Time runs faster than real time, --scale milliseconds per simulated second, only the order of
+    the pulses and the fixes comes from the threads.
+
+    A few pulses are dropped and a few spurious ones added, and the system clock is stepped half
+    way through. The offset measured when the sentence is read, as the drivers did, is compared
+    with the PPS filtered offset, against the offset the clock was given.
+
+    bench_pps [--seconds N] [--jitter MICROSECONDS] [--rate HZ] [--scale MS] [--log FILE] [--output FILE]
+*/
+
+#include "ppsclock.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Whole seconds of UTC at the start of the run
+static const long EPOCH = 1700000000;
+
+// System clock minus UTC, before and after the step
+static const double SKEW_BEFORE = 0.250;
+static const double SKEW_AFTER  = -0.180;
+
+typedef struct
+{
+    // UTC of the fix and system time it was read
+    struct timespec fix, received;
+    // UTC seconds since the start, for pacing
+    double at;
+} FixEvent;
+
+typedef struct
+{
+    struct timespec edge;
+    double at;
+} PulseEvent;
+
+static struct timespec toTimespec(double seconds)
+{
+    struct timespec t;
+    t.tv_sec  = static_cast<time_t>(floor(seconds));
+    t.tv_nsec = static_cast<long>(llround((seconds - floor(seconds)) * 1e9));
+    if (t.tv_nsec >= 1000000000)
+    {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000;
+    }
+    return t;
+}
+
+// Offsets are close to the epoch, keep them apart from it in doubles
+static struct timespec systemTime(double utc, double skew)
+{
+    struct timespec t = toTimespec(utc - floor(utc) + skew + 10);
+    t.tv_sec += EPOCH + static_cast<long>(floor(utc)) - 10;
+    return t;
+}
+
+static double skewAt(double utc, int seconds)
+{
+    return utc < seconds / 2 ? SKEW_BEFORE : SKEW_AFTER;
+}
+
+int main(int argc, char **argv)
+{
+    int seconds        = 300;
+    double jitter      = 5e-6;
+    int rate           = 10;
+    double scale       = 0.02;
+    const char *log    = nullptr;
+    const char *output = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--seconds"))
+            seconds = atoi(argv[++i]);
+        else if (arg("--jitter"))
+            jitter = atof(argv[++i]) * 1e-6;
+        else if (arg("--rate"))
+            rate = atoi(argv[++i]);
+        else if (arg("--scale"))
+            scale = atof(argv[++i]) / 1000;
+        else if (arg("--log"))
+            log = argv[++i];
+        else if (arg("--output"))
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--seconds N] [--jitter MICROSECONDS] [--rate HZ] [--scale MS] [--log FILE] [--output FILE]\n",
+                    argv[0]);
+            return 2;
+        }
+    }
+    if (seconds < 60 || rate < 1 || rate > 20 || jitter < 0 || scale <= 0)
+    {
+        fprintf(stderr, "The run needs at least 60 seconds and 1 to 20 fixes per second\n");
+        return 2;
+    }
+
+    // The whole run, decided up front
+    std::mt19937 random(1);
+    std::normal_distribution<double> noise(0, jitter);
+    std::uniform_real_distribution<double> latency(0.040, 0.100), chance(0, 1);
+
+    std::vector<PulseEvent> pulses;
+    int dropped = 0, spurious = 0;
+    for (int k = 0; k < seconds; k++)
+    {
+        if (k > 10 && chance(random) < 0.01)
+        {
+            dropped++;
+            continue;
+        }
+        pulses.push_back({ systemTime(k + noise(random), skewAt(k, seconds)), static_cast<double>(k) });
+        if (k > 10 && chance(random) < 0.005)
+        {
+            // Noise on the line, some way into the second
+            double at = k + 0.2 + chance(random) * 0.2;
+            pulses.push_back({ systemTime(at, skewAt(k, seconds)), at });
+            spurious++;
+        }
+    }
+
+    std::vector<FixEvent> fixes;
+    for (int k = 0; k < seconds; k++)
+    {
+        for (int j = 0; j < rate; j++)
+        {
+            double utc = k + static_cast<double>(j) / rate;
+            double late = latency(random);
+            fixes.push_back({ systemTime(utc, 0), systemTime(utc + late, skewAt(utc + late, seconds)), utc + late });
+        }
+    }
+    std::sort(fixes.begin(), fixes.end(), [](const FixEvent &a, const FixEvent &b)
+    {
+        return a.at < b.at;
+    });
+
+    PPSClock clock;
+    if (log != nullptr && !clock.setLog(log))
+    {
+        fprintf(stderr, "Unable to write %s\n", log);
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto pace = [start, scale](double at)
+    {
+        std::this_thread::sleep_until(start + std::chrono::duration<double>(at * scale));
+    };
+
+    // Simulated PPS source
+    std::thread source([&]()
+    {
+        unsigned long sequence = 0;
+        for (const PulseEvent &p : pulses)
+        {
+            pace(p.at);
+            clock.pulse(p.edge, ++sequence);
+        }
+    });
+
+    // Line end offsets, filtered offsets after settling, in seconds from the truth
+    std::vector<double> lineErrors, ppsErrors;
+    int matched = 0, unmatched = 0;
+    double relock = -1;
+    for (const FixEvent &f : fixes)
+    {
+        pace(f.at);
+        double truth = -skewAt(f.at, seconds);
+
+        double line = static_cast<double>(f.fix.tv_sec - f.received.tv_sec) + (f.fix.tv_nsec - f.received.tv_nsec) / 1e9;
+        lineErrors.push_back(line - truth);
+
+        if (clock.correlate(f.fix, f.received))
+            matched++;
+        else
+            unmatched++;
+
+        PPSClock::Status status = clock.getStatus();
+        double error = status.offset - truth;
+        // The filter takes a few tens of pulses to settle, from the start and after the step
+        double since = f.at < seconds / 2 ? f.at : f.at - seconds / 2;
+        if (f.at >= seconds / 2 && relock < 0 && fabs(error) < 1e-3)
+            relock = since;
+        if (since > 30)
+            ppsErrors.push_back(error);
+    }
+    source.join();
+
+    auto summary = [](const std::vector<double> &errors, double *mean, double *rms, double *peak)
+    {
+        double sum = 0, squares = 0;
+        *peak = 0;
+        for (double e : errors)
+        {
+            sum += e;
+            *peak = std::max(*peak, fabs(e));
+        }
+        *mean = sum / errors.size();
+        for (double e : errors)
+            squares += (e - *mean) * (e - *mean);
+        *rms = sqrt(squares / errors.size());
+    };
+    double lineMean, lineJitter, linePeak, ppsMean, ppsJitter, ppsPeak;
+    summary(lineErrors, &lineMean, &lineJitter, &linePeak);
+    summary(ppsErrors, &ppsMean, &ppsJitter, &ppsPeak);
+    PPSClock::Status status = clock.getStatus();
+
+    // Each dropped pulse loses the fixes of its second, late thread wake ups may lose a few more
+    int expectedUnmatched = dropped * rate;
+    bool passed = ppsPeak < std::max(10 * jitter, 2e-6) && relock >= 0 && relock < 10 &&
+                  unmatched <= expectedUnmatched + static_cast<int>(fixes.size() / 100) &&
+                  status.jitter > 0.5 * jitter && status.jitter < 2 * jitter + 1e-6 &&
+                  fabs(lineMean) > 10 * ppsPeak;
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"gpsnmea_pps\",\n");
+    fprintf(out, "  \"config\": {\"seconds\": %d, \"rate\": %d, \"jitter_us\": %.3f, \"scale_ms\": %.3f},\n", seconds, rate,
+            jitter * 1e6, scale * 1000);
+    fprintf(out, "  \"pulses\": {\"fed\": %zu, \"dropped\": %d, \"spurious\": %d, \"counted\": %lu},\n", pulses.size(),
+            dropped, spurious, status.pulses);
+    fprintf(out, "  \"fixes\": {\"total\": %zu, \"matched\": %d, \"unmatched\": %d, \"expected_unmatched\": %d},\n",
+            fixes.size(), matched, unmatched, expectedUnmatched);
+    fprintf(out, "  \"line_end\": {\"mean_error_ms\": %.3f, \"jitter_ms\": %.3f, \"peak_error_ms\": %.3f},\n", lineMean * 1e3,
+            lineJitter * 1e3, linePeak * 1e3);
+    fprintf(out, "  \"pps\": {\"mean_error_us\": %.3f, \"rms_us\": %.3f, \"peak_error_us\": %.3f, \"jitter_estimate_us\": %.3f, "
+            "\"relock_s\": %.1f},\n", ppsMean * 1e6, ppsJitter * 1e6, ppsPeak * 1e6, status.jitter * 1e6, relock);
+    fprintf(out, "  \"passed\": %s\n}\n", passed ? "true" : "false");
+    if (output)
+        fclose(out);
+
+    return passed ? 0 : 1;
+}
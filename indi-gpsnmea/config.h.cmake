@@ -6,5 +6,7 @@
 /* Define Driver version */
 #define GPSNMEA_VERSION_MAJOR @GPSNMEA_VERSION_MAJOR@
 #define GPSNMEA_VERSION_MINOR @GPSNMEA_VERSION_MINOR@
+/* Define if the Linux PPS API is available */
+#cmakedefine HAVE_SYS_TIMEPPS_H 1
 
 #endif // CONFIG_H
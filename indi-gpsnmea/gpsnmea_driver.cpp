@@ -33,6 +33,7 @@
 #include <libnova/sidereal_time.h>
 
 #include <memory>
+#include <string>
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
@@ -64,6 +65,21 @@ bool GPSNMEA::initProperties()
     IUFillTextVector(&GPSstatusTP, GPSstatusT, 1, getDeviceName(), "GPS_STATUS", "GPS Status", MAIN_CONTROL_TAB, IP_RO,
                      60, IPS_IDLE);
 
+    // Pulse per second from the receiver, through the Linux PPS API
+    IUFillSwitch(&PPSS[PPS_ENABLE], "PPS_ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&PPSS[PPS_DISABLE], "PPS_DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&PPSSP, PPSS, 2, getDeviceName(), "PPS", "PPS", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillText(&PPSSettingsT[PPS_DEVICE], "PPS_DEVICE", "Device", "/dev/pps0");
+    IUFillText(&PPSSettingsT[PPS_LOG], "PPS_LOG", "Timing log", "");
+    IUFillTextVector(&PPSSettingsTP, PPSSettingsT, 2, getDeviceName(), "PPS_SETTINGS", "PPS Settings", OPTIONS_TAB, IP_RW,
+                     60, IPS_IDLE);
+
+    IUFillNumber(&PPSN[PPS_OFFSET], "PPS_OFFSET", "Clock offset (ms)", "%.3f", -1e9, 1e9, 0, 0);
+    IUFillNumber(&PPSN[PPS_JITTER], "PPS_JITTER", "Jitter (ms)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumber(&PPSN[PPS_PULSES], "PPS_PULSES", "Pulses", "%.f", 0, 1e12, 0, 0);
+    IUFillNumberVector(&PPSNP, PPSN, 3, getDeviceName(), "PPS_CLOCK", "PPS Clock", MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
+
     tcpConnection = new Connection::TCP(this);
     tcpConnection->setDefaultHost("192.168.1.1");
     tcpConnection->setDefaultPort(50000);
@@ -91,29 +107,160 @@ bool GPSNMEA::updateProperties()
     {
         defineProperty(&GPSstatusTP);
 
+        if (PPSClock::isSupported())
+        {
+            if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE)
+                PPSSP.s = startPPS() ? IPS_OK : IPS_ALERT;
+
+            defineProperty(&PPSSP);
+            defineProperty(&PPSSettingsTP);
+            defineProperty(&PPSNP);
+        }
+
         pthread_create(&nmeaThread, nullptr, &GPSNMEA::parseNMEAHelper, this);
     }
     else
     {
         // We're disconnected
         deleteProperty(GPSstatusTP.name);
+
+        if (PPSClock::isSupported())
+        {
+            ppsClock.stop();
+            deleteProperty(PPSSP.name);
+            deleteProperty(PPSSettingsTP.name);
+            deleteProperty(PPSNP.name);
+        }
+    }
+    return true;
+}
+
+bool GPSNMEA::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev != nullptr && !strcmp(dev, getDeviceName()))
+    {
+        if (!strcmp(name, PPSSP.name))
+        {
+            IUUpdateSwitch(&PPSSP, states, names, n);
+            if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE)
+                PPSSP.s = startPPS() ? IPS_OK : IPS_ALERT;
+            else
+            {
+                ppsClock.stop();
+                LOG_INFO("PPS capture stopped.");
+                PPSSP.s = IPS_IDLE;
+                PPSNP.s = IPS_IDLE;
+                IDSetNumber(&PPSNP, nullptr);
+            }
+            IDSetSwitch(&PPSSP, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::GPS::ISNewSwitch(dev, name, states, names, n);
+}
+
+bool GPSNMEA::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (dev != nullptr && !strcmp(dev, getDeviceName()))
+    {
+        if (!strcmp(name, PPSSettingsTP.name))
+        {
+            std::string device = PPSSettingsT[PPS_DEVICE].text;
+            IUUpdateText(&PPSSettingsTP, texts, names, n);
+            PPSSettingsTP.s = IPS_OK;
+            if (!ppsClock.setLog(PPSSettingsT[PPS_LOG].text))
+            {
+                LOGF_ERROR("Unable to open PPS timing log %s: %s", PPSSettingsT[PPS_LOG].text, strerror(errno));
+                PPSSettingsTP.s = IPS_ALERT;
+            }
+            // A new device takes effect right away
+            if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE && device != PPSSettingsT[PPS_DEVICE].text)
+            {
+                PPSSP.s = startPPS() ? IPS_OK : IPS_ALERT;
+                IDSetSwitch(&PPSSP, nullptr);
+            }
+            IDSetText(&PPSSettingsTP, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::GPS::ISNewText(dev, name, texts, names, n);
+}
+
+bool GPSNMEA::saveConfigItems(FILE *fp)
+{
+    INDI::GPS::saveConfigItems(fp);
+
+    // The device before the switch that opens it
+    IUSaveConfigText(fp, &PPSSettingsTP);
+    IUSaveConfigSwitch(fp, &PPSSP);
+
+    return true;
+}
+
+bool GPSNMEA::startPPS()
+{
+    if (!ppsClock.start(PPSSettingsT[PPS_DEVICE].text))
+    {
+        LOGF_ERROR("Unable to capture PPS from %s: %s", PPSSettingsT[PPS_DEVICE].text, strerror(errno));
+        return false;
     }
+
+    LOGF_INFO("Capturing PPS from %s.", PPSSettingsT[PPS_DEVICE].text);
     return true;
 }
 
 IPState GPSNMEA::updateGPS()
 {
     IPState rc = IPS_BUSY;
+    Fix latest;
+
+    if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE)
+    {
+        PPSClock::Status pps = ppsClock.getStatus();
+        PPSN[PPS_OFFSET].value = pps.offset * 1000;
+        PPSN[PPS_JITTER].value = pps.jitter * 1000;
+        PPSN[PPS_PULSES].value = pps.pulses;
+        if (!ppsClock.isRunning())
+            PPSNP.s = IPS_ALERT;
+        else
+            PPSNP.s = pps.locked ? IPS_OK : IPS_BUSY;
+        IDSetNumber(&PPSNP, nullptr);
+    }
 
     pthread_mutex_lock(&lock);
     if (locationPending == false && timePending == false)
     {
         rc = IPS_OK;
+        latest = fix;
         locationPending = true;
         timePending = true;
     }
     pthread_mutex_unlock(&lock);
 
+    if (rc != IPS_OK)
+        return rc;
+
+    LocationNP[LOCATION_LATITUDE].value  = latest.latitude;
+    LocationNP[LOCATION_LONGITUDE].value = latest.longitude;
+    LocationNP[LOCATION_ELEVATION].value = latest.elevation;
+
+    char ts[32] = {0};
+    time_t raw_time = latest.time;
+    struct tm *utc, *local;
+
+    if (latest.dated)
+        m_GPSTime = raw_time;
+
+    utc = gmtime(&raw_time);
+    strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
+    TimeTP[0].setText(ts);
+
+    local = localtime(&raw_time);
+    snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
+    TimeTP[1].setText(ts);
+
     return rc;
 }
 
@@ -139,16 +286,47 @@ void* GPSNMEA::parseNMEAHelper(void *obj)
     return nullptr;
 }
 
+void GPSNMEA::updateFixStatus(int type)
+{
+    // GSA comes with every fix, only send changes
+    if (type == fixType)
+        return;
+
+    fixType = type;
+
+    if (type == 1)
+    {
+        GPSstatusTP.s = IPS_BUSY;
+        IUSaveText(&GPSstatusT[0], "NO FIX");
+    }
+    else if (type == 2)
+    {
+        GPSstatusTP.s = IPS_OK;
+        IUSaveText(&GPSstatusT[0], "2D FIX");
+    }
+    else if (type == 3)
+    {
+        GPSstatusTP.s = IPS_OK;
+        IUSaveText(&GPSstatusT[0], "3D FIX");
+    }
+    else
+        return;
+
+    IDSetText(&GPSstatusTP, nullptr);
+}
+
 void GPSNMEA::parseNEMA()
 {
-    static char ts[32] = {0};
+    // Decoded so far, published after each read
+    Fix working;
+    time_t systemTime = -1;
 
-    char line[MINMEA_MAX_LENGTH];
+    reader.reset();
+    fixType = 0;
 
     while (isConnected())
     {
-        int bytes_read = 0;
-        int tty_rc = tty_nread_section(PortFD, line, MINMEA_MAX_LENGTH, 0xA, 3, &bytes_read);
+        int tty_rc = reader.fill(PortFD, 3);
         if (tty_rc < 0)
         {
             if (tty_rc == TTY_OVERFLOW)
@@ -171,6 +349,7 @@ void GPSNMEA::parseNEMA()
                         usleep(10 * 1e6);
                         tcpConnection->Connect();
                         PortFD = tcpConnection->getPortFD();
+                        reader.reset();
                     }
                     else if (timeoutCounter++ > MAX_TIMEOUT_COUNT)
                     {
@@ -181,195 +360,166 @@ void GPSNMEA::parseNEMA()
                         usleep(5 * 1e6);
                         tcpConnection->Connect();
                         PortFD = tcpConnection->getPortFD();
+                        reader.reset();
                         timeoutCounter = 0;
                     }
                 }
                 continue;
             }
         }
-        line[bytes_read] = '\0';
 
-        LOGF_DEBUG("%s", line);
-        switch (minmea_sentence_id(line, false))
+        // Taken before parsing, the PPS offset only depends on how late the sentences came in
+        struct timespec received;
+        clock_gettime(CLOCK_REALTIME, &received);
+        bool pps = ppsClock.isRunning();
+
+        bool location = false, time = false;
+        enum minmea_sentence_id id;
+        const char *line;
+
+        // Everything that came in with this read, checksums already verified
+        while ((line = reader.next(&id)) != nullptr)
         {
-            case MINMEA_SENTENCE_RMC:
+            LOGF_DEBUG("%s", line);
+            switch (id)
             {
-                struct minmea_sentence_rmc frame;
-                if (minmea_parse_rmc(&frame, line))
+                case MINMEA_SENTENCE_RMC:
                 {
-                    if (frame.valid)
+                    struct minmea_sentence_rmc frame;
+                    if (minmea_parse_rmc(&frame, line))
                     {
-                        LocationNP[LOCATION_LATITUDE].value  = minmea_tocoord(&frame.latitude);
-                        LocationNP[LOCATION_LONGITUDE].value = minmea_tocoord(&frame.longitude);
-                        if (LocationNP[LOCATION_LONGITUDE].value < 0)
-                            LocationNP[LOCATION_LONGITUDE].value += 360;
-
                         struct timespec timesp;
-                        time_t raw_time;
-                        struct tm *utc, *local;
-
-                        if (minmea_gettime(&timesp, &frame.date, &frame.time) == -1)
-                            break;
 
-                        raw_time = timesp.tv_sec;
-                        m_GPSTime = raw_time;
-                        utc = gmtime(&raw_time);
-                        strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                        TimeTP[0].setText(ts);
+                        if (frame.valid && minmea_gettime(&timesp, &frame.date, &frame.time) != -1)
+                        {
+                            working.latitude  = minmea_tocoord(&frame.latitude);
+                            working.longitude = minmea_tocoord(&frame.longitude);
+                            if (working.longitude < 0)
+                                working.longitude += 360;
 
-                        setSystemTime(raw_time);
+                            working.time  = timesp.tv_sec;
+                            working.dated = true;
+                            location = time = true;
 
-                        local = localtime(&raw_time);
-                        snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                        TimeTP[1].setText(ts);
-
-                        pthread_mutex_lock(&lock);
-                        locationPending = false;
-                        timePending = false;
-                        LOG_DEBUG("Threaded Location and Time updates complete.");
-                        pthread_mutex_unlock(&lock);
+                            if (pps)
+                                ppsClock.correlate(timesp, received);
+                        }
+                    }
+                    else
+                    {
+                        LOG_DEBUG("$xxRMC sentence is not parsed");
                     }
                 }
-                else
-                {
-                    LOG_DEBUG("$xxRMC sentence is not parsed");
-                }
-            }
-            break;
+                break;
 
-            case MINMEA_SENTENCE_GGA:
-            {
-                struct minmea_sentence_gga frame;
-                if (minmea_parse_gga(&frame, line))
+                case MINMEA_SENTENCE_GGA:
                 {
-                    if (frame.fix_quality == 1)
+                    struct minmea_sentence_gga frame;
+                    if (minmea_parse_gga(&frame, line))
                     {
-                        LocationNP[LOCATION_LATITUDE].value  = minmea_tocoord(&frame.latitude);
-                        LocationNP[LOCATION_LONGITUDE].value = minmea_tocoord(&frame.longitude);
-                        if (LocationNP[LOCATION_LONGITUDE].value < 0)
-                            LocationNP[LOCATION_LONGITUDE].value += 360;
-
-                        LocationNP[LOCATION_ELEVATION].value = minmea_tofloat(&frame.altitude);
-
-                        struct timespec timesp;
-                        time_t raw_time;
-                        struct tm *utc, *local;
-                        minmea_date gmt_date;
-
-                        time(&raw_time);
-                        utc = gmtime(&raw_time);
-                        gmt_date.day = utc->tm_mday;
-                        gmt_date.month = utc->tm_mon + 1;
-                        gmt_date.year = utc->tm_year;
-
-                        minmea_gettime(&timesp, &gmt_date, &frame.time);
-
-                        raw_time = timesp.tv_sec;
-                        utc = gmtime(&raw_time);
-                        strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                        TimeTP[0].setText(ts);
-                        setSystemTime(raw_time);
-
-                        local = localtime(&raw_time);
-                        snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                        TimeTP[1].setText(ts);
-
-                        pthread_mutex_lock(&lock);
-                        timePending = false;
-                        locationPending = false;
-                        LOG_DEBUG("Threaded Location and Time updates complete.");
-                        pthread_mutex_unlock(&lock);
+                        if (frame.fix_quality == 1)
+                        {
+                            working.latitude  = minmea_tocoord(&frame.latitude);
+                            working.longitude = minmea_tocoord(&frame.longitude);
+                            if (working.longitude < 0)
+                                working.longitude += 360;
+
+                            working.elevation = minmea_tofloat(&frame.altitude);
+
+                            struct timespec timesp;
+                            time_t raw_time;
+                            struct tm *utc;
+                            minmea_date gmt_date;
+
+                            // GGA has no date, take it from the system clock
+                            ::time(&raw_time);
+                            utc = gmtime(&raw_time);
+                            gmt_date.day = utc->tm_mday;
+                            gmt_date.month = utc->tm_mon + 1;
+                            gmt_date.year = utc->tm_year;
+
+                            minmea_gettime(&timesp, &gmt_date, &frame.time);
+
+                            working.time  = timesp.tv_sec;
+                            working.dated = false;
+                            location = time = true;
+
+                            if (pps)
+                                ppsClock.correlate(timesp, received);
+                        }
+                    }
+                    else
+                    {
+                        LOG_DEBUG("$xxGGA sentence is not parsed");
                     }
                 }
-                else
-                {
-                    LOG_DEBUG("$xxGGA sentence is not parsed");
-                }
-            }
-            break;
+                break;
 
-            case MINMEA_SENTENCE_GSA:
-            {
-                struct minmea_sentence_gsa frame;
-                if (minmea_parse_gsa(&frame, line))
+                case MINMEA_SENTENCE_GSA:
                 {
-                    if (frame.fix_type == 1)
+                    struct minmea_sentence_gsa frame;
+                    if (minmea_parse_gsa(&frame, line))
+                        updateFixStatus(frame.fix_type);
+                    else
                     {
-                        GPSstatusTP.s = IPS_BUSY;
-                        IUSaveText(&GPSstatusT[0], "NO FIX");
+                        LOG_DEBUG("$xxGSA sentence is not parsed.");
                     }
-                    else if (frame.fix_type == 2)
+                }
+                break;
+
+                case MINMEA_SENTENCE_ZDA:
+                {
+                    struct minmea_sentence_zda frame;
+                    if (minmea_parse_zda(&frame, line))
                     {
-                        GPSstatusTP.s = IPS_OK;
-                        IUSaveText(&GPSstatusT[0], "2D FIX");
+                        LOGF_DEBUG("$xxZDA: %d:%d:%d %02d.%02d.%d UTC%+03d:%02d",
+                                   frame.time.hours,
+                                   frame.time.minutes,
+                                   frame.time.seconds,
+                                   frame.date.day,
+                                   frame.date.month,
+                                   frame.date.year,
+                                   frame.hour_offset,
+                                   frame.minute_offset);
+
+                        struct timespec timesp;
+                        minmea_gettime(&timesp, &frame.date, &frame.time);
+
+                        working.time  = timesp.tv_sec;
+                        working.dated = true;
+                        time = true;
+
+                        if (pps)
+                            ppsClock.correlate(timesp, received);
                     }
-                    else if (frame.fix_type == 3)
+                    else
                     {
-                        GPSstatusTP.s = IPS_OK;
-                        IUSaveText(&GPSstatusT[0], "3D FIX");
+                        LOG_DEBUG("$xxZDA sentence is not parsed");
                     }
-                    IDSetText(&GPSstatusTP, nullptr);
-
-                }
-                else
-                {
-                    LOG_DEBUG("$xxGSA sentence is not parsed.");
-                }
-            }
-            break;
-            case MINMEA_SENTENCE_ZDA:
-            {
-                struct minmea_sentence_zda frame;
-                if (minmea_parse_zda(&frame, line))
-                {
-                    LOGF_DEBUG("$xxZDA: %d:%d:%d %02d.%02d.%d UTC%+03d:%02d",
-                               frame.time.hours,
-                               frame.time.minutes,
-                               frame.time.seconds,
-                               frame.date.day,
-                               frame.date.month,
-                               frame.date.year,
-                               frame.hour_offset,
-                               frame.minute_offset);
-
-                    struct timespec timesp;
-                    time_t raw_time;
-                    struct tm *utc, *local;
-
-                    minmea_gettime(&timesp, &frame.date, &frame.time);
-
-                    raw_time = timesp.tv_sec;
-                    utc = gmtime(&raw_time);
-                    strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                    TimeTP[0].setText(ts);
-                    setSystemTime(raw_time);
-
-                    local = localtime(&raw_time);
-                    snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                    TimeTP[1].setText(ts);
-
-                    pthread_mutex_lock(&lock);
-                    timePending = false;
-                    LOG_DEBUG("Threaded Time update complete.");
-                    pthread_mutex_unlock(&lock);
-                }
-                else
-                {
-                    LOG_DEBUG("$xxZDA sentence is not parsed");
                 }
+                break;
+
+                default:
+                    break;
             }
-            break;
+        }
 
-            case MINMEA_INVALID:
-            {
-                //LOG_WARN("$xxxxx sentence is not valid");
-            } break;
+        // The clock has a resolution of a second, set it once per second instead of once per sentence
+        if (time && working.time != systemTime)
+        {
+            systemTime = working.time;
+            setSystemTime(systemTime);
+        }
 
-            default:
-            {
-                LOG_DEBUG("$xxxxx sentence is not parsed");
-            }
-            break;
+        if (location || time)
+        {
+            pthread_mutex_lock(&lock);
+            fix = working;
+            if (location)
+                locationPending = false;
+            if (time)
+                timePending = false;
+            pthread_mutex_unlock(&lock);
         }
     }
 
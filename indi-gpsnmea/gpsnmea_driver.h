@@ -26,6 +26,11 @@
 
 #include <indigps.h>
 
+#include "nmeareader.h"
+#include "ppsclock.h"
+
+#include <time.h>
+
 class GPSNMEA : public INDI::GPS
 {
   public:
@@ -37,22 +42,71 @@ class GPSNMEA : public INDI::GPS
 
     static void* parseNMEAHelper(void *);
 
+    virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+    virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
+
   protected:    
     //  Generic indi device entries
     virtual const char *getDefaultName() override;
     virtual bool initProperties() override;
     virtual bool updateProperties() override;
     virtual IPState updateGPS() override;
+    virtual bool saveConfigItems(FILE *fp) override;
 
 private:
+    // Latest values decoded from the stream, handed to updateGPS() as a whole
+    typedef struct
+    {
+        double latitude { 0 };
+        double longitude { 0 };
+        double elevation { 0 };
+        time_t time { -1 };
+        // The date came from the receiver, not from the system clock
+        bool dated { false };
+    } Fix;
+
     Connection::TCP *tcpConnection { nullptr };
     bool isNMEA();
     void parseNEMA();
+    void updateFixStatus(int fixType);
+    bool startPPS();
+
+    // Pulse per second timestamping
+    ISwitch PPSS[2];
+    ISwitchVectorProperty PPSSP;
+    enum
+    {
+        PPS_ENABLE,
+        PPS_DISABLE
+    };
+    IText PPSSettingsT[2] {};
+    ITextVectorProperty PPSSettingsTP;
+    enum
+    {
+        PPS_DEVICE,
+        PPS_LOG
+    };
+    INumber PPSN[3];
+    INumberVectorProperty PPSNP;
+    enum
+    {
+        PPS_OFFSET,
+        PPS_JITTER,
+        PPS_PULSES
+    };
+    PPSClock ppsClock;
 
     int PortFD { -1 };
     uint8_t timeoutCounter=0;
     bool locationPending = true, timePending=true;
 
-    pthread_mutex_t lock;
+    // Reader thread only
+    NMEAReader reader;
+    int fixType { 0 };
+
+    // Guarded by lock
+    Fix fix;
+
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
     pthread_t nmeaThread;
 };
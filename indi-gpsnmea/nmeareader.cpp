@@ -0,0 +1,177 @@
+/*******************************************************************************
+  Copyright(c) 2017 Jasem Mutlaq. All rights reserved.
+
+  INDI GPS NMEA Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "nmeareader.h"
+
+#include <indicom.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+
+// Longest sentence, with its checksum, that minmea accepts
+#define MAX_SENTENCE (MINMEA_MAX_LENGTH + 3)
+
+static int hex2int(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+int NMEAReader::fill(int fd, int timeout)
+{
+    // Move the partial sentence left over to the front
+    if (start > 0)
+    {
+        memmove(buffer, buffer + start, end - start);
+        end -= start;
+        start = 0;
+    }
+
+    // Only when next() was not called until it ran dry
+    if (end == BUFFER_SIZE)
+    {
+        rejected++;
+        end = 0;
+    }
+
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    int rc = poll(&pfd, 1, timeout * 1000);
+    if (rc == 0)
+        return TTY_TIME_OUT;
+    if (rc < 0)
+        return errno == EINTR ? TTY_OK : TTY_SELECT_ERROR;
+
+    ssize_t bytes_read = read(fd, buffer + end, BUFFER_SIZE - end);
+    if (bytes_read < 0)
+        return (errno == EINTR || errno == EAGAIN) ? TTY_OK : TTY_READ_ERROR;
+    if (bytes_read == 0)
+        return TTY_OVERFLOW;
+
+    end += bytes_read;
+    return TTY_OK;
+}
+
+const char *NMEAReader::next(enum minmea_sentence_id *id)
+{
+    while (start < end)
+    {
+        char *line = buffer + start;
+        char *eol  = static_cast<char *>(memchr(line, '\n', end - start));
+
+        if (eol == nullptr)
+        {
+            // Noise, no sentence is that long
+            if (end - start > MAX_SENTENCE + 2)
+            {
+                rejected++;
+                start = end;
+            }
+            return nullptr;
+        }
+        start = eol - buffer + 1;
+
+        size_t length = eol - line;
+        if (length > 0 && line[length - 1] == '\r')
+            length--;
+        line[length] = '\0';
+
+        if (length == 0)
+            continue;
+
+        if (length < 6 || line[0] != '$')
+        {
+            rejected++;
+            continue;
+        }
+
+        // The type alone tells whether the sentence is worth checking, whatever the talker
+        const char *type = line + 3;
+        enum minmea_sentence_id found;
+        if (!memcmp(type, "RMC", 3))
+            found = MINMEA_SENTENCE_RMC;
+        else if (!memcmp(type, "GGA", 3))
+            found = MINMEA_SENTENCE_GGA;
+        else if (!memcmp(type, "GSA", 3))
+            found = MINMEA_SENTENCE_GSA;
+        else if (!memcmp(type, "ZDA", 3))
+            found = MINMEA_SENTENCE_ZDA;
+        else
+        {
+            skipped++;
+            continue;
+        }
+
+        if (!validate(line, length))
+        {
+            rejected++;
+            continue;
+        }
+
+        sentences++;
+        *id = found;
+        return line;
+    }
+
+    return nullptr;
+}
+
+void NMEAReader::reset()
+{
+    start = end = 0;
+}
+
+// Same rules as minmea_check(), without the strict mode
+bool NMEAReader::validate(const char *line, size_t length) const
+{
+    if (length > MAX_SENTENCE)
+        return false;
+
+    uint8_t checksum = 0;
+    size_t i = 1;
+    for (; i < length && line[i] != '*'; i++)
+    {
+        if (!isprint(static_cast<unsigned char>(line[i])))
+            return false;
+        checksum ^= line[i];
+    }
+
+    // The checksum is optional
+    if (i == length)
+        return true;
+
+    if (length - i != 3)
+        return false;
+
+    int upper = hex2int(line[i + 1]);
+    int lower = hex2int(line[i + 2]);
+    return upper >= 0 && lower >= 0 && (upper << 4 | lower) == checksum;
+}
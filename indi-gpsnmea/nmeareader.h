@@ -0,0 +1,90 @@
+/*******************************************************************************
+  Copyright(c) 2017 Jasem Mutlaq. All rights reserved.
+
+  INDI GPS NMEA Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include "minmea.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief The NMEAReader class splits a raw NMEA stream into sentences.
+ *
+ * The stream is read in large chunks and split in place, so sentences are handed out as pointers
+ * into the read buffer. Only the RMC, GGA, GSA and ZDA sentences the driver uses are returned, and
+ * only once their checksum matched, so minmea never sees anything else.
+ */
+class NMEAReader
+{
+  public:
+    // Room for many sentences, a whole burst from a 20 Hz receiver fits in one read
+    static const size_t BUFFER_SIZE = 4096;
+
+    /**
+     * @brief fill Wait for data and append a single read to the buffer.
+     * @param fd Port to read from.
+     * @param timeout Seconds to wait for data.
+     * @return TTY_OK, TTY_TIME_OUT, TTY_READ_ERROR with errno set, or TTY_OVERFLOW when the
+     * peer closed the connection, the error tty_nread_section ran into in that case.
+     */
+    int fill(int fd, int timeout);
+
+    /**
+     * @brief next Take the next usable sentence from the buffer.
+     * @param id Set to the sentence type.
+     * @return The sentence, null terminated without its line ending, or nullptr once the buffer holds
+     * no more complete sentences. Valid until the next call to fill() or reset().
+     */
+    const char *next(enum minmea_sentence_id *id);
+
+    /** @brief reset Drop any buffered data, after the port was reopened. */
+    void reset();
+
+    // Statistics
+    uint64_t getSentences() const
+    {
+        return sentences;
+    }
+    uint64_t getSkipped() const
+    {
+        return skipped;
+    }
+    uint64_t getRejected() const
+    {
+        return rejected;
+    }
+
+  private:
+    bool validate(const char *line, size_t length) const;
+
+    char buffer[BUFFER_SIZE + 1];
+    size_t start { 0 };
+    size_t end { 0 };
+
+    // Sentences returned, not used by the driver and failing the checks
+    uint64_t sentences { 0 };
+    uint64_t skipped { 0 };
+    uint64_t rejected { 0 };
+};
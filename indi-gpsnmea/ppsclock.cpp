@@ -0,0 +1,271 @@
+/*******************************************************************************
+  Copyright(c) 2017 Jasem Mutlaq. All rights reserved.
+
+  INDI GPS NMEA Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "config.h"
+#include "ppsclock.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <unistd.h>
+
+#ifdef HAVE_SYS_TIMEPPS_H
+#include <sys/timepps.h>
+#endif
+
+// Filter gain, the offset settles in a few tens of pulses
+#define FILTER_GAIN     (1.0 / 8)
+// Offsets this far from the filtered one are outliers, seconds
+#define OUTLIER_LIMIT   (0.1)
+// Consecutive outliers taken as a clock step, the filter restarts on the new offset
+#define MAX_OUTLIERS    (3)
+
+static double toSeconds(const struct timespec &t)
+{
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+PPSClock::~PPSClock()
+{
+    stop();
+    setLog(nullptr);
+}
+
+bool PPSClock::isSupported()
+{
+#ifdef HAVE_SYS_TIMEPPS_H
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PPSClock::start(const char *device)
+{
+    stop();
+
+#ifdef HAVE_SYS_TIMEPPS_H
+    // Write access is only needed to change the capture mode
+    fd = open(device, O_RDWR);
+    if (fd < 0 && errno == EACCES)
+        fd = open(device, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    pps_handle_t handle;
+    if (time_pps_create(fd, &handle) < 0)
+    {
+        int error = errno;
+        close(fd);
+        fd = -1;
+        errno = error;
+        return false;
+    }
+
+    auto fail = [this, handle](int error)
+    {
+        time_pps_destroy(handle);
+        close(fd);
+        fd = -1;
+        errno = error;
+        return false;
+    };
+
+    int mode = 0;
+    pps_params_t params;
+    if (time_pps_getcap(handle, &mode) < 0 || time_pps_getparams(handle, &params) < 0)
+        return fail(errno);
+    // Without waiting, the thread would have to poll
+    if (!(mode & PPS_CAPTUREASSERT) || !(mode & PPS_CANWAIT))
+        return fail(EOPNOTSUPP);
+    if (!(params.mode & PPS_CAPTUREASSERT))
+    {
+        params.mode |= PPS_CAPTUREASSERT | PPS_TSFMT_TSPEC;
+        if (time_pps_setparams(handle, &params) < 0)
+            return fail(errno);
+    }
+
+    reset();
+    running = true;
+    thread = std::thread([this, handle]()
+    {
+        while (running)
+        {
+            pps_info_t info;
+            // Short enough for stop() not to wait on a receiver that lost its fix
+            struct timespec timeout = { 0, 500000000 };
+            if (time_pps_fetch(handle, PPS_TSFMT_TSPEC, &info, &timeout) < 0)
+            {
+                if (errno == ETIMEDOUT || errno == EINTR)
+                    continue;
+                break;
+            }
+            pulse(info.assert_timestamp, info.assert_sequence);
+        }
+        time_pps_destroy(handle);
+        running = false;
+    });
+    return true;
+#else
+    (void)device;
+    errno = EOPNOTSUPP;
+    return false;
+#endif
+}
+
+void PPSClock::stop()
+{
+    running = false;
+    if (thread.joinable())
+        thread.join();
+    if (fd >= 0)
+    {
+        close(fd);
+        fd = -1;
+    }
+}
+
+void PPSClock::pulse(const struct timespec &edge, unsigned long sequence)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (count > 0 && sequence == lastSequence)
+        return;
+
+    history[head] = { edge, sequence };
+    head = (head + 1) % HISTORY;
+    if (count < HISTORY)
+        count++;
+    lastSequence = sequence;
+    status.pulses++;
+}
+
+bool PPSClock::correlate(const struct timespec &fixTime, const struct timespec &received, double *offset)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+
+    // Where the second of the fix started on the system clock, had the sentence come in no time.
+    // The pulse that started it is the last one before that.
+    double start = toSeconds(received) - fixTime.tv_nsec / 1e9;
+    const Pulse *match = nullptr;
+    for (int i = 1; i <= count; i++)
+    {
+        const Pulse &p = history[(head - i + HISTORY) % HISTORY];
+        if (toSeconds(p.edge) <= start)
+        {
+            match = &p;
+            break;
+        }
+    }
+    // A missed pulse, the fix would be matched with the second before
+    if (match == nullptr || start - toSeconds(match->edge) >= 1)
+        return false;
+
+    // Whole seconds apart, keeps the nanoseconds out of a double of the epoch
+    double measured = static_cast<double>(fixTime.tv_sec - match->edge.tv_sec) - match->edge.tv_nsec / 1e9;
+    status.fixes++;
+
+    // Every fix of a second measures the same edge, count it once
+    if (!filteredAny || match->sequence != filteredSequence)
+    {
+        filteredAny      = true;
+        filteredSequence = match->sequence;
+
+        double residual = measured - filtered;
+        if (!status.locked)
+        {
+            filtered      = measured;
+            meanSquare    = 0;
+            outliers      = 0;
+            status.locked = true;
+        }
+        else if (fabs(residual) > OUTLIER_LIMIT)
+        {
+            // A spurious edge or a stepped clock, only follow it if it stays
+            if (++outliers >= MAX_OUTLIERS)
+            {
+                filtered   = measured;
+                meanSquare = 0;
+                outliers   = 0;
+            }
+        }
+        else
+        {
+            outliers = 0;
+            filtered += residual * FILTER_GAIN;
+            meanSquare += (residual * residual - meanSquare) * FILTER_GAIN;
+        }
+        status.offset = filtered;
+        status.jitter = sqrt(meanSquare);
+    }
+
+    if (log != nullptr)
+        fprintf(log, "%lu,%ld.%09ld,%ld.%09ld,%ld.%09ld,%.9f,%.9f,%.9f\n", match->sequence,
+                static_cast<long>(match->edge.tv_sec), match->edge.tv_nsec,
+                static_cast<long>(fixTime.tv_sec), fixTime.tv_nsec,
+                static_cast<long>(received.tv_sec), received.tv_nsec,
+                measured, status.offset, status.jitter);
+
+    if (offset != nullptr)
+        *offset = measured;
+    return true;
+}
+
+PPSClock::Status PPSClock::getStatus()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    return status;
+}
+
+bool PPSClock::setLog(const char *path)
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    if (log != nullptr)
+    {
+        fclose(log);
+        log = nullptr;
+    }
+    if (path == nullptr || path[0] == '\0')
+        return true;
+
+    log = fopen(path, "a");
+    if (log == nullptr)
+        return false;
+    // One line per fix, a crash loses at most the last one
+    setvbuf(log, nullptr, _IOLBF, 0);
+    if (ftell(log) == 0)
+        fprintf(log, "# sequence,pulse,fix,received,offset,filtered,jitter\n");
+    return true;
+}
+
+void PPSClock::reset()
+{
+    std::lock_guard<std::mutex> guard(mutex);
+    count       = 0;
+    head        = 0;
+    filteredAny = false;
+    filtered    = 0;
+    meanSquare  = 0;
+    outliers    = 0;
+    status      = Status();
+}
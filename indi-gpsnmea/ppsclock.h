@@ -0,0 +1,131 @@
+/*******************************************************************************
+  Copyright(c) 2017 Jasem Mutlaq. All rights reserved.
+
+  INDI GPS NMEA Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include <stdio.h>
+#include <time.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief The PPSClock class measures the system clock offset against the receiver pulse per second.
+ *
+ * The pulses are timestamped by the kernel through the Linux PPS API on a thread of their own, or
+ * handed over with pulse(). Each fix is matched with the pulse that started its second, which
+ * gives the offset without the serial and parsing latency of the sentence. The offsets go through
+ * an exponential filter that also tracks their jitter, and can be logged as they come.
+ */
+class PPSClock
+{
+  public:
+    typedef struct
+    {
+        // Seconds to add to the system clock to get UTC
+        double offset { 0 };
+        // RMS of the offset residuals, seconds
+        double jitter { 0 };
+        unsigned long pulses { 0 };
+        unsigned long fixes { 0 };
+        bool locked { false };
+    } Status;
+
+    PPSClock() = default;
+    ~PPSClock();
+
+    /** @brief isSupported Whether the driver was built with the Linux PPS API. */
+    static bool isSupported();
+
+    /**
+     * @brief start Open a PPS device and timestamp its assert edges on the capture thread.
+     * @param device Such as /dev/pps0.
+     * @return false with errno set if the device cannot be opened or does not capture assert edges.
+     */
+    bool start(const char *device);
+
+    /** @brief stop Join the capture thread and close the device. */
+    void stop();
+
+    bool isRunning() const
+    {
+        return running;
+    }
+
+    /**
+     * @brief pulse Record an assert edge.
+     * @param edge System time of the edge.
+     * @param sequence Pulse count, repeated sequences are dropped.
+     */
+    void pulse(const struct timespec &edge, unsigned long sequence);
+
+    /**
+     * @brief correlate Match a fix with the pulse that started its second and update the filter.
+     * @param fixTime UTC time of the fix, from the receiver.
+     * @param received System time the sentence carrying the fix was read.
+     * @param offset Set to the measured offset, in seconds, if not nullptr.
+     * @return false if no pulse came in the second before the fix.
+     */
+    bool correlate(const struct timespec &fixTime, const struct timespec &received, double *offset = nullptr);
+
+    Status getStatus();
+
+    /**
+     * @brief setLog Write every correlated fix to a CSV file.
+     * @param path File to append to, nullptr or empty to close the log.
+     */
+    bool setLog(const char *path);
+
+    /** @brief reset Forget the pulses and the filter state. */
+    void reset();
+
+  private:
+    typedef struct
+    {
+        struct timespec edge;
+        unsigned long sequence;
+    } Pulse;
+
+    // A few seconds of pulses, fixes are never older than that
+    static const int HISTORY = 8;
+
+    Pulse history[HISTORY] {};
+    int count { 0 }, head { 0 };
+    unsigned long lastSequence { 0 };
+
+    // Filter, updated on the first fix after each pulse
+    bool filteredAny { false };
+    unsigned long filteredSequence { 0 };
+    double filtered { 0 }, meanSquare { 0 };
+    int outliers { 0 };
+    Status status;
+
+    FILE *log { nullptr };
+
+    std::mutex mutex;
+    std::thread thread;
+    std::atomic<bool> running { false };
+    int fd { -1 };
+};
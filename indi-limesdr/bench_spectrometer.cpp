@@ -0,0 +1,245 @@
+/*
+    indi_limesdr_receiver - a software defined radio driver for INDI
+    Copyright (C) 2017  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/*
+    Spectrometer benchmark
+
+    Writes a synthetic I/Q file with two tones over a little noise, replays it through FileIQSource
+    into the Spectrometer and reports the throughput for several worker counts. The output of a
+    short run is checked against a scalar DFT implementation of the same Welch average, and the
+    tones must land in their channels.
+
+    bench_spectrometer [--channels N] [--decimation N] [--samples N] [--file PATH] [--output FILE]
+*/
+
+#include "iqstream.h"
+#include "spectrometer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define CHUNK_SAMPLES (16384)
+
+// Tones, in channels from the centre of the band
+#define TONE1_CHANNEL (-100)
+#define TONE2_CHANNEL (37)
+
+static bool writeToneFile(const char *path, int channels, int decimation, size_t samples)
+{
+    FILE *f = fopen(path, "wb");
+    if (f == nullptr)
+        return false;
+
+    uint32_t seed = 1;
+    auto noise = [&seed]()
+    {
+        seed = seed * 1664525u + 1013904223u;
+        return ((seed >> 8) / 16777216.0 - 0.5) * 0.02;
+    };
+
+    // Frequencies in cycles per input sample, on channel centres after decimation
+    double f1 = static_cast<double>(TONE1_CHANNEL) / channels / decimation;
+    double f2 = static_cast<double>(TONE2_CHANNEL) / channels / decimation;
+    std::vector<float> buf(2 * CHUNK_SAMPLES);
+    for (size_t done = 0; done < samples;)
+    {
+        size_t n = std::min<size_t>(CHUNK_SAMPLES, samples - done);
+        for (size_t i = 0; i < n; i++)
+        {
+            double t    = static_cast<double>(done + i);
+            buf[2 * i]     = 0.5 * cos(2 * M_PI * f1 * t) + 0.1 * cos(2 * M_PI * f2 * t) + noise();
+            buf[2 * i + 1] = 0.5 * sin(2 * M_PI * f1 * t) + 0.1 * sin(2 * M_PI * f2 * t) + noise();
+        }
+        fwrite(buf.data(), 2 * sizeof(float), n, f);
+        done += n;
+    }
+    fclose(f);
+    return true;
+}
+
+static std::vector<float> readSamples(const char *path, size_t samples)
+{
+    std::vector<float> iq(2 * samples);
+    FileIQSource source(path);
+    // No pacing
+    source.setSampleRate(1e15);
+    if (!source.open())
+        return std::vector<float>();
+    for (size_t done = 0; done < samples;)
+    {
+        int n = source.read(&iq[2 * done], std::min<size_t>(CHUNK_SAMPLES, samples - done), 1000);
+        if (n < 0)
+            return std::vector<float>();
+        done += n;
+    }
+    return iq;
+}
+
+// Same estimate as Spectrometer, straight from the definitions
+static std::vector<double> referenceSpectrum(const std::vector<float> &iq, size_t samples, int channels, int decimation)
+{
+    std::vector<std::complex<double>> x;
+    for (size_t i = 0; i + decimation <= samples; i += decimation)
+    {
+        std::complex<double> sum = 0;
+        for (int j = 0; j < decimation; j++)
+            sum += std::complex<double>(iq[2 * (i + j)], iq[2 * (i + j) + 1]);
+        x.push_back(sum / static_cast<double>(decimation));
+    }
+
+    std::vector<double> window(channels), power(channels, 0);
+    double windowPower = 0;
+    for (int i = 0; i < channels; i++)
+    {
+        window[i] = 0.5 - 0.5 * cos(2 * M_PI * i / channels);
+        windowPower += window[i] * window[i];
+    }
+
+    size_t frames = 0;
+    for (size_t offset = 0; offset + channels <= x.size(); offset += channels / 2, frames++)
+    {
+        for (int k = 0; k < channels; k++)
+        {
+            std::complex<double> sum = 0;
+            for (int n = 0; n < channels; n++)
+                sum += x[offset + n] * window[n] * std::polar(1.0, -2 * M_PI * k * n / channels);
+            power[k] += std::norm(sum);
+        }
+    }
+
+    std::vector<double> shifted(channels);
+    for (int k = 0; k < channels; k++)
+        shifted[k] = power[(k + channels - channels / 2) % channels] / (frames * windowPower);
+    return shifted;
+}
+
+static int peakChannel(const std::vector<double> &spectrum, int from, int to)
+{
+    return static_cast<int>(std::max_element(spectrum.begin() + from, spectrum.begin() + to) - spectrum.begin());
+}
+
+int main(int argc, char **argv)
+{
+    int channels       = 1024;
+    int decimation     = 1;
+    size_t samples     = 1 << 24;
+    const char *path   = "/tmp/bench_spectrometer.cf32";
+    const char *output = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--channels"))
+            channels = atoi(argv[++i]);
+        else if (arg("--decimation"))
+            decimation = atoi(argv[++i]);
+        else if (arg("--samples"))
+            samples = strtoull(argv[++i], nullptr, 10);
+        else if (arg("--file"))
+            path = argv[++i];
+        else if (arg("--output"))
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--channels N] [--decimation N] [--samples N] [--file PATH] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (channels < 256 || decimation < 1)
+    {
+        fprintf(stderr, "At least 256 channels are needed to resolve the tones\n");
+        return 2;
+    }
+
+    if (!writeToneFile(path, channels, decimation, samples))
+    {
+        fprintf(stderr, "Unable to write %s\n", path);
+        return 1;
+    }
+    std::vector<float> iq = readSamples(path, samples);
+    if (iq.empty())
+    {
+        fprintf(stderr, "Unable to read %s\n", path);
+        return 1;
+    }
+
+    // Correctness on a short run, long enough to span several blocks plus a partial one
+    bool ok = true;
+    size_t checkSamples = std::min<size_t>(samples, static_cast<size_t>(channels) * decimation * 100);
+    std::vector<double> reference = referenceSpectrum(iq, checkSamples, channels, decimation);
+    double peak = *std::max_element(reference.begin(), reference.end());
+
+    Spectrometer check;
+    check.setup(channels, decimation, 3);
+    for (size_t done = 0; done < checkSamples; done += CHUNK_SAMPLES)
+        check.process(&iq[2 * done], std::min<size_t>(CHUNK_SAMPLES, checkSamples - done));
+    std::vector<double> spectrum;
+    uint64_t frames = check.finish(spectrum);
+
+    double maxError = 0;
+    for (int k = 0; k < channels; k++)
+        maxError = std::max(maxError, fabs(spectrum[k] - reference[k]) / peak);
+    int tone1 = peakChannel(spectrum, 0, channels / 2 + (TONE1_CHANNEL + TONE2_CHANNEL) / 2);
+    int tone2 = peakChannel(spectrum, channels / 2 + (TONE1_CHANNEL + TONE2_CHANNEL) / 2, channels);
+    ok = maxError < 1e-9 && tone1 == channels / 2 + TONE1_CHANNEL && tone2 == channels / 2 + TONE2_CHANNEL;
+
+    // Throughput
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"limesdr_spectrometer\",\n");
+    fprintf(out, "  \"config\": {\"channels\": %d, \"decimation\": %d, \"samples\": %zu},\n", channels, decimation, samples);
+    fprintf(out, "  \"check\": {\"frames\": %llu, \"max_error\": %.3g, \"tone_channels\": [%d, %d], \"expected\": [%d, %d], \"passed\": %s},\n",
+            static_cast<unsigned long long>(frames), maxError, tone1, tone2, channels / 2 + TONE1_CHANNEL,
+            channels / 2 + TONE2_CHANNEL, ok ? "true" : "false");
+    fprintf(out, "  \"runs\": [\n");
+
+    int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int workers = 1; workers <= cores; workers *= 2)
+    {
+        Spectrometer spectrometer;
+        spectrometer.setup(channels, decimation, workers);
+
+        auto start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done < samples; done += CHUNK_SAMPLES)
+            spectrometer.process(&iq[2 * done], std::min<size_t>(CHUNK_SAMPLES, samples - done));
+        frames = spectrometer.finish(spectrum);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        fprintf(out, "    {\"workers\": %d, \"frames\": %llu, \"seconds\": %.4f, \"msps\": %.2f}%s\n", workers,
+                static_cast<unsigned long long>(frames), seconds, samples / seconds / 1e6, workers * 2 <= cores ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    if (output)
+        fclose(out);
+
+    return ok ? 0 : 1;
+}
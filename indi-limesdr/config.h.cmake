@@ -7,6 +7,9 @@
 /* Define if you have fitsio.h */
 #cmakedefine   HAVE_CFITSIO_H 1
 
+/* Define if you have fftw3.h */
+#cmakedefine   HAVE_FFTW3 1
+
 /* Define Driver version */
 #define LIMESDR_VERSION_MAJOR @LIMESDR_VERSION_MAJOR@
 #define LIMESDR_VERSION_MINOR @LIMESDR_VERSION_MINOR@
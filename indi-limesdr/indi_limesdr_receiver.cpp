@@ -17,6 +17,7 @@
     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
 */
 
+#include "config.h"
 #include "indi_limesdr_receiver.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -24,6 +25,7 @@
 #include <indilogger.h>
 #include <memory>
 #include <deque>
+#include <cmath>
 
 #define min(a, b)               \
     ({                          \
@@ -37,6 +39,11 @@
 #define MIN_FRAME_SIZE (512)
 #define MAX_FRAME_SIZE (SUBFRAME_SIZE * 16)
 #define SPECTRUM_SIZE  (256)
+// Device FIFO and ring between the receive and reduce threads, in samples and chunks
+#define STREAM_FIFO_SIZE (1 << 20)
+#define RING_CHUNKS      (64)
+// Longer integrations are averaged down to this many continuum values
+#define MAX_CONTINUUM_SIZE (1 << 22)
 
 static class Loader
 {
@@ -46,6 +53,13 @@ public:
 public:
     Loader()
     {
+        // Replay a recording without hardware
+        if (getenv("LIMESDR_IQ_FILE") != nullptr)
+        {
+            receivers.push_back(std::unique_ptr<LIMESDR>(new LIMESDR(0)));
+            return;
+        }
+
         int iNumofConnectedReceivers = LMS_GetDeviceList(lime_dev_list);
 
         if (iNumofConnectedReceivers <= 0)
@@ -67,6 +81,8 @@ LIMESDR::LIMESDR(uint32_t index)
 {
     InIntegration = false;
     receiverIndex = index;
+    if (getenv("LIMESDR_IQ_FILE") != nullptr)
+        iqFile = getenv("LIMESDR_IQ_FILE");
 
     char name[MAXINDIDEVICE];
     snprintf(name, MAXINDIDEVICE, "%s %d", getDefaultName(), index);
@@ -78,6 +94,12 @@ LIMESDR::LIMESDR(uint32_t index)
 ***************************************************************************************/
 bool LIMESDR::Connect()
 {
+    if (!iqFile.empty())
+    {
+        LOGF_INFO("Replaying %s instead of a LIME-SDR Receiver.", iqFile.c_str());
+        return true;
+    }
+
     int r = LMS_Open(&lime_dev, loader.lime_dev_list[receiverIndex], NULL);
     if (r < 0)
     {
@@ -99,8 +121,14 @@ bool LIMESDR::Connect()
 ***************************************************************************************/
 bool LIMESDR::Disconnect()
 {
-    InIntegration = false;
-    LMS_Close(lime_dev);
+    {
+        std::lock_guard<std::mutex> lock(integrationMutex);
+        InIntegration = false;
+    }
+    iqStream.reset();
+    if (lime_dev != nullptr)
+        LMS_Close(lime_dev);
+    lime_dev = nullptr;
     setBufferSize(1);
     LOG_INFO("LIME-SDR Receiver disconnected successfully!");
     return true;
@@ -133,6 +161,15 @@ bool LIMESDR::initProperties()
     setMinMaxStep("RECEIVER_SETTINGS", "RECEIVER_BANDWIDTH", 400.0e+6, 3.8e+9, 1, false);
     setMinMaxStep("RECEIVER_SETTINGS", "RECEIVER_BITSPERSAMPLE", -32, -32, 0, false);
     setIntegrationFileExtension("fits");
+
+    IUFillSwitch(&ModeS[0], "MODE_CONTINUUM", "Continuum", ISS_ON);
+    IUFillSwitch(&ModeS[1], "MODE_SPECTRUM", "Spectrum", ISS_OFF);
+    IUFillSwitchVector(&ModeSP, ModeS, 2, getDeviceName(), "LIMESDR_MODE", "Mode", MAIN_CONTROL_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    // Channels of the spectrum, and input samples averaged before the FFT
+    IUFillNumber(&SpectrometerN[0], "SPECTROMETER_CHANNELS", "Channels", "%.f", 64, 65536, 64, 1024);
+    IUFillNumber(&SpectrometerN[1], "SPECTROMETER_DECIMATION", "Decimation", "%.f", 1, 1024, 1, 1);
+    IUFillNumberVector(&SpectrometerNP, SpectrometerN, 2, getDeviceName(), "LIMESDR_SPECTROMETER", "Spectrometer", MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
     /*
     // PrimaryReceiver Device Continuum Blob
     IUFillBLOB(&TFitsB[0], "TRMT", "Transmit1", "");
@@ -163,6 +200,10 @@ bool LIMESDR::updateProperties()
     {
         // Inital values
         setupParams(1000000, 1420000000, 10000, 10);
+#ifdef HAVE_FFTW3
+        defineProperty(&ModeSP);
+        defineProperty(&SpectrometerNP);
+#endif
         //defineProperty(&TFitsBP);
 
         // Start the timer
@@ -170,6 +211,10 @@ bool LIMESDR::updateProperties()
     }
     else
     {
+#ifdef HAVE_FFTW3
+        deleteProperty(ModeSP.name);
+        deleteProperty(SpectrometerNP.name);
+#endif
         //deleteProperty(TFitsBP.name);
     }
 
@@ -183,24 +228,54 @@ bool LIMESDR::StartIntegration(double duration)
 {
     IntegrationRequest = duration;
 
+    if (!iqStream || !iqStream->isRunning())
+    {
+        LOG_ERROR("Receive stream is not running.");
+        return false;
+    }
+
     // Since we have only have one Receiver with one chip, we set the exposure duration of the primary Receiver
     setIntegrationTime(duration);
-    b_read  = 0;
-    to_read = getSampleRate() * getIntegrationTime();
 
-    setBufferSize(to_read * sizeof(float));
+#ifdef HAVE_FFTW3
+    // Planning the transforms can take a while, only done when the configuration changes
+    bool spectrum = ModeS[1].s == ISS_ON;
+    if (spectrum && !spectrometer.setup(SpectrometerN[0].value, SpectrometerN[1].value))
+    {
+        LOG_ERROR("Failed to set up the spectrometer.");
+        return false;
+    }
+#else
+    // Built without FFTW, continuum only
+    bool spectrum = false;
+#endif
+
+    std::lock_guard<std::mutex> lock(integrationMutex);
+    spectrumMode = spectrum;
+#ifdef HAVE_FFTW3
+    if (spectrumMode)
+        spectrometer.reset();
+#endif
+    b_read      = 0;
+    n_read      = 0;
+    to_read     = getSampleRate() * getIntegrationTime();
+    decimation  = (to_read + MAX_CONTINUUM_SIZE - 1) / MAX_CONTINUUM_SIZE;
+    accumulator = 0;
+    accumulated = 0;
+    overruns    = iqStream->getStatistics().overruns;
 
     if (to_read > 0)
     {
-        lime_stream.channel             = 0;
-        lime_stream.isTx                = false;
-        lime_stream.fifoSize            = to_read;
-        lime_stream.dataFmt             = lms_stream_t::LMS_FMT_F32;
-        lime_stream.throughputVsLatency = 0.5;
-        LMS_SetupStream(lime_dev, &lime_stream);
-        LMS_StartStream(&lime_stream);
+        // One magnitude per sample, or the average of decimation samples for long integrations.
+        // The spectrum is written when the integration completes.
+        if (!spectrumMode)
+        {
+            setBufferSize(((to_read + decimation - 1) / decimation) * sizeof(float));
+            continuum = getBuffer();
+        }
         gettimeofday(&CapStart, nullptr);
-        InIntegration = true;
+        IntegrationReady = false;
+        InIntegration    = true;
         LOG_INFO("Integration started...");
         return true;
     }
@@ -216,21 +291,58 @@ void LIMESDR::setupParams(float sr, float freq, float bw, float gain)
 {
     setBPS(-32);
     int r = 0;
-    r |= LMS_SetAntenna(lime_dev, LMS_CH_RX, 0, 0);
-    r |= LMS_SetNormalizedGain(lime_dev, LMS_CH_RX, 0, gain);
-    r |= LMS_SetLOFrequency(lime_dev, LMS_CH_RX, 0, freq);
-    r |= LMS_SetSampleRate(lime_dev, sr, 0);
-    r |= LMS_Calibrate(lime_dev, LMS_CH_RX, 0, bw, 0);
+
+    // The stream is rebuilt around the changes, the sample rate can not change while streaming
+    iqStream.reset();
+    if (lime_dev != nullptr)
+    {
+        r |= LMS_SetAntenna(lime_dev, LMS_CH_RX, 0, 0);
+        r |= LMS_SetNormalizedGain(lime_dev, LMS_CH_RX, 0, gain);
+        r |= LMS_SetLOFrequency(lime_dev, LMS_CH_RX, 0, freq);
+        r |= LMS_SetSampleRate(lime_dev, sr, 0);
+        r |= LMS_Calibrate(lime_dev, LMS_CH_RX, 0, bw, 0);
+    }
 
     if (r != 0)
     {
         LOG_INFO("Error(s) setting parameters.");
     }
+
+    if (!startStream(sr))
+        LOG_ERROR("Failed to start the receive stream.");
+}
+
+/**************************************************************************************
+** Start receiving, from the device or from the replay file
+***************************************************************************************/
+bool LIMESDR::startStream(double sampleRate)
+{
+    std::unique_ptr<IQSource> source;
+    if (!iqFile.empty())
+        source.reset(new FileIQSource(iqFile));
+    else if (lime_dev != nullptr)
+        source.reset(new LimeIQSource(lime_dev, STREAM_FIFO_SIZE));
+    else
+        return false;
+    source->setSampleRate(sampleRate);
+
+    iqStream.reset(new IQStream(RING_CHUNKS, SUBFRAME_SIZE));
+    return iqStream->start(std::move(source), [this](const float * iq, size_t samples)
+    {
+        reduce(iq, samples);
+    });
 }
 
 bool LIMESDR::ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n)
 {
     bool r = false;
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, SpectrometerNP.name))
+    {
+        IUUpdateNumber(&SpectrometerNP, values, names, n);
+        SpectrometerNP.s = IPS_OK;
+        IDSetNumber(&SpectrometerNP, nullptr);
+        return true;
+    }
     if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, ReceiverSettingsNP.name)) {
         for(int i = 0; i < n; i++) {
             if (!strcmp(names[i], "RECEIVER_GAIN")) {
@@ -248,22 +360,34 @@ bool LIMESDR::ISNewNumber(const char *dev, const char *name, double values[], ch
     return processNumber(dev, name, values, names, n) & !r;
 }
 
-/**************************************************************************************
-** Client is asking us to abort a capture
-***************************************************************************************/
-bool LIMESDR::AbortIntegration()
+bool LIMESDR::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
 {
-    if (InIntegration)
+    if (dev && !strcmp(dev, getDeviceName()) && !strcmp(name, ModeSP.name))
     {
-        lms_stream_status_t status;
-        LMS_GetStreamStatus(&lime_stream, &status);
-        if (status.fifoFilledCount <= 0)
+        if (InIntegration)
         {
-            InIntegration = false;
-            LMS_StopStream(&lime_stream);
-            LMS_DestroyStream(lime_dev, &lime_stream);
+            ModeSP.s = IPS_ALERT;
+            IDSetSwitch(&ModeSP, nullptr);
+            LOG_ERROR("Can not change the mode during an integration.");
+            return false;
         }
+        IUUpdateSwitch(&ModeSP, states, names, n);
+        ModeSP.s = IPS_OK;
+        IDSetSwitch(&ModeSP, nullptr);
+        return true;
     }
+    return INDI::Receiver::ISNewSwitch(dev, name, states, names, n);
+}
+
+/**************************************************************************************
+** Client is asking us to abort a capture
+***************************************************************************************/
+bool LIMESDR::AbortIntegration()
+{
+    // The stream keeps running, received samples are just not reduced anymore
+    std::lock_guard<std::mutex> lock(integrationMutex);
+    InIntegration    = false;
+    IntegrationReady = false;
     return true;
 }
 
@@ -298,22 +422,15 @@ void LIMESDR::TimerHit()
     if (InIntegration)
     {
         timeleft = CalcTimeLeft();
-        if (timeleft < 0.1)
+        if (IntegrationReady)
         {
             /* We're done capturing */
             LOG_INFO("Integration done, expecting data...");
-            lms_stream_status_t status;
-            LMS_GetStreamStatus(&lime_stream, &status);
-            if (status.active)
-            {
-                if (status.fifoFilledCount >= status.fifoSize)
-                {
-                    n_read = status.fifoFilledCount;
-                    grabData();
-                }
-            }
+            grabData();
             timeleft = 0.0;
         }
+        else if (timeleft < 0.1)
+            timeleft = 0.0;
 
         // This is an over simplified timing method, check ReceiverSimulator and limesdrReceiver for better timing checks
         setIntegrationLeft(timeleft);
@@ -323,6 +440,44 @@ void LIMESDR::TimerHit()
     return;
 }
 
+/**************************************************************************************
+** Accumulate received samples into the continuum
+***************************************************************************************/
+void LIMESDR::reduce(const float *iq, size_t samples)
+{
+    std::lock_guard<std::mutex> lock(integrationMutex);
+    if (!InIntegration || IntegrationReady)
+        return;
+
+#ifdef HAVE_FFTW3
+    if (spectrumMode)
+    {
+        size_t n = min(static_cast<uint64_t>(samples), to_read - b_read);
+        spectrometer.process(iq, n);
+        b_read += n;
+        if (b_read == to_read)
+            IntegrationReady = true;
+        return;
+    }
+#endif
+
+    float *out = reinterpret_cast<float *>(continuum);
+    for (size_t i = 0; i < samples && b_read < to_read; i++)
+    {
+        accumulator += std::sqrt(iq[2 * i] * iq[2 * i] + iq[2 * i + 1] * iq[2 * i + 1]);
+        b_read++;
+        if (++accumulated == decimation || b_read == to_read)
+        {
+            out[n_read++] = accumulator / accumulated;
+            accumulator   = 0;
+            accumulated   = 0;
+        }
+    }
+
+    if (b_read == to_read)
+        IntegrationReady = true;
+}
+
 /**************************************************************************************
 ** Create the spectrum
 ***************************************************************************************/
@@ -330,12 +485,28 @@ void LIMESDR::grabData()
 {
     if (InIntegration)
     {
-        continuum = getBuffer();
-        LOG_INFO("Downloading...");
-        LMS_RecvStream(&lime_stream, continuum, n_read, NULL, 1000);
-        LMS_StopStream(&lime_stream);
-        LMS_DestroyStream(lime_dev, &lime_stream);
-        InIntegration = false;
+        {
+            std::lock_guard<std::mutex> lock(integrationMutex);
+            InIntegration    = false;
+            IntegrationReady = false;
+        }
+
+        uint64_t dropped = iqStream ? iqStream->getStatistics().overruns - overruns : 0;
+        if (dropped > 0)
+            LOGF_WARN("%llu chunks of %d samples dropped during the integration.", static_cast<unsigned long long>(dropped), SUBFRAME_SIZE);
+
+#ifdef HAVE_FFTW3
+        if (spectrumMode)
+        {
+            std::vector<double> spectrum;
+            uint64_t frames = spectrometer.finish(spectrum);
+            setBufferSize(spectrum.size() * sizeof(float));
+            float *out = reinterpret_cast<float *>(getBuffer());
+            for (size_t i = 0; i < spectrum.size(); i++)
+                out[i] = spectrum[i];
+            LOGF_INFO("%llu spectra averaged.", static_cast<unsigned long long>(frames));
+        }
+#endif
 
         LOG_INFO("Download complete.");
         IntegrationComplete();
@@ -21,6 +21,15 @@
 
 #include <lime/LimeSuite.h>
 #include "indireceiver.h"
+#include "iqstream.h"
+#ifdef HAVE_FFTW3
+#include "spectrometer.h"
+#endif
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
 
 enum Settings
 {
@@ -35,6 +44,7 @@ class LIMESDR : public INDI::Receiver
     LIMESDR(uint32_t index);
 
     bool ISNewNumber(const char *dev, const char *name, double values[], char *names[], int n) override;
+    bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
 
   protected:
 	// General device functions
@@ -51,26 +61,50 @@ class LIMESDR : public INDI::Receiver
     void TimerHit() override;
 
     void grabData();
+    // Runs in the stream worker thread
+    void reduce(const float *iq, size_t samples);
 
   private:
     lms_device_t *lime_dev = { nullptr };
 	// Utility functions
 	float CalcTimeLeft();
     void setupParams(float sr, float freq, float bw, float gain);
-    lms_stream_t lime_stream;
-	// Are we exposing?
+    bool startStream(double sampleRate);
+    // Long-lived receive stream, samples are reduced into the receiver buffer as they arrive
+    std::unique_ptr<IQStream> iqStream;
+    // Replay this file of float32 I/Q samples instead of using the device
+    std::string iqFile;
+	// Are we exposing? Changed with integrationMutex held
     bool InIntegration;
+    std::atomic<bool> IntegrationReady { false };
+    std::mutex integrationMutex;
 	// Struct to keep timing
 	struct timeval CapStart;
-    int to_read;
-    int b_read;
-    int n_read;
+    // Samples wanted and received, continuum values written
+    uint64_t to_read;
+    uint64_t b_read;
+    size_t n_read;
+    // Samples averaged into each continuum value
+    uint64_t decimation;
+    double accumulator;
+    uint64_t accumulated;
+    uint64_t overruns;
+    // Publish the averaged spectrum instead of the continuum
+    bool spectrumMode { false };
+#ifdef HAVE_FFTW3
+    Spectrometer spectrometer;
+#endif
     float IntegrationRequest;
 	uint8_t* continuum;
     uint8_t *spectrum;
 
     uint32_t receiverIndex = { 0 };
 
+    ISwitch ModeS[2];
+    ISwitchVectorProperty ModeSP;
+    INumber SpectrometerN[2];
+    INumberVectorProperty SpectrometerNP;
+
     IBLOB TFitsB[5];
     IBLOBVectorProperty TFitsBP;
 };
@@ -0,0 +1,282 @@
+/*
+    indi_limesdr_receiver - a software defined radio driver for INDI
+    Copyright (C) 2017  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "iqstream.h"
+
+#include <cstring>
+
+/**************************************************************************************
+** LimeSDR source
+***************************************************************************************/
+LimeIQSource::LimeIQSource(lms_device_t *device, uint32_t fifoSize) : device(device), fifoSize(fifoSize)
+{
+    memset(&stream, 0, sizeof(stream));
+}
+
+LimeIQSource::~LimeIQSource()
+{
+    close();
+}
+
+bool LimeIQSource::open()
+{
+    stream.channel             = 0;
+    stream.isTx                = false;
+    stream.fifoSize            = fifoSize;
+    stream.dataFmt             = lms_stream_t::LMS_FMT_F32;
+    stream.throughputVsLatency = 0.5;
+    if (LMS_SetupStream(device, &stream) != 0)
+        return false;
+    if (LMS_StartStream(&stream) != 0)
+    {
+        LMS_DestroyStream(device, &stream);
+        return false;
+    }
+    streaming = true;
+    return true;
+}
+
+void LimeIQSource::close()
+{
+    if (!streaming)
+        return;
+    LMS_StopStream(&stream);
+    LMS_DestroyStream(device, &stream);
+    streaming = false;
+}
+
+int LimeIQSource::read(float *iq, size_t samples, int timeoutMS)
+{
+    return LMS_RecvStream(&stream, iq, samples, nullptr, timeoutMS);
+}
+
+/**************************************************************************************
+** File source
+***************************************************************************************/
+FileIQSource::FileIQSource(const std::string &path) : path(path)
+{
+}
+
+FileIQSource::~FileIQSource()
+{
+    close();
+}
+
+bool FileIQSource::open()
+{
+    file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    start     = std::chrono::steady_clock::now();
+    delivered = 0;
+    return true;
+}
+
+void FileIQSource::close()
+{
+    if (file)
+        fclose(file);
+    file = nullptr;
+}
+
+void FileIQSource::setSampleRate(double rate)
+{
+    sampleRate = rate;
+}
+
+int FileIQSource::read(float *iq, size_t samples, int timeoutMS)
+{
+    if (file == nullptr)
+        return -1;
+
+    // Pace the replay like a receiver would: samples are available once their time has come
+    double rate = sampleRate;
+    auto due    = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                      std::chrono::duration<double>((delivered + samples) / rate));
+    auto limit  = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMS);
+    if (due > limit)
+    {
+        std::this_thread::sleep_until(limit);
+        return 0;
+    }
+    std::this_thread::sleep_until(due);
+
+    size_t got = 0;
+    bool rewound = false;
+    while (got < samples)
+    {
+        size_t n = fread(iq + 2 * got, 2 * sizeof(float), samples - got, file);
+        got += n;
+        if (got < samples)
+        {
+            // Loop, but do not spin on an empty file
+            if (rewound && n == 0)
+                return -1;
+            rewound = true;
+            rewind(file);
+        }
+    }
+    delivered += got;
+    return static_cast<int>(got);
+}
+
+/**************************************************************************************
+** Ring
+***************************************************************************************/
+IQRing::IQRing(size_t chunks, size_t chunkSamples) : chunks(chunks), chunkSamples(chunkSamples),
+    data(chunks * chunkSamples * 2), counts(chunks)
+{
+}
+
+float *IQRing::writeSlot()
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= chunks)
+        return nullptr;
+    return &data[(h % chunks) * chunkSamples * 2];
+}
+
+void IQRing::commit(size_t samples)
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    counts[h % chunks] = samples;
+    head.store(h + 1, std::memory_order_release);
+}
+
+const float *IQRing::readSlot(size_t *samples)
+{
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire))
+        return nullptr;
+    *samples = counts[t % chunks];
+    return &data[(t % chunks) * chunkSamples * 2];
+}
+
+void IQRing::release()
+{
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void IQRing::clear()
+{
+    head = 0;
+    tail = 0;
+}
+
+/**************************************************************************************
+** Stream
+***************************************************************************************/
+IQStream::IQStream(size_t chunks, size_t chunkSamples) : ring(chunks, chunkSamples), chunkSamples(chunkSamples),
+    discard(chunkSamples * 2)
+{
+}
+
+IQStream::~IQStream()
+{
+    stop();
+}
+
+bool IQStream::start(std::unique_ptr<IQSource> source, Consumer consumer)
+{
+    stop();
+    if (!source->open())
+        return false;
+
+    this->source   = std::move(source);
+    this->consumer = consumer;
+    ring.clear();
+    chunks   = 0;
+    samples  = 0;
+    overruns = 0;
+    errors   = 0;
+
+    running  = true;
+    receiver = std::thread(&IQStream::receiveLoop, this);
+    worker   = std::thread(&IQStream::consumeLoop, this);
+    return true;
+}
+
+void IQStream::stop()
+{
+    running = false;
+    available.notify_all();
+    if (receiver.joinable())
+        receiver.join();
+    if (worker.joinable())
+        worker.join();
+    if (source)
+        source->close();
+    source.reset();
+}
+
+IQStream::Statistics IQStream::getStatistics() const
+{
+    Statistics stats;
+    stats.chunks   = chunks;
+    stats.samples  = samples;
+    stats.overruns = overruns;
+    stats.errors   = errors;
+    return stats;
+}
+
+void IQStream::receiveLoop()
+{
+    while (running)
+    {
+        // Keep draining the source when the consumer is behind, the device FIFO must not fill up
+        float *slot = ring.writeSlot();
+        int n = source->read(slot ? slot : discard.data(), chunkSamples, 250);
+        if (n < 0)
+        {
+            errors++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (n == 0)
+            continue;
+
+        samples += n;
+        if (slot == nullptr)
+        {
+            overruns++;
+            continue;
+        }
+        ring.commit(n);
+        chunks++;
+        available.notify_one();
+    }
+}
+
+void IQStream::consumeLoop()
+{
+    while (running)
+    {
+        size_t n = 0;
+        const float *chunk = ring.readSlot(&n);
+        if (chunk == nullptr)
+        {
+            // The notification is not synchronised with the ring, hence the timeout
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait_for(lock, std::chrono::milliseconds(10));
+            continue;
+        }
+        consumer(chunk, n);
+        ring.release();
+    }
+}
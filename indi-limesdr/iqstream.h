@@ -0,0 +1,179 @@
+/*
+    indi_limesdr_receiver - a software defined radio driver for INDI
+    Copyright (C) 2017  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <lime/LimeSuite.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The IQSource class is a source of interleaved float I/Q samples.
+ */
+class IQSource
+{
+  public:
+    virtual ~IQSource() = default;
+
+    virtual bool open() = 0;
+    virtual void close() = 0;
+
+    /**
+     * @brief read Read up to samples I/Q pairs into iq (2 * samples floats).
+     * @return number of pairs read, 0 on timeout, -1 on error.
+     */
+    virtual int read(float *iq, size_t samples, int timeoutMS) = 0;
+
+    virtual void setSampleRate(double rate)
+    {
+        (void)rate;
+    }
+};
+
+/**
+ * @brief The LimeIQSource class streams from channel 0 of a LimeSDR through a fixed size FIFO.
+ */
+class LimeIQSource : public IQSource
+{
+  public:
+    LimeIQSource(lms_device_t *device, uint32_t fifoSize);
+    ~LimeIQSource() override;
+
+    bool open() override;
+    void close() override;
+    int read(float *iq, size_t samples, int timeoutMS) override;
+
+  private:
+    lms_device_t *device { nullptr };
+    lms_stream_t stream;
+    uint32_t fifoSize { 0 };
+    bool streaming { false };
+};
+
+/**
+ * @brief The FileIQSource class replays a file of interleaved float32 I/Q samples, as recorded by
+ * LimeSuite or GNU Radio, in a loop and at the configured sample rate.
+ */
+class FileIQSource : public IQSource
+{
+  public:
+    explicit FileIQSource(const std::string &path);
+    ~FileIQSource() override;
+
+    bool open() override;
+    void close() override;
+    int read(float *iq, size_t samples, int timeoutMS) override;
+    void setSampleRate(double rate) override;
+
+  private:
+    std::string path;
+    FILE *file { nullptr };
+    std::atomic<double> sampleRate { 1000000 };
+    std::chrono::steady_clock::time_point start;
+    uint64_t delivered { 0 };
+};
+
+/**
+ * @brief The IQRing class is a single producer, single consumer ring of fixed size chunks.
+ */
+class IQRing
+{
+  public:
+    IQRing(size_t chunks, size_t chunkSamples);
+
+    /** @return slot for the next chunk, nullptr if the ring is full. */
+    float *writeSlot();
+    void commit(size_t samples);
+
+    /** @return oldest chunk and its number of samples, nullptr if the ring is empty. */
+    const float *readSlot(size_t *samples);
+    void release();
+
+    void clear();
+
+  private:
+    size_t chunks, chunkSamples;
+    std::vector<float> data;
+    std::vector<size_t> counts;
+    std::atomic<size_t> head { 0 };  // Written by the producer
+    std::atomic<size_t> tail { 0 };  // Written by the consumer
+};
+
+/**
+ * @brief The IQStream class keeps an IQSource running in a receive thread and hands each chunk
+ * to a consumer in a second thread, so that a slow consumer never stalls the device FIFO. Chunks
+ * arriving while the ring is full are dropped and counted as overruns.
+ */
+class IQStream
+{
+  public:
+    typedef std::function<void(const float *iq, size_t samples)> Consumer;
+
+    typedef struct Statistics
+    {
+        uint64_t chunks { 0 };
+        uint64_t samples { 0 };
+        uint64_t overruns { 0 };
+        uint64_t errors { 0 };
+    } Statistics;
+
+    IQStream(size_t chunks, size_t chunkSamples);
+    ~IQStream();
+
+    bool start(std::unique_ptr<IQSource> source, Consumer consumer);
+    void stop();
+    bool isRunning() const
+    {
+        return running;
+    }
+
+    IQSource *getSource()
+    {
+        return source.get();
+    }
+
+    Statistics getStatistics() const;
+
+  private:
+    void receiveLoop();
+    void consumeLoop();
+
+    IQRing ring;
+    size_t chunkSamples;
+    std::unique_ptr<IQSource> source;
+    Consumer consumer;
+    std::vector<float> discard;
+
+    std::atomic<bool> running { false };
+    std::thread receiver, worker;
+    std::mutex mutex;
+    std::condition_variable available;
+
+    std::atomic<uint64_t> chunks { 0 }, samples { 0 }, overruns { 0 }, errors { 0 };
+};
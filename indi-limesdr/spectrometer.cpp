@@ -0,0 +1,246 @@
+/*
+    indi_limesdr_receiver - a software defined radio driver for INDI
+    Copyright (C) 2017  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#include "spectrometer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Roughly this many samples per job, whatever the channel count
+#define BLOCK_SAMPLES (1 << 16)
+#define MAX_WORKERS   (8)
+
+// The FFTW planner is not thread safe, execution of distinct plans is
+static std::mutex planner;
+
+Spectrometer::~Spectrometer()
+{
+    stop();
+}
+
+bool Spectrometer::setup(int channels, int decimation, int workers)
+{
+    if (channels < 2 || decimation < 1)
+        return false;
+    if (workers <= 0)
+        workers = std::max(1, std::min(MAX_WORKERS, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+    if (running && channels == this->channels && decimation == this->decimation && workers == getWorkers())
+        return true;
+
+    stop();
+    this->channels   = channels;
+    this->decimation = decimation;
+    hop              = channels / 2;
+    blockSize        = std::max<size_t>(4, BLOCK_SAMPLES / hop) * hop + (channels - hop);
+
+    window.resize(channels);
+    windowPower = 0;
+    for (int i = 0; i < channels; i++)
+    {
+        window[i] = 0.5 - 0.5 * std::cos(2 * M_PI * i / channels);
+        windowPower += window[i] * window[i];
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(planner);
+        for (int i = 0; i < workers; i++)
+        {
+            std::unique_ptr<Worker> worker(new Worker);
+            worker->in   = fftw_alloc_complex(channels);
+            worker->out  = fftw_alloc_complex(channels);
+            worker->plan = fftw_plan_dft_1d(channels, worker->in, worker->out, FFTW_FORWARD, FFTW_MEASURE);
+            worker->power.assign(channels, 0);
+            this->workers.push_back(std::move(worker));
+        }
+    }
+
+    running = true;
+    for (auto &worker : this->workers)
+        worker->thread = std::thread(&Spectrometer::workerLoop, this, worker.get());
+
+    reset();
+    return true;
+}
+
+void Spectrometer::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    queued.notify_all();
+
+    std::lock_guard<std::mutex> lock(planner);
+    for (auto &worker : workers)
+    {
+        if (worker->thread.joinable())
+            worker->thread.join();
+        fftw_destroy_plan(worker->plan);
+        fftw_free(worker->in);
+        fftw_free(worker->out);
+    }
+    workers.clear();
+    jobs.clear();
+    spare.clear();
+    busy = 0;
+}
+
+void Spectrometer::reset()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]()
+    {
+        return jobs.empty() && busy == 0;
+    });
+    for (auto &worker : workers)
+    {
+        std::fill(worker->power.begin(), worker->power.end(), 0);
+        worker->frames = 0;
+    }
+    block.clear();
+    block.reserve(blockSize);
+    decimated      = 0;
+    decimatedCount = 0;
+}
+
+void Spectrometer::process(const float *iq, size_t samples)
+{
+    if (!running)
+        return;
+
+    for (size_t i = 0; i < samples; i++)
+    {
+        decimated += std::complex<double>(iq[2 * i], iq[2 * i + 1]);
+        if (++decimatedCount < decimation)
+            continue;
+
+        block.push_back(decimated / static_cast<double>(decimation));
+        decimated      = 0;
+        decimatedCount = 0;
+        if (block.size() == blockSize)
+            dispatch();
+    }
+}
+
+void Spectrometer::dispatch()
+{
+    Block next;
+    std::unique_lock<std::mutex> lock(mutex);
+    // Bounded queue, the caller sits behind a ring buffer and can afford to wait
+    done.wait(lock, [this]()
+    {
+        return jobs.size() < 2 * workers.size();
+    });
+    if (!spare.empty())
+    {
+        next = std::move(spare.back());
+        spare.pop_back();
+    }
+
+    // Frames overlap by half, the tail of this block starts the next one
+    next.assign(block.end() - (channels - hop), block.end());
+    next.reserve(blockSize);
+    jobs.push_back(std::move(block));
+    block = std::move(next);
+    queued.notify_one();
+}
+
+uint64_t Spectrometer::finish(std::vector<double> &spectrum)
+{
+    spectrum.assign(channels, 0);
+    uint64_t frames = 0;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this]()
+        {
+            return jobs.empty() && busy == 0;
+        });
+        for (auto &worker : workers)
+        {
+            for (int k = 0; k < channels; k++)
+                spectrum[k] += worker->power[k];
+            frames += worker->frames;
+        }
+    }
+
+    // Frames still in the partial block are part of the average too
+    Worker *worker = workers.empty() ? nullptr : workers.front().get();
+    if (worker && block.size() >= static_cast<size_t>(channels))
+    {
+        std::fill(worker->power.begin(), worker->power.end(), 0);
+        worker->frames = 0;
+        transform(worker, block);
+        for (int k = 0; k < channels; k++)
+            spectrum[k] += worker->power[k];
+        frames += worker->frames;
+    }
+
+    // DC to the middle, normalised per frame and by the window power
+    std::vector<double> shifted(channels);
+    for (int k = 0; k < channels; k++)
+        shifted[k] = frames ? spectrum[(k + channels - channels / 2) % channels] / (frames * windowPower) : 0;
+    spectrum.swap(shifted);
+
+    reset();
+    return frames;
+}
+
+void Spectrometer::workerLoop(Worker *worker)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        queued.wait(lock, [this]()
+        {
+            return !running || !jobs.empty();
+        });
+        if (!running)
+            return;
+
+        Block job = std::move(jobs.front());
+        jobs.pop_front();
+        busy++;
+        // Room in the queue
+        done.notify_all();
+        lock.unlock();
+
+        transform(worker, job);
+
+        lock.lock();
+        spare.push_back(std::move(job));
+        busy--;
+        done.notify_all();
+    }
+}
+
+void Spectrometer::transform(Worker *worker, const Block &block)
+{
+    for (size_t offset = 0; offset + channels <= block.size(); offset += hop)
+    {
+        for (int i = 0; i < channels; i++)
+        {
+            worker->in[i][0] = block[offset + i].real() * window[i];
+            worker->in[i][1] = block[offset + i].imag() * window[i];
+        }
+        fftw_execute(worker->plan);
+        for (int k = 0; k < channels; k++)
+            worker->power[k] += worker->out[k][0] * worker->out[k][0] + worker->out[k][1] * worker->out[k][1];
+        worker->frames++;
+    }
+}
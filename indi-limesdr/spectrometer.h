@@ -0,0 +1,115 @@
+/*
+    indi_limesdr_receiver - a software defined radio driver for INDI
+    Copyright (C) 2017  Ilia Platone
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#pragma once
+
+#include <fftw3.h>
+
+#include <complex>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief The Spectrometer class computes a Welch power spectrum of a stream of I/Q samples.
+ *
+ * Input samples are decimated by averaging, cut into Hann windowed frames overlapping by half and
+ * transformed with FFTW. Blocks of consecutive frames are handed to a pool of workers, each with
+ * its own plan and its own power accumulator, so the workers never contend on the results.
+ */
+class Spectrometer
+{
+  public:
+    Spectrometer() = default;
+    ~Spectrometer();
+
+    /**
+     * @brief setup Plan the transforms and start the workers. Does nothing if the configuration
+     * did not change.
+     * @param channels FFT length, number of channels of the spectrum.
+     * @param decimation Number of input samples averaged into each FFT input sample.
+     * @param workers Number of worker threads, 0 for one per spare core.
+     */
+    bool setup(int channels, int decimation, int workers = 0);
+
+    /** @brief reset Drop accumulated spectra and partial frames. */
+    void reset();
+
+    /** @brief process Feed interleaved float I/Q samples, in stream order, from a single thread. */
+    void process(const float *iq, size_t samples);
+
+    /**
+     * @brief finish Wait for the queued frames and return the averaged power spectrum, lowest
+     * frequency first, normalised by the window power. Accumulators are reset.
+     * @return number of frames averaged.
+     */
+    uint64_t finish(std::vector<double> &spectrum);
+
+    int getChannels() const
+    {
+        return channels;
+    }
+    int getWorkers() const
+    {
+        return static_cast<int>(workers.size());
+    }
+
+  private:
+    typedef std::vector<std::complex<double>> Block;
+
+    typedef struct Worker
+    {
+        std::thread thread;
+        fftw_complex *in { nullptr };
+        fftw_complex *out { nullptr };
+        fftw_plan plan { nullptr };
+        std::vector<double> power;
+        uint64_t frames { 0 };
+    } Worker;
+
+    void stop();
+    void workerLoop(Worker *worker);
+    void transform(Worker *worker, const Block &block);
+    void dispatch();
+
+    int channels { 0 };
+    int decimation { 0 };
+    size_t hop { 0 };
+    // Samples in a block: framesPerBlock frames, overlapping the next block by channels - hop
+    size_t blockSize { 0 };
+    std::vector<double> window;
+    double windowPower { 0 };
+
+    // Producer state
+    Block block;
+    std::complex<double> decimated { 0 };
+    int decimatedCount { 0 };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex mutex;
+    std::condition_variable queued, done;
+    std::deque<Block> jobs;
+    std::vector<Block> spare;
+    int busy { 0 };
+    bool running { false };
+};
@@ -26,10 +26,14 @@
 #include "config.h"
 
 #include <math.h>
+#include <algorithm>
+#include <chrono>
 #include <deque>
 #include <memory>
 #include <utility>
 
+#include <sharedblob.h>
+
 #define TEMP_THRESHOLD  0.2  /* Differential temperature threshold (°C) */
 #define TEMP_COOLER_OFF 100  /* High enough temperature for the camera cooler to turn off (°C) */
 #define MAX_DEVICES     4    /* Max device cameraCount */
@@ -141,6 +145,10 @@ MICCD::MICCD(int camId, bool eth) : FilterInterface(this)
 
 MICCD::~MICCD()
 {
+    stopAcquisition();
+    for (uint8_t *buffer : backBuffer)
+        if (buffer != nullptr)
+            IDSharedBlobFree(buffer);
     gxccd_release(cameraHandle);
 }
 
@@ -205,6 +213,14 @@ bool MICCD::initProperties()
     IUFillNumberVector(&PreflashNP, PreflashN, 2, getDeviceName(), "NIR_PRE_FLASH", "NIR Preflash",
                        MAIN_CONTROL_TAB, IP_RW, 60, IPS_IDLE);
 
+    // Acquisition statistics
+    IUFillNumber(&AcqStatsN[ACQ_STATS_READOUT], "READOUT", "Readout (ms)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&AcqStatsN[ACQ_STATS_PACKAGING], "PACKAGING", "Packaging (ms)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&AcqStatsN[ACQ_STATS_CADENCE], "CADENCE", "Frame interval (ms)", "%.1f", 0, 1e9, 0, 0);
+    IUFillNumber(&AcqStatsN[ACQ_STATS_FRAMES], "FRAMES", "Frames", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumberVector(&AcqStatsNP, AcqStatsN, 4, getDeviceName(), "CCD_ACQUISITION_STATS", "Acquisition",
+                       IMAGE_INFO_TAB, IP_RO, 60, IPS_IDLE);
+
     addAuxControls();
 
     setDriverInterface(getDriverInterface() | FILTER_INTERFACE);
@@ -279,6 +295,8 @@ bool MICCD::updateProperties()
             INDI::FilterInterface::updateProperties();
         }
 
+        defineProperty(&AcqStatsNP);
+
         // Let's get parameters now from CCD
         setupParams();
 
@@ -312,6 +330,8 @@ bool MICCD::updateProperties()
         {
             INDI::FilterInterface::updateProperties();
         }
+
+        deleteProperty(AcqStatsNP.name);
         RemoveTimer(timerID);
     }
 
@@ -331,6 +351,7 @@ bool MICCD::Connect()
 
         numFilters = 5;
 
+        startAcquisition();
         return true;
     }
 
@@ -391,11 +412,14 @@ bool MICCD::Connect()
         }
         IDSetSwitch(&ReadModeSP, nullptr);
     }
+
+    startAcquisition();
     return true;
 }
 
 bool MICCD::Disconnect()
 {
+    stopAcquisition();
     LOGF_INFO("Disconnected from %s.", name);
     gxccd_release(cameraHandle);
     cameraHandle = nullptr;
@@ -486,16 +510,18 @@ bool MICCD::StartExposure(float duration)
     imageFrameType = PrimaryCCD.getFrameType();
     useShutter = (imageFrameType == INDI::CCDChip::LIGHT_FRAME || imageFrameType == INDI::CCDChip::FLAT_FRAME);
 
+    // send binned coords
+    int x = PrimaryCCD.getSubX() / PrimaryCCD.getBinX();
+    int y = PrimaryCCD.getSubY() / PrimaryCCD.getBinY();
+    int w = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
+    int d = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+
     if (!isSimulation())
     {
+        std::lock_guard<std::mutex> cameraLock(cameraMutex);
         int mode = IUFindOnSwitchIndex(&ReadModeSP);
         gxccd_set_read_mode(cameraHandle, mode);
 
-        // send binned coords
-        int x = PrimaryCCD.getSubX() / PrimaryCCD.getBinX();
-        int y = PrimaryCCD.getSubY() / PrimaryCCD.getBinY();
-        int w = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
-        int d = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
         // invert frame, libgxccd has 0 on the bottom
         int fd = PrimaryCCD.getYRes() / PrimaryCCD.getBinY();
         int fy = fd - y - d;
@@ -507,7 +533,19 @@ bool MICCD::StartExposure(float duration)
 
     gettimeofday(&ExpStart, nullptr);
     InExposure  = true;
-    downloading = false;
+
+    // Hand the exposure to the readout thread
+    {
+        std::lock_guard<std::mutex> lock(acqMutex);
+        acqGeneration++;
+        acqArmed  = true;
+        acqWidth  = w;
+        acqHeight = d;
+        acqSize   = PrimaryCCD.getFrameBufferSize();
+        acqDuration = duration;
+    }
+    acqCondition.notify_all();
+
     LOGF_DEBUG("Taking a %.3f seconds frame...", ExposureRequest);
     return true;
 }
@@ -516,6 +554,7 @@ bool MICCD::AbortExposure()
 {
     if (InExposure && !isSimulation())
     {
+        std::lock_guard<std::mutex> cameraLock(cameraMutex);
         if (gxccd_abort_exposure(cameraHandle, false) < 0)
         {
             char errorStr[MAX_ERROR_LEN];
@@ -525,8 +564,21 @@ bool MICCD::AbortExposure()
         }
     }
 
+    // Drop the exposure in flight and any frame still waiting to be packaged
+    {
+        std::lock_guard<std::mutex> lock(acqMutex);
+        acqGeneration++;
+        acqAborts++;
+        acqArmed = false;
+        if (pendingBackBuffer >= 0)
+        {
+            backBufferBusy[pendingBackBuffer] = false;
+            pendingBackBuffer = -1;
+        }
+    }
+    acqCondition.notify_all();
+
     InExposure  = false;
-    downloading = false;
     LOG_INFO("Exposure aborted.");
     return true;
 }
@@ -611,80 +663,285 @@ static void mirror_image(void *buf, size_t w, size_t d)
     }
 }
 
-/* Downloads the image from the CCD. */
-int MICCD::grabImage()
+static double monotonicMS()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/* Downloads the image from the CCD into buffer. */
+int MICCD::readImage(uint8_t *buffer, size_t size, int width, int height)
 {
-    std::unique_lock<std::mutex> guard(ccdBufferLock);
-    int ret              = 0;
-    unsigned char *image = (unsigned char *)PrimaryCCD.getFrameBuffer();
-    int width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX();
-    int height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
+    int ret = 0;
 
     if (isSimulation())
     {
-        uint16_t *buffer = (uint16_t *)image;
+        uint16_t *image = (uint16_t *)buffer;
 
         for (int i = 0; i < height; i++)
             for (int j = 0; j < width; j++)
-                buffer[i * width + j] = rand() % UINT16_MAX;
+                image[i * width + j] = rand() % UINT16_MAX;
     }
     else
     {
-        ret = gxccd_read_image(cameraHandle, image, PrimaryCCD.getFrameBufferSize());
+        std::unique_lock<std::mutex> cameraLock(cameraMutex);
+        ret = gxccd_read_image(cameraHandle, buffer, size);
         if (ret < 0)
         {
             char errorStr[MAX_ERROR_LEN];
             gxccd_get_last_error(cameraHandle, errorStr, sizeof(errorStr));
+            cameraLock.unlock();
             LOGF_ERROR("Error getting image: %s.", errorStr);
         }
         else
         {
-            mirror_image(image, width, height);
+            cameraLock.unlock();
+            mirror_image(buffer, width, height);
         }
     }
 
-    guard.unlock();
+    return ret;
+}
 
-    if (ExposureRequest > 5 && !ret)
-        LOG_INFO("Download complete.");
+void MICCD::startAcquisition()
+{
+    if (readoutWorker.joinable())
+        return;
 
-    downloading = false;
-    ExposureComplete(&PrimaryCCD);
+    {
+        std::lock_guard<std::mutex> lock(acqMutex);
+        acqQuit           = false;
+        acqArmed          = false;
+        pendingBackBuffer = -1;
+        backBufferBusy[0] = backBufferBusy[1] = false;
+        lastFrameTime     = 0;
+    }
 
-    return ret;
+    readoutWorker   = std::thread(&MICCD::readoutThread, this);
+    packagingWorker = std::thread(&MICCD::packagingThread, this);
 }
 
-void MICCD::TimerHit()
+void MICCD::stopAcquisition()
 {
-    if (!isConnected())
-        return; // No need to reset timer if we are not connected anymore
+    {
+        std::lock_guard<std::mutex> lock(acqMutex);
+        acqQuit = true;
+    }
+    acqCondition.notify_all();
 
-    if (InExposure)
+    if (readoutWorker.joinable())
+        readoutWorker.join();
+    if (packagingWorker.joinable())
+        packagingWorker.join();
+}
+
+/* Waits for the armed exposure to finish and reads it out into a free back buffer. */
+void MICCD::readoutThread()
+{
+    std::unique_lock<std::mutex> lock(acqMutex);
+
+    while (true)
     {
-        float timeleft = calcTimeLeft();
-        bool ready     = false;
+        acqCondition.wait(lock, [this] { return acqQuit || acqArmed; });
+        if (acqQuit)
+            break;
+
+        uint32_t generation = acqGeneration;
+        uint32_t aborts     = acqAborts;
+        int width   = acqWidth;
+        int height  = acqHeight;
+        size_t size = acqSize;
+        float duration = acqDuration;
+
+        // Sleep through most of the exposure, then poll the camera
+        bool ready  = false;
+        bool failed = false;
+        while (!ready && !failed)
+        {
+            float timeleft = calcTimeLeft();
+            int delayMS    = timeleft > 0.1 ? std::min(static_cast<int>(timeleft * 1000) - 50, 250) : 10;
+            acqCondition.wait_for(lock, std::chrono::milliseconds(delayMS));
+            if (acqQuit || acqGeneration != generation)
+                break;
+            if (calcTimeLeft() > 0.1)
+                continue;
+
+            lock.unlock();
+            if (isSimulation())
+                ready = calcTimeLeft() <= 0;
+            else
+            {
+                std::unique_lock<std::mutex> cameraLock(cameraMutex);
+                if (gxccd_image_ready(cameraHandle, &ready) < 0)
+                {
+                    char errorStr[MAX_ERROR_LEN];
+                    gxccd_get_last_error(cameraHandle, errorStr, sizeof(errorStr));
+                    cameraLock.unlock();
+                    LOGF_ERROR("Getting image ready failed: %s.", errorStr);
+                    failed = true;
+                }
+            }
+            lock.lock();
+        }
 
-        if (!downloading && (gxccd_image_ready(cameraHandle, &ready) < 0))
+        if (acqQuit)
+            break;
+        // aborted, or restarted with a new exposure
+        if (acqGeneration != generation)
+            continue;
+
+        acqArmed = false;
+        if (failed)
         {
-            char errorStr[MAX_ERROR_LEN];
-            gxccd_get_last_error(cameraHandle, errorStr, sizeof(errorStr));
-            LOGF_ERROR("Getting image ready failed: %s.", errorStr);
+            InExposure = false;
+            lock.unlock();
+            PrimaryCCD.setExposureFailed();
+            lock.lock();
+            continue;
+        }
+
+        // Wait until the packaging thread is done with the buffer we are about to fill
+        int index = nextBackBuffer;
+        acqCondition.wait(lock, [&] { return acqQuit || !backBufferBusy[index]; });
+        if (acqQuit)
+            break;
+        backBufferBusy[index] = true;
+        nextBackBuffer ^= 1;
+        InExposure = false;
+        lock.unlock();
+
+        PrimaryCCD.setExposureLeft(0);
+        // Don't spam the session log unless it is a long exposure > 5 seconds
+        if (duration > 5)
+            LOG_INFO("Exposure done, downloading image...");
+
+        double readoutStart = monotonicMS();
+        if (backBufferSize[index] < size)
+        {
+            void *buffer = backBuffer[index] == nullptr ? IDSharedBlobAlloc(size) : IDSharedBlobRealloc(backBuffer[index], size);
+            if (buffer == nullptr)
+            {
+                LOGF_ERROR("Failed to allocate %zu bytes for the frame.", size);
+                lock.lock();
+                backBufferBusy[index] = false;
+                lock.unlock();
+                PrimaryCCD.setExposureFailed();
+                lock.lock();
+                continue;
+            }
+            backBuffer[index]     = static_cast<uint8_t *>(buffer);
+            backBufferSize[index] = size;
+        }
+        int ret = readImage(backBuffer[index], size, width, height);
+        double readoutMS = monotonicMS() - readoutStart;
+
+        lock.lock();
+        // StartExposure may already have armed the next exposure, only an abort drops the frame
+        if (ret < 0 || acqAborts != aborts)
+        {
+            backBufferBusy[index] = false;
+            if (ret < 0)
+            {
+                lock.unlock();
+                PrimaryCCD.setExposureFailed();
+                lock.lock();
+            }
+            continue;
         }
-        if (ready)
+
+        backBufferReadoutMS[index] = readoutMS;
+        backBufferDuration[index]  = duration;
+        pendingBackBuffer = index;
+        acqCondition.notify_all();
+    }
+}
+
+/* Swaps read out frames in as the CCD frame buffer and sends them to the client. */
+void MICCD::packagingThread()
+{
+    std::unique_lock<std::mutex> lock(acqMutex);
+
+    while (true)
+    {
+        acqCondition.wait(lock, [this] { return acqQuit || pendingBackBuffer >= 0; });
+        if (acqQuit)
+            break;
+
+        int index = pendingBackBuffer;
+        pendingBackBuffer = -1;
+        double readoutMS = backBufferReadoutMS[index];
+        float duration   = backBufferDuration[index];
+        lock.unlock();
+
+        double packagingStart = monotonicMS();
+        bool swapped = false;
         {
-            PrimaryCCD.setExposureLeft(0);
-            InExposure  = false;
-            downloading = true;
+            // The CCD buffer goes back to the readout thread in place of the frame. Only this
+            // thread swaps, so the frame stays put until ExposureComplete below has sent it.
+            std::unique_lock<std::mutex> guard(ccdBufferLock);
+            size_t size = PrimaryCCD.getFrameBufferSize();
+            // The subframe grew while the frame was read out, keep the buffer as large as the CCD expects
+            if (backBufferSize[index] < size)
+            {
+                void *buffer = IDSharedBlobRealloc(backBuffer[index], size);
+                if (buffer != nullptr)
+                {
+                    backBuffer[index]     = static_cast<uint8_t *>(buffer);
+                    backBufferSize[index] = size;
+                }
+            }
+            if (backBufferSize[index] >= size)
+            {
+                uint8_t *frame = backBuffer[index];
+                backBuffer[index]     = PrimaryCCD.getFrameBuffer();
+                backBufferSize[index] = size;
+                PrimaryCCD.setFrameBuffer(frame);
+                swapped = true;
+            }
+        }
 
-            // Don't spam the session log unless it is a long exposure > 5 seconds
-            if (ExposureRequest > 5)
-                LOG_INFO("Exposure done, downloading image...");
+        lock.lock();
+        backBufferBusy[index] = false;
+        acqCondition.notify_all();
+        lock.unlock();
 
-            // grab and save image
-            grabImage();
+        if (!swapped)
+        {
+            LOG_ERROR("Failed to allocate the frame buffer.");
+            PrimaryCCD.setExposureFailed();
+            lock.lock();
+            continue;
         }
+
+        if (duration > 5)
+            LOG_INFO("Download complete.");
+
+        ExposureComplete(&PrimaryCCD);
+
+        double now = monotonicMS();
+        AcqStatsN[ACQ_STATS_READOUT].value   = readoutMS;
+        AcqStatsN[ACQ_STATS_PACKAGING].value = now - packagingStart;
+        AcqStatsN[ACQ_STATS_CADENCE].value   = lastFrameTime > 0 ? now - lastFrameTime : 0;
+        AcqStatsN[ACQ_STATS_FRAMES].value++;
+        AcqStatsNP.s  = IPS_OK;
+        lastFrameTime = now;
+        IDSetNumber(&AcqStatsNP, nullptr);
+
+        lock.lock();
+    }
+}
+
+void MICCD::TimerHit()
+{
+    if (!isConnected())
+        return; // No need to reset timer if we are not connected anymore
+
+    // The readout thread watches the camera, we only keep the client informed.
+    if (InExposure)
+    {
+        float timeleft = calcTimeLeft();
+
         // camera may need some time for image download -> update client only for positive values
-        else if (timeleft >= 0)
+        if (timeleft >= 0)
         {
             LOGF_DEBUG("Exposure in progress: Time left %.2fs", timeleft);
             PrimaryCCD.setExposureLeft(timeleft);
@@ -701,6 +958,7 @@ int MICCD::QueryFilter()
 
 bool MICCD::SelectFilter(int position)
 {
+    std::unique_lock<std::mutex> cameraLock(cameraMutex);
     if (!isSimulation() && gxccd_set_filter(cameraHandle, position - 1) < 0)
     {
         char errorStr[MAX_ERROR_LEN];
@@ -708,6 +966,7 @@ bool MICCD::SelectFilter(int position)
         LOGF_ERROR("Setting filter failed: %s.", errorStr);
         return false;
     }
+    cameraLock.unlock();
 
     CurrentFilter = position;
     SelectFilterDone(position);
@@ -717,6 +976,7 @@ bool MICCD::SelectFilter(int position)
 
 IPState MICCD::GuideNorth(uint32_t ms)
 {
+    std::lock_guard<std::mutex> cameraLock(cameraMutex);
     if (gxccd_move_telescope(cameraHandle, 0, static_cast<int16_t>(ms)) < 0)
     {
         char errorStr[MAX_ERROR_LEN];
@@ -729,6 +989,7 @@ IPState MICCD::GuideNorth(uint32_t ms)
 
 IPState MICCD::GuideSouth(uint32_t ms)
 {
+    std::lock_guard<std::mutex> cameraLock(cameraMutex);
     if (gxccd_move_telescope(cameraHandle, 0, (-1 * static_cast<int16_t>(ms))) < 0)
     {
         char errorStr[MAX_ERROR_LEN];
@@ -741,6 +1002,7 @@ IPState MICCD::GuideSouth(uint32_t ms)
 
 IPState MICCD::GuideEast(uint32_t ms)
 {
+    std::lock_guard<std::mutex> cameraLock(cameraMutex);
     if (gxccd_move_telescope(cameraHandle, (-1 * static_cast<int16_t>(ms)), 0) < 0)
     {
         char errorStr[MAX_ERROR_LEN];
@@ -753,6 +1015,7 @@ IPState MICCD::GuideEast(uint32_t ms)
 
 IPState MICCD::GuideWest(uint32_t ms)
 {
+    std::lock_guard<std::mutex> cameraLock(cameraMutex);
     if (gxccd_move_telescope(cameraHandle, static_cast<int16_t>(ms), 0) < 0)
     {
         char errorStr[MAX_ERROR_LEN];
@@ -938,6 +1201,7 @@ void MICCD::updateTemperature()
     }
     else
     {
+        std::lock_guard<std::mutex> cameraLock(cameraMutex);
         if (gxccd_get_value(cameraHandle, GV_CHIP_TEMPERATURE, &ccdtemp) < 0)
         {
             char errorStr[MAX_ERROR_LEN];
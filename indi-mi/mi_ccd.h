@@ -26,6 +26,11 @@
 #include <indiccd.h>
 #include <indifilterinterface.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 class MICCD : public INDI::CCD, public INDI::FilterInterface
 {
     public:
@@ -89,6 +94,17 @@ class MICCD : public INDI::CCD, public INDI::FilterInterface
         INumber PreflashN[2];
         INumberVectorProperty PreflashNP;
 
+        // Acquisition timing, all in milliseconds except the frame counter
+        INumber AcqStatsN[4];
+        INumberVectorProperty AcqStatsNP;
+        enum
+        {
+            ACQ_STATS_READOUT,
+            ACQ_STATS_PACKAGING,
+            ACQ_STATS_CADENCE,
+            ACQ_STATS_FRAMES
+        };
+
     private:
         char name[MAXINDIDEVICE];
 
@@ -111,8 +127,6 @@ class MICCD : public INDI::CCD, public INDI::FilterInterface
         int temperatureID;
         int timerID;
 
-        bool downloading;
-
         bool canDoPreflash;
 
         INDI::CCDChip::CCD_FRAME imageFrameType;
@@ -124,7 +138,38 @@ class MICCD : public INDI::CCD, public INDI::FilterInterface
         bool setupParams();
 
         float calcTimeLeft();
-        int grabImage();
+
+        // Acquisition pipeline. The readout thread waits for the camera and reads each frame
+        // into one of two back buffers, the packaging thread swaps it in as the CCD frame buffer
+        // and calls ExposureComplete. The next exposure can be armed as soon as readout ends.
+        void startAcquisition();
+        void stopAcquisition();
+        void readoutThread();
+        void packagingThread();
+        int readImage(uint8_t *buffer, size_t size, int width, int height);
+
+        std::thread readoutWorker;
+        std::thread packagingWorker;
+        std::mutex acqMutex;                // guards the acquisition state below
+        std::condition_variable acqCondition;
+        std::mutex cameraMutex;             // serializes libgxccd calls made from different threads
+        bool acqQuit { false };
+        bool acqArmed { false };
+        uint32_t acqGeneration { 0 };       // bumped on every start/abort, stale exposures are dropped
+        uint32_t acqAborts { 0 };           // bumped on abort only, a frame read out before the next start is kept
+        int acqWidth { 0 };
+        int acqHeight { 0 };
+        size_t acqSize { 0 };
+        float acqDuration { 0 };            // ExposureRequest of the armed exposure
+        // Allocated with IDSharedBlobAlloc, as they trade places with the CCD frame buffer
+        uint8_t *backBuffer[2] { nullptr, nullptr };
+        size_t backBufferSize[2] { 0, 0 };
+        bool backBufferBusy[2] { false, false };
+        double backBufferReadoutMS[2] { 0, 0 };
+        float backBufferDuration[2] { 0, 0 };
+        int nextBackBuffer { 0 };
+        int pendingBackBuffer { -1 };
+        double lastFrameTime { 0 };
 
         void updateTemperature();
         static void updateTemperatureHelper(void *);
@@ -375,6 +375,10 @@ bool NightscapeCCD::StartExposure(float duration)
     dn->setImgSize(m->getRawImgSize(zonestart, zonelen, framediv));
     dn->setFrameYBinning(framediv);
     dn->setFrameXBinning(PrimaryCCD.getBinX());
+    // Have the download thread cook lines straight into the frame buffer as they arrive
+    memset(PrimaryCCD.getFrameBuffer(), 0, PrimaryCCD.getFrameBufferSize());
+    dn->setFrameBuffer(PrimaryCCD.getFrameBuffer(), PrimaryCCD.getFrameBufferSize(),
+                       PrimaryCCD.getSubX(), PrimaryCCD.getSubW(), PrimaryCCD.getBinX());
     m->sendzone(zonestart, zonelen, framediv);
     INDI::CCDChip::CCD_FRAME ft = PrimaryCCD.getFrameType();
     if (ft == INDI::CCDChip::DARK_FRAME || ft == INDI::CCDChip::BIAS_FRAME) dark = true;
@@ -574,8 +578,12 @@ void NightscapeCCD::grabImage()
     // Get width and height
     //int width  = PrimaryCCD.getSubW() / PrimaryCCD.getBinX() * PrimaryCCD.getBPP() / 8;
     //int height = PrimaryCCD.getSubH() / PrimaryCCD.getBinY();
-    memset(image, 0, PrimaryCCD.getFrameBufferSize());
-    dn->copydownload(image, PrimaryCCD.getSubX(), PrimaryCCD.getSubW(), PrimaryCCD.getBinX(), 1, 1);
+    // Lines are normally already in the frame buffer, cooked by the download thread.
+    if (dn->getCookedLines() == 0)
+    {
+        memset(image, 0, PrimaryCCD.getFrameBufferSize());
+        dn->copydownload(image, PrimaryCCD.getSubX(), PrimaryCCD.getSubW(), PrimaryCCD.getBinX(), 1, 1);
+    }
     guard.unlock();
     //IDLog("copied..\n");
 
@@ -106,6 +106,20 @@ void NsDownload::setInterrupted(){
 void NsDownload::setZeroReads(int zeroes){
 	zero_reads = zeroes;
 }
+
+void NsDownload::setFrameBuffer(unsigned char *buf, size_t bufsiz, int xstart, int xlen, int xbin) {
+	std::unique_lock<std::mutex> ulock(mutx);
+	framebuf = buf;
+	framebufsiz = bufsiz;
+	framexstart = xstart;
+	framexlen = xlen;
+	framexbin = xbin > 0 ? xbin : 1;
+	cookedlines = 0;
+}
+
+int NsDownload::getCookedLines() {
+	return cookedlines;
+}
  int NsDownload::getActWriteLines(){
 		 return writelines;	
 }
@@ -154,6 +168,7 @@ int NsDownload::downloader()
 			if (rd->nread >= rd->imgsz) {
 				readdone = 1;	
 			}
+			cookdownload();
 			if (readdone) {
 			  download=0;
 				lastread = rc2;
@@ -302,12 +317,61 @@ void NsDownload::writedownload(int pad, int cooked)
 
 
 
-void NsDownload::copydownload(unsigned char *buf, int xstart, int xlen, int xbin, int pad, int cooked)
+/* Crop and bin one raw sensor line into dbufp. */
+void NsDownload::cookline(unsigned char *dbufp, const unsigned char *bufp, int xstart, int xlen, int xbin)
 {
-	unsigned char linebuf[KAF8300_MAX_X*2];
-	bool forwards = true;
 	bool rms = false;
 	int binning = xbin;
+
+	if (binning > 1) {
+		const uint8_t * lbufp = bufp + (KAF8300_POSTAMBLE*2) + xstart*2;
+		int len = xlen * 2;
+		uint8_t * lout = dbufp;
+		while (len > 0) {
+			short px[4];
+			long long pxsq =0;
+			long pxav =0;
+			short pxa;
+			memcpy(px, lbufp,binning * 2);
+			for (int a = 0; a < binning; a++) {
+				pxav += px[a];
+				pxsq	+= px[a]*px[a];
+			}
+			pxav /= binning;
+			pxsq /= binning;
+			if(rms) {
+				pxa = round(sqrt((double)	pxsq));
+			} else {
+				pxa = pxav;	
+			}
+			memcpy (lout, &pxa, 2);
+			lout += 2;
+			lbufp += 2*binning;
+			len -= 2* binning;
+		}
+	} else {
+		memcpy (dbufp, bufp + (KAF8300_POSTAMBLE*2) + xstart*2, xlen * 2 ); //KAF8300_ACTIVE_X*2 );
+	}
+}
+
+/* Cook every complete raw line that arrived since the last call straight into the
+ * caller supplied frame buffer, so the image is ready as soon as the read finishes. */
+void NsDownload::cookdownload()
+{
+	if (framebuf == NULL || rd->buffer == NULL) return;
+
+	size_t linelen = (framexlen*2)/framexbin;
+	int rawlines = rd->nread / (KAF8300_MAX_X*2);
+
+	while (cookedlines < rawlines && (cookedlines + 1) * linelen <= framebufsiz) {
+		cookline(framebuf + cookedlines * linelen, rd->buffer + cookedlines * (KAF8300_MAX_X*2),
+			framexstart, framexlen, framexbin);
+		cookedlines++;
+	}
+}
+
+void NsDownload::copydownload(unsigned char *buf, int xstart, int xlen, int xbin, int pad, int cooked)
+{
 	uint8_t * dbufp = buf;
 	uint8_t * bufp;
 	int nwrite = 0;
@@ -326,60 +390,14 @@ void NsDownload::copydownload(unsigned char *buf, int xstart, int xlen, int xbin
 		}
 		memcpy (dbufp, retrBuf->buffer, nwrite);
 	} else {
-		//int actlines = nwrite / (KAF8300_MAX_X*2);
-	  //int rem = nwrite % (KAF8300_MAX_X*2);
 	  nwrite = retrBuf->nread;
 		int nwriteleft = nwrite;
-		if (forwards) {
-			bufp = retrBuf->buffer;
-			//dbufp =  (dbufp +(KAF8300_ACTIVE_X*2*IMG_Y)) - (KAF8300_ACTIVE_X*2);
-		} else {
-			bufp = (retrBuf->buffer + nwrite) - (KAF8300_MAX_X*2);
-			dbufp =  (dbufp +(KAF8300_ACTIVE_X*2*IMG_MAX_Y)) - (KAF8300_ACTIVE_X*2);
-		}
+		bufp = retrBuf->buffer;
 		writelines = 0;
 	  while (nwriteleft >= (KAF8300_MAX_X*2)) {
-	  //swab (bufp + (KAF8300_POSTAMBLE*2),  linebuf, KAF8300_ACTIVE_X*2 );
-	   //memcpy (dbufp, linebuf, KAF8300_ACTIVE_X*2);
-	    if (binning > 1) {
-	    	uint8_t * lbufp = bufp + (KAF8300_POSTAMBLE*2) + xstart*2;
-	    	int len = xlen * 2;
-	    	int linelen = 0;
-	    	while (len > 0) {
-	    		short px[4];
-	    		long long pxsq =0;
-	    		long pxav =0;
-	    		short pxa;
-	    		memcpy(px, lbufp,binning * 2);
-	    		for (int a = 0; a < binning; a++) {
-	    			pxav += px[a];
-	    			pxsq	+= px[a]*px[a];
-	    		}
-	    		pxav /= binning;
-	    		pxsq /= binning;
-	    		if(rms) {
-	    			pxa = round(sqrt((double)	pxsq));
-	    			
-	    		} else {
-	    			pxa = pxav;	
-	    		}
-	    		memcpy (linebuf + linelen, &pxa, 2);
-	    		linelen += 2;
-	    		lbufp += 2*binning;
-	    		len -= 2* binning;
-				}
-				memcpy (dbufp, linebuf, (xlen*2)/binning);
-
-	    } else {
-	  		memcpy (dbufp, bufp + (KAF8300_POSTAMBLE*2) + xstart*2, xlen * 2 ); //KAF8300_ACTIVE_X*2 );
-	  	}
-			if (forwards) { 
-				bufp +=  KAF8300_MAX_X*2;
-				dbufp +=(xlen*2)/binning;
-			} else {
-				bufp -=  KAF8300_MAX_X*2;
-				dbufp-=(xlen*2)/binning;
-			}
+			cookline(dbufp, bufp, xstart, xlen, xbin);
+			bufp +=  KAF8300_MAX_X*2;
+			dbufp +=(xlen*2)/xbin;
 			nwriteleft -= KAF8300_MAX_X*2;
 			writelines++;
 	  }
@@ -421,7 +439,7 @@ int NsDownload::fulldownload()
 		  rd->nread += rc2;
 		  rd->nblks += rc2/65536;
 		  DO_INFO("read %d tot %d\n", rc2, rd->nread);
-
+		  cookdownload();
 		}	
 		return rc2;
 }
@@ -470,6 +488,7 @@ void NsDownload::trun()
 			in_download = 1;
 			ctx->imgseq++;
 			zeroes = 0;
+			cookedlines = 0;
 		}
 	  while (in_download && !interrupted) {
 	  	//int rc2= cn->setDataRts();;
@@ -503,6 +522,7 @@ void NsDownload::trun()
 	  		}
 	    }	
 	    lastread = down;
+	    if (framebuf) writelines = cookedlines;
 	    	   // IDLog("foop\n");
 
 	    if (zero_reads > 1) {
@@ -106,8 +106,13 @@ class NsDownload {
 		void copydownload(unsigned char *buf, int xstart, int xlen, int xbin, int pad, int cooked);
 		void writedownload(int pad, int cooked);
 		void setZeroReads(int zeroes);
+		void setFrameBuffer(unsigned char *buf, size_t bufsiz, int xstart, int xlen, int xbin);
+		int getCookedLines();
 	private:
 
+		static void cookline(unsigned char *dbufp, const unsigned char *bufp, int xstart, int xlen, int xbin);
+		void cookdownload();
+
 	  void fitsheader(int x, int y, char * fbase, struct img_params * ip);
 		int fulldownload(); 
 		bool getDoDownload();
@@ -136,5 +141,13 @@ class NsDownload {
 		ns_readdata_t * retrBuf;
 		int zero_reads { 1 };
 		int writelines{0};
+
+		// caller supplied destination for cooked lines, filled while the download streams in
+		unsigned char * framebuf { NULL };
+		size_t framebufsiz { 0 };
+		int framexstart { 0 };
+		int framexlen { 0 };
+		int framexbin { 1 };
+		volatile int cookedlines { 0 };
 };
 #endif
\ No newline at end of file
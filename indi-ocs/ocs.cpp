@@ -31,10 +31,12 @@ USB and network connections supported.
 #include "ocs.h"
 #include "termios.h"
 
+#include <algorithm>
 #include <cstring>
 #include <ctime>
 #include <memory>
 #include <mutex>
+#include <sys/ioctl.h>
 
 // Custom tabs
 #define STATUS_TAB "Status"
@@ -54,7 +56,6 @@ OCS::OCS() : INDI::Dome(), WI(this)
 {
     setVersion(1, 0);
     SetDomeCapability(DOME_CAN_ABORT | DOME_HAS_SHUTTER);
-    SlowTimer.callOnTimeout(std::bind(&OCS::SlowTimerHit, this));
 }
 
 /*******************************************************
@@ -94,7 +95,6 @@ bool OCS::Handshake()
             LOG_DEBUG("OCS handshake established");
             handshake_status = true;
             GetCapabilites();
-            SlowTimer.start(60000);
         }
         else {
             LOGF_DEBUG("OCS handshake error, reponse was: %s", handshake_response);
@@ -378,8 +378,9 @@ void OCS::GetCapabilites()
         LOG_INFO("OCS does not have weather sensor(s), disabling tab");
     }
 
-    // Call the slow property update once as this is startup and we want to populate now
-    SlowTimerHit();
+    // Read every status item once as this is startup and we want to populate now
+    buildStatusQueries();
+    pollStatusQueries(true);
 }
 
 /**********************************************************************
@@ -721,8 +722,8 @@ bool OCS::updateProperties()
         // Debug only
         // deleteProperty(Arbitary_CommandTP.name);
 
-        // As we're disconnected, stop calling one minute updates
-        SlowTimer.stop();
+        // As we're disconnected, drop the status queries, they are rebuilt on the next handshake
+        status_queries.clear();
     }
 
     return true;
@@ -733,622 +734,631 @@ bool OCS::updateProperties()
 *************************************************************/
 void OCS::TimerHit()
 {
-    // Get the roof/shutter status
-    char roof_status_response[RB_MAX_LEN] = {0};
-    int roof_status_error_or_fail  = getCommandSingleCharErrorOrLongResponse(PortFD, roof_status_response,
-                                                                             OCS_get_roof_status);
-    if (roof_status_error_or_fail > 1) {
-        bool roof_was_in_error = (getShutterState() == SHUTTER_ERROR);
+    pollStatusQueries(false);
 
-        LOGF_DEBUG("roof_was_in_error, %d", roof_was_in_error);
+    // Timer loop control
+    if (!isConnected())
+        return; //  No need to reset timer if we are not connected anymore
 
-        char *split;
-        char roof_message[30];
-        split = strtok(roof_status_response, ",");
-        if (strcmp(split, "o") == 0) {
-            if (getShutterState() != SHUTTER_MOVING) {
-                setShutterState(SHUTTER_MOVING);
-            }
-            split = strtok(NULL, ",");
-            sprintf(roof_message, "Opening, travel %s", split);
-        } else if (strcmp(split, "c") == 0) {
-            if (getShutterState() != SHUTTER_MOVING) {
-                setShutterState(SHUTTER_MOVING);
+    SetTimer(getCurrentPollingPeriod());
+}
+
+/**************************************************************
+* Status query scheduler. Each item has its own refresh period,
+* due items are sent most urgent first, OCS_BATCH_MAX commands
+* per round trip, and at most OCS_QUERIES_PER_POLL per poll so
+* a long backlog can't delay the next roof status read.
+***************************************************************/
+void OCS::addStatusQuery(int item, int index, int priority, int period_ms, const char *command)
+{
+    OCSQuery query {};
+    query.item = item;
+    query.index = index;
+    query.priority = priority;
+    query.period_ms = period_ms;
+    indi_strlcpy(query.command, command, sizeof(query.command));
+    query.has_response = false;
+    query.next_due = std::chrono::steady_clock::now();
+    status_queries.push_back(query);
+}
+
+/*************************************************************
+* Build the query table - called once the capabilities are known
+**************************************************************/
+void OCS::buildStatusQueries()
+{
+    status_queries.clear();
+    last_shutter_status[0] = '\0';
+
+    addStatusQuery(OCS_QUERY_ROOF_STATUS, 0, OCS_PRIORITY_SAFETY, 0, OCS_get_roof_status);
+    // The polled roof status returns any error flagged at the time but could miss a transient condition
+    // cleared in-between polls. Last roof error holds the condition until cleared by a roof/shutter action.
+    addStatusQuery(OCS_QUERY_ROOF_LAST_ERROR, 0, OCS_PRIORITY_SAFETY, 10000, OCS_get_roof_last_error);
+    addStatusQuery(OCS_QUERY_SAFETY_STATUS, 0, OCS_PRIORITY_SAFETY, 10000, OCS_get_safety_status);
+    if (hasDome) {
+        addStatusQuery(OCS_QUERY_DOME_STATUS, 0, OCS_PRIORITY_SAFETY, 0, OCS_get_dome_status);
+        addStatusQuery(OCS_QUERY_DOME_AZIMUTH, 0, OCS_PRIORITY_SAFETY, 0, OCS_get_dome_azimuth);
+    }
+    addStatusQuery(OCS_QUERY_POWER_STATUS, 0, OCS_PRIORITY_STATUS, 60000, OCS_get_power_status);
+    addStatusQuery(OCS_QUERY_MCU_TEMPERATURE, 0, OCS_PRIORITY_COSMETIC, 60000, OCS_get_MCU_temperature);
+
+    char relay_command[CMD_MAX_LEN] = {0};
+    if (thermostat_controls_enabled) {
+        addStatusQuery(OCS_QUERY_THERMOSTAT_STATUS, 0, OCS_PRIORITY_COSMETIC, 60000, OCS_get_thermostat_status);
+        addStatusQuery(OCS_QUERY_THERMOSTAT_SETPOINT, THERMOSTAT_HEAT_SETPOINT, OCS_PRIORITY_STATUS, 60000,
+                       OCS_get_thermostat_heat_setpoint);
+        addStatusQuery(OCS_QUERY_THERMOSTAT_SETPOINT, THERMOSTAT_COOL_SETPOINT, OCS_PRIORITY_STATUS, 60000,
+                       OCS_get_thermostat_cool_setpoint);
+        addStatusQuery(OCS_QUERY_THERMOSTAT_SETPOINT, THERMOSTAT_HUMIDITY_SETPOINT, OCS_PRIORITY_STATUS, 60000,
+                       OCS_get_thermostat_humidity_setpoint);
+        for (int relay = 0; relay < THERMOSTAT_RELAY_COUNT; relay++) {
+            if (thermostat_relays[relay] > 0) {
+                snprintf(relay_command, sizeof(relay_command), "%s%d%s", OCS_get_relay_part, thermostat_relays[relay], OCS_command_terminator);
+                addStatusQuery(OCS_QUERY_THERMOSTAT_RELAY, relay, OCS_PRIORITY_STATUS, 60000, relay_command);
             }
-            split = strtok(NULL, ",");
-            sprintf(roof_message, "Closing, travel %s", split);
-        } else if (strcmp(split, "i") == 0) {
-            split = strtok(NULL, ",");
-            if (strcmp(split, "OPEN") == 0) {
-                if (getShutterState() != SHUTTER_OPENED) {
-                    setShutterState(SHUTTER_OPENED);
-                }
-                sprintf(roof_message, "Idle - Open");
-            } else if (strcmp(split, "CLOSED") == 0) {
-                if (getShutterState() != SHUTTER_CLOSED) {
-                    setShutterState(SHUTTER_CLOSED);
-                }
-                sprintf(roof_message, "Idle - Closed");
-            } else if (strcmp(split, "No Error") == 0) {
-                sprintf(roof_message, "Idle - No Error");
-            } else if (strcmp(split, "Waiting for mount to park") == 0) {
-                sprintf(roof_message, "Waiting for mount to park");
-            } else {
-                // Must be an error message
-                sprintf(roof_message, "Roof/shutter: %s", split);
-                if (getShutterState() != SHUTTER_ERROR) {
-                    setShutterState(SHUTTER_ERROR);
-                }
+        }
+    }
+    if (power_tab_enabled) {
+        for (int relay = 0; relay < POWER_DEVICE_COUNT; relay++) {
+            if (power_device_relays[relay] > 0) {
+                snprintf(relay_command, sizeof(relay_command), "%s%d%s", OCS_get_relay_part, power_device_relays[relay], OCS_command_terminator);
+                addStatusQuery(OCS_QUERY_POWER_RELAY, relay, OCS_PRIORITY_STATUS, 60000, relay_command);
             }
         }
-
-        if (strcmp(last_shutter_status, roof_message) != 0) {
-            if (getShutterState() == SHUTTER_ERROR) {
-                LOGF_ERROR("Roof/shutter error - %s", roof_message);
-            } else {
-                LOGF_DEBUG("Roof/shutter is %s", roof_message);
-                if (roof_was_in_error) {
-                    LOG_INFO("Roof/shutter error cleared");
-                }
+    }
+    if (lights_tab_enabled) {
+        for (int relay = 0; relay < LIGHT_COUNT; relay++) {
+            if (light_relays[relay] > 0) {
+                snprintf(relay_command, sizeof(relay_command), "%s%d%s", OCS_get_relay_part, light_relays[relay], OCS_command_terminator);
+                addStatusQuery(OCS_QUERY_LIGHT_RELAY, relay, OCS_PRIORITY_STATUS, 60000, relay_command);
             }
-            sprintf(last_shutter_status, "%s", roof_message);
         }
-
-        IUSaveText(&ShutterStatusT[0], roof_message);
-        IDSetText(&ShutterStatusTP, nullptr);
     }
+}
 
-    // Dome updates
-    if (hasDome) {
-        // Get the dome status
-        char dome_message[10];
-        char dome_status_response[RB_MAX_LEN] = {0};
-        int dome_status_error_or_fail  = getCommandSingleCharErrorOrLongResponse(PortFD, dome_status_response,
-                                                                                 OCS_get_dome_status);
-        if (dome_status_error_or_fail > 1) { //> 1 as an OCS error would be 1 char in response
-            if (strcmp(dome_status_response, "H") == 0) {
-                if (getDomeState() != DOME_IDLE) {
-                    setDomeState(DOME_IDLE);
-                    ParkSP[0].setState(ISS_OFF);
-                    ParkSP[1].setState(ISS_ON);
-                    ParkSP.setState(IPS_OK);
-                    ParkSP.apply();
-                }
-                sprintf(dome_message, "Home");
-            } else if (strcmp(dome_status_response, "P") == 0) {
-                if (getDomeState() != DOME_PARKED) {
-                    setDomeState(DOME_PARKED);
-                    ParkSP[0].setState(ISS_ON);
-                    ParkSP[1].setState(ISS_OFF);
-                    ParkSP.setState(IPS_OK);
-                    ParkSP.apply();
-                }
-                sprintf(dome_message, "Parked");
-            } else if (strcmp(dome_status_response, "K") == 0) {
-                if (getDomeState() != DOME_PARKING) {
-                    setDomeState(DOME_PARKING);
-                    ParkSP[0].setState(ISS_OFF);
-                    ParkSP[1].setState(ISS_OFF);
-                    ParkSP.setState(IPS_BUSY);
-                    ParkSP.apply();
-                }
-                sprintf(dome_message, "Parking");
-            } else if (strcmp(dome_status_response, "S") == 0) {
-                if (getDomeState() != DOME_MOVING) {
-                    setDomeState(DOME_MOVING);
-                    ParkSP[0].setState(ISS_OFF);
-                    ParkSP[1].setState(ISS_ON);
-                    ParkSP.setState(IPS_OK);
-                    ParkSP.apply();
-                }
-                sprintf(dome_message, "Slewing");
-            } else if (strcmp(dome_status_response, "I") == 0) {
-                if (getDomeState() != DOME_IDLE) {
-                    setDomeState(DOME_IDLE);
-                    ParkSP[0].setState(ISS_OFF);
-                    ParkSP[1].setState(ISS_ON);
-                    ParkSP.setState(IPS_OK);
-                    ParkSP.apply();
-                }
-                sprintf(dome_message, "Idle");
-            }
-            IUSaveText(&DomeStatusT[0], dome_message);
-            IDSetText(&DomeStatusTP, nullptr);
-        } else {
-            LOGF_WARN("Communication error on get Dome status %s, this update aborted, will try again...", OCS_get_dome_status);
-        }
-
-        // Get the dome position
-        char dome_position_response[RB_MAX_LEN] = {0};
-        double position = conversion_error ;
-        int dome_position_error_or_fail = getCommandDoubleResponse(PortFD, &position, dome_position_response,
-                                                                   OCS_get_dome_azimuth);
-        if (dome_position_error_or_fail > 1 && position != conversion_error) {
-            // DomeAbsPosN->value = position;
-            DomeAbsPosNP[0].setValue(position);
-            DomeAbsPosNP.apply();
-        } else {
-            LOGF_WARN("Communication error on get Dome position %s, this update aborted, will try again...", OCS_get_dome_azimuth);
+/*******************************************************************
+* A client changed something: re-publish every item on its next read
+* even if the OCS reply is unchanged, and re-read the controls now
+********************************************************************/
+void OCS::invalidateStatusQueries()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (auto &query : status_queries) {
+        query.has_response = false;
+        if (query.priority == OCS_PRIORITY_STATUS) {
+            query.next_due = now;
         }
     }
+}
 
-    IDSetText(&Status_ItemsTP, nullptr);
+/*****************************************************
+* Send the due queries and process their replies, all
+* of them regardless of the per poll limit if all set
+******************************************************/
+void OCS::pollStatusQueries(bool all)
+{
+    auto now = std::chrono::steady_clock::now();
 
-    // Timer loop control
-    if (!isConnected())
-        return; //  No need to reset timer if we are not connected anymore
+    // Most urgent first, then the longest overdue
+    std::vector<OCSQuery *> due;
+    for (auto &query : status_queries) {
+        if (all || query.next_due <= now) {
+            due.push_back(&query);
+        }
+    }
+    std::stable_sort(due.begin(), due.end(), [](const OCSQuery *a, const OCSQuery *b) {
+        if (a->priority != b->priority) {
+            return a->priority < b->priority;
+        }
+        return a->next_due < b->next_due;
+    });
+    if (!all && due.size() > OCS_QUERIES_PER_POLL) {
+        due.resize(OCS_QUERIES_PER_POLL);
+    }
 
-    SetTimer(getCurrentPollingPeriod());
-}
+    status_items_changed = false;
+    thermostat_setpoints_changed = false;
+    for (size_t first = 0; first < due.size(); first += OCS_BATCH_MAX) {
+        int count = std::min(static_cast<int>(due.size() - first), OCS_BATCH_MAX);
+        getCommandBatchResponses(PortFD, &due[first], count);
+        for (int i = 0; i < count; i++) {
+            OCSQuery &query = *due[first + i];
+            bool changed = !query.has_response || strcmp(query.response, query.last_response) != 0;
+            query.next_due = now + std::chrono::milliseconds(query.period_ms);
+            processStatusQuery(query, changed);
+        }
+    }
 
-/***************************************
-* Poll properties for updates per minute
-****************************************/
-void OCS::SlowTimerHit()
-{
-    // Status tab
-    char power_status_response[RB_MAX_LEN] = {0};
-    int power_status_error_or_fail  = getCommandSingleCharErrorOrLongResponse(PortFD, power_status_response,
-                                                                              OCS_get_power_status);
-    if (power_status_error_or_fail > 1) {
-        IUSaveText(&Status_ItemsT[STATUS_MAINS], power_status_response);
+    if (status_items_changed) {
         IDSetText(&Status_ItemsTP, nullptr);
-    } else {
-        LOGF_WARN("Communication error on get Power Status %s, this update aborted, will try again...", OCS_get_power_status);
     }
+    if (thermostat_setpoints_changed) {
+        IDSetNumber(&Thermostat_setpointsNP, nullptr);
+    }
+}
 
-    char safety_status_response[RB_MAX_LEN] = {0};
-    int safety_status_error_or_fail  = getCommandSingleCharErrorOrLongResponse(PortFD, safety_status_response,
-                                                                                     OCS_get_safety_status);
-    if (safety_status_error_or_fail > 1) {
-        IUSaveText(&Status_ItemsT[STATUS_OCS_SAFETY], safety_status_response);
-        IDSetText(&Status_ItemsTP, nullptr);
-    } else {
-        LOGF_WARN("Communication error on get OCS Safety Status %s, this update aborted, will try again...", OCS_get_safety_status);
+/**********************************************************
+* Apply one reply, INDI properties are only sent if changed
+***********************************************************/
+void OCS::processStatusQuery(OCSQuery &query, bool changed)
+{
+    bool replied = (query.error_or_fail > 1); //> 1 as an OCS error would be 1 char in response
+    if (replied) {
+        indi_strlcpy(query.last_response, query.response, RB_MAX_LEN);
+        query.has_response = true;
     }
 
-    char MCU_temp_response[RB_MAX_LEN] = {0};
-    int MCU_temp_status_error_or_fail  = getCommandSingleCharErrorOrLongResponse(PortFD, MCU_temp_response,
-                                                                                 OCS_get_MCU_temperature);
-    if (MCU_temp_status_error_or_fail > 1) {
-        IUSaveText(&Status_ItemsT[STATUS_MCU_TEMPERATURE], MCU_temp_response);
-        IDSetText(&Status_ItemsTP, nullptr);
-    } else {
-        LOGF_WARN("Communication error on get MCU temperature %s, this update aborted, will try again...", OCS_get_thermostat_status);
-    }
-
-    // Get the last roof error (if any)
-    // This is here because although the 1 second polled get roof status would return any error flagged
-    // at the time it could miss a transient condition that has been cleared in-between poll periods.
-    // Last roof error holds the condition until cleared by a shutter/roof action.
-    char roof_error_response[RB_MAX_LEN] = {0};
-    int roof_error_error_or_fail  = getCommandSingleCharErrorOrLongResponse(PortFD, roof_error_response,
-                                                                            OCS_get_roof_last_error);
-    if (roof_error_error_or_fail > 1) {
-        if (strcmp(roof_error_response, "Error: Open safety interlock") == 0 &&
-                strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+    ISwitchVectorProperty *thermostat_relay_sp[THERMOSTAT_RELAY_COUNT] = {
+        &Thermostat_heat_relaySP, &Thermostat_cool_relaySP, &Thermostat_humidity_relaySP
+    };
+    ISwitchVectorProperty *power_relay_sp[POWER_DEVICE_COUNT] = {
+        &Power_Device1SP, &Power_Device2SP, &Power_Device3SP, &Power_Device4SP, &Power_Device5SP, &Power_Device6SP
+    };
+    ISwitchVectorProperty *light_relay_sp[LIGHT_COUNT] = {
+        &LIGHT_WRWSP, &LIGHT_WRRSP, &LIGHT_ORWSP, &LIGHT_ORRSP, &LIGHT_OUTSIDESP
+    };
+
+    switch (query.item) {
+        case OCS_QUERY_ROOF_STATUS:
+            // Processed on every reply so the shutter state follows the OCS after any command
+            if (replied) {
+                processRoofStatus(query.response);
             }
-            LOG_WARN("Roof/shutter error - Open safety interlock");
-        } else if (strcmp(roof_error_response, "Error: Close safety interlock") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
-            }
-            LOG_WARN("Roof/shutter error - Close safety interlock");
-        } else if (strcmp(roof_error_response, "Error: Open unknown error") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+
+        case OCS_QUERY_ROOF_LAST_ERROR:
+            if (replied && changed) {
+                processRoofLastError(query.response);
+            } else if (query.error_or_fail == 1) {
+                LOGF_WARN("Communication error on get Roof/Shutter last error %s, this update aborted, will try again...", OCS_get_roof_last_error);
             }
-            LOG_WARN("Roof/shutter error - Open unknown");
-        } else if (strcmp(roof_error_response, "Error: Open limit sw fail") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+
+        case OCS_QUERY_SAFETY_STATUS:
+        case OCS_QUERY_POWER_STATUS:
+        case OCS_QUERY_MCU_TEMPERATURE: {
+            int status_item = (query.item == OCS_QUERY_SAFETY_STATUS) ? STATUS_OCS_SAFETY :
+                              (query.item == OCS_QUERY_POWER_STATUS) ? STATUS_MAINS : STATUS_MCU_TEMPERATURE;
+            if (replied) {
+                if (changed) {
+                    IUSaveText(&Status_ItemsT[status_item], query.response);
+                    status_items_changed = true;
+                }
+            } else {
+                LOGF_WARN("Communication error on get %s %s, this update aborted, will try again...",
+                          Status_ItemsT[status_item].label, query.command);
             }
-            LOG_WARN("Roof/shutter error - Open limit switch fail");
-        } else if (strcmp(roof_error_response, "Error: Open over time") == 0 &&
-            strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+        }
+
+        case OCS_QUERY_DOME_STATUS:
+            if (replied) {
+                processDomeStatus(query.response, changed);
+            } else {
+                LOGF_WARN("Communication error on get Dome status %s, this update aborted, will try again...", OCS_get_dome_status);
             }
-            LOG_WARN("Roof/shutter error - Open max time exceeded");
-        } else if (strcmp(roof_error_response, "Error: Open under time") == 0 &&
-            strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+
+        case OCS_QUERY_DOME_AZIMUTH: {
+            double position = conversion_error;
+            if (replied && sscanf(query.response, "%lf", &position) == 1 && position != conversion_error) {
+                if (changed) {
+                    DomeAbsPosNP[0].setValue(position);
+                    DomeAbsPosNP.apply();
+                }
+            } else {
+                query.has_response = false;
+                LOGF_WARN("Communication error on get Dome position %s, this update aborted, will try again...", OCS_get_dome_azimuth);
             }
-            LOG_WARN("Roof/shutter error - Open min time not reached");
-        } else if (strcmp(roof_error_response, "Error: Close unknown error") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+        }
+
+        case OCS_QUERY_THERMOSTAT_STATUS:
+            if (replied) {
+                if (changed) {
+                    char *split;
+                    split = strtok(query.response, ",");
+                    IUSaveText(&Thermostat_StatusT[THERMOSTAT_TEMERATURE], split);
+                    split = strtok(NULL, ",");
+                    IUSaveText(&Thermostat_StatusT[THERMOSTAT_HUMIDITY], split);
+                    IDSetText(&Thermostat_StatusTP, nullptr);
+                }
+            } else {
+                LOGF_WARN("Communication error on get Thermostat Status %s, this update aborted, will try again...", OCS_get_thermostat_status);
             }
-            LOG_WARN("Roof/shutter error - Close unknow");
-        } else if (strcmp(roof_error_response, "Error: Close limit sw fail") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+
+        case OCS_QUERY_THERMOSTAT_SETPOINT: {
+            int setpoint = (query.error_or_fail >= 0) ? charToInt(query.response) : conversion_error; // errors are negative
+            if (setpoint != conversion_error) {
+                if (changed) {
+                    Thermostat_setpointN[query.index].value = setpoint;
+                    thermostat_setpoints_changed = true;
+                }
+            } else {
+                query.has_response = false;
+                LOGF_WARN("Communication error on get Thermostat %s setpoint %s, this update aborted, will try again...",
+                          Thermostat_setpointN[query.index].label, query.command);
             }
-            LOG_WARN("Roof/shutter error - Close limit switch");
-        } else if (strcmp(roof_error_response, "Error: Close over time") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+        }
+
+        case OCS_QUERY_THERMOSTAT_RELAY:
+            if (replied && changed) {
+                setRelaySwitch(thermostat_relay_sp[query.index], query.response);
             }
-            LOG_WARN("Roof/shutter error - Close max time exceeded");
-        } else if (strcmp(roof_error_response, "Error: Close under tim") == 0 &&
-            strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            LOG_WARN("Roof/shutter error - Close min time not reached");
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+
+        case OCS_QUERY_POWER_RELAY:
+            if (replied && changed) {
+                setRelaySwitch(power_relay_sp[query.index], query.response);
             }
-        } else if (strcmp(roof_error_response, "Error: Limit switch malfunction") == 0 &&
-                strcmp(roof_error_response, last_shutter_error) != 0) {
-            indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-            if (getShutterState() != SHUTTER_ERROR) {
-                setShutterState(SHUTTER_ERROR);
+            break;
+
+        case OCS_QUERY_LIGHT_RELAY:
+            if (replied && changed) {
+                setRelaySwitch(light_relay_sp[query.index], query.response);
             }
-            LOG_WARN("Roof/shutter error - Both open & close limit switches active together");
-        } else if (strcmp(roof_error_response, "Error: Closed/opened limit sw on") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Closed/opened limit switch on");
-        } else if (strcmp(roof_error_response, "Warning: Already closed") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               LOG_WARN("Roof/shutter warning - Roof/shutter is already closed");
-        } else if (strcmp(roof_error_response, "Error: Close location unknown") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Close location unknown");
-        } else if (strcmp(roof_error_response, "Error: Motion direction unknown") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Motion direction unknown");
-        } else if (strcmp(roof_error_response, "Error: Close already in motion") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Close already in motion");
-        } else if (strcmp(roof_error_response, "Error: Opened/closed limit sw on") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Opened/closed limit switch on");
-        } else if (strcmp(roof_error_response, "Warning: Already open") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               LOG_WARN("Roof/shutter warning - Roof/shutter is already open");
-        } else if (strcmp(roof_error_response, "Error: Open location unknow") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Open location unknow");
-        } else if (strcmp(roof_error_response, "Error: Open already in motion") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Open already in motion");
-        } else if (strcmp(roof_error_response, "Error: Close mount not parked") == 0 &&
-                   strcmp(roof_error_response, last_shutter_error) != 0) {
-               indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
-               if (getShutterState() != SHUTTER_ERROR) {
-                   setShutterState(SHUTTER_ERROR);
-               }
-               LOG_WARN("Roof/shutter error - Timeout waiting for mount to park before closing");
-        }
-        IUSaveText(&Status_ItemsT[STATUS_ROOF_LAST_ERROR], last_shutter_error);
-    } else if (roof_error_error_or_fail == 1) {
-        LOGF_WARN("Communication error on get Roof/Shutter last error %s, this update aborted, will try again...", OCS_get_roof_last_error);
-    }
-
-    // Thermostat tab
-    if (thermostat_controls_enabled) {
-        // Get the Obsy Thermostat readings
-        char thermostat_status_response[RB_MAX_LEN] = {0};
-        int thermostat_status_error_or_fail  = getCommandSingleCharErrorOrLongResponse(PortFD, thermostat_status_response,
-                                                                                       OCS_get_thermostat_status);
-        if (thermostat_status_error_or_fail > 1) {
-            char *split;
-            split = strtok(thermostat_status_response, ",");
-            IUSaveText(&Thermostat_StatusT[THERMOSTAT_TEMERATURE], split);
-            split = strtok(NULL, ",");
-            IUSaveText(&Thermostat_StatusT[THERMOSTAT_HUMIDITY], split);
-            IDSetText(&Thermostat_StatusTP, nullptr);
-        } else {
-            LOGF_WARN("Communication error on get Thermostat Status %s, this update aborted, will try again...", OCS_get_thermostat_status);
-        }
+            break;
+    }
+}
 
-        // Get the Thermostat setpoints
-        char heat_response[RB_MAX_LEN] = {0};
-        int heat_int_response = 0;
-        int heat_setpoint_error_or_fail = getCommandIntFromCharResponse(PortFD, heat_response, &heat_int_response,
-                                                                        OCS_get_thermostat_heat_setpoint);
-        if (heat_setpoint_error_or_fail >= 0 && heat_int_response != conversion_error) { // errors are negative
-            Thermostat_setpointN[THERMOSTAT_HEAT_SETPOINT].value = heat_int_response;
-        } else {
-            LOGF_WARN("Communication error on get Thermostat Heat Setpoint %d, this update aborted, will try again...", heat_int_response);
-        }
+/*********************************
+* Roof/shutter status, every poll
+**********************************/
+void OCS::processRoofStatus(char *roof_status_response)
+{
+    bool roof_was_in_error = (getShutterState() == SHUTTER_ERROR);
 
-        char cool_response[RB_MAX_LEN] = {0};
-        int cool_int_response = 0;
-        int cool_setpoint_error_or_fail = getCommandIntFromCharResponse(PortFD, cool_response, &cool_int_response,
-                                                                        OCS_get_thermostat_cool_setpoint);
-        if (cool_setpoint_error_or_fail >= 0 && cool_int_response != conversion_error) { // errors are negative
-            Thermostat_setpointN[THERMOSTAT_COOL_SETPOINT].value = cool_int_response;
-        } else {
-            LOGF_WARN("Communication error on get Thermostat Cool Setpoint %d, this update aborted, will try again...", cool_int_response);
-        }
+    LOGF_DEBUG("roof_was_in_error, %d", roof_was_in_error);
 
-        char humidity_response[RB_MAX_LEN] = {0};
-        int humidity_int_response = 0;
-        int humidity_setpoint_error_or_fail = getCommandIntFromCharResponse(PortFD, humidity_response, &humidity_int_response,
-                                                                            OCS_get_thermostat_humidity_setpoint);
-        if (humidity_setpoint_error_or_fail >= 0 && humidity_int_response != conversion_error) { // errors are negative
-            Thermostat_setpointN[THERMOSTAT_HUMIDITY_SETPOINT].value = humidity_int_response;
-        } else {
-            LOGF_WARN("Communication error on get Thermostat Humidity Setpoint %d, this update aborted, will try again...", humidity_int_response);
+    char *split;
+    char roof_message[30] = {0};
+    split = strtok(roof_status_response, ",");
+    if (strcmp(split, "o") == 0) {
+        if (getShutterState() != SHUTTER_MOVING) {
+            setShutterState(SHUTTER_MOVING);
         }
-        IDSetNumber(&Thermostat_setpointsNP, nullptr);
-
-        // Get the Thermostat relay status'
-        for (int relay = 0; relay < THERMOSTAT_RELAY_COUNT; relay++) {
-            if (thermostat_relays[relay] > 0) {
-                char thermo_relay_response[RB_MAX_LEN] = {0};
-                char thermo_relay_command[RB_MAX_LEN] = {0};
-                sprintf(thermo_relay_command, "%s%d%s", OCS_get_relay_part, thermostat_relays[relay], OCS_command_terminator);
-                int thermo_relay_error_or_fail = getCommandSingleCharErrorOrLongResponse(PortFD, thermo_relay_response,
-                                                                                         thermo_relay_command);
-                if (thermo_relay_error_or_fail > 1) {
-                    if (relay == THERMOSTAT_HEAT_RELAY) {
-                        if (strcmp(thermo_relay_response, "ON") == 0) {
-                            Thermostat_heat_relayS[ON_SWITCH].s = ISS_ON;
-                            Thermostat_heat_relayS[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(thermo_relay_response, "OFF") == 0) {
-                            Thermostat_heat_relayS[ON_SWITCH].s = ISS_OFF;
-                            Thermostat_heat_relayS[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Thermostat_heat_relaySP, nullptr);
-                    } else if (relay == THERMOSTAT_COOL_RELAY) {
-                        if (strcmp(thermo_relay_response, "ON") == 0) {
-                            Thermostat_cool_relayS[ON_SWITCH].s = ISS_ON;
-                            Thermostat_cool_relayS[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(thermo_relay_response, "OFF") == 0) {
-                            Thermostat_cool_relayS[ON_SWITCH].s = ISS_OFF;
-                            Thermostat_cool_relayS[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Thermostat_cool_relaySP, nullptr);
-                    } else if (relay == THERMOSTAT_HUMIDITY_RELAY) {
-                        if (strcmp(thermo_relay_response, "ON") == 0) {
-                            Thermostat_humidity_relayS[ON_SWITCH].s = ISS_ON;
-                            Thermostat_humidity_relayS[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(thermo_relay_response, "OFF") == 0) {
-                            Thermostat_humidity_relayS[ON_SWITCH].s = ISS_OFF;
-                            Thermostat_humidity_relayS[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Thermostat_humidity_relaySP, nullptr);
-                    }
-                }
+        split = strtok(NULL, ",");
+        sprintf(roof_message, "Opening, travel %s", split);
+    } else if (strcmp(split, "c") == 0) {
+        if (getShutterState() != SHUTTER_MOVING) {
+            setShutterState(SHUTTER_MOVING);
+        }
+        split = strtok(NULL, ",");
+        sprintf(roof_message, "Closing, travel %s", split);
+    } else if (strcmp(split, "i") == 0) {
+        split = strtok(NULL, ",");
+        if (strcmp(split, "OPEN") == 0) {
+            if (getShutterState() != SHUTTER_OPENED) {
+                setShutterState(SHUTTER_OPENED);
+            }
+            sprintf(roof_message, "Idle - Open");
+        } else if (strcmp(split, "CLOSED") == 0) {
+            if (getShutterState() != SHUTTER_CLOSED) {
+                setShutterState(SHUTTER_CLOSED);
+            }
+            sprintf(roof_message, "Idle - Closed");
+        } else if (strcmp(split, "No Error") == 0) {
+            sprintf(roof_message, "Idle - No Error");
+        } else if (strcmp(split, "Waiting for mount to park") == 0) {
+            sprintf(roof_message, "Waiting for mount to park");
+        } else {
+            // Must be an error message
+            sprintf(roof_message, "Roof/shutter: %s", split);
+            if (getShutterState() != SHUTTER_ERROR) {
+                setShutterState(SHUTTER_ERROR);
             }
         }
     }
 
-    // Power tab
-    if (power_tab_enabled) {
-        // Get the Power relay status'
-        for (int relay = 0; relay < POWER_DEVICE_COUNT; relay++) {
-            if (power_device_relays[relay] > 0) {
-                char power_relay_response[RB_MAX_LEN] = {0};
-                char power_relay_command[RB_MAX_LEN] = {0};
-                sprintf(power_relay_command, "%s%d%s", OCS_get_relay_part, power_device_relays[relay], OCS_command_terminator);
-                int power_relay_error_or_fail = getCommandSingleCharErrorOrLongResponse(PortFD, power_relay_response,
-                                                                                        power_relay_command);
-                if (power_relay_error_or_fail > 1) {
-                    if (relay == POWER_DEVICE1) {
-                        if (strcmp(power_relay_response, "ON") == 0) {
-                            Power_Device1S[ON_SWITCH].s = ISS_ON;
-                            Power_Device1S[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(power_relay_response, "OFF") == 0) {
-                            Power_Device1S[ON_SWITCH].s = ISS_OFF;
-                            Power_Device1S[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Power_Device1SP, nullptr);
-                    } else if (relay == POWER_DEVICE2) {
-                        if (strcmp(power_relay_response, "ON") == 0) {
-                            Power_Device2S[ON_SWITCH].s = ISS_ON;
-                            Power_Device2S[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(power_relay_response, "OFF") == 0) {
-                            Power_Device2S[ON_SWITCH].s = ISS_OFF;
-                            Power_Device2S[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Power_Device2SP, nullptr);
-                    } else if (relay == POWER_DEVICE3) {
-                        if (strcmp(power_relay_response, "ON") == 0) {
-                            Power_Device3S[ON_SWITCH].s = ISS_ON;
-                            Power_Device3S[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(power_relay_response, "OFF") == 0) {
-                            Power_Device3S[ON_SWITCH].s = ISS_OFF;
-                            Power_Device3S[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Power_Device3SP, nullptr);
-                    } else if (relay == POWER_DEVICE4) {
-                        if (strcmp(power_relay_response, "ON") == 0) {
-                            Power_Device4S[ON_SWITCH].s = ISS_ON;
-                            Power_Device4S[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(power_relay_response, "OFF") == 0) {
-                            Power_Device4S[ON_SWITCH].s = ISS_OFF;
-                            Power_Device4S[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Power_Device4SP, nullptr);
-                    } else if (relay == POWER_DEVICE5) {
-                        if (strcmp(power_relay_response, "ON") == 0) {
-                            Power_Device5S[ON_SWITCH].s = ISS_ON;
-                            Power_Device5S[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(power_relay_response, "OFF") == 0) {
-                            Power_Device5S[ON_SWITCH].s = ISS_OFF;
-                            Power_Device5S[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Power_Device5SP, nullptr);
-                    } else if (relay == POWER_DEVICE6) {
-                        if (strcmp(power_relay_response, "ON") == 0) {
-                            Power_Device6S[ON_SWITCH].s = ISS_ON;
-                            Power_Device6S[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(power_relay_response, "OFF") == 0) {
-                            Power_Device6S[ON_SWITCH].s = ISS_OFF;
-                            Power_Device6S[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&Power_Device6SP, nullptr);
-                    }
-                }
+    if (strcmp(last_shutter_status, roof_message) != 0) {
+        if (getShutterState() == SHUTTER_ERROR) {
+            LOGF_ERROR("Roof/shutter error - %s", roof_message);
+        } else {
+            LOGF_DEBUG("Roof/shutter is %s", roof_message);
+            if (roof_was_in_error) {
+                LOG_INFO("Roof/shutter error cleared");
             }
         }
+        sprintf(last_shutter_status, "%s", roof_message);
+        IUSaveText(&ShutterStatusT[0], roof_message);
+        IDSetText(&ShutterStatusTP, nullptr);
     }
+}
 
-    // Lights tab
-    if (lights_tab_enabled) {
-        // Get the Lights relay status'
-        for (int relay = 0; relay < LIGHT_COUNT; relay++) {
-            if (light_relays[relay] > 0) {
-                char light_relay_response[RB_MAX_LEN] = {0};
-                char light_relay_command[RB_MAX_LEN] = {0};
-                sprintf(light_relay_command, "%s%d%s", OCS_get_relay_part, light_relays[relay], OCS_command_terminator);
-                int light_relay_error_or_fail = getCommandSingleCharErrorOrLongResponse(PortFD, light_relay_response,
-                                                                                        light_relay_command);
-                if (light_relay_error_or_fail > 1) {
-                    if (relay == LIGHT_WRW_RELAY) {
-                        if (strcmp(light_relay_response, "ON") == 0) {
-                            LIGHT_WRWS[ON_SWITCH].s = ISS_ON;
-                            LIGHT_WRWS[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(light_relay_response, "OFF") == 0) {
-                            LIGHT_WRWS[ON_SWITCH].s = ISS_OFF;
-                            LIGHT_WRWS[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&LIGHT_WRWSP, nullptr);
-                    } else if (relay == LIGHT_WRR_RELAY) {
-                        if (strcmp(light_relay_response, "ON") == 0) {
-                            LIGHT_WRRS[ON_SWITCH].s = ISS_ON;
-                            LIGHT_WRRS[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(light_relay_response, "OFF") == 0) {
-                            LIGHT_WRRS[ON_SWITCH].s = ISS_OFF;
-                            LIGHT_WRRS[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&LIGHT_WRRSP, nullptr);
-                    } else if (relay == LIGHT_ORW_RELAY) {
-                        if (strcmp(light_relay_response, "ON") == 0) {
-                            LIGHT_ORWS[ON_SWITCH].s = ISS_ON;
-                            LIGHT_ORWS[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(light_relay_response, "OFF") == 0) {
-                            LIGHT_ORWS[ON_SWITCH].s = ISS_OFF;
-                            LIGHT_ORWS[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&LIGHT_ORWSP, nullptr);
-                    } else if (relay == LIGHT_ORR_RELAY) {
-                        if (strcmp(light_relay_response, "ON") == 0) {
-                            LIGHT_ORRS[ON_SWITCH].s = ISS_ON;
-                            LIGHT_ORRS[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(light_relay_response, "OFF") == 0) {
-                            LIGHT_ORRS[ON_SWITCH].s = ISS_OFF;
-                            LIGHT_ORRS[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&LIGHT_ORRSP, nullptr);
-                    } else if (relay == LIGHT_OUTSIDE_RELAY) {
-                        if (strcmp(light_relay_response, "ON") == 0) {
-                            LIGHT_OUTSIDES[ON_SWITCH].s = ISS_ON;
-                            LIGHT_OUTSIDES[OFF_SWITCH].s = ISS_OFF;
-                        } else if (strcmp(light_relay_response, "OFF") == 0) {
-                            LIGHT_OUTSIDES[ON_SWITCH].s = ISS_OFF;
-                            LIGHT_OUTSIDES[OFF_SWITCH].s = ISS_ON;
-                        }
-                        IDSetSwitch(&LIGHT_OUTSIDESP, nullptr);
-                    }
-                }
-            }
-        }
+/****************************************************************
+* Last roof/shutter error, only called when the reply has changed
+*****************************************************************/
+void OCS::processRoofLastError(const char *roof_error_response)
+{
+    if (strcmp(roof_error_response, "Error: Open safety interlock") == 0 &&
+            strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Open safety interlock");
+    } else if (strcmp(roof_error_response, "Error: Close safety interlock") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Close safety interlock");
+    } else if (strcmp(roof_error_response, "Error: Open unknown error") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Open unknown");
+    } else if (strcmp(roof_error_response, "Error: Open limit sw fail") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Open limit switch fail");
+    } else if (strcmp(roof_error_response, "Error: Open over time") == 0 &&
+        strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Open max time exceeded");
+    } else if (strcmp(roof_error_response, "Error: Open under time") == 0 &&
+        strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Open min time not reached");
+    } else if (strcmp(roof_error_response, "Error: Close unknown error") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Close unknow");
+    } else if (strcmp(roof_error_response, "Error: Close limit sw fail") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Close limit switch");
+    } else if (strcmp(roof_error_response, "Error: Close over time") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Close max time exceeded");
+    } else if (strcmp(roof_error_response, "Error: Close under tim") == 0 &&
+        strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        LOG_WARN("Roof/shutter error - Close min time not reached");
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+    } else if (strcmp(roof_error_response, "Error: Limit switch malfunction") == 0 &&
+            strcmp(roof_error_response, last_shutter_error) != 0) {
+        indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+        if (getShutterState() != SHUTTER_ERROR) {
+            setShutterState(SHUTTER_ERROR);
+        }
+        LOG_WARN("Roof/shutter error - Both open & close limit switches active together");
+    } else if (strcmp(roof_error_response, "Error: Closed/opened limit sw on") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Closed/opened limit switch on");
+    } else if (strcmp(roof_error_response, "Warning: Already closed") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           LOG_WARN("Roof/shutter warning - Roof/shutter is already closed");
+    } else if (strcmp(roof_error_response, "Error: Close location unknown") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Close location unknown");
+    } else if (strcmp(roof_error_response, "Error: Motion direction unknown") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Motion direction unknown");
+    } else if (strcmp(roof_error_response, "Error: Close already in motion") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Close already in motion");
+    } else if (strcmp(roof_error_response, "Error: Opened/closed limit sw on") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Opened/closed limit switch on");
+    } else if (strcmp(roof_error_response, "Warning: Already open") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           LOG_WARN("Roof/shutter warning - Roof/shutter is already open");
+    } else if (strcmp(roof_error_response, "Error: Open location unknow") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Open location unknow");
+    } else if (strcmp(roof_error_response, "Error: Open already in motion") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Open already in motion");
+    } else if (strcmp(roof_error_response, "Error: Close mount not parked") == 0 &&
+               strcmp(roof_error_response, last_shutter_error) != 0) {
+           indi_strlcpy(last_shutter_error,roof_error_response, RB_MAX_LEN);
+           if (getShutterState() != SHUTTER_ERROR) {
+               setShutterState(SHUTTER_ERROR);
+           }
+           LOG_WARN("Roof/shutter error - Timeout waiting for mount to park before closing");
+    }
+    IUSaveText(&Status_ItemsT[STATUS_ROOF_LAST_ERROR], last_shutter_error);
+    status_items_changed = true;
+}
+
+/*****************************************************
+* Dome status, the text is only sent when it changed
+******************************************************/
+void OCS::processDomeStatus(const char *dome_status_response, bool changed)
+{
+    char dome_message[10] = {0};
+    if (strcmp(dome_status_response, "H") == 0) {
+        if (getDomeState() != DOME_IDLE) {
+            setDomeState(DOME_IDLE);
+            ParkSP[0].setState(ISS_OFF);
+            ParkSP[1].setState(ISS_ON);
+            ParkSP.setState(IPS_OK);
+            ParkSP.apply();
+        }
+        sprintf(dome_message, "Home");
+    } else if (strcmp(dome_status_response, "P") == 0) {
+        if (getDomeState() != DOME_PARKED) {
+            setDomeState(DOME_PARKED);
+            ParkSP[0].setState(ISS_ON);
+            ParkSP[1].setState(ISS_OFF);
+            ParkSP.setState(IPS_OK);
+            ParkSP.apply();
+        }
+        sprintf(dome_message, "Parked");
+    } else if (strcmp(dome_status_response, "K") == 0) {
+        if (getDomeState() != DOME_PARKING) {
+            setDomeState(DOME_PARKING);
+            ParkSP[0].setState(ISS_OFF);
+            ParkSP[1].setState(ISS_OFF);
+            ParkSP.setState(IPS_BUSY);
+            ParkSP.apply();
+        }
+        sprintf(dome_message, "Parking");
+    } else if (strcmp(dome_status_response, "S") == 0) {
+        if (getDomeState() != DOME_MOVING) {
+            setDomeState(DOME_MOVING);
+            ParkSP[0].setState(ISS_OFF);
+            ParkSP[1].setState(ISS_ON);
+            ParkSP.setState(IPS_OK);
+            ParkSP.apply();
+        }
+        sprintf(dome_message, "Slewing");
+    } else if (strcmp(dome_status_response, "I") == 0) {
+        if (getDomeState() != DOME_IDLE) {
+            setDomeState(DOME_IDLE);
+            ParkSP[0].setState(ISS_OFF);
+            ParkSP[1].setState(ISS_ON);
+            ParkSP.setState(IPS_OK);
+            ParkSP.apply();
+        }
+        sprintf(dome_message, "Idle");
+    }
+    if (changed) {
+        IUSaveText(&DomeStatusT[0], dome_message);
+        IDSetText(&DomeStatusTP, nullptr);
     }
 }
 
+/******************************************
+* Set an ON/OFF relay switch from its reply
+*******************************************/
+bool OCS::setRelaySwitch(ISwitchVectorProperty *relay_sp, const char *relay_response)
+{
+    if (strcmp(relay_response, "ON") == 0) {
+        relay_sp->sp[ON_SWITCH].s = ISS_ON;
+        relay_sp->sp[OFF_SWITCH].s = ISS_OFF;
+    } else if (strcmp(relay_response, "OFF") == 0) {
+        relay_sp->sp[ON_SWITCH].s = ISS_OFF;
+        relay_sp->sp[OFF_SWITCH].s = ISS_ON;
+    } else {
+        return false;
+    }
+    IDSetSwitch(relay_sp, nullptr);
+    return true;
+}
+
 /*****************************************************************
 * Poll Weather properties for updates - period set by Weather poll
 ******************************************************************/
 IPState OCS::updateWeather() {
     if (weather_tab_enabled) {
+        // All enabled measurements are queried in as few round trips as possible
+        OCSQuery measurements[WEATHER_MEASUREMENTS_COUNT] {};
+        OCSQuery *batch[WEATHER_MEASUREMENTS_COUNT];
+        int count = 0;
         for (int measurement = 0; measurement < WEATHER_MEASUREMENTS_COUNT; measurement ++) {
             if (weather_enabled[measurement] == 1) {
-                char measurement_reponse[RB_MAX_LEN];
-                char measurement_command[CMD_MAX_LEN];
+                char *measurement_command = measurements[count].command;
+                size_t command_size = sizeof(measurements[count].command);
                 if (measurement == WEATHER_TEMPERATURE) {
-                    indi_strlcpy(measurement_command, OCS_get_outside_temperature, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_outside_temperature, command_size);
                 } else if (measurement == WEATHER_SKY_TEMP) {
-                    indi_strlcpy(measurement_command, OCS_get_sky_IR_temperature, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_sky_IR_temperature, command_size);
                 } else if (measurement == WEATHER_DIFF_SKY_TEMP) {
-                    indi_strlcpy(measurement_command, OCS_get_sky_diff_temperature, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_sky_diff_temperature, command_size);
                 } else if (measurement == WEATHER_PRESSURE) {
-                    indi_strlcpy(measurement_command, OCS_get_pressure, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_pressure, command_size);
                 } else if (measurement == WEATHER_HUMIDITY) {
-                    indi_strlcpy(measurement_command, OCS_get_humidity, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_humidity, command_size);
                 } else if (measurement == WEATHER_WIND) {
-                    indi_strlcpy(measurement_command, OCS_get_wind_speed, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_wind_speed, command_size);
                 } else if (measurement == WEATHER_RAIN) {
-                    indi_strlcpy(measurement_command, OCS_get_rain_sensor_status, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_rain_sensor_status, command_size);
                 } else if (measurement == WEATHER_CLOUD) {
-                    indi_strlcpy(measurement_command, OCS_get_cloud_description, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_cloud_description, command_size);
                 } else if (measurement == WEATHER_SKY) {
-                    indi_strlcpy(measurement_command, OCS_get_sky_quality, sizeof(measurement_command));
+                    indi_strlcpy(measurement_command, OCS_get_sky_quality, command_size);
                 }
-                double value = conversion_error;
-                int measurement_error_or_fail = getCommandDoubleResponse(PortFD, &value, measurement_reponse,
-                                                                         measurement_command);
-                if (measurement_error_or_fail >= 0 && value != conversion_error) {
-                     if (measurement == WEATHER_TEMPERATURE && weather_enabled[WEATHER_TEMPERATURE] == 1) {
-                        setParameterValue("WEATHER_TEMPERATURE", value);
-                    } else if (measurement == WEATHER_PRESSURE && weather_enabled[WEATHER_PRESSURE] == 1) {
-                        setParameterValue("WEATHER_PRESSURE", value);
-                    } else if (measurement == WEATHER_HUMIDITY && weather_enabled[WEATHER_HUMIDITY] == 1) {
-                        setParameterValue("WEATHER_HUMIDITY", value);
-                    } else if (measurement == WEATHER_WIND && weather_enabled[WEATHER_WIND] == 1) {
-                        setParameterValue("WEATHER_WIND", value);
-                    } else if (measurement == WEATHER_DIFF_SKY_TEMP && weather_enabled[WEATHER_DIFF_SKY_TEMP] == 1) {
-                        setParameterValue("WEATHER_SKY_DIFF_TEMP", value);
-                    } else if (measurement == WEATHER_CLOUD && weather_enabled[WEATHER_CLOUD] ==1) {
-                        IUSaveText(&Weather_CloudT[0], measurement_reponse);
-                        IDSetText(&Weather_CloudTP, nullptr);
-                    } else if (measurement == WEATHER_SKY && weather_enabled[WEATHER_SKY] ==1) {
-                        IUSaveText(&Weather_SkyT[0], measurement_reponse);
-                        IDSetText(&Weather_SkyTP, nullptr);
-                    } else if (measurement == WEATHER_SKY_TEMP && weather_enabled[WEATHER_SKY_TEMP] ==1) {
-                        IUSaveText(&Weather_Sky_TempT[0], measurement_reponse);
-                        IDSetText(&Weather_Sky_TempTP, nullptr);
-                    }
+                measurements[count].index = measurement;
+                batch[count] = &measurements[count];
+                count++;
+            }
+        }
+        for (int first = 0; first < count; first += OCS_BATCH_MAX) {
+            getCommandBatchResponses(PortFD, &batch[first], std::min(count - first, OCS_BATCH_MAX));
+        }
+
+        for (int i = 0; i < count; i++) {
+            int measurement = measurements[i].index;
+            char *measurement_reponse = measurements[i].response;
+            double value = conversion_error;
+            if (measurements[i].error_or_fail >= 0 && sscanf(measurement_reponse, "%lf", &value) == 1 && value != conversion_error) {
+                if (measurement == WEATHER_TEMPERATURE) {
+                    setParameterValue("WEATHER_TEMPERATURE", value);
+                } else if (measurement == WEATHER_PRESSURE) {
+                    setParameterValue("WEATHER_PRESSURE", value);
+                } else if (measurement == WEATHER_HUMIDITY) {
+                    setParameterValue("WEATHER_HUMIDITY", value);
+                } else if (measurement == WEATHER_WIND) {
+                    setParameterValue("WEATHER_WIND", value);
+                } else if (measurement == WEATHER_DIFF_SKY_TEMP) {
+                    setParameterValue("WEATHER_SKY_DIFF_TEMP", value);
+                } else if (measurement == WEATHER_CLOUD && strcmp(Weather_CloudT[0].text, measurement_reponse) != 0) {
+                    IUSaveText(&Weather_CloudT[0], measurement_reponse);
+                    IDSetText(&Weather_CloudTP, nullptr);
+                } else if (measurement == WEATHER_SKY && strcmp(Weather_SkyT[0].text, measurement_reponse) != 0) {
+                    IUSaveText(&Weather_SkyT[0], measurement_reponse);
+                    IDSetText(&Weather_SkyTP, nullptr);
+                } else if (measurement == WEATHER_SKY_TEMP && strcmp(Weather_Sky_TempT[0].text, measurement_reponse) != 0) {
+                    IUSaveText(&Weather_Sky_TempT[0], measurement_reponse);
+                    IDSetText(&Weather_Sky_TempTP, nullptr);
                 }
             }
         }
@@ -1646,6 +1656,7 @@ bool OCS::ISNewSwitch(const char *dev, const char *name, ISState *states, char *
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0) {
 
         LOGF_DEBUG("Got an IsNewSwitch for: %s", name);
+        invalidateStatusQueries();
 
         // Power devices
         //--------------
@@ -1901,6 +1912,7 @@ bool OCS::ISNewNumber(const char *dev,const char *name,double values[],char *nam
     if (dev != nullptr && strcmp(dev, getDeviceName()) == 0) {
 
         LOGF_DEBUG("Got an IsNewNumber for: %s", name);
+        invalidateStatusQueries();
 
         if (!strcmp(Thermostat_setpointsNP.name, name)) {
             if (THERMOSTAT_SETPOINT_COUNT == n) {
@@ -2275,15 +2287,103 @@ int OCS::getCommandIntFromCharResponse(int fd, char *data, int *response, const
 }
 
 
+/****************************************************************************
+ * Send several commands in one write, then read their replies in order.
+ * Replies are told apart by their # terminator. An unconfigured item returns
+ * an unterminated 0 which merges with the next reply, leaving the last read
+ * of the batch without a reply: if any read fails, none of the replies can
+ * be trusted, so the line is flushed and the commands are re-sent one by one.
+ * Returns the number of commands answered within the batch.
+ * **************************************************************************/
+int OCS::getCommandBatchResponses(int fd, OCSQuery **batch, int count)
+{
+    char commands[OCS_BATCH_MAX * CMD_MAX_LEN] = {0};
+    size_t length = 0;
+    int error_type;
+    int nbytes_write = 0, replies = 0;
+
+    count = std::min(count, OCS_BATCH_MAX);
+    for (int i = 0; i < count; i++) {
+        DEBUGF(INDI::Logger::DBG_DEBUG, "CMD <%s>", batch[i]->command);
+        length += snprintf(commands + length, sizeof(commands) - length, "%s", batch[i]->command);
+        batch[i]->response[0] = '\0';
+        batch[i]->error_or_fail = TTY_TIME_OUT;
+    }
+
+    /* Add mutex */
+    std::unique_lock<std::mutex> guard(ocsCommsLock);
+    discardInput(fd);
+
+    if ((error_type = tty_write_string(fd, commands, &nbytes_write)) != TTY_OK) {
+        for (int i = 0; i < count; i++) {
+            batch[i]->error_or_fail = error_type;
+        }
+        return 0;
+    }
+
+    for (; replies < count; replies++) {
+        char *data = batch[replies]->response;
+        char *term;
+        int nbytes_read = 0;
+
+        error_type = tty_read_section_expanded(fd, data, '#', OCSTimeoutSeconds, OCSTimeoutMicroSeconds, &nbytes_read);
+
+        term = strchr(data, '#');
+        if (term)
+            *term = '\0';
+        if (nbytes_read < RB_MAX_LEN) { //If within buffer, terminate string with \0 (in case it didn't find the #)
+            data[nbytes_read] = '\0'; //Indexed at 0, so this is the byte passed it
+        } else {
+            LOG_DEBUG("got RB_MAX_LEN bytes back, last byte set to null and possible overflow");
+            data[RB_MAX_LEN - 1] = '\0';
+        }
+
+        DEBUGF(INDI::Logger::DBG_DEBUG, "RES <%s>", data);
+
+        if (error_type != TTY_OK) {
+            LOGF_DEBUG("Error %d", error_type);
+            batch[replies]->error_or_fail = error_type;
+            break;
+        }
+        batch[replies]->error_or_fail = nbytes_read;
+    }
+
+    if (replies < count) {
+        LOGF_DEBUG("Batch abandoned after %d of %d replies, flushing connection", replies, count);
+        discardInput(fd);
+        guard.unlock();
+        for (int i = 0; i < count; i++) {
+            batch[i]->error_or_fail = getCommandSingleCharErrorOrLongResponse(fd, batch[i]->response, batch[i]->command);
+        }
+        return 0;
+    }
+
+    return replies;
+}
+
 /**********************
  * Flush the comms port
  * ********************/
 int OCS::flushIO(int fd)
 {
-    tcflush(fd, TCIOFLUSH);
+    std::unique_lock<std::mutex> guard(ocsCommsLock);
+    discardInput(fd);
+
+    return 0;
+}
+
+/*******************************************************************
+ * Discard any pending input, the caller must hold ocsCommsLock.
+ * Nothing is pending on an idle line, skip the flush and the read
+ * timeout then. Checked before tcflush, which would empty the queue.
+ * *****************************************************************/
+void OCS::discardInput(int fd)
+{
     int error_type = 0;
     int nbytes_read;
-    std::unique_lock<std::mutex> guard(ocsCommsLock);
+    int nbytes_pending = 0;
+    if (ioctl(fd, FIONREAD, &nbytes_pending) == 0 && nbytes_pending == 0)
+        return;
     tcflush(fd, TCIOFLUSH);
     do {
         char discard_data[RB_MAX_LEN] = {0};
@@ -2294,8 +2394,6 @@ int OCS::flushIO(int fd)
         //LOGF_DEBUG("flushIO: error_type = %i", error_type);
     }
     while (error_type > 0);
-
-    return 0;
 }
 
 int OCS::charToInt (char *inString)
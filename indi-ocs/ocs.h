@@ -25,8 +25,15 @@
 #include "indipropertyswitch.h"
 #include "inditimer.h"
 
+#include <chrono>
+#include <vector>
+
 #define RB_MAX_LEN 64
 #define CMD_MAX_LEN 32
+// Maximum number of queries written before their replies are read
+#define OCS_BATCH_MAX 4
+// Maximum number of scheduled queries sent per poll
+#define OCS_QUERIES_PER_POLL 12
 enum ResponseErrors {RES_ERR_FORMAT = -1001};
 
 /**********************************************************************
@@ -434,7 +441,6 @@ class OCS : public INDI::Dome, public INDI::WeatherInterface
     bool Disconnect() override;
 
     void TimerHit() override;
-    void SlowTimerHit();
     virtual IPState updateWeather() override;
 
     bool sendOCSCommand(const char *cmd);
@@ -448,6 +454,22 @@ class OCS : public INDI::Dome, public INDI::WeatherInterface
     int getCommandIntFromCharResponse(int fd, char *data, int *response, const char *cmd); //Calls getCommandSingleCharErrorOrLongResponse with conversion of return
     int charToInt(char *inString);
 
+    // A status query, its reply and its schedule
+    typedef struct OCSQuery {
+        int item;                       // OCS_QUERY_* below
+        int index;                      // Relay or measurement index for items with several instances
+        int priority;                   // OCS_PRIORITY_*, lowest is sent first
+        int period_ms;                  // Refresh period, 0 for every poll
+        char command[CMD_MAX_LEN];
+        char response[RB_MAX_LEN];
+        char last_response[RB_MAX_LEN]; // Last reply processed, to detect changes
+        int error_or_fail;              // Same meaning as getCommandSingleCharErrorOrLongResponse return
+        bool has_response;              // last_response is valid
+        std::chrono::steady_clock::time_point next_due;
+    } OCSQuery;
+    int getCommandBatchResponses(int fd, OCSQuery **batch, int count); //Writes all commands, then reads the replies in order
+    void discardInput(int fd); //flushIO without taking ocsCommsLock
+
     long int OCSTimeoutSeconds = 0;
     long int OCSTimeoutMicroSeconds = 100000;
 
@@ -459,8 +481,42 @@ private:
     void GetCapabilites();
     bool hasDome = false;
 
-    // Timer for slow updates, once per minute
-    INDI::Timer SlowTimer;
+protected:
+    // Status query scheduler
+    //-----------------------
+    enum {
+        OCS_PRIORITY_SAFETY,    // Roof, dome and safety state
+        OCS_PRIORITY_STATUS,    // Controls the user may act on
+        OCS_PRIORITY_COSMETIC   // Informational readings
+    };
+    enum {
+        OCS_QUERY_ROOF_STATUS,
+        OCS_QUERY_ROOF_LAST_ERROR,
+        OCS_QUERY_SAFETY_STATUS,
+        OCS_QUERY_DOME_STATUS,
+        OCS_QUERY_DOME_AZIMUTH,
+        OCS_QUERY_POWER_STATUS,
+        OCS_QUERY_MCU_TEMPERATURE,
+        OCS_QUERY_THERMOSTAT_STATUS,
+        OCS_QUERY_THERMOSTAT_SETPOINT,
+        OCS_QUERY_THERMOSTAT_RELAY,
+        OCS_QUERY_POWER_RELAY,
+        OCS_QUERY_LIGHT_RELAY
+    };
+    std::vector<OCSQuery> status_queries;
+    void addStatusQuery(int item, int index, int priority, int period_ms, const char *command);
+    void buildStatusQueries();
+    void invalidateStatusQueries();
+    void pollStatusQueries(bool all);
+    void processStatusQuery(OCSQuery &query, bool changed);
+
+private:
+    void processRoofStatus(char *roof_status_response);
+    void processRoofLastError(const char *roof_error_response);
+    void processDomeStatus(const char *dome_status_response, bool changed);
+    bool setRelaySwitch(ISwitchVectorProperty *relay_sp, const char *relay_response);
+    bool status_items_changed = false;
+    bool thermostat_setpoints_changed = false;
 
     // Roof/Shutter control
     //---------------------
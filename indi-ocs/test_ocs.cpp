@@ -0,0 +1,392 @@
+/******************************************************************************
+ Copyright(c) 2014/2023 Jasem Mutlaq/Ed Lee. All rights reserved.
+
+ This library is free software; you can redistribute it and/or
+ modify it under the terms of the GNU Library General Public
+ License version 2 as published by the Free Software Foundation.
+ .
+ This library is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ Library General Public License for more details.
+ .
+ You should have received a copy of the GNU Library General Public License
+ along with this library; see the file COPYING.LIB.  If not, write to
+ the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ Boston, MA 02110-1301, USA.
+*******************************************************************************/
+
+/******************************************************************************
+Batched OCS queries and the status query scheduler against a responder on a
+pty. The responder answers each command after a simulated link round trip,
+like an OCS on a network bridge.
+*******************************************************************************/
+
+#include "ocs.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <pty.h>
+#include <sys/ioctl.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Exposes the comms functions under test
+class TestOCS : public OCS
+{
+    public:
+        using OCS::OCSQuery;
+        using OCS::flushIO;
+        using OCS::getCommandSingleCharErrorOrLongResponse;
+        using OCS::getCommandBatchResponses;
+        using OCS::PortFD;
+        using OCS::status_queries;
+        using OCS::addStatusQuery;
+        using OCS::pollStatusQueries;
+        using OCS::OCS_PRIORITY_SAFETY;
+        using OCS::OCS_PRIORITY_STATUS;
+        using OCS::OCS_PRIORITY_COSMETIC;
+        using OCS::OCS_QUERY_SAFETY_STATUS;
+        using OCS::OCS_QUERY_POWER_STATUS;
+        using OCS::OCS_QUERY_MCU_TEMPERATURE;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double elapsedMS(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+class OCSResponder
+{
+    public:
+        explicit OCSResponder(int latency_ms) : latency_ms(latency_ms)
+        {
+            openpty(&master, &slave, nullptr, nullptr, nullptr);
+            struct termios t;
+            tcgetattr(slave, &t);
+            cfmakeraw(&t);
+            tcsetattr(slave, TCSANOW, &t);
+            thread = std::thread(&OCSResponder::loop, this);
+        }
+
+        ~OCSResponder()
+        {
+            running = false;
+            thread.join();
+            close(master);
+            close(slave);
+        }
+
+        void reply(const std::string &command, const std::string &response)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            replies[command] = response;
+        }
+
+        // The reply to this command is never sent
+        void drop(const std::string &command)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            dropped = command;
+        }
+
+        std::vector<std::string> takeReceived()
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            std::vector<std::string> commands;
+            commands.swap(received);
+            return commands;
+        }
+
+        // Unsolicited bytes, as left over by an earlier exchange
+        void inject(const std::string &data)
+        {
+            write(master, data.data(), data.size());
+        }
+
+        int slave { -1 };
+
+    private:
+        void loop()
+        {
+            std::string buffer;
+            while (running)
+            {
+                struct pollfd p = { master, POLLIN, 0 };
+                if (poll(&p, 1, 20) <= 0)
+                    continue;
+                char data[256];
+                int n = read(master, data, sizeof(data));
+                if (n <= 0)
+                    continue;
+                Clock::time_point arrival = Clock::now();
+                buffer.append(data, n);
+
+                size_t end;
+                while ((end = buffer.find('#')) != std::string::npos)
+                {
+                    std::string command = buffer.substr(0, end + 1), response;
+                    bool drop;
+                    buffer.erase(0, end + 1);
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        received.push_back(command);
+                        // Unconfigured items answer an unterminated 0
+                        response = replies.count(command) ? replies[command] : "0";
+                        drop = command == dropped;
+                    }
+                    std::this_thread::sleep_until(arrival + std::chrono::milliseconds(latency_ms));
+                    if (!drop)
+                        write(master, response.data(), response.size());
+                }
+            }
+        }
+
+        int master { -1 };
+        int latency_ms;
+        std::atomic<bool> running { true };
+        std::thread thread;
+        std::mutex lock;
+        std::map<std::string, std::string> replies;
+        std::vector<std::string> received;
+        std::string dropped;
+};
+
+class OCSBatchTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            responder.reply(":RS#", "i,CLOSED#");
+            responder.reply(":Gs#", "SAFE#");
+            responder.reply(":GX9F#", "31.5#");
+            responder.reply(":GR1#", "ON#");
+            for (size_t i = 0; i < OCS_BATCH_MAX; i++)
+                batch[i] = &queries[i];
+            setCommands({ ":RS#", ":Gs#", ":GX9F#", ":GR1#" });
+        }
+
+        void setCommands(const std::vector<const char *> &commands)
+        {
+            for (size_t i = 0; i < commands.size(); i++)
+                snprintf(queries[i].command, CMD_MAX_LEN, "%s", commands[i]);
+        }
+
+        void expectReplies()
+        {
+            EXPECT_STREQ(queries[0].response, "i,CLOSED");
+            EXPECT_STREQ(queries[1].response, "SAFE");
+            EXPECT_STREQ(queries[2].response, "31.5");
+            EXPECT_STREQ(queries[3].response, "ON");
+            for (int i = 0; i < OCS_BATCH_MAX; i++)
+                EXPECT_GT(queries[i].error_or_fail, 0);
+        }
+
+        TestOCS ocs;
+        OCSResponder responder { 8 };
+        TestOCS::OCSQuery queries[OCS_BATCH_MAX] {};
+        TestOCS::OCSQuery *batch[OCS_BATCH_MAX];
+};
+
+TEST_F(OCSBatchTest, batch_replies_in_order)
+{
+    auto start = Clock::now();
+    for (int i = 0; i < OCS_BATCH_MAX; i++)
+        queries[i].error_or_fail = ocs.getCommandSingleCharErrorOrLongResponse(responder.slave, queries[i].response,
+                                   queries[i].command);
+    double sequential = elapsedMS(start);
+    expectReplies();
+    responder.takeReceived();
+
+    start = Clock::now();
+    EXPECT_EQ(ocs.getCommandBatchResponses(responder.slave, batch, OCS_BATCH_MAX), OCS_BATCH_MAX);
+    double batched = elapsedMS(start);
+    expectReplies();
+
+    // One write, one round trip
+    EXPECT_EQ(responder.takeReceived(), std::vector<std::string>({ ":RS#", ":Gs#", ":GX9F#", ":GR1#" }));
+    EXPECT_LT(batched, sequential / 2);
+}
+
+TEST_F(OCSBatchTest, stale_input_discarded)
+{
+    responder.inject("OFF#");
+    usleep(10000);
+    EXPECT_EQ(ocs.getCommandBatchResponses(responder.slave, batch, OCS_BATCH_MAX), OCS_BATCH_MAX);
+    expectReplies();
+}
+
+TEST_F(OCSBatchTest, unterminated_zero_falls_back)
+{
+    // Merges with the next reply, the last read of the batch times out
+    setCommands({ ":RS#", ":GX99#", ":Gs#", ":GX9F#" });
+    EXPECT_EQ(ocs.getCommandBatchResponses(responder.slave, batch, OCS_BATCH_MAX), 0);
+
+    // Re-sent one by one, no reply misattributed
+    EXPECT_STREQ(queries[0].response, "i,CLOSED");
+    EXPECT_STREQ(queries[1].response, "0");
+    EXPECT_EQ(queries[1].error_or_fail, TTY_TIME_OUT);
+    EXPECT_STREQ(queries[2].response, "SAFE");
+    EXPECT_STREQ(queries[3].response, "31.5");
+    EXPECT_EQ(responder.takeReceived().size(), 2u * OCS_BATCH_MAX);
+
+    // The line is in step for the next batch
+    setCommands({ ":RS#", ":Gs#", ":GX9F#", ":GR1#" });
+    EXPECT_EQ(ocs.getCommandBatchResponses(responder.slave, batch, OCS_BATCH_MAX), OCS_BATCH_MAX);
+    expectReplies();
+}
+
+TEST_F(OCSBatchTest, lost_reply_falls_back)
+{
+    responder.drop(":Gs#");
+    EXPECT_EQ(ocs.getCommandBatchResponses(responder.slave, batch, OCS_BATCH_MAX), 0);
+    EXPECT_STREQ(queries[0].response, "i,CLOSED");
+    EXPECT_EQ(queries[1].error_or_fail, TTY_TIME_OUT);
+    EXPECT_STREQ(queries[2].response, "31.5");
+    EXPECT_STREQ(queries[3].response, "ON");
+
+    responder.drop("");
+    EXPECT_EQ(ocs.getCommandBatchResponses(responder.slave, batch, OCS_BATCH_MAX), OCS_BATCH_MAX);
+    expectReplies();
+}
+
+TEST_F(OCSBatchTest, idle_flush_skips_timeout)
+{
+    auto start = Clock::now();
+    for (int i = 0; i < 100; i++)
+        ocs.flushIO(responder.slave);
+    EXPECT_LT(elapsedMS(start), 50);
+
+    // Pending input is still read out
+    responder.inject("ON#OFF#");
+    usleep(10000);
+    ocs.flushIO(responder.slave);
+    int pending = -1;
+    ioctl(responder.slave, FIONREAD, &pending);
+    EXPECT_EQ(pending, 0);
+}
+
+// Status queries scheduled over the responder, every command has its own reply
+class OCSSchedulerTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            ocs.initProperties();
+            ocs.PortFD = responder.slave;
+        }
+
+        std::string addQuery(int item, int priority, int period_ms)
+        {
+            char command[CMD_MAX_LEN];
+            snprintf(command, sizeof(command), ":GQ%02d#", static_cast<int>(ocs.status_queries.size()));
+            responder.reply(command, std::string(command + 3, 2) + "#");
+            ocs.addStatusQuery(item, 0, priority, period_ms, command);
+            return command;
+        }
+
+        static bool contains(const std::vector<std::string> &sent, const std::string &command)
+        {
+            return std::find(sent.begin(), sent.end(), command) != sent.end();
+        }
+
+        TestOCS ocs;
+        OCSResponder responder { 1 };
+};
+
+TEST_F(OCSSchedulerTest, urgent_first_within_poll_limit)
+{
+    // Added least urgent first, the table order must not matter
+    std::vector<std::string> cosmetic, status, safety;
+    for (int i = 0; i < 5; i++)
+        cosmetic.push_back(addQuery(TestOCS::OCS_QUERY_MCU_TEMPERATURE, TestOCS::OCS_PRIORITY_COSMETIC, 60000));
+    for (int i = 0; i < 6; i++)
+        status.push_back(addQuery(TestOCS::OCS_QUERY_POWER_STATUS, TestOCS::OCS_PRIORITY_STATUS, 60000));
+    for (int i = 0; i < 3; i++)
+        safety.push_back(addQuery(TestOCS::OCS_QUERY_SAFETY_STATUS, TestOCS::OCS_PRIORITY_SAFETY, 0));
+
+    std::vector<std::string> expected = safety;
+    expected.insert(expected.end(), status.begin(), status.end());
+    expected.insert(expected.end(), cosmetic.begin(), cosmetic.begin() + OCS_QUERIES_PER_POLL - expected.size());
+    ocs.pollStatusQueries(false);
+    EXPECT_EQ(responder.takeReceived(), expected);
+
+    // The roof is read on every poll, the rest of the backlog follows it
+    expected = safety;
+    expected.insert(expected.end(), cosmetic.end() - 2, cosmetic.end());
+    ocs.pollStatusQueries(false);
+    EXPECT_EQ(responder.takeReceived(), expected);
+    for (auto &query : ocs.status_queries)
+        EXPECT_TRUE(query.has_response) << query.command;
+
+    // Nothing else is due
+    ocs.pollStatusQueries(false);
+    EXPECT_EQ(responder.takeReceived(), safety);
+
+    // On connection everything is read, past the limit
+    expected = safety;
+    expected.insert(expected.end(), status.begin(), status.end());
+    expected.insert(expected.end(), cosmetic.begin(), cosmetic.end());
+    ocs.pollStatusQueries(true);
+    EXPECT_EQ(responder.takeReceived(), expected);
+}
+
+TEST_F(OCSSchedulerTest, low_priority_within_period)
+{
+    // A roof with a dome and every tab enabled, the periods of the driver scaled down 100 times
+    const int poll_ms = 20, period_ms = 600;
+    std::vector<std::string> every_poll, periodic;
+    for (int i = 0; i < 3; i++)
+        every_poll.push_back(addQuery(TestOCS::OCS_QUERY_SAFETY_STATUS, TestOCS::OCS_PRIORITY_SAFETY, 0));
+    for (int i = 0; i < 2; i++)
+        periodic.push_back(addQuery(TestOCS::OCS_QUERY_SAFETY_STATUS, TestOCS::OCS_PRIORITY_SAFETY, 100));
+    for (int i = 0; i < 15; i++)
+        periodic.push_back(addQuery(TestOCS::OCS_QUERY_POWER_STATUS, TestOCS::OCS_PRIORITY_STATUS, period_ms));
+    for (int i = 0; i < 2; i++)
+        periodic.push_back(addQuery(TestOCS::OCS_QUERY_MCU_TEMPERATURE, TestOCS::OCS_PRIORITY_COSMETIC, period_ms));
+
+    // Poll number of each send. The polls are at least poll_ms apart, a period is at most
+    // period_ms / poll_ms + 1 polls whatever the scheduling of the test.
+    std::map<std::string, std::vector<int>> sends;
+    const int polls = 3 * period_ms / poll_ms;
+    for (int poll = 0; poll < polls; poll++)
+    {
+        ocs.pollStatusQueries(false);
+        std::vector<std::string> sent = responder.takeReceived();
+        ASSERT_LE(sent.size(), static_cast<size_t>(OCS_QUERIES_PER_POLL));
+        for (auto &command : every_poll)
+            EXPECT_TRUE(contains(sent, command)) << command << " not sent on poll " << poll;
+        for (auto &command : sent)
+            sends[command].push_back(poll);
+        std::this_thread::sleep_for(std::chrono::milliseconds(poll_ms));
+    }
+
+    // 19 periodic items behind 3 read on every poll, 9 a poll: 3 polls to catch up
+    const int catch_up = 3, period_polls = period_ms / poll_ms + 1;
+    for (auto &command : periodic)
+    {
+        const std::vector<int> &at = sends[command];
+        ASSERT_FALSE(at.empty()) << command << " never sent";
+        EXPECT_LT(at.front(), catch_up) << command;
+        for (size_t i = 1; i < at.size(); i++)
+            EXPECT_LE(at[i] - at[i - 1], period_polls + catch_up) << command << " starved";
+        EXPECT_LE(polls - 1 - at.back(), period_polls + catch_up) << command << " starved";
+    }
+    EXPECT_STREQ(ocs.status_queries.back().last_response, "21");
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
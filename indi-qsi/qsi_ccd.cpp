@@ -64,6 +64,7 @@ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110 - 1301  USA
 #include <zlib.h>
 
 #include <memory>
+#include <algorithm>
 
 #include <fitsio.h>
 
@@ -884,12 +885,10 @@ int QSICCD::grabImage()
     int x, y, z;
     try
     {
-        bool imageReady = false;
-        QSICam.get_ImageReady(&imageReady);
-        while (!imageReady)
+        if (!waitImageReady())
         {
-            usleep(500);
-            QSICam.get_ImageReady(&imageReady);
+            LOG_ERROR("Timed out waiting for image to become ready.");
+            return -1;
         }
 
         QSICam.get_ImageArraySize(x, y, z);
@@ -910,6 +909,29 @@ int QSICCD::grabImage()
     return 0;
 }
 
+/* Poll the camera until the image is ready. The interval starts short so that readout of small
+ * frames is picked up promptly, then backs off so long readouts do not hammer the USB link. */
+bool QSICCD::waitImageReady(uint32_t timeoutMS)
+{
+    bool imageReady = false;
+    uint32_t delayMS = 1, waitedMS = 0;
+
+    QSICam.get_ImageReady(&imageReady);
+    while (!imageReady)
+    {
+        if (waitedMS >= timeoutMS)
+            return false;
+
+        usleep(delayMS * 1000);
+        waitedMS += delayMS;
+        delayMS = std::min<uint32_t>(delayMS * 2, IMAGE_READY_MAX_POLL_MS);
+
+        QSICam.get_ImageReady(&imageReady);
+    }
+
+    return true;
+}
+
 void QSICCD::addFITSKeywords(INDI::CCDChip *targetChip, std::vector<INDI::FITSRecord> &fitsKeywords)
 {
     INDI::CCD::addFITSKeywords(targetChip, fitsKeywords);
@@ -1216,20 +1238,10 @@ void QSICCD::TimerHit()
 
     if (InExposure)
     {
-        bool imageReady;
-
         timeleft = CalcTimeLeft(ExpStart, ExposureRequest);
 
         if (timeleft < 1)
         {
-            QSICam.get_ImageReady(&imageReady);
-
-            while (!imageReady)
-            {
-                usleep(100);
-                QSICam.get_ImageReady(&imageReady);
-            }
-
             /* We're done exposing */
             LOG_INFO("Exposure done, downloading image...");
             PrimaryCCD.setExposureLeft(0);
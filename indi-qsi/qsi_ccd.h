@@ -127,7 +127,10 @@ private:
     // Image Data
     int imageWidth, imageHeight;
     INDI::CCDChip::CCD_FRAME imageFrameType;
+    static constexpr uint32_t IMAGE_READY_MAX_POLL_MS = 50;
+    static constexpr uint32_t IMAGE_READY_TIMEOUT_MS = 120000;
     int grabImage();
+    bool waitImageReady(uint32_t timeoutMS = IMAGE_READY_TIMEOUT_MS);
 
     // Timers
     int timerID;
@@ -0,0 +1,538 @@
+/*******************************************************************************
+  Copyright(c) 2020 Ilia Platone - Jasem Mutlaq. All rights reserved.
+
+  INDI RTKLIB Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+/*
+    rtkrcv reader benchmark
+
+    Generates rtkrcv output, console solutions and llh solution streams in degrees and in degrees,
+    minutes and seconds, mixed with prompts, headers, screen clears and noise. Or replays a capture
+    with --capture, then only the throughput and the reconnections are checked.
+
+    The parser throughput is measured in memory, with the output split in random pieces. Then the
+    output is replayed over a local TCP socket and a pty to RTKRCVPump, and the server drops the
+    connection, goes away for a while and stays silent, to measure how long the pump takes to come
+    back. Last, how long stop() takes while the pump waits to reconnect.
+
+    bench_rtkrcv [--solutions N] [--capture FILE] [--output FILE]
+*/
+
+#include "rtkrcvpump.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <pty.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// 2020-05-01T12:00:00Z
+static const time_t START = 1588334400;
+
+static double seconds(Clock::time_point from)
+{
+    return std::chrono::duration<double>(Clock::now() - from).count();
+}
+
+// Degrees, minutes and seconds to 1e-4 arcsecond, printed the way rtkrcv does
+static void dms(double angle, int *degrees, int *minutes, double *secs)
+{
+    long long total = llround(fabs(angle) * 3600e4);
+    *degrees = static_cast<int>(total / 36000000);
+    *minutes = static_cast<int>(total / 600000 % 60);
+    *secs    = (total % 600000) / 1e4;
+}
+
+static double fromDms(double angle)
+{
+    int d, m;
+    double s;
+    dms(angle, &d, &m, &s);
+    double value = d + m / 60.0 + s / 3600;
+    return angle < 0 ? -value : value;
+}
+
+static std::string generate(int count, std::vector<RTKRCVReader::Solution> &expected)
+{
+    static const char *names[] = { "------", "FIX", "FLOAT", "SBAS", "DGPS", "SINGLE", "PPP" };
+    std::mt19937 random(7);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    std::string out = "% program   : RTKNAVI\n% (lat/lon/height=WGS84/ellipsoidal,Q=1:fix,2:float,5:single)\n";
+    char line[512];
+
+    expected.clear();
+    for (int i = 0; i < count; i++)
+    {
+        RTKRCVReader::Solution s;
+        int format = i % 4;
+        s.status    = static_cast<RTKRCVReader::Status>(1 + static_cast<int>(uniform(random) * 6));
+        s.latitude  = (uniform(random) - 0.5) * 170;
+        s.longitude = (uniform(random) - 0.5) * 350;
+        s.elevation = uniform(random) * 3000 - 100;
+
+        // Tenths of a second on the console, milliseconds in the stream
+        long tenths = i * 2;
+        s.time.tv_sec  = START + tenths / 10;
+        s.time.tv_nsec = (tenths % 10) * 100000000L;
+        struct tm utc;
+        gmtime_r(&s.time.tv_sec, &utc);
+        char stamp[64];
+        snprintf(stamp, sizeof(stamp), "%04d/%02d/%02d %02d:%02d:%02d", utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday,
+                 utc.tm_hour, utc.tm_min, utc.tm_sec);
+        const char *lat = s.latitude < 0 ? "S" : "N", *lon = s.longitude < 0 ? "W" : "E";
+
+        switch (format)
+        {
+            case 0:
+            {
+                int ld, lm, od, om;
+                double ls, os;
+                dms(s.latitude, &ld, &lm, &ls);
+                dms(s.longitude, &od, &om, &os);
+                snprintf(line, sizeof(line), "%s%s.%ld (%-6s) %s:%2d %02d %07.4f %s:%3d %02d %07.4f H:%8.3f "
+                         "(N:%6.3f E:%6.3f U:%6.3f) A:%4.1f R:%5.1f N:%2d\r\n", i % 50 == 0 ? "\033[H\033[2J" : "",
+                         stamp, tenths % 10, names[s.status], lat, ld, lm, ls, lon, od, om, os, s.elevation,
+                         0.003, 0.002, 0.010, 0.0, 12.3, 12);
+                s.latitude  = fromDms(s.latitude);
+                s.longitude = fromDms(s.longitude);
+                s.elevation = round(s.elevation * 1e3) / 1e3;
+                break;
+            }
+            case 1:
+                // The sign is printed along with the hemisphere
+                snprintf(line, sizeof(line), "%s.%ld (%-6s) %s:%11.8f %s:%12.8f H:%8.3f A:%4.1f R:%5.1f N:%2d\f", stamp,
+                         tenths % 10, names[s.status], lat, s.latitude, lon, s.longitude, s.elevation, 1.0, 3.4, 9);
+                s.latitude  = round(s.latitude * 1e8) / 1e8;
+                s.longitude = round(s.longitude * 1e8) / 1e8;
+                s.elevation = round(s.elevation * 1e3) / 1e3;
+                break;
+            case 2:
+                snprintf(line, sizeof(line), "%s.%ld00 %14.9f %14.9f %10.4f %3d %3d %8.4f %8.4f %8.4f %8.4f %8.4f %8.4f %6.2f %6.1f\n",
+                         stamp, tenths % 10, s.latitude, s.longitude, s.elevation, static_cast<int>(s.status), 14,
+                         0.0123, 0.0098, 0.0321, 0.0011, -0.0042, 0.0017, 0.0, 999.9);
+                s.latitude  = round(s.latitude * 1e9) / 1e9;
+                s.longitude = round(s.longitude * 1e9) / 1e9;
+                s.elevation = round(s.elevation * 1e4) / 1e4;
+                break;
+            default:
+            {
+                int ld, lm, od, om;
+                double ls, os;
+                char latd[16], lond[16];
+                dms(s.latitude, &ld, &lm, &ls);
+                dms(s.longitude, &od, &om, &os);
+                // The sign goes with the degrees, even when they are zero
+                snprintf(latd, sizeof(latd), "%s%d", s.latitude < 0 ? "-" : "", ld);
+                snprintf(lond, sizeof(lond), "%s%d", s.longitude < 0 ? "-" : "", od);
+                snprintf(line, sizeof(line), "%s.%ld00 %4s %02d %07.4f %4s %02d %07.4f %10.4f %3d %3d %8.4f %8.4f %8.4f\n",
+                         stamp, tenths % 10, latd, lm, ls, lond, om, os, s.elevation, static_cast<int>(s.status), 14, 0.0123,
+                         0.0098, 0.0321);
+                s.latitude  = fromDms(s.latitude);
+                s.longitude = fromDms(s.longitude);
+                s.elevation = round(s.elevation * 1e4) / 1e4;
+                break;
+            }
+        }
+        out += line;
+        expected.push_back(s);
+
+        // Everything else rtkrcv and the link may send
+        if (i % 97 == 0)
+            out += "rtkrcv> solution 1\r\n";
+        if (i % 193 == 0)
+            out += "2020/05/01 12:00:00.0 (FIX   ) X:-3957199.123 Y: 3310199.456 Z: 3737711.789 A: 0.0 R: 0.0 N:10\n";
+        if (i % 389 == 0)
+            out += "2020/05/01 12:00\n";
+        if (i % 1031 == 0)
+            out += std::string(1500, 'x') + "\n";
+    }
+    return out;
+}
+
+static bool same(const RTKRCVReader::Solution &a, const RTKRCVReader::Solution &b)
+{
+    return a.status == b.status && fabs(a.latitude - b.latitude) < 1e-8 && fabs(a.longitude - b.longitude) < 1e-8 &&
+           fabs(a.elevation - b.elevation) < 1e-6 && a.time.tv_sec == b.time.tv_sec &&
+           labs(a.time.tv_nsec - b.time.tv_nsec) < 1000;
+}
+
+static int listenOn(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 4) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int portOf(int fd)
+{
+    struct sockaddr_in address;
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<struct sockaddr *>(&address), &length);
+    return ntohs(address.sin_port);
+}
+
+static int connectTo(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family      = AF_INET;
+    address.sin_port        = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void sendAll(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0)
+            return;
+        data += n;
+        length -= n;
+    }
+}
+
+// Sends the output in random pieces, like a network or a UART would deliver it
+static void replay(int fd, const std::string &output, std::mt19937 &random)
+{
+    std::uniform_int_distribution<size_t> piece(1, 700);
+    for (size_t i = 0; i < output.size();)
+    {
+        size_t n = std::min(piece(random), output.size() - i);
+        sendAll(fd, output.data() + i, n);
+        i += n;
+    }
+}
+
+// Decoded solutions as the pump hands them over
+typedef struct
+{
+    std::mutex mutex;
+    std::vector<RTKRCVReader::Solution> solutions;
+    int connects { 0 };
+    int drops { 0 };
+
+    size_t count()
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        return solutions.size();
+    }
+    bool waitFor(size_t n, double timeout)
+    {
+        Clock::time_point start = Clock::now();
+        while (count() < n)
+        {
+            if (seconds(start) > timeout)
+                return false;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        return true;
+    }
+} Received;
+
+int main(int argc, char **argv)
+{
+    int count           = 20000;
+    const char *capture = nullptr;
+    const char *output  = nullptr;
+
+    for (int i = 1; i < argc; i++)
+    {
+        auto arg = [&](const char *name)
+        {
+            return !strcmp(argv[i], name) && i + 1 < argc;
+        };
+        if (arg("--solutions"))
+            count = atoi(argv[++i]);
+        else if (arg("--capture"))
+            capture = argv[++i];
+        else if (arg("--output"))
+            output = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: %s [--solutions N] [--capture FILE] [--output FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<RTKRCVReader::Solution> expected;
+    std::string data;
+    if (capture)
+    {
+        FILE *fp = fopen(capture, "rb");
+        if (!fp)
+        {
+            fprintf(stderr, "Unable to read %s\n", capture);
+            return 1;
+        }
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+            data.append(buf, n);
+        fclose(fp);
+    }
+    else
+        data = generate(std::max(count, 100), expected);
+
+    // Without a reference, the capture as decoded in a single pass is the reference
+    std::vector<RTKRCVReader::Solution> reference = expected;
+    if (capture)
+    {
+        RTKRCVReader reader;
+        RTKRCVReader::Solution s;
+        for (size_t i = 0; i < data.size();)
+        {
+            i += reader.feed(data.data() + i, data.size() - i);
+            while (reader.next(&s))
+                reference.push_back(s);
+        }
+        if (reference.size() < 10)
+        {
+            fprintf(stderr, "The capture holds less than 10 solutions\n");
+            return 1;
+        }
+    }
+
+    FILE *out = output ? fopen(output, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Unable to write %s\n", output);
+        return 1;
+    }
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"rtklib_rtkrcv\",\n");
+    fprintf(out, "  \"config\": {\"bytes\": %zu, \"solutions\": %zu, \"capture\": %s},\n", data.size(), reference.size(),
+            capture ? "true" : "false");
+    bool ok = true;
+
+    // Parser, in memory
+    {
+        std::mt19937 random(3);
+        std::uniform_int_distribution<size_t> piece(1, 1500);
+        RTKRCVReader reader;
+        RTKRCVReader::Solution s;
+        size_t decoded = 0, mismatches = 0;
+        int passes = 0;
+        Clock::time_point start = Clock::now();
+        do
+        {
+            size_t index = 0;
+            for (size_t i = 0; i < data.size();)
+            {
+                i += reader.feed(data.data() + i, std::min(piece(random), data.size() - i));
+                while (reader.next(&s))
+                {
+                    if (index >= reference.size() || !same(s, reference[index]))
+                        mismatches++;
+                    index++;
+                    decoded++;
+                }
+            }
+            mismatches += index != reference.size();
+            passes++;
+        }
+        while (seconds(start) < 1);
+        double elapsed = seconds(start);
+        bool passed = mismatches == 0;
+        ok = ok && passed;
+        fprintf(out, "  \"parser\": {\"passes\": %d, \"mb_per_s\": %.1f, \"solutions_per_s\": %.0f, \"rejected_lines\": %lu, "
+                "\"mismatches\": %zu, \"passed\": %s},\n", passes, data.size() * passes / elapsed / 1e6, decoded / elapsed,
+                static_cast<unsigned long>(reader.getRejected() / passes), mismatches, passed ? "true" : "false");
+    }
+
+    // Replay over TCP, with the server misbehaving in several ways
+    {
+        std::mt19937 random(5);
+        Received received;
+        int listener = listenOn(0);
+        int port = portOf(listener);
+        int clientFD = connectTo(port);
+        int serverFD = accept(listener, nullptr, nullptr);
+
+        RTKRCVPump pump;
+        pump.setHandlers([&]()
+        {
+            clientFD = connectTo(port);
+            return clientFD;
+        }, [&]()
+        {
+            close(clientFD);
+            clientFD = -1;
+        }, [&](const RTKRCVReader::Solution & s, const struct timespec &)
+        {
+            std::lock_guard<std::mutex> guard(received.mutex);
+            received.solutions.push_back(s);
+        }, [&](bool connected, double)
+        {
+            std::lock_guard<std::mutex> guard(received.mutex);
+            if (connected)
+                received.connects++;
+            else
+                received.drops++;
+        });
+        const double timeout = 1.5;
+        pump.start(clientFD, timeout);
+
+        Clock::time_point start = Clock::now();
+        replay(serverFD, data, random);
+        bool complete = received.waitFor(reference.size(), 30);
+        double elapsed = seconds(start);
+        size_t mismatches = 0;
+        {
+            std::lock_guard<std::mutex> guard(received.mutex);
+            for (size_t i = 0; i < received.solutions.size(); i++)
+                mismatches += i >= reference.size() || !same(received.solutions[i], reference[i]);
+        }
+        bool passed = complete && mismatches == 0;
+        ok = ok && passed;
+        fprintf(out, "  \"tcp_replay\": {\"seconds\": %.3f, \"mb_per_s\": %.1f, \"received\": %zu, \"mismatches\": %zu, \"passed\": %s},\n",
+                elapsed, data.size() / elapsed / 1e6, received.count(), mismatches, passed ? "true" : "false");
+
+        // A line to tell when the pump is back
+        std::string probe = "2020/05/01 12:00:00.000   35.670123456  139.756789012    45.1230   1  12\n";
+        auto back = [&](Clock::time_point from, double *latency)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            size_t before = received.count();
+            sendAll(fd, probe.data(), probe.size());
+            bool done = received.waitFor(before + 1, 60);
+            *latency = seconds(from);
+            return done ? fd : -1;
+        };
+
+        // The peer closes
+        double closed;
+        close(serverFD);
+        serverFD = back(Clock::now(), &closed);
+
+        // Silence, the pump gives up after the timeout
+        double silent;
+        serverFD = back(Clock::now(), &silent);
+
+        // The server goes away, the pump retries at growing intervals
+        double outage = 2.5, restored;
+        close(serverFD);
+        close(listener);
+        std::this_thread::sleep_for(std::chrono::duration<double>(outage));
+        listener = listenOn(port);
+        serverFD = back(Clock::now(), &restored);
+
+        // Stop while waiting to reconnect, a long wait by now
+        close(serverFD);
+        close(listener);
+        std::this_thread::sleep_for(std::chrono::seconds(4));
+        Clock::time_point stopping = Clock::now();
+        pump.stop();
+        double stopped = seconds(stopping);
+        if (clientFD >= 0)
+            close(clientFD);
+
+        passed = serverFD != -1 && closed < RTKRCVPump::MIN_BACKOFF + 0.5 && silent < timeout + RTKRCVPump::MIN_BACKOFF + 0.5 &&
+                 restored <= 2.5 && stopped < 0.05;
+        ok = ok && passed;
+        fprintf(out, "  \"reconnect\": {\"peer_closed_s\": %.3f, \"silent_s\": %.3f, \"outage_s\": %.1f, \"after_outage_s\": %.3f, "
+                "\"stop_s\": %.4f, \"connects\": %d, \"drops\": %d, \"passed\": %s},\n", closed, silent, outage, restored, stopped,
+                received.connects, received.drops, passed ? "true" : "false");
+    }
+
+    // Replay over a pty, the tty transport
+    {
+        std::mt19937 random(9);
+        Received received;
+        int master, slave;
+        if (openpty(&master, &slave, nullptr, nullptr, nullptr) < 0)
+        {
+            fprintf(stderr, "Unable to open a pty\n");
+            return 1;
+        }
+        struct termios tio;
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+
+        RTKRCVPump pump;
+        pump.setHandlers(nullptr, nullptr, [&](const RTKRCVReader::Solution & s, const struct timespec &)
+        {
+            std::lock_guard<std::mutex> guard(received.mutex);
+            received.solutions.push_back(s);
+        }, nullptr);
+        pump.start(slave, 5);
+
+        Clock::time_point start = Clock::now();
+        replay(master, data, random);
+        bool complete = received.waitFor(reference.size(), 30);
+        double elapsed = seconds(start);
+        size_t mismatches = 0;
+        {
+            std::lock_guard<std::mutex> guard(received.mutex);
+            for (size_t i = 0; i < received.solutions.size(); i++)
+                mismatches += i >= reference.size() || !same(received.solutions[i], reference[i]);
+        }
+        pump.stop();
+        close(master);
+        close(slave);
+
+        bool passed = complete && mismatches == 0;
+        ok = ok && passed;
+        fprintf(out, "  \"tty_replay\": {\"seconds\": %.3f, \"received\": %zu, \"mismatches\": %zu, \"passed\": %s},\n", elapsed,
+                received.count(), mismatches, passed ? "true" : "false");
+    }
+
+    fprintf(out, "  \"passed\": %s\n}\n", ok ? "true" : "false");
+    if (output)
+        fclose(out);
+
+    return ok ? 0 : 1;
+}
@@ -6,5 +6,7 @@
 /* Define Driver version */
 #define RTKLIB_VERSION_MAJOR @RTKLIB_VERSION_MAJOR@
 #define RTKLIB_VERSION_MINOR @RTKLIB_VERSION_MINOR@
+/* Define if the Linux PPS API is available */
+#cmakedefine HAVE_SYS_TIMEPPS_H 1
 
 #endif // CONFIG_H
@@ -23,24 +23,25 @@
 *******************************************************************************/
 
 #include "rtklib_driver.h"
-#include "rtkrcv_parser.h"
 
 #include "config.h"
 
+#include <connectionplugins/connectionserial.h>
 #include <connectionplugins/connectiontcp.h>
 #include <indicom.h>
 #include <libnova/julian_day.h>
 #include <libnova/sidereal_time.h>
 
 #include <memory>
+#include <string>
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
 #include <string.h>
 #include <pthread.h>
 
-#define MAX_RTKRCV_PARSES     50              // Read 50 streams before giving up
-#define MAX_TIMEOUT_COUNT   5               // Maximum timeout before auto-connect
+#define RTKRCV_TIMEOUT      15              // Seconds without a solution before reconnecting
+#define HANDSHAKE_TIMEOUT   3               // Seconds to wait for rtkrcv output when connecting
 
 // We declare an auto pointer to GPSD.
 static std::unique_ptr<RTKLIB> rtkrcv(new RTKLIB());
@@ -64,6 +65,21 @@ bool RTKLIB::initProperties()
     IUFillTextVector(&GPSstatusTP, GPSstatusT, 1, getDeviceName(), "GPS_STATUS", "GPS Status", MAIN_CONTROL_TAB, IP_RO,
                      60, IPS_IDLE);
 
+    // Pulse per second from the receiver, through the Linux PPS API
+    IUFillSwitch(&PPSS[PPS_ENABLE], "PPS_ENABLE", "Enable", ISS_OFF);
+    IUFillSwitch(&PPSS[PPS_DISABLE], "PPS_DISABLE", "Disable", ISS_ON);
+    IUFillSwitchVector(&PPSSP, PPSS, 2, getDeviceName(), "PPS", "PPS", OPTIONS_TAB, IP_RW, ISR_1OFMANY, 60, IPS_IDLE);
+
+    IUFillText(&PPSSettingsT[PPS_DEVICE], "PPS_DEVICE", "Device", "/dev/pps0");
+    IUFillText(&PPSSettingsT[PPS_LOG], "PPS_LOG", "Timing log", "");
+    IUFillTextVector(&PPSSettingsTP, PPSSettingsT, 2, getDeviceName(), "PPS_SETTINGS", "PPS Settings", OPTIONS_TAB, IP_RW,
+                     60, IPS_IDLE);
+
+    IUFillNumber(&PPSN[PPS_OFFSET], "PPS_OFFSET", "Clock offset (ms)", "%.3f", -1e9, 1e9, 0, 0);
+    IUFillNumber(&PPSN[PPS_JITTER], "PPS_JITTER", "Jitter (ms)", "%.3f", 0, 1e6, 0, 0);
+    IUFillNumber(&PPSN[PPS_PULSES], "PPS_PULSES", "Pulses", "%.f", 0, 1e12, 0, 0);
+    IUFillNumberVector(&PPSNP, PPSN, 3, getDeviceName(), "PPS_CLOCK", "PPS Clock", MAIN_CONTROL_TAB, IP_RO, 60, IPS_IDLE);
+
     tcpConnection = new Connection::TCP(this);
     tcpConnection->setDefaultHost("192.168.1.1");
     tcpConnection->setDefaultPort(50000);
@@ -75,6 +91,34 @@ bool RTKLIB::initProperties()
 
     registerConnection(tcpConnection);
 
+    // rtkrcv solution output to a serial port
+    serialConnection = new Connection::Serial(this);
+    serialConnection->setDefaultBaudRate(Connection::Serial::B_115200);
+    serialConnection->registerHandshake([&]()
+    {
+        PortFD = serialConnection->getPortFD();
+        return is_rtkrcv();
+    });
+
+    registerConnection(serialConnection);
+
+    pump.setHandlers([this]()
+    {
+        return reopen();
+    }, [this]()
+    {
+        closePort();
+    }, [this](const RTKRCVReader::Solution & solution, const struct timespec & received)
+    {
+        processSolution(solution, received);
+    }, [this](bool connected, double retry)
+    {
+        if (connected)
+            LOG_INFO("Reconnected to rtkrcv.");
+        else
+            LOGF_WARN("Lost rtkrcv, retrying in %.1f seconds...", retry);
+    });
+
     addDebugControl();
 
     setDriverInterface(GPS_INTERFACE | AUX_INTERFACE);
@@ -91,176 +135,227 @@ bool RTKLIB::updateProperties()
     {
         defineProperty(&GPSstatusTP);
 
-        pthread_create(&rtkThread, nullptr, &RTKLIB::parse_rtkrcv_helper, this);
+        if (PPSClock::isSupported())
+        {
+            if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE)
+                PPSSP.s = startPPS() ? IPS_OK : IPS_ALERT;
+
+            defineProperty(&PPSSP);
+            defineProperty(&PPSSettingsTP);
+            defineProperty(&PPSNP);
+        }
+
+        fixStatus  = RTKRCVReader::STATUS_NONE;
+        systemTime = -1;
+        pump.start(PortFD, RTKRCV_TIMEOUT);
     }
     else
     {
         // We're disconnected
+        pump.stop();
         deleteProperty(GPSstatusTP.name);
+
+        if (PPSClock::isSupported())
+        {
+            ppsClock.stop();
+            deleteProperty(PPSSP.name);
+            deleteProperty(PPSSettingsTP.name);
+            deleteProperty(PPSNP.name);
+        }
     }
     return true;
 }
 
+bool RTKLIB::ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n)
+{
+    if (dev != nullptr && !strcmp(dev, getDeviceName()))
+    {
+        if (!strcmp(name, PPSSP.name))
+        {
+            IUUpdateSwitch(&PPSSP, states, names, n);
+            if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE)
+                PPSSP.s = startPPS() ? IPS_OK : IPS_ALERT;
+            else
+            {
+                ppsClock.stop();
+                LOG_INFO("PPS capture stopped.");
+                PPSSP.s = IPS_IDLE;
+                PPSNP.s = IPS_IDLE;
+                IDSetNumber(&PPSNP, nullptr);
+            }
+            IDSetSwitch(&PPSSP, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::GPS::ISNewSwitch(dev, name, states, names, n);
+}
+
+bool RTKLIB::ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n)
+{
+    if (dev != nullptr && !strcmp(dev, getDeviceName()))
+    {
+        if (!strcmp(name, PPSSettingsTP.name))
+        {
+            std::string device = PPSSettingsT[PPS_DEVICE].text;
+            IUUpdateText(&PPSSettingsTP, texts, names, n);
+            PPSSettingsTP.s = IPS_OK;
+            if (!ppsClock.setLog(PPSSettingsT[PPS_LOG].text))
+            {
+                LOGF_ERROR("Unable to open PPS timing log %s: %s", PPSSettingsT[PPS_LOG].text, strerror(errno));
+                PPSSettingsTP.s = IPS_ALERT;
+            }
+            // A new device takes effect right away
+            if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE && device != PPSSettingsT[PPS_DEVICE].text)
+            {
+                PPSSP.s = startPPS() ? IPS_OK : IPS_ALERT;
+                IDSetSwitch(&PPSSP, nullptr);
+            }
+            IDSetText(&PPSSettingsTP, nullptr);
+            return true;
+        }
+    }
+
+    return INDI::GPS::ISNewText(dev, name, texts, names, n);
+}
+
+bool RTKLIB::saveConfigItems(FILE *fp)
+{
+    INDI::GPS::saveConfigItems(fp);
+
+    // The device before the switch that opens it
+    IUSaveConfigText(fp, &PPSSettingsTP);
+    IUSaveConfigSwitch(fp, &PPSSP);
+
+    return true;
+}
+
+bool RTKLIB::startPPS()
+{
+    if (!ppsClock.start(PPSSettingsT[PPS_DEVICE].text))
+    {
+        LOGF_ERROR("Unable to capture PPS from %s: %s", PPSSettingsT[PPS_DEVICE].text, strerror(errno));
+        return false;
+    }
+
+    LOGF_INFO("Capturing PPS from %s.", PPSSettingsT[PPS_DEVICE].text);
+    return true;
+}
+
+bool RTKLIB::Disconnect()
+{
+    // The pump reads from the port until it is joined
+    pump.stop();
+    return INDI::GPS::Disconnect();
+}
+
 IPState RTKLIB::updateGPS()
 {
     IPState rc = IPS_BUSY;
+    RTKRCVReader::Solution latest;
+
+    if (IUFindOnSwitchIndex(&PPSSP) == PPS_ENABLE)
+    {
+        PPSClock::Status pps = ppsClock.getStatus();
+        PPSN[PPS_OFFSET].value = pps.offset * 1000;
+        PPSN[PPS_JITTER].value = pps.jitter * 1000;
+        PPSN[PPS_PULSES].value = pps.pulses;
+        if (!ppsClock.isRunning())
+            PPSNP.s = IPS_ALERT;
+        else
+            PPSNP.s = pps.locked ? IPS_OK : IPS_BUSY;
+        IDSetNumber(&PPSNP, nullptr);
+    }
 
     pthread_mutex_lock(&lock);
     if (locationPending == false && timePending == false)
     {
         rc = IPS_OK;
+        latest = solution;
         locationPending = true;
         timePending = true;
     }
     pthread_mutex_unlock(&lock);
 
+    if (rc != IPS_OK)
+        return rc;
+
+    LocationNP[LOCATION_LATITUDE].value  = latest.latitude;
+    LocationNP[LOCATION_LONGITUDE].value = latest.longitude;
+    LocationNP[LOCATION_ELEVATION].value = latest.elevation;
+    if (LocationNP[LOCATION_LONGITUDE].value < 0)
+        LocationNP[LOCATION_LONGITUDE].value += 360;
+
+    char ts[32] = {0};
+    time_t raw_time = latest.time.tv_sec;
+    struct tm *utc, *local;
+
+    m_GPSTime = raw_time;
+    utc = gmtime(&raw_time);
+    strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
+    TimeTP[0].setText(ts);
+
+    local = localtime(&raw_time);
+    snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
+    TimeTP[1].setText(ts);
+
     return rc;
 }
 
 bool RTKLIB::is_rtkrcv()
 {
-    char line[RTKRCV_MAX_LENGTH];
-
-    int bytes_read = 0;
-    int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH, 0xC, 3, &bytes_read);
-    if (tty_rc < 0)
+    // Anything coming in will do, lines the reader does not understand are skipped
+    if (!pump.wait(PortFD, HANDSHAKE_TIMEOUT * 1000))
     {
-        LOGF_ERROR("Error getting device readings: %s", strerror(errno));
+        LOG_ERROR("No output from rtkrcv.");
         return false;
     }
-    line[bytes_read] = '\0';
 
     return true;
 }
 
-void* RTKLIB::parse_rtkrcv_helper(void *obj)
+int RTKLIB::reopen()
 {
-    static_cast<RTKLIB*>(obj)->parse_rtkrcv();
-    return nullptr;
+    // The connection plugin opens the port again and runs the handshake
+    if (!getActiveConnection()->Connect())
+        return -1;
+
+    return PortFD;
 }
 
-void RTKLIB::parse_rtkrcv()
+void RTKLIB::closePort()
 {
-    static char ts[32] = {0};
+    getActiveConnection()->Disconnect();
+    PortFD = -1;
+}
 
-    char line[RTKRCV_MAX_LENGTH];
+void RTKLIB::processSolution(const RTKRCVReader::Solution &latest, const struct timespec &received)
+{
+    if (latest.status != fixStatus)
+    {
+        fixStatus = latest.status;
+        GPSstatusTP.s = latest.status == RTKRCVReader::STATUS_FIX ? IPS_OK : IPS_BUSY;
+        IUSaveText(&GPSstatusT[0], RTKRCVReader::statusName(latest.status));
+        IDSetText(&GPSstatusTP, nullptr);
+    }
+
+    // Only a fixed solution is worth publishing
+    if (latest.status != RTKRCVReader::STATUS_FIX)
+        return;
+
+    if (ppsClock.isRunning())
+        ppsClock.correlate(latest.time, received);
 
-    while (isConnected())
+    // The clock has a resolution of a second, set it once per second instead of once per solution
+    if (latest.time.tv_sec != systemTime)
     {
-        int bytes_read = 0;
-        int tty_rc = tty_nread_section(PortFD, line, RTKRCV_MAX_LENGTH, 0xC, 3, &bytes_read);
-        if (tty_rc < 0)
-        {
-            if (tty_rc == TTY_OVERFLOW)
-            {
-                LOG_WARN("Overflow detected. Possible remote GPS disconnection. Disconnecting driver...");
-                INDI::GPS::setConnected(false);
-                updateProperties();
-                break;
-            }
-            else
-            {
-                char errmsg[MAXRBUF];
-                tty_error_msg(tty_rc, errmsg, MAXRBUF);
-                if (tty_rc == TTY_TIME_OUT || errno == ECONNREFUSED)
-                {
-                    if (errno == ECONNREFUSED)
-                    {
-                        // sleep for 10 seconds
-                        tcpConnection->Disconnect();
-                        usleep(10 * 1e6);
-                        tcpConnection->Connect();
-                        PortFD = tcpConnection->getPortFD();
-                    }
-                    else if (timeoutCounter++ > MAX_TIMEOUT_COUNT)
-                    {
-                        LOG_WARN("Timeout limit reached, reconnecting...");
-
-                        tcpConnection->Disconnect();
-                        // sleep for 5 seconds
-                        usleep(5 * 1e6);
-                        tcpConnection->Connect();
-                        PortFD = tcpConnection->getPortFD();
-                        timeoutCounter = 0;
-                    }
-                }
-                continue;
-            }
-        }
-        line[bytes_read] = '\0';
-
-        LOGF_DEBUG("%s", line);
-        char flags;
-        char type;
-        double enu[3];
-        double timestamp;
-        rtkrcv_fix_status fix;
-        scansolution(line, &flags, &type, enu, &fix, &timestamp);
-        switch (fix)
-        {
-            case status_no_fix:
-                LOG_DEBUG("no fix");
-                break;
-            case status_float:
-                LOG_DEBUG("float fix");
-                break;
-            case status_sbas:
-                LOG_DEBUG("sbas fix");
-                break;
-            case status_dgps:
-                LOG_DEBUG("dgps fix");
-                break;
-            case status_single:
-                LOG_DEBUG("single fix");
-                break;
-            case status_ppp:
-                LOG_DEBUG("ppp fix");
-                break;
-            case status_unknown:
-                LOG_DEBUG("unknown fix status");
-                break;
-            case status_fix:
-            {
-                LocationNP[LOCATION_LATITUDE].value  = enu[0];
-                LocationNP[LOCATION_LONGITUDE].value = enu[1];
-                LocationNP[LOCATION_ELEVATION].value = enu[2];
-                if (LocationNP[LOCATION_LONGITUDE].value < 0)
-                    LocationNP[LOCATION_LONGITUDE].value += 360;
-
-                struct timespec timesp;
-                time_t raw_time;
-                struct tm *utc, *local;
-
-                timesp.tv_sec = (time_t)timestamp;
-                timesp.tv_nsec = (time_t)(timestamp * 1000000000.0);
-
-                raw_time = timesp.tv_sec;
-                m_GPSTime = raw_time;
-                utc = gmtime(&raw_time);
-                strftime(ts, 32, "%Y-%m-%dT%H:%M:%S", utc);
-                TimeTP[0].setText(ts);
-
-                setSystemTime(raw_time);
-
-                local = localtime(&raw_time);
-                snprintf(ts, 32, "%4.2f", (local->tm_gmtoff / 3600.0));
-                TimeTP[1].setText(ts);
-
-                pthread_mutex_lock(&lock);
-                locationPending = false;
-                timePending = false;
-                LOG_DEBUG("Threaded Location and Time updates complete.");
-                pthread_mutex_unlock(&lock);
-                break;
-
-                default:
-                {
-                    LOG_DEBUG("solution is not parsed");
-                }
-                break;
-            }
-        }
+        systemTime = latest.time.tv_sec;
+        setSystemTime(systemTime);
     }
 
-    pthread_exit(nullptr);
+    pthread_mutex_lock(&lock);
+    solution = latest;
+    locationPending = false;
+    timePending = false;
+    pthread_mutex_unlock(&lock);
 }
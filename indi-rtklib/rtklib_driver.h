@@ -26,6 +26,15 @@
 
 #include <indigps.h>
 
+#include "ppsclock.h"
+#include "rtkrcvpump.h"
+
+namespace Connection
+{
+class Serial;
+class TCP;
+}
+
 class RTKLIB : public INDI::GPS
 {
   public:
@@ -35,24 +44,62 @@ class RTKLIB : public INDI::GPS
     IText GPSstatusT[1] {};
     ITextVectorProperty GPSstatusTP;
 
-    static void* parse_rtkrcv_helper(void *);
+    virtual bool ISNewSwitch(const char *dev, const char *name, ISState *states, char *names[], int n) override;
+    virtual bool ISNewText(const char *dev, const char *name, char *texts[], char *names[], int n) override;
 
   protected:    
     //  Generic indi device entries
     virtual const char *getDefaultName() override;
     virtual bool initProperties() override;
     virtual bool updateProperties() override;
+    virtual bool Disconnect() override;
     virtual IPState updateGPS() override;
+    virtual bool saveConfigItems(FILE *fp) override;
 
 private:
     Connection::TCP *tcpConnection { nullptr };
+    Connection::Serial *serialConnection { nullptr };
     bool is_rtkrcv();
-    void parse_rtkrcv();
+    int reopen();
+    void closePort();
+    void processSolution(const RTKRCVReader::Solution &solution, const struct timespec &received);
+    bool startPPS();
+
+    // Pulse per second timestamping
+    ISwitch PPSS[2];
+    ISwitchVectorProperty PPSSP;
+    enum
+    {
+        PPS_ENABLE,
+        PPS_DISABLE
+    };
+    IText PPSSettingsT[2] {};
+    ITextVectorProperty PPSSettingsTP;
+    enum
+    {
+        PPS_DEVICE,
+        PPS_LOG
+    };
+    INumber PPSN[3];
+    INumberVectorProperty PPSNP;
+    enum
+    {
+        PPS_OFFSET,
+        PPS_JITTER,
+        PPS_PULSES
+    };
+    PPSClock ppsClock;
 
     int PortFD { -1 };
-    uint8_t timeoutCounter=0;
     bool locationPending = true, timePending=true;
 
-    pthread_mutex_t lock;
-    pthread_t rtkThread;
+    // Pump thread only
+    RTKRCVPump pump;
+    RTKRCVReader::Status fixStatus { RTKRCVReader::STATUS_NONE };
+    time_t systemTime { -1 };
+
+    // Latest fixed solution, guarded by lock
+    RTKRCVReader::Solution solution;
+
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
 };
@@ -0,0 +1,232 @@
+/*******************************************************************************
+  Copyright(c) 2020 Ilia Platone - Jasem Mutlaq. All rights reserved.
+
+  INDI RTKLIB Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "rtkrcvpump.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+
+constexpr double RTKRCVPump::MIN_BACKOFF;
+constexpr double RTKRCVPump::MAX_BACKOFF;
+
+RTKRCVPump::RTKRCVPump()
+{
+    if (pipe(wakeFD) == 0)
+    {
+        for (int fd : wakeFD)
+        {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+}
+
+RTKRCVPump::~RTKRCVPump()
+{
+    stop();
+    for (int fd : wakeFD)
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+}
+
+void RTKRCVPump::setHandlers(OpenHandler open, CloseHandler close, SolutionHandler solution, StateHandler state)
+{
+    openHandler     = open;
+    closeHandler    = close;
+    solutionHandler = solution;
+    stateHandler    = state;
+}
+
+bool RTKRCVPump::start(int fd, double timeout)
+{
+    if (running || wakeFD[0] < 0)
+        return false;
+
+    this->timeout = timeout;
+    reconnecting  = false;
+    running       = true;
+    thread = std::thread(&RTKRCVPump::loop, this, fd);
+    return true;
+}
+
+void RTKRCVPump::stop()
+{
+    if (!thread.joinable())
+        return;
+
+    running = false;
+    if (write(wakeFD[1], "", 1) < 0)
+    {
+        // Full, the thread has a wake up pending already
+    }
+    thread.join();
+    drain();
+}
+
+void RTKRCVPump::reconnect()
+{
+    if (!running)
+        return;
+
+    reconnecting = true;
+    if (write(wakeFD[1], "", 1) < 0)
+    {
+        // Full, the thread has a wake up pending already
+    }
+}
+
+bool RTKRCVPump::wait(int fd, int milliseconds)
+{
+    struct pollfd fds[2] = { { fd, POLLIN, 0 }, { wakeFD[0], POLLIN, 0 } };
+    int rc;
+    do
+    {
+        rc = poll(fds, 2, milliseconds);
+    }
+    while (rc < 0 && errno == EINTR);
+
+    // The wake up is left for the pump thread to see
+    return rc > 0 && fds[1].revents == 0 && (fds[0].revents & POLLIN);
+}
+
+bool RTKRCVPump::pause(double seconds)
+{
+    struct pollfd pfd = { wakeFD[0], POLLIN, 0 };
+    if (poll(&pfd, 1, static_cast<int>(ceil(seconds * 1000))) > 0)
+    {
+        drain();
+        reconnecting = false;
+    }
+    return running;
+}
+
+void RTKRCVPump::drain()
+{
+    char buf[64];
+    while (read(wakeFD[0], buf, sizeof(buf)) > 0)
+        ;
+}
+
+void RTKRCVPump::loop(int fd)
+{
+    using clock = std::chrono::steady_clock;
+
+    double backoff = MIN_BACKOFF;
+    clock::time_point last = clock::now();
+
+    auto drop = [&]()
+    {
+        if (closeHandler)
+            closeHandler();
+        fd = -1;
+        if (stateHandler)
+            stateHandler(false, backoff);
+    };
+
+    if (fd >= 0)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    reader.reset();
+
+    while (running)
+    {
+        if (fd < 0)
+        {
+            if (!pause(backoff))
+                break;
+            fd = openHandler ? openHandler() : -1;
+            if (fd < 0)
+            {
+                backoff = std::min(backoff * 2, MAX_BACKOFF);
+                if (stateHandler)
+                    stateHandler(false, backoff);
+                continue;
+            }
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            reader.reset();
+            last = clock::now();
+            if (stateHandler)
+                stateHandler(true, 0);
+            continue;
+        }
+
+        double idle = timeout - std::chrono::duration<double>(clock::now() - last).count();
+        if (idle <= 0)
+        {
+            drop();
+            continue;
+        }
+
+        struct pollfd fds[2] = { { fd, POLLIN, 0 }, { wakeFD[0], POLLIN, 0 } };
+        int rc = poll(fds, 2, static_cast<int>(ceil(idle * 1000)));
+        if (rc < 0)
+        {
+            if (errno != EINTR)
+                drop();
+            continue;
+        }
+        if (fds[1].revents != 0)
+        {
+            drain();
+            if (reconnecting.exchange(false))
+            {
+                backoff = MIN_BACKOFF;
+                drop();
+            }
+            continue;
+        }
+        if (fds[0].revents == 0)
+            continue;
+
+        ssize_t bytes_read = reader.fill(fd);
+        if (bytes_read < 0 && (errno == EAGAIN || errno == EINTR))
+            continue;
+        // Closed by the peer, or gone
+        if (bytes_read <= 0)
+        {
+            drop();
+            continue;
+        }
+
+        // Before decoding, the time the solutions came in
+        struct timespec received;
+        clock_gettime(CLOCK_REALTIME, &received);
+        last    = clock::now();
+        backoff = MIN_BACKOFF;
+
+        RTKRCVReader::Solution solution;
+        while (reader.next(&solution))
+        {
+            if (solutionHandler)
+                solutionHandler(solution, received);
+        }
+    }
+}
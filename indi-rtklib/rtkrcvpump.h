@@ -0,0 +1,107 @@
+/*******************************************************************************
+  Copyright(c) 2020 Ilia Platone - Jasem Mutlaq. All rights reserved.
+
+  INDI RTKLIB Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include "rtkrcvreader.h"
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+/**
+ * @brief The RTKRCVPump class reads rtkrcv solutions on a thread of its own.
+ *
+ * The thread waits in poll() on the transport, a TCP socket or a tty, and on a wake up pipe, so
+ * stop() and reconnect() take effect right away. Whatever each read brings is handed to an
+ * RTKRCVReader. When the peer closes, an error occurs or nothing comes in for a while, the
+ * transport is closed and reopened after a delay that doubles on every failed attempt.
+ */
+class RTKRCVPump
+{
+  public:
+    // Reopen the transport, returns its descriptor or -1
+    typedef std::function<int()> OpenHandler;
+    typedef std::function<void()> CloseHandler;
+    // A decoded solution and the system time it was read
+    typedef std::function<void(const RTKRCVReader::Solution &, const struct timespec &)> SolutionHandler;
+    // Connected, or lost with the seconds until the next attempt
+    typedef std::function<void(bool, double)> StateHandler;
+
+    // Reconnection delays, seconds
+    static constexpr double MIN_BACKOFF = 0.5;
+    static constexpr double MAX_BACKOFF = 30;
+
+    RTKRCVPump();
+    ~RTKRCVPump();
+
+    void setHandlers(OpenHandler open, CloseHandler close, SolutionHandler solution, StateHandler state);
+
+    /**
+     * @brief start Read from an open transport on the pump thread.
+     * @param fd Descriptor, switched to non-blocking.
+     * @param timeout Seconds without data before reconnecting.
+     */
+    bool start(int fd, double timeout);
+
+    /** @brief stop Wake the thread up and join it. The transport is left as it is. */
+    void stop();
+
+    /** @brief reconnect Drop the transport and reopen it. */
+    void reconnect();
+
+    /**
+     * @brief wait Wait for data on a descriptor, unless stop() is called first.
+     * @return true if there is data to read.
+     */
+    bool wait(int fd, int milliseconds);
+
+    bool isRunning() const
+    {
+        return running;
+    }
+
+    const RTKRCVReader &getReader() const
+    {
+        return reader;
+    }
+
+  private:
+    void loop(int fd);
+    // Sleep unless woken up, false if stopping
+    bool pause(double seconds);
+    void drain();
+
+    RTKRCVReader reader;
+    OpenHandler openHandler;
+    CloseHandler closeHandler;
+    SolutionHandler solutionHandler;
+    StateHandler stateHandler;
+
+    std::thread thread;
+    std::atomic<bool> running { false };
+    std::atomic<bool> reconnecting { false };
+    int wakeFD[2] { -1, -1 };
+    double timeout { 0 };
+};
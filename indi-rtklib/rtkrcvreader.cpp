@@ -0,0 +1,365 @@
+/*******************************************************************************
+  Copyright(c) 2020 Ilia Platone - Jasem Mutlaq. All rights reserved.
+
+  INDI RTKLIB Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#include "rtkrcvreader.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Blanks, and the escape sequences the console clears the screen with
+static const char *skip(const char *p)
+{
+    while (true)
+    {
+        if (*p == ' ' || *p == '\t')
+            p++;
+        else if (*p == '\033')
+        {
+            p++;
+            if (*p == '[')
+            {
+                p++;
+                while (*p != '\0' && !isalpha(static_cast<unsigned char>(*p)))
+                    p++;
+                if (*p != '\0')
+                    p++;
+            }
+        }
+        else
+            return p;
+    }
+}
+
+static bool digits(const char *&p, int count, int *value)
+{
+    *value = 0;
+    for (int i = 0; i < count; i++, p++)
+    {
+        if (!isdigit(static_cast<unsigned char>(*p)))
+            return false;
+        *value = *value * 10 + (*p - '0');
+    }
+    return true;
+}
+
+static bool number(const char *&p, double *value, bool *point = nullptr, bool *negative = nullptr)
+{
+    p = skip(p);
+    char *end;
+    *value = strtod(p, &end);
+    if (end == p || !isfinite(*value))
+        return false;
+    if (point != nullptr)
+        *point = memchr(p, '.', end - p) != nullptr;
+    if (negative != nullptr)
+        *negative = *p == '-';
+    p = end;
+    return true;
+}
+
+// Days since 1970-01-01 in the proleptic Gregorian calendar, without the time zone timegm() looks at
+static long daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    long era = (year >= 0 ? year : year - 399) / 400;
+    long yearOfEra = year - era * 400;
+    long dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    long dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+// yyyy/mm/dd hh:mm:ss.sss
+static bool date(const char *&p, struct timespec *time)
+{
+    int year, month, day, hour, minute;
+    double second;
+
+    p = skip(p);
+    if (!digits(p, 4, &year) || *p++ != '/' || !digits(p, 2, &month) || *p++ != '/' || !digits(p, 2, &day))
+        return false;
+    p = skip(p);
+    if (!digits(p, 2, &hour) || *p++ != ':' || !digits(p, 2, &minute) || *p++ != ':' || !number(p, &second))
+        return false;
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second < 0 || second >= 61)
+        return false;
+
+    long whole = static_cast<long>(second);
+    long nanoseconds = lround((second - whole) * 1e9);
+    if (nanoseconds >= 1000000000)
+    {
+        whole++;
+        nanoseconds -= 1000000000;
+    }
+    time->tv_sec  = static_cast<time_t>(daysFromCivil(year, month, day)) * 86400 + hour * 3600 + minute * 60 + whole;
+    time->tv_nsec = nanoseconds;
+    return true;
+}
+
+// Console angle, N:35 40 12.3456 or N:35.67012345, signed by the hemisphere
+static bool hemisphereAngle(const char *&p, const char *hemispheres, double *angle)
+{
+    p = skip(p);
+    if ((p[0] != hemispheres[0] && p[0] != hemispheres[1]) || p[1] != ':')
+        return false;
+    bool negative = p[0] == hemispheres[1];
+    p += 2;
+
+    double degrees;
+    bool point;
+    if (!number(p, &degrees, &point))
+        return false;
+    degrees = fabs(degrees);
+    if (!point)
+    {
+        double minutes, seconds;
+        if (!number(p, &minutes) || !number(p, &seconds))
+            return false;
+        degrees += minutes / 60 + seconds / 3600;
+    }
+    *angle = negative ? -degrees : degrees;
+    return true;
+}
+
+// Solution stream angle, 35.670123456 or -35 40 12.44432
+static bool signedAngle(const char *&p, bool dms, double *angle)
+{
+    bool negative;
+    if (!number(p, angle, nullptr, &negative))
+        return false;
+    if (!dms)
+        return true;
+
+    double minutes, seconds;
+    if (!number(p, &minutes) || !number(p, &seconds))
+        return false;
+    *angle = fabs(*angle) + minutes / 60 + seconds / 3600;
+    if (negative)
+        *angle = -*angle;
+    return true;
+}
+
+ssize_t RTKRCVReader::fill(int fd)
+{
+    compact();
+    // Only when next() was not called until it ran dry
+    if (end == BUFFER_SIZE)
+    {
+        rejected++;
+        start = end = scanned = 0;
+        discarding = true;
+    }
+
+    ssize_t bytes_read = read(fd, buffer + end, BUFFER_SIZE - end);
+    if (bytes_read > 0)
+        end += bytes_read;
+    return bytes_read;
+}
+
+size_t RTKRCVReader::feed(const char *data, size_t length)
+{
+    compact();
+    if (length > BUFFER_SIZE - end)
+        length = BUFFER_SIZE - end;
+    memcpy(buffer + end, data, length);
+    end += length;
+    return length;
+}
+
+void RTKRCVReader::compact()
+{
+    if (start > 0)
+    {
+        memmove(buffer, buffer + start, end - start);
+        end -= start;
+        start = 0;
+    }
+}
+
+bool RTKRCVReader::next(Solution *solution)
+{
+    while (start < end)
+    {
+        char *line = buffer + start;
+        char *eol  = nullptr;
+
+        // Only the bytes that came in since the last call
+        for (char *c = line + scanned; c < buffer + end; c++)
+        {
+            if (*c == '\n' || *c == '\r' || *c == '\f')
+            {
+                eol = c;
+                break;
+            }
+        }
+
+        if (eol == nullptr)
+        {
+            scanned = end - start;
+            if (scanned > MAX_LINE)
+            {
+                if (!discarding)
+                    rejected++;
+                discarding = true;
+                start = end;
+                scanned = 0;
+            }
+            return false;
+        }
+        start   = eol - buffer + 1;
+        scanned = 0;
+        *eol    = '\0';
+
+        // The tail of a line dropped as noise, or the second half of a CR LF
+        if (discarding)
+        {
+            discarding = false;
+            continue;
+        }
+        if (eol == line)
+            continue;
+
+        if (decode(line, solution))
+        {
+            solutions++;
+            return true;
+        }
+        // Prompts, headers, other monitor output
+        rejected++;
+    }
+
+    return false;
+}
+
+void RTKRCVReader::reset()
+{
+    start = end = scanned = 0;
+    discarding = false;
+}
+
+bool RTKRCVReader::decode(const char *line, Solution *solution)
+{
+    const char *p = line;
+    Solution found;
+
+    if (!date(p, &found.time))
+        return false;
+
+    p = skip(p);
+    if (*p == '(')
+    {
+        // Console: (STATUS) N:... E:... H:...
+        const char *status = ++p;
+        const char *close  = strchr(status, ')');
+        if (close == nullptr)
+            return false;
+        size_t length = close - status;
+        while (length > 0 && status[length - 1] == ' ')
+            length--;
+
+        static const struct
+        {
+            const char *name;
+            Status status;
+        } names[] =
+        {
+            { "------", STATUS_NONE },
+            { "FIX", STATUS_FIX },
+            { "FLOAT", STATUS_FLOAT },
+            { "SBAS", STATUS_SBAS },
+            { "DGPS", STATUS_DGPS },
+            { "SINGLE", STATUS_SINGLE },
+            { "PPP", STATUS_PPP },
+        };
+        found.status = STATUS_UNKNOWN;
+        for (const auto &name : names)
+        {
+            if (strlen(name.name) == length && !memcmp(name.name, status, length))
+                found.status = name.status;
+        }
+
+        // Positions as X:, Y:, Z: or E:, N:, U: are not geographic, and fail here
+        p = close + 1;
+        if (!hemisphereAngle(p, "NS", &found.latitude) || !hemisphereAngle(p, "EW", &found.longitude))
+            return false;
+        p = skip(p);
+        if (p[0] != 'H' || p[1] != ':')
+            return false;
+        p += 2;
+        if (!number(p, &found.elevation))
+            return false;
+    }
+    else
+    {
+        // Solution stream: latitude longitude height Q ns ...
+        double quality;
+        bool point;
+        const char *first = p;
+        if (!number(first, &found.latitude, &point))
+            return false;
+        // Degrees are printed without a decimal point when followed by minutes and seconds
+        if (!signedAngle(p, !point, &found.latitude) || !signedAngle(p, !point, &found.longitude) ||
+                !number(p, &found.elevation) || !number(p, &quality))
+            return false;
+
+        static const Status qualities[] =
+        {
+            STATUS_NONE, STATUS_FIX, STATUS_FLOAT, STATUS_SBAS, STATUS_DGPS, STATUS_SINGLE, STATUS_PPP
+        };
+        int q = static_cast<int>(quality);
+        found.status = (q >= 0 && q <= 6 && q == quality) ? qualities[q] : STATUS_UNKNOWN;
+    }
+
+    // ECEF coordinates in the solution stream end up here
+    if (fabs(found.latitude) > 90 || found.longitude < -180 || found.longitude > 360)
+        return false;
+
+    *solution = found;
+    return true;
+}
+
+const char *RTKRCVReader::statusName(Status status)
+{
+    switch (status)
+    {
+        case STATUS_NONE:
+            return "NO FIX";
+        case STATUS_FIX:
+            return "FIX";
+        case STATUS_FLOAT:
+            return "FLOAT";
+        case STATUS_SBAS:
+            return "SBAS";
+        case STATUS_DGPS:
+            return "DGPS";
+        case STATUS_SINGLE:
+            return "SINGLE";
+        case STATUS_PPP:
+            return "PPP";
+        default:
+            return "UNKNOWN";
+    }
+}
@@ -0,0 +1,122 @@
+/*******************************************************************************
+  Copyright(c) 2020 Ilia Platone - Jasem Mutlaq. All rights reserved.
+
+  INDI RTKLIB Driver
+
+  This program is free software; you can redistribute it and/or modify it
+  under the terms of the GNU General Public License as published by the Free
+  Software Foundation; either version 2 of the License, or (at your option)
+  any later version.
+
+  This program is distributed in the hope that it will be useful, but WITHOUT
+  ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+  FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+  more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+
+  The full GNU General Public License is included in this distribution in the
+  file called LICENSE.
+*******************************************************************************/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <time.h>
+
+/**
+ * @brief The RTKRCVReader class decodes rtkrcv solutions from a byte stream, as it comes.
+ *
+ * Data is appended in whatever pieces the transport delivers and split into lines in place, on
+ * line feeds, carriage returns or form feeds. Two kinds of lines are understood, both with
+ * latitude and longitude in degrees or in degrees, minutes and seconds:
+ *
+ * - the rtkrcv console "solution" output, such as
+ *   2020/05/01 12:00:00.0 (FIX   ) N:35 40 12.3456 E:139 45 23.4567 H:  45.123 ... A: 0.0 R: 12.3 N:12
+ * - the llh solution stream of an rtkrcv output, such as
+ *   2020/05/01 12:00:00.000   35.670123456  139.756789012    45.1230   1  12 ...
+ *
+ * Only the time, status, position and height are decoded, everything else on the line is skipped.
+ * Times are taken as UTC, rtkrcv has to be set to output UTC for them to be.
+ */
+class RTKRCVReader
+{
+  public:
+    typedef enum
+    {
+        STATUS_NONE = 0,
+        STATUS_FIX,
+        STATUS_FLOAT,
+        STATUS_SBAS,
+        STATUS_DGPS,
+        STATUS_SINGLE,
+        STATUS_PPP,
+        STATUS_UNKNOWN
+    } Status;
+
+    typedef struct
+    {
+        Status status { STATUS_NONE };
+        // Degrees, north and east positive
+        double latitude { 0 };
+        double longitude { 0 };
+        // Meters above the ellipsoid
+        double elevation { 0 };
+        struct timespec time {};
+    } Solution;
+
+    // Longer lines are noise
+    static const size_t MAX_LINE = 512;
+    static const size_t BUFFER_SIZE = 4096;
+
+    /**
+     * @brief fill Append a single read from a non-blocking descriptor.
+     * @return The read() result, -1 with errno EAGAIN when there was nothing to read.
+     */
+    ssize_t fill(int fd);
+
+    /** @brief feed Append bytes from elsewhere, as much as fits. */
+    size_t feed(const char *data, size_t length);
+
+    /**
+     * @brief next Decode the next complete solution line.
+     * @return false once the buffer holds no more complete lines.
+     */
+    bool next(Solution *solution);
+
+    /** @brief reset Drop any buffered data, after the transport was reopened. */
+    void reset();
+
+    static const char *statusName(Status status);
+
+    // Statistics
+    uint64_t getSolutions() const
+    {
+        return solutions;
+    }
+    uint64_t getRejected() const
+    {
+        return rejected;
+    }
+
+  private:
+    // Room for the next read, after the partial line left over
+    void compact();
+    static bool decode(const char *line, Solution *solution);
+
+    char buffer[BUFFER_SIZE + 1];
+    size_t start { 0 };
+    size_t end { 0 };
+    // Bytes after start known to hold no line end
+    size_t scanned { 0 };
+    // Inside an overlong line, up to its end
+    bool discarding { false };
+
+    uint64_t solutions { 0 };
+    uint64_t rejected { 0 };
+};
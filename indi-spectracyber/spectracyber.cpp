@@ -23,9 +23,19 @@
 
     Format of BLOB data is:
 
+    Text (.ascii_cont, .ascii_spec), the default: one line per sample
+
     ########### ####### ########## ## ###
     Julian_Date Voltage Freqnuency RA DEC
 
+    Binary (.bin_cont, .bin_spec), on request: packed records of three doubles in host byte order
+
+    ########### ####### ##########
+    Julian_Date Voltage Freqnuency
+
+    Samples are batched into one BLOB per flush interval. A text stream with a flush
+    interval of zero sends every sample in its own BLOB.
+
 */
 
 #include "spectracyber.h"
@@ -36,6 +46,8 @@
 
 #include <libnova/julian_day.h>
 
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <stdlib.h>
 #include <string.h>
@@ -64,8 +76,13 @@ const unsigned int SPECTROMETER_OFFSET = 0x050;
 /* 90 Khz Rest Correction */
 const double SPECTROMETER_REST_CORRECTION = 0.090;
 
-static const char *contFMT = ".ascii_cont";
-static const char *specFMT = ".ascii_spec";
+/* A command and its reply, 9 bytes at 2400 baud */
+const int SPECTROMETER_EXCHANGE_US = 37500;
+
+static const char *contFMT    = ".ascii_cont";
+static const char *specFMT    = ".ascii_spec";
+static const char *contBinFMT = ".bin_cont";
+static const char *specBinFMT = ".bin_spec";
 
 // We declare an auto pointer to spectrometer.
 std::unique_ptr<SpectraCyber> spectracyber(new SpectraCyber());
@@ -168,8 +185,23 @@ bool SpectraCyber::initProperties()
     if (!DataStreamBP)
         LOG_ERROR("Error: BLOB data property is missing. Spectrometer cannot be operated.");
 
-    if (DataStreamBP)
-        DataStreamBP[0].setBlob((char *)malloc(MAXBLEN * sizeof(char)));
+    AcquisitionNP = getNumber("Acquisition");
+    if (!AcquisitionNP)
+        LOG_WARN("Acquisition property is missing. Using a settle time of 500 ms and a flush interval of 1 s.");
+    else
+    {
+        settleTime    = AcquisitionNP[0].getValue();
+        flushInterval = AcquisitionNP[1].getValue();
+    }
+
+    StreamFormatSP = getSwitch("Stream Format");
+    if (!StreamFormatSP)
+        LOG_WARN("Stream format property is missing. Using the text stream.");
+    else
+        textStream = StreamFormatSP[1].getState() == ISS_ON;
+
+    if (FreqNP)
+        min_freq = FreqNP[0].getMin();
 
     /**************************************************************************/
     // Equatorial Coords - SET
@@ -250,6 +282,8 @@ bool SpectraCyber::init_spectrometer()
 *****************************************************************/
 bool SpectraCyber::Disconnect()
 {
+    stop_acquisition();
+
     tty_disconnect(fd);
 
     return true;
@@ -272,6 +306,20 @@ bool SpectraCyber::ISNewNumber(const char *dev, const char *name, double values[
     if (!nProp)
         return false;
 
+    // Acquisition options, also set from the configuration before connecting
+    if (nProp.isNameMatch("Acquisition"))
+    {
+        if (!nProp.update(values, names, n))
+            return false;
+
+        settleTime    = nProp[0].getValue();
+        flushInterval = nProp[1].getValue();
+
+        nProp.setState(IPS_OK);
+        nProp.apply();
+        return true;
+    }
+
     if (isConnected() == false)
     {
         resetProperties();
@@ -342,7 +390,16 @@ bool SpectraCyber::ISNewNumber(const char *dev, const char *name, double values[
 
     // Freq Change
     if (nProp.isNameMatch("Freq (Mhz)"))
+    {
+        // The acquisition thread owns the receiver frequency during a scan
+        if (ScanSP.getState() == IPS_BUSY)
+        {
+            nProp.apply("Stop the scan before changing the frequency.");
+            return false;
+        }
+
         return update_freq(values[0]);
+    }
 
     // Scan Options
     if (nProp.isNameMatch("Scan Parameters"))
@@ -426,6 +483,19 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
     if (!sProp)
         return false;
 
+    // Stream format, also set from the configuration before connecting
+    if (sProp.isNameMatch("Stream Format"))
+    {
+        if (!sProp.update(states, names, n))
+            return false;
+
+        textStream = sProp[1].getState() == ISS_ON;
+
+        sProp.setState(IPS_OK);
+        sProp.apply();
+        return true;
+    }
+
     if (isConnected() == false)
     {
         resetProperties();
@@ -446,6 +516,12 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
         {
             if (sProp.getState() == IPS_BUSY)
             {
+                stop_acquisition();
+                flush_samples(true);
+
+                if (scan_channel == SPECTRAL_CHANNEL)
+                    FreqNP[0].setValue(scanFreq);
+
                 sProp.setState(IPS_IDLE);
                 FreqNP.setState(IPS_IDLE);
                 DataStreamBP.setState(IPS_IDLE);
@@ -464,8 +540,10 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
         sProp.setState(IPS_BUSY);
         DataStreamBP.setState(IPS_BUSY);
 
+        scan_channel = ChannelSP.findOnSwitchIndex();
+
         // Compute starting freq  = base_freq - low
-        if (sProp[SPEC_CHANNEL].getState() == ISS_ON)
+        if (scan_channel == SPECTRAL_CHANNEL)
         {
             start_freq  = (SPECTROMETER_RF_FREQ + SPECTROMETER_REST_FREQ) - abs((int)ScanNP[0].getValue()) / 1000.;
             target_freq = (SPECTROMETER_RF_FREQ + SPECTROMETER_REST_FREQ) + abs((int)ScanNP[1].getValue()) / 1000.;
@@ -477,8 +555,12 @@ bool SpectraCyber::ISNewSwitch(const char *dev, const char *name, ISState *state
                         target_freq, sample_rate);
         }
         else
+        {
+            start_freq = target_freq = FreqNP[0].getValue();
             sProp.apply("Starting continuum scan @ %g MHz...", FreqNP[0].getValue());
+        }
 
+        start_acquisition();
         return true;
     }
 
@@ -646,6 +728,8 @@ bool SpectraCyber::dispatch_command(SpectrometerCommand command_type)
     // Maximum of 3 hex digits in addition to null terminator
     char hex[5];
 
+    std::lock_guard<std::recursive_mutex> lock(portMutex);
+
     tcflush(fd, TCIOFLUSH);
 
     switch (command_type)
@@ -761,13 +845,14 @@ bool SpectraCyber::dispatch_command(SpectrometerCommand command_type)
             // e.g. To set 50.00 Mhz, diff = 50 - 46.4 = 3.6 / 0.005 = 800 = 320h
             //      Freq = 320h + 050h (or 800 + 80) = 370h = 880 decimal
 
-            final_value = (int)((FreqNP[0].getValue() + SPECTROMETER_REST_CORRECTION - FreqNP[0].getMin()) / 0.005 +
-                                SPECTROMETER_OFFSET);
+            // Rounded, truncation lands on the channel below for most frequencies
+            final_value = (int)lround((tune_freq + SPECTROMETER_REST_CORRECTION - min_freq) / 0.005 +
+                                      SPECTROMETER_OFFSET);
             sprintf(hex, "%03X", (uint32_t)final_value);
             if (isDebug())
                 IDLog("Required Freq is: %.3f --- Min Freq is: %.3f --- Spec Offset is: %d -- Final Value (Dec): %d "
                       "--- Final Value (Hex): %s\n",
-                      FreqNP[0].getValue(), FreqNP[0].getMin(), SPECTROMETER_OFFSET, final_value, hex);
+                      tune_freq, min_freq, SPECTROMETER_OFFSET, final_value, hex);
             command[2] = hex[0];
             command[3] = hex[1];
             command[4] = hex[2];
@@ -779,7 +864,7 @@ bool SpectraCyber::dispatch_command(SpectrometerCommand command_type)
             command[1]  = 'D';
             command[2]  = '0';
             command[3]  = '0';
-            final_value = ChannelSP.findOnSwitchIndex();
+            final_value = scan_channel;
             command[4]  = (final_value == 0) ? '0' : '1';
             break;
         }
@@ -826,6 +911,9 @@ bool SpectraCyber::dispatch_command(SpectrometerCommand command_type)
         return false;
     }
 
+    // The next command flushes the port, let this one leave first
+    tcdrain(fd);
+
     return true;
 }
 
@@ -847,7 +935,14 @@ bool SpectraCyber::update_freq(double nFreq)
 
     FreqNP[0].setValue(nFreq);
 
-    if (dispatch_command(RECV_FREQ) == false)
+    bool tuned;
+    {
+        std::lock_guard<std::recursive_mutex> lock(portMutex);
+        tune_freq = nFreq;
+        tuned     = dispatch_command(RECV_FREQ);
+    }
+
+    if (tuned == false)
     {
         FreqNP[0].setValue(last_value);
         FreqNP.setState(IPS_ALERT);
@@ -874,6 +969,8 @@ bool SpectraCyber::reset()
     if (isDebug())
         IDLog("Attempting to write to spectrometer....\n");
 
+    std::lock_guard<std::recursive_mutex> lock(portMutex);
+
     dispatch_command(RESET);
 
     if (isDebug())
@@ -911,117 +1008,254 @@ void SpectraCyber::TimerHit()
     if (!isConnected())
         return;
 
-    char RAStr[16], DecStr[16];
+    uint32_t period = getCurrentPollingPeriod();
 
-    switch (ScanSP.getState())
+    if (ScanSP.getState() == IPS_BUSY)
     {
-        case IPS_BUSY:
-            if (ChannelSP[CONT_CHANNEL].getState() == ISS_ON)
-                break;
+        if (scanFailed)
+        {
+            abort_scan();
 
-            if (FreqNP[0].getValue() >= target_freq)
-            {
-                ScanSP.setState(IPS_OK);
-                FreqNP.setState(IPS_OK);
+            DataStreamBP.setState(IPS_ALERT);
+            DataStreamBP.apply();
+        }
+        else if (scanComplete)
+        {
+            stop_acquisition();
+            flush_samples(true);
 
-                FreqNP.apply();
-                ScanSP.apply("Scan complete.");
-                SetTimer(getCurrentPollingPeriod());
-                return;
-            }
+            FreqNP[0].setValue(scanFreq);
+            ScanSP.setState(IPS_OK);
+            FreqNP.setState(IPS_OK);
+            DataStreamBP.setState(IPS_IDLE);
 
-            if (update_freq(FreqNP[0].getValue()) == false)
+            FreqNP.apply();
+            DataStreamBP.apply();
+            ScanSP.apply("Scan complete.");
+        }
+        else
+        {
+            flush_samples(false);
+
+            if (scan_channel == SPECTRAL_CHANNEL)
             {
-                abort_scan();
-                SetTimer(getCurrentPollingPeriod());
-                return;
+                FreqNP[0].setValue(scanFreq);
+                FreqNP.apply();
             }
 
-            FreqNP[0].setValue(FreqNP[0].getValue() +  sample_rate / 1000.);
-            break;
+            // Do not let a long polling period hold back the flushes
+            if (flushInterval > 0)
+                period = std::min<uint32_t>(period, flushInterval);
+        }
+    }
 
-        default:
-            break;
+    SetTimer(period);
+}
+
+void SpectraCyber::abort_scan()
+{
+    stop_acquisition();
+    flush_samples(true);
+
+    if (scan_channel == SPECTRAL_CHANNEL)
+        FreqNP[0].setValue(scanFreq);
+
+    FreqNP.setState(IPS_IDLE);
+    ScanSP.setState(IPS_ALERT);
+    DataStreamBP.setState(IPS_IDLE);
+
+    ScanSP.reset();
+    ScanSP[1].setState(ISS_ON);
+
+    FreqNP.apply();
+    DataStreamBP.apply();
+    ScanSP.apply("Scan aborted due to errors.");
+}
+
+void SpectraCyber::start_acquisition()
+{
+    stop_acquisition();
+
+    {
+        std::lock_guard<std::mutex> lock(samplesMutex);
+        samples.clear();
     }
 
-    switch (DataStreamBP.getState())
+    scanComplete = false;
+    scanFailed   = false;
+    scanFreq     = start_freq;
+    lastFlush    = std::chrono::steady_clock::now();
+    acquiring    = true;
+
+    acquisitionThread = std::thread(&SpectraCyber::acquisition_loop, this);
+}
+
+void SpectraCyber::stop_acquisition()
+{
+    acquiring = false;
+
+    if (acquisitionThread.joinable())
+        acquisitionThread.join();
+}
+
+/****************************************************************
+** Steps and samples as fast as the serial link and the settle
+** time allow. Only the port and the sample buffer are shared with
+** the main thread, the properties are published by TimerHit.
+*****************************************************************/
+void SpectraCyber::acquisition_loop()
+{
+    bool spectral = (scan_channel == SPECTRAL_CHANNEL);
+    double step   = sample_rate / 1000.;
+    double freq   = start_freq;
+
+    while (acquiring)
     {
-        case IPS_BUSY: {
-            if (ScanSP.getState() != IPS_BUSY)
+        if (spectral)
+        {
+            // Half a step of slack so rounding does not skip the last channel
+            if (freq > target_freq + step / 2)
             {
-                DataStreamBP.setState(IPS_IDLE);
-                DataStreamBP.apply();
-                break;
+                scanComplete = true;
+                return;
             }
 
-            if (read_channel() == false)
+            bool tuned;
             {
-                DataStreamBP.setState(IPS_ALERT);
-
-                if (ScanSP.getState() == IPS_BUSY)
-                    abort_scan();
-
-                DataStreamBP.apply();
+                std::lock_guard<std::recursive_mutex> lock(portMutex);
+                tune_freq = freq;
+                tuned     = dispatch_command(RECV_FREQ);
             }
 
-            JD = ln_get_julian_from_sys();
+            if (tuned == false)
+            {
+                LOG_ERROR("Error dispatching RECV FREQ command to spectrometer. Check logs.");
+                scanFailed = true;
+                return;
+            }
 
-            // Continuum
-            if (ChannelSP[0].getState() == ISS_ON)
-                DataStreamBP[0].setFormat(contFMT);
-            else
-                DataStreamBP[0].setFormat(specFMT);
+            scanFreq = freq;
 
-            fs_sexa(RAStr, EquatorialCoordsRN[0].value, 2, 3600);
-            fs_sexa(DecStr, EquatorialCoordsRN[1].value, 2, 3600);
+            // Let the integrator settle on the new channel, in short naps so a stop is not held up
+            for (int left = settleTime; left > 0 && acquiring; left -= 50)
+                usleep(std::min(left, 50) * 1000);
 
-            if (telescopeID && strlen(telescopeID->text) > 0)
-                snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f %s %s", JD, chanValue, FreqNP[0].getValue(), RAStr, DecStr);
-            else
-                snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f", JD, chanValue, FreqNP[0].getValue());
+            if (!acquiring)
+                return;
+        }
 
-            auto bLineSize = strlen(bLine);
-            DataStreamBP[0].setBlobLen(bLineSize);
-            DataStreamBP[0].setSize(bLineSize);
-            memcpy(DataStreamBP[0].getBlob(), bLine, bLineSize);
+        ScanSample sample;
 
-            //IDLog("\nSTRLEN: %d -- BLOB:'%s'\n", strlen(bLine), (char *) DataStreamBP->bp[0].blob);
+        if (read_channel(&sample.value) == false)
+        {
+            LOG_ERROR("Error reading channel value from spectrometer. Check logs.");
+            scanFailed = true;
+            return;
+        }
 
-            DataStreamBP.apply();
+        sample.JD   = ln_get_julian_from_sys();
+        sample.freq = freq;
 
-            break;
+        {
+            std::lock_guard<std::mutex> lock(samplesMutex);
+            samples.push_back(sample);
         }
-        default:
-            break;
-    }
 
-    SetTimer(getCurrentPollingPeriod());
+        if (spectral)
+            freq += step;
+    }
 }
 
-void SpectraCyber::abort_scan()
+/****************************************************************
+** Publish the samples acquired since the last flush, once the
+** flush interval elapsed or right away if forced.
+*****************************************************************/
+void SpectraCyber::flush_samples(bool force)
 {
-    FreqNP.setState(IPS_IDLE);
-    ScanSP.setState(IPS_ALERT);
+    auto now = std::chrono::steady_clock::now();
 
-    ScanSP.reset();
-    ScanSP[1].setState(ISS_ON);
+    if (!force && flushInterval > 0 && now - lastFlush < std::chrono::milliseconds(flushInterval))
+        return;
 
-    FreqNP.apply();
-    ScanSP.apply("Scan aborted due to errors.");
+    flushed.clear();
+    {
+        std::lock_guard<std::mutex> lock(samplesMutex);
+        flushed.swap(samples);
+    }
+
+    if (flushed.empty())
+        return;
+
+    lastFlush = now;
+
+    bool continuum = (scan_channel == CONTINUUM_CHANNEL);
+
+    auto publish = [this]()
+    {
+        DataStreamBP[0].setBlob(blobData.data());
+        DataStreamBP[0].setBlobLen(blobData.size());
+        DataStreamBP[0].setSize(blobData.size());
+        DataStreamBP.apply();
+    };
+
+    if (!textStream)
+    {
+        DataStreamBP[0].setFormat(continuum ? contBinFMT : specBinFMT);
+
+        blobData.resize(flushed.size() * sizeof(ScanSample));
+        memcpy(blobData.data(), flushed.data(), blobData.size());
+        publish();
+        return;
+    }
+
+    DataStreamBP[0].setFormat(continuum ? contFMT : specFMT);
+
+    char RAStr[16], DecStr[16];
+    bool pointing = telescopeID && strlen(telescopeID->text) > 0;
+
+    fs_sexa(RAStr, EquatorialCoordsRN[0].value, 2, 3600);
+    fs_sexa(DecStr, EquatorialCoordsRN[1].value, 2, 3600);
+
+    blobData.clear();
+    for (const ScanSample &sample : flushed)
+    {
+        if (pointing)
+            snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f %s %s", sample.JD, sample.value, sample.freq, RAStr, DecStr);
+        else
+            snprintf(bLine, MAXBLEN, "%.8f %.3f %.3f", sample.JD, sample.value, sample.freq);
+
+        // One line per BLOB, as before batching
+        if (flushInterval == 0)
+        {
+            blobData.assign(bLine, bLine + strlen(bLine));
+            publish();
+            continue;
+        }
+
+        if (!blobData.empty())
+            blobData.push_back('\n');
+        blobData.insert(blobData.end(), bLine, bLine + strlen(bLine));
+    }
+
+    if (flushInterval > 0)
+        publish();
 }
 
-bool SpectraCyber::read_channel()
+bool SpectraCyber::read_channel(double *value)
 {
     int err_code = 0, nbytes_read = 0;
-    char response[SPECTROMETER_CMD_REPLY];
+    char response[SPECTROMETER_CMD_REPLY + 1] = {0};
     char err_msg[SPECTROMETER_ERROR_BUFFER];
 
     if (isSimulation())
     {
-        chanValue = ((double)rand()) / ((double)RAND_MAX) * 10.0;
+        usleep(SPECTROMETER_EXCHANGE_US);
+        *value = ((double)rand()) / ((double)RAND_MAX) * 10.0;
         return true;
     }
 
+    std::lock_guard<std::recursive_mutex> lock(portMutex);
+
     dispatch_command(READ_CHANNEL);
     if ((err_code = tty_read(fd, response, SPECTROMETER_CMD_REPLY, 5, &nbytes_read)) != TTY_OK)
     {
@@ -1037,7 +1271,19 @@ bool SpectraCyber::read_channel()
     int result = 0;
     sscanf(response, "D%x", &result);
     // We divide by 409.5 to scale the value to 0 - 10 VDC range
-    chanValue = result / 409.5;
+    *value = result / 409.5;
+
+    return true;
+}
+
+bool SpectraCyber::saveConfigItems(FILE *fp)
+{
+    INDI::DefaultDevice::saveConfigItems(fp);
+
+    if (AcquisitionNP)
+        AcquisitionNP.save(fp);
+    if (StreamFormatSP)
+        StreamFormatSP.save(fp);
 
     return true;
 }
@@ -28,7 +28,12 @@
 
 #include <defaultdevice.h>
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 #define MAXBLEN 64
 
@@ -81,6 +86,7 @@ class SpectraCyber : public INDI::DefaultDevice
     virtual bool Connect() override;
     virtual bool Disconnect() override;
     virtual void TimerHit() override;
+    virtual bool saveConfigItems(FILE *fp) override;
 
     //void reset_all_properties(bool reset_to_idle=false);
     bool update_freq(double nFreq);
@@ -91,6 +97,8 @@ class SpectraCyber : public INDI::DefaultDevice
     INDI::PropertySwitch ScanSP       {INDI::Property()};
     INDI::PropertySwitch ChannelSP    {INDI::Property()};
     INDI::PropertyBlob   DataStreamBP {INDI::Property()};
+    INDI::PropertyNumber AcquisitionNP {INDI::Property()};
+    INDI::PropertySwitch StreamFormatSP {INDI::Property()};
     IText *telescopeID;
 
     // Snooping On
@@ -101,11 +109,25 @@ class SpectraCyber : public INDI::DefaultDevice
     virtual bool initProperties() override;
     bool init_spectrometer();
     void abort_scan();
-    bool read_channel();
+    bool read_channel(double *value);
     bool dispatch_command(SpectrometerCommand command);
     int get_on_switch(ISwitchVectorProperty *sp);
     bool reset();
 
+    // Scan acquisition
+    void start_acquisition();
+    void stop_acquisition();
+    void acquisition_loop();
+    void flush_samples(bool force);
+
+    // Binary stream record, host byte order
+    typedef struct
+    {
+        double JD;
+        double value;
+        double freq;
+    } ScanSample;
+
     // Variables
     std::string type_name;
     std::string default_port;
@@ -113,5 +135,30 @@ class SpectraCyber : public INDI::DefaultDevice
     int fd;
     char bLine[MAXBLEN];
     char command[5];
-    double start_freq, target_freq, sample_rate, JD, chanValue;
+    double start_freq, target_freq, sample_rate;
+
+    // Frequency encoded by RECV_FREQ and channel read by READ_CHANNEL, so the
+    // acquisition thread never reads the properties
+    double tune_freq { 0 };
+    double min_freq { 0 };
+    int scan_channel { CONTINUUM_CHANNEL };
+
+    // Serializes the command/reply exchanges of both threads
+    std::recursive_mutex portMutex;
+
+    std::thread acquisitionThread;
+    std::atomic<bool> acquiring { false };
+    std::atomic<bool> scanComplete { false };
+    std::atomic<bool> scanFailed { false };
+    std::atomic<double> scanFreq { 0 };
+    std::atomic<int> settleTime { 500 };
+    int flushInterval { 1000 };
+    bool textStream { true };
+
+    // Samples waiting for the next flush
+    std::mutex samplesMutex;
+    std::vector<ScanSample> samples;
+    std::vector<ScanSample> flushed;
+    std::vector<char> blobData;
+    std::chrono::steady_clock::time_point lastFlush;
 };
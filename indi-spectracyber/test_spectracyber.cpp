@@ -0,0 +1,353 @@
+/*
+    Kuwait National Radio Observatory
+    INDI Driver for SpectraCyber Hydrogen Line Spectrometer
+    Communication: RS232 <---> USB
+
+    Copyright (C) 2009 Jasem Mutlaq (mutlaqja@ikarustech.com)
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Scan acquisition against a spectrometer stub on a pty. The stub answers the
+    reset, tune and read commands, with a hydrogen line profile on the spectral
+    channel and a flat continuum.
+*/
+
+#include "spectracyber.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Minimum of the "Freq (Mhz)" property, the frequency of tuning code 050h
+static const double STUB_MIN_FREQ = 1418.205;
+static const double STUB_CONTINUUM = 0.25;
+
+static double lineProfile(double freq)
+{
+    return 0.1 + 0.8 * exp(-pow((freq - 1420.405) / 0.05, 2));
+}
+
+// Voltage read by the driver for a level, after the 12 bit conversion
+static double readVoltage(double level)
+{
+    return lround(level * 4095) / 409.5;
+}
+
+// Spectrometer served on the master side of a pty pair, one five byte command at a time
+class SpectraCyberPtyStub
+{
+    public:
+        SpectraCyberPtyStub()
+        {
+            master = posix_openpt(O_RDWR | O_NOCTTY);
+            if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+                return;
+            // Held open so the master never sees a hangup between connections
+            slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+            if (slave < 0)
+                return;
+
+            struct termios tio;
+            tcgetattr(slave, &tio);
+            cfmakeraw(&tio);
+            tcsetattr(slave, TCSANOW, &tio);
+
+            port = ptsname(master);
+            server = std::thread(&SpectraCyberPtyStub::serve, this);
+        }
+
+        ~SpectraCyberPtyStub()
+        {
+            running = false;
+            if (server.joinable())
+                server.join();
+            if (slave >= 0)
+                close(slave);
+            if (master >= 0)
+                close(master);
+        }
+
+        std::string port;
+        std::atomic<int> commands { 0 };
+
+    private:
+        void serve()
+        {
+            std::string rx;
+            double freq = 1420.405;
+            while (running)
+            {
+                struct pollfd p = { master, POLLIN, 0 };
+                if (poll(&p, 1, 20) <= 0)
+                    continue;
+                char data[64];
+                int n = read(master, data, sizeof(data));
+                if (n <= 0)
+                    continue;
+                rx.append(data, n);
+
+                size_t start;
+                while ((start = rx.find('!')) != std::string::npos && rx.size() - start >= 5)
+                {
+                    std::string command = rx.substr(start, 5);
+                    rx.erase(0, start + 5);
+                    commands++;
+
+                    switch (command[1])
+                    {
+                        case 'R':
+                            write(master, "R000", 4);
+                            break;
+                        case 'F':
+                            freq = (strtol(command.substr(2).c_str(), nullptr, 16) - 0x50) * 0.005 + STUB_MIN_FREQ - 0.090;
+                            break;
+                        case 'D':
+                        {
+                            double level = command[4] == '1' ? lineProfile(freq) : STUB_CONTINUUM;
+                            char reply[8];
+                            snprintf(reply, sizeof(reply), "D%03X", (int)lround(level * 4095));
+                            // Four bytes back at 2400 baud
+                            usleep(16667);
+                            write(master, reply, 4);
+                            break;
+                        }
+                        default:
+                            break;
+                    }
+                }
+            }
+        }
+
+        int master { -1 };
+        int slave { -1 };
+        std::atomic<bool> running { true };
+        std::thread server;
+};
+
+// Exposes the timer, the main loop is driven by the tests
+class TestSpectraCyber : public SpectraCyber
+{
+    public:
+        using SpectraCyber::TimerHit;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+class SpectraCyberTest : public ::testing::Test
+{
+    protected:
+        void SetUp() override
+        {
+            ASSERT_FALSE(stub.port.empty());
+            device.ISGetProperties(nullptr);
+            setText("DEVICE_PORT", "PORT", stub.port.c_str());
+            // A flush on a pty also drops what the stub has not read yet, unlike a UART after a
+            // drain, so the stub gets a moment to take the tuning command
+            setNumber("Acquisition", "Settle (ms)", 20);
+            setNumber("Acquisition", "Flush (ms)", 60000);
+            setSwitch("CONNECTION", "CONNECT");
+            ASSERT_TRUE(device.isConnected());
+            // 11 channels of 20 Khz around the line
+            setNumber("Scan Parameters", "Low (Khz)", -100);
+            setNumber("Scan Parameters", "High (Khz)", 100);
+            setNumber("Scan Parameters", "Step (5 Khz)", 4);
+        }
+
+        void TearDown() override
+        {
+            setSwitch("CONNECTION", "DISCONNECT");
+        }
+
+        void setText(const char *property, const char *name, const char *value)
+        {
+            char *names[1] = { const_cast<char *>(name) };
+            char *texts[1] = { const_cast<char *>(value) };
+            device.ISNewText(device.getDeviceName(), property, texts, names, 1);
+        }
+
+        void setNumber(const char *property, const char *name, double value)
+        {
+            char *names[1] = { const_cast<char *>(name) };
+            double values[1] = { value };
+            device.ISNewNumber(device.getDeviceName(), property, values, names, 1);
+        }
+
+        void setSwitch(const char *property, const char *name)
+        {
+            char *names[1] = { const_cast<char *>(name) };
+            ISState states[1] = { ISS_ON };
+            device.ISNewSwitch(device.getDeviceName(), property, states, names, 1);
+        }
+
+        IPState scanState()
+        {
+            return device.getSwitch("Scan").getState();
+        }
+
+        // Fires the timer until the scan is over or the time is up, the last BLOB sent is kept
+        void runScan(double seconds)
+        {
+            auto start = Clock::now();
+            while (scanState() == IPS_BUSY &&
+                    std::chrono::duration<double>(Clock::now() - start).count() < seconds)
+            {
+                usleep(20000);
+                device.TimerHit();
+            }
+        }
+
+        std::string blob()
+        {
+            auto data = device.getBLOB("Data");
+            return std::string(static_cast<const char *>(data[0].getBlob()), data[0].getBlobLen());
+        }
+
+        std::string blobFormat()
+        {
+            return device.getBLOB("Data")[0].getFormat();
+        }
+
+        SpectraCyberPtyStub stub;
+        TestSpectraCyber device;
+};
+
+TEST_F(SpectraCyberTest, text_stream_by_default)
+{
+    auto format = device.getSwitch("Stream Format");
+    ASSERT_TRUE(format);
+    EXPECT_EQ(format.findWidgetByName("Text")->getState(), ISS_ON);
+    EXPECT_EQ(format.findWidgetByName("Binary")->getState(), ISS_OFF);
+
+    setSwitch("Channels", "Spectral");
+    setSwitch("Scan", "Start");
+    runScan(10);
+    ASSERT_EQ(scanState(), IPS_OK);
+
+    // One batched BLOB, one line per channel
+    EXPECT_EQ(blobFormat(), ".ascii_spec");
+    std::istringstream lines(blob());
+    std::string line;
+    int channel = 0;
+    while (std::getline(lines, line))
+    {
+        double jd = 0, value = 0, freq = 0;
+        ASSERT_EQ(sscanf(line.c_str(), "%lf %lf %lf", &jd, &value, &freq), 3) << line;
+        EXPECT_NEAR(freq, 1420.305 + 0.02 * channel, 1e-3);
+        EXPECT_NEAR(value, readVoltage(lineProfile(1420.305 + 0.02 * channel)), 1e-3);
+        EXPECT_GT(jd, 2451545.0);
+        channel++;
+    }
+    EXPECT_EQ(channel, 11);
+}
+
+TEST_F(SpectraCyberTest, binary_stream_on_request)
+{
+    setSwitch("Stream Format", "Binary");
+    setSwitch("Channels", "Spectral");
+    setSwitch("Scan", "Start");
+    runScan(10);
+    ASSERT_EQ(scanState(), IPS_OK);
+
+    // Julian date, voltage and frequency of each channel
+    EXPECT_EQ(blobFormat(), ".bin_spec");
+    std::string data = blob();
+    ASSERT_EQ(data.size(), 11 * 3 * sizeof(double));
+    std::vector<double> records(data.size() / sizeof(double));
+    memcpy(records.data(), data.data(), data.size());
+    for (size_t channel = 0; channel < 11; channel++)
+    {
+        double freq = 1420.305 + 0.02 * channel;
+        EXPECT_NEAR(records[channel * 3 + 2], freq, 1e-6);
+        EXPECT_NEAR(records[channel * 3 + 1], readVoltage(lineProfile(freq)), 1e-6);
+        if (channel > 0)
+        {
+            EXPECT_GE(records[channel * 3], records[channel * 3 - 3]);
+        }
+    }
+}
+
+TEST_F(SpectraCyberTest, unbatched_text_stream)
+{
+    // A line per BLOB, as the stream was before batching
+    setNumber("Acquisition", "Flush (ms)", 0);
+    setSwitch("Channels", "Continuum");
+    setSwitch("Scan", "Start");
+    runScan(0.5);
+    EXPECT_EQ(scanState(), IPS_BUSY);
+    setSwitch("Scan", "Stop");
+    EXPECT_EQ(scanState(), IPS_IDLE);
+
+    EXPECT_EQ(blobFormat(), ".ascii_cont");
+    std::string line = blob();
+    EXPECT_EQ(line.find('\n'), std::string::npos);
+    double jd = 0, value = 0, freq = 0;
+    ASSERT_EQ(sscanf(line.c_str(), "%lf %lf %lf", &jd, &value, &freq), 3) << line;
+    EXPECT_NEAR(value, readVoltage(STUB_CONTINUUM), 1e-3);
+    EXPECT_NEAR(freq, 1420.405, 1e-3);
+}
+
+TEST_F(SpectraCyberTest, stop_during_settle)
+{
+    setNumber("Acquisition", "Settle (ms)", 5000);
+    setSwitch("Channels", "Spectral");
+    setSwitch("Scan", "Start");
+    runScan(0.3);
+
+    auto start = Clock::now();
+    setSwitch("Scan", "Stop");
+    EXPECT_LT(std::chrono::duration<double>(Clock::now() - start).count(), 0.5);
+    EXPECT_EQ(scanState(), IPS_IDLE);
+}
+
+TEST_F(SpectraCyberTest, channel_change_aborts_scan)
+{
+    setNumber("Acquisition", "Settle (ms)", 100);
+    setSwitch("Channels", "Spectral");
+    setSwitch("Scan", "Start");
+    runScan(0.3);
+    setSwitch("Channels", "Continuum");
+    EXPECT_EQ(scanState(), IPS_ALERT);
+
+    // The receiver frequency belongs to the scan while it runs
+    setSwitch("Channels", "Spectral");
+    setSwitch("Scan", "Start");
+    double before = device.getNumber("Freq (Mhz)")[0].getValue();
+    setNumber("Freq (Mhz)", "Value", 1420.0);
+    EXPECT_DOUBLE_EQ(device.getNumber("Freq (Mhz)")[0].getValue(), before);
+    setSwitch("Scan", "Stop");
+}
+
+int main(int argc, char **argv)
+{
+    INDI::Logger::getInstance().configure("", INDI::Logger::file_off,
+                                          INDI::Logger::DBG_ERROR, INDI::Logger::DBG_ERROR);
+    ::testing::InitGoogleTest(&argc, argv);
+
+    me = strdup("indi_spectracyber");
+
+    return RUN_ALL_TESTS();
+}
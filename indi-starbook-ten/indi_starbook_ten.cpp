@@ -1,6 +1,7 @@
 #include "indicom.h"
 #include "indi_starbook_ten.h"
 #include "config.h"
+#include <algorithm>
 
 #define MOUNT_TAB "Mount"
 
@@ -167,6 +168,14 @@ INDIStarbookTen::initProperties()
     IUFillSwitchVector(&HomeSP, HomeS, HS_LAST, getDeviceName(), "TELESCOPE_HOME", "Homing", MAIN_CONTROL_TAB, IP_RW, ISR_ATMOST1, 60,
                        IPS_IDLE);
 
+    IUFillNumber(&PollLatencyN[PL_LAST_POLL], "LAST_POLL", "Last poll (ms)", "%.1f", 0, 1e6, 0, 0);
+    IUFillNumber(&PollLatencyN[PL_AVERAGE], "AVERAGE", "Avg request (ms)", "%.1f", 0, 1e6, 0, 0);
+    IUFillNumber(&PollLatencyN[PL_MAX], "MAX", "Max request (ms)", "%.1f", 0, 1e6, 0, 0);
+    IUFillNumber(&PollLatencyN[PL_REQUESTS], "REQUESTS", "Requests", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumber(&PollLatencyN[PL_FAILURES], "FAILURES", "Failures", "%.0f", 0, 1e9, 0, 0);
+    IUFillNumberVector(&PollLatencyNP, PollLatencyN, PL_LAST, getDeviceName(), "POLL_LATENCY",
+                       "Poll Latency", MOUNT_TAB, IP_RO, 60, IPS_IDLE);
+
     GI::initProperties(GUIDE_TAB);
 
     setDriverInterface(getDriverInterface() | GUIDER_INTERFACE);
@@ -189,6 +198,7 @@ INDIStarbookTen::updateProperties()
         defineProperty(&StateTP);
         defineProperty(&GuideRateNP);
         defineProperty(&HomeSP);
+        defineProperty(&PollLatencyNP);
 
         return fetchStartupInfo();
     }
@@ -198,6 +208,7 @@ INDIStarbookTen::updateProperties()
         deleteProperty(StateTP.name);
         deleteProperty(GuideRateNP.name);
         deleteProperty(HomeSP.name);
+        deleteProperty(PollLatencyNP.name);
 
         return true;
     }
@@ -294,6 +305,9 @@ INDIStarbookTen::Handshake()
 {
     auto http = httpConnection->getClient();
     starbook->setHttpClient(http);
+    starbook->openSessions(httpConnection->host());
+    starbook->resetEndpointStats();
+    statsTimer.start();
 
     try
     {
@@ -309,6 +323,44 @@ INDIStarbookTen::Handshake()
 }
 
 
+bool
+INDIStarbookTen::Disconnect()
+{
+    publishEndpointStats();
+    starbook->closeSessions();
+    return INDI::Telescope::Disconnect();
+}
+
+
+void
+INDIStarbookTen::publishEndpointStats()
+{
+    StarbookTen::EndpointStats total;
+
+    for (const auto &it : starbook->getEndpointStats())
+    {
+        DEBUGF(DBG_SCOPE, "%s: %llu requests, %llu failed, avg %.1f ms, max %.1f ms", it.first.c_str(),
+               static_cast<unsigned long long>(it.second.requests), static_cast<unsigned long long>(it.second.failures),
+               it.second.averageMS(), it.second.maxMS);
+
+        total.requests += it.second.requests;
+        total.failures += it.second.failures;
+        total.totalMS  += it.second.totalMS;
+        total.maxMS     = std::max(total.maxMS, it.second.maxMS);
+    }
+
+    PollLatencyN[PL_AVERAGE].value  = total.averageMS();
+    PollLatencyN[PL_MAX].value      = total.maxMS;
+    PollLatencyN[PL_REQUESTS].value = total.requests;
+    PollLatencyN[PL_FAILURES].value = total.failures;
+    PollLatencyNP.s = total.failures ? IPS_ALERT : IPS_OK;
+    IDSetNumber(&PollLatencyNP, nullptr);
+
+    starbook->resetEndpointStats();
+    statsTimer.start();
+}
+
+
 bool
 INDIStarbookTen::updateStarbookState(StarbookTen::MountStatus &stat)
 {
@@ -372,10 +424,18 @@ INDIStarbookTen::fetchStartupInfo()
 bool
 INDIStarbookTen::ReadScopeStatus()
 {
+    if (statsTimer.elapsed() >= STATS_INTERVAL)
+        publishEndpointStats();
+
     try
     {
-        auto stat = retry<StarbookTen::MountStatus>(2, &StarbookTen::getStatus, starbook);
-        bool isTracking = retry<bool>(2, &StarbookTen::isTracking, starbook);
+        // Status, tracking, pier side and guiding are independent queries, sent concurrently
+        pollTimer.start();
+        auto poll = retry<StarbookTen::PollStatus>(2, &StarbookTen::pollStatus, starbook,
+                    isPropGuidingRA || isPropGuidingDE);
+        PollLatencyN[PL_LAST_POLL].value = pollTimer.elapsed();
+        auto &stat = poll.status;
+        bool isTracking = poll.tracking;
 
         updateStarbookState(stat);
 
@@ -412,21 +472,19 @@ INDIStarbookTen::ReadScopeStatus()
 
         NewRaDec(stat.ra, stat.dec);
 
-        auto ps = retry<StarbookTen::PierSide>(2, &StarbookTen::getPierSide, starbook);
-        setPierSide((ps == StarbookTen::PIERSIDE_EAST) ? INDI::Telescope::PIER_EAST : INDI::Telescope::PIER_WEST);
+        setPierSide((poll.pierside == StarbookTen::PIERSIDE_EAST) ? INDI::Telescope::PIER_EAST : INDI::Telescope::PIER_WEST);
 
         if (isPropGuidingRA || isPropGuidingDE)
         {
-            auto gs = retry<std::tuple<bool, bool> >(2, &StarbookTen::getGuidingRaDec, starbook);
-            LOGF_DEBUG("Prop guiding status: RA=%d, DEC=%d", !!(std::get<0>(gs)), !!(std::get<1>(gs)));
-            if (isPropGuidingRA && !std::get<0>(gs))
+            LOGF_DEBUG("Prop guiding status: RA=%d, DEC=%d", !!poll.guiding_ra, !!poll.guiding_dec);
+            if (isPropGuidingRA && !poll.guiding_ra)
             {
                 LOG_DEBUG("Prop guiding in RA finished");
                 isPropGuidingRA = false;
                 INDI::GuiderInterface::GuideComplete(AXIS_RA);
             }
 
-            if (isPropGuidingDE && !std::get<1>(gs))
+            if (isPropGuidingDE && !poll.guiding_dec)
             {
                 LOG_DEBUG("Prop guiding in DE finished");
                 isPropGuidingDE = false;
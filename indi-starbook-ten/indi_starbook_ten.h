@@ -3,6 +3,7 @@
 
 #include "inditelescope.h"
 #include "indiguiderinterface.h"
+#include "indielapsedtimer.h"
 #include "connectionhttp.h"
 #include "starbook_ten.h"
 
@@ -19,6 +20,7 @@ protected:
     virtual bool initProperties() override;
     virtual bool updateProperties() override;
     virtual bool Handshake() override;
+    virtual bool Disconnect() override;
     virtual bool saveConfigItems(FILE *fp) override;
 
     /***************************************************/
@@ -58,6 +60,7 @@ protected:
 private:
     bool fetchStartupInfo();
     bool updateStarbookState(StarbookTen::MountStatus& stat);
+    void publishEndpointStats();
 
     uint8_t DBG_SCOPE { INDI::Logger::DBG_IGNORE };
 
@@ -101,9 +104,27 @@ private:
     ISwitch HomeS[HS_LAST];
     ISwitchVectorProperty HomeSP;
 
+    /* Status poll latency, over the last STATS_INTERVAL */
+    enum {
+        PL_LAST_POLL,
+        PL_AVERAGE,
+        PL_MAX,
+        PL_REQUESTS,
+        PL_FAILURES,
+        PL_LAST
+    } PollLatencyProps;
+
+    INumber PollLatencyN[PL_LAST];
+    INumberVectorProperty PollLatencyNP;
+
     Connection::HTTP *httpConnection = nullptr;
 
     StarbookTen *starbook;
+
+    /* Endpoint latency is published and logged at this interval, in ms */
+    static const int STATS_INTERVAL = 10000;
+    INDI::ElapsedTimer statsTimer;
+    INDI::ElapsedTimer pollTimer;
 };
 
 #endif /* _INDI_STARBOOK_TEN_H_ */
@@ -1,8 +1,119 @@
 #include <regex>
+#include <chrono>
 #include <cmath>
+#include <cstring>
+#include <future>
 #include <stdio.h>
 #include "starbook_ten.h"
 
+/*
+ * Parsers for the status replies, which are polled every tick. They walk the
+ * body in place instead of running a regex over it.
+ */
+namespace {
+
+const char *
+after(const std::string &body, const char *key) {
+    size_t pos = body.find(key);
+    return (pos == std::string::npos) ? nullptr : body.c_str() + pos + strlen(key);
+}
+
+const char *
+skip(const char *p, const char *expected) {
+    size_t n = strlen(expected);
+    return (p && strncmp(p, expected, n) == 0) ? p + n : nullptr;
+}
+
+const char *
+parseFlag(const char *p, char max, int *value) {
+    if (!p || *p < '0' || *p > max)
+        return nullptr;
+
+    *value = *p - '0';
+    return p + 1;
+}
+
+const char *
+parseDouble(const char *p, double *value) {
+    if (!p)
+        return nullptr;
+
+    char *end;
+    *value = strtod(p, &end);
+    return (end == p) ? nullptr : end;
+}
+
+/* <!--RA=12.345&DEC=-1.234&GOTO=0&STATE=SCOPE--> */
+bool
+parseStatus(const std::string &body, StarbookTen::MountStatus *stat) {
+    int goto_busy;
+    const char *p = parseDouble(after(body, "<!--RA="), &stat->ra);
+    p = parseDouble(skip(p, "&DEC="), &stat->dec);
+    p = parseFlag(skip(p, "&GOTO="), '1', &goto_busy);
+    p = skip(p, "&STATE=");
+
+    if (!p)
+        return false;
+
+    size_t n = strspn(p, "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    if (n == 0 || strncmp(p + n, "-->", 3) != 0)
+        return false;
+
+    stat->goto_busy = goto_busy;
+    stat->state =
+        (n == 4 && strncmp(p, "USER", n) == 0)  ? StarbookTen::STATE_USER  :
+        (n == 5 && strncmp(p, "CHART", n) == 0) ? StarbookTen::STATE_CHART :
+        (n == 5 && strncmp(p, "SCOPE", n) == 0) ? StarbookTen::STATE_SCOPE : StarbookTen::STATE_INIT;
+
+    return true;
+}
+
+/* <!--TRACK=1--> */
+bool
+parseTrackStatus(const std::string &body, bool *tracking) {
+    int track;
+
+    // TRACK=2 seems to be used during gotos, but since we can already figure
+    // gotos out from the getstatus2 call, there's no need to handle it here.
+    if (!skip(parseFlag(after(body, "<!--TRACK="), '2', &track), "-->"))
+        return false;
+
+    *tracking = (track == 1);
+    return true;
+}
+
+/* PIERSIDE=1 */
+bool
+parsePierSide(const std::string &body, StarbookTen::PierSide *pierside) {
+    int side;
+
+    if (!parseFlag(after(body, "PIERSIDE="), '1', &side))
+        return false;
+
+    *pierside = static_cast<StarbookTen::PierSide>(side);
+    return true;
+}
+
+/* <!--RA+=0&RA-=0&DEC+=0&DEC-=0--> */
+bool
+parseGuideStatus(const std::string &body, bool *ra, bool *dec) {
+    int ra_p, ra_n, dec_p, dec_n;
+    const char *p = parseFlag(after(body, "<!--RA+="), '1', &ra_p);
+    p = parseFlag(skip(p, "&RA-="), '1', &ra_n);
+    p = parseFlag(skip(p, "&DEC+="), '1', &dec_p);
+    p = parseFlag(skip(p, "&DEC-="), '1', &dec_n);
+
+    if (!skip(p, "-->"))
+        return false;
+
+    *ra = ra_p || ra_n;
+    *dec = dec_p || dec_n;
+    return true;
+}
+
+}
+
+
 StarbookTen::StarbookTen(httplib::Client *http) : http(http) {
     setHttpClient(http);
 }
@@ -10,14 +121,8 @@ StarbookTen::StarbookTen(httplib::Client *http) : http(http) {
 
 StarbookTen::StarbookTen(const char *base_url) {
     http = new httplib::Client(base_url);
-
-    http->set_connection_timeout(2, 0);
-    http->set_read_timeout(3, 0);
-    http->set_write_timeout(3, 0);
-
-    http->set_keep_alive(true);
-
-    http->set_url_encode(false);
+    configureClient(http);
+    openSessions(base_url);
 
     destroyClient = true;
 }
@@ -30,31 +135,90 @@ StarbookTen::~StarbookTen() {
 
 
 void
-StarbookTen::setHttpClient(httplib::Client *http) {
-    if (http) {
-        http->set_connection_timeout(2, 0);
-        http->set_read_timeout(3, 0);
-        http->set_write_timeout(3, 0);
+StarbookTen::configureClient(httplib::Client *client) {
+    client->set_connection_timeout(2, 0);
+    client->set_read_timeout(3, 0);
+    client->set_write_timeout(3, 0);
 
-        http->set_keep_alive(true);
+    client->set_keep_alive(true);
 
-        http->set_url_encode(false);
-    }
+    client->set_url_encode(false);
+}
+
+
+void
+StarbookTen::setHttpClient(httplib::Client *http) {
+    if (http)
+        configureClient(http);
 
     this->http = http;
     destroyClient = false;
 }
 
 
-bool
-StarbookTen::sendBasicCmd(const char *cmd) {
-    auto res = http->Get(cmd);
+void
+StarbookTen::openSessions(const char *base_url) {
+    closeSessions();
+
+    for (size_t i = 0; i < POLL_SESSIONS; i++) {
+        sessions.emplace_back(new httplib::Client(base_url));
+        configureClient(sessions.back().get());
+    }
+}
+
+
+void
+StarbookTen::closeSessions() {
+    sessions.clear();
+}
+
+
+std::map<std::string, StarbookTen::EndpointStats>
+StarbookTen::getEndpointStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return stats;
+}
+
+
+void
+StarbookTen::resetEndpointStats() {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.clear();
+}
 
-    if (!res || res->status != 200) {
-        throw std::runtime_error("sendBasicCmd HTTP error");
+
+std::string
+StarbookTen::get(httplib::Client *client, const char *path) {
+    auto start = std::chrono::steady_clock::now();
+    auto res = client->Get(path);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    bool ok = res && res->status == 200;
+
+    // Latency is accounted per endpoint, without the query string
+    const char *query = strchr(path, '?');
+    std::string endpoint = query ? std::string(path, query - path) : std::string(path);
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        EndpointStats &stat = stats[endpoint];
+        stat.requests++;
+        stat.failures += ok ? 0 : 1;
+        stat.totalMS += ms;
+        stat.maxMS = std::max(stat.maxMS, ms);
+    }
+
+    if (!ok) {
+        throw std::runtime_error("HTTP get failed");
     }
 
-    if (res->body.find(R"(<!--OK-->)") == std::string::npos) {
+    return std::move(res->body);
+}
+
+
+bool
+StarbookTen::sendBasicCmd(const char *cmd) {
+    std::string body = get(http, cmd);
+
+    if (body.find(R"(<!--OK-->)") == std::string::npos) {
         throw std::runtime_error("sendBasicCmd response error");
     }
 
@@ -64,16 +228,12 @@ StarbookTen::sendBasicCmd(const char *cmd) {
 
 std::tuple<int,int>
 StarbookTen::getFirmwareVersion() {
-    auto res = http->Get("/version");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
+    std::string body = get(http, "/version");
 
     std::regex r(R"(<!--VERSION=([0-9]+)\.([0-9]+)-->)");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         int vmaj = std::stoi(sm[1]);
         int vmin = std::stoi(sm[2]);
 
@@ -86,49 +246,36 @@ StarbookTen::getFirmwareVersion() {
 
 StarbookTen::PierSide
 StarbookTen::getPierSide() {
-    auto res = http->Get("/get_pierside");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
-
-    std::regex r(R"(PIERSIDE=([01]))");
-    std::smatch sm;
+    PierSide pierside;
 
-    if (std::regex_search(res->body, sm, r)) {
-        return static_cast<StarbookTen::PierSide>(std::stoi(sm[1]));
-    } else {
+    if (!parsePierSide(get(http, "/get_pierside"), &pierside)) {
         throw std::runtime_error("Could not get pier side");
     }
+
+    return pierside;
 }
 
 
 StarbookTen::PierSide
 StarbookTen::getNewPierSide(double ra, double dec) {
-    std::stringstream cmd_ss;
-    cmd_ss << "/calc_sideofpier?ra=" << ra << "&dec=" << dec;
-    auto res = http->Get(cmd_ss.str().c_str());
+    char cmd[128];
+    PierSide pierside;
 
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
+    snprintf(cmd, sizeof(cmd), "/calc_sideofpier?ra=%g&dec=%g", ra, dec);
 
-    std::regex r(R"(PIERSIDE=([01]))");
-    std::smatch sm;
-
-    if (std::regex_search(res->body, sm, r)) {
-        return static_cast<StarbookTen::PierSide>(std::stoi(sm[1]));
-    } else {
+    if (!parsePierSide(get(http, cmd), &pierside)) {
         throw std::runtime_error("Could not get new pier side");
     }
+
+    return pierside;
 }
 
 
 bool
 StarbookTen::setPierSide(PierSide pierside) {
-    std::stringstream cmd_ss;
-    cmd_ss << "/set_pierside?pierside=" << static_cast<int>(pierside);
-    return sendBasicCmd(cmd_ss.str().c_str());
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "/set_pierside?pierside=%d", static_cast<int>(pierside));
+    return sendBasicCmd(cmd);
 }
 
 
@@ -136,16 +283,12 @@ ln_zonedate
 StarbookTen::getDateTime() {
     ln_zonedate zdt;
 
-    auto res = http->Get("/gettime");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
+    std::string body = get(http, "/gettime");
 
     std::regex r(R"(TIME=(\d{4})\+(\d{1,2})\+(\d{1,2})\+(\d{1,2})\+(\d{1,2})\+(\d{1,2}))");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         zdt.years = std::stoi(sm[1]);
         zdt.months = std::stoi(sm[2]);
         zdt.days = std::stoi(sm[3]);
@@ -156,16 +299,12 @@ StarbookTen::getDateTime() {
         throw std::runtime_error("Could not get time");
     }
 
-    res = http->Get("/getplace");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
+    body = get(http, "/getplace");
 
     std::regex rtz(R"(<!--.*timezone=([+-]?\d+)-->)");
     std::smatch smtz;
 
-    if (std::regex_search(res->body, smtz, rtz)) {
+    if (std::regex_search(body, smtz, rtz)) {
         zdt.gmtoff = std::stoi(smtz[1])*3600;
     } else {
         throw std::runtime_error("Could not get timezone");
@@ -219,16 +358,12 @@ StarbookTen::setLatLonTz(double lat, double lon, long utc_off_secs) {
 
 std::tuple<double,double>
 StarbookTen::getLatLon() {
-    auto res = http->Get("/getplace");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
+    std::string body = get(http, "/getplace");
 
     std::regex r(R"(<!--longitude=([EW])(\d+)\+(\d+)&latitude=([NS])(\d+)\+(\d+)&.*-->)");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         ln_dms lon_dms, lat_dms;
 
         lon_dms.neg = (sm[1].compare("W") == 0) ? 1 : 0;
@@ -250,16 +385,12 @@ StarbookTen::getLatLon() {
 
 StarbookTen::CoordType
 StarbookTen::getCoordType() {
-    auto res = http->Get("/getradectype");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
+    std::string body = get(http, "/getradectype");
 
     std::regex r(R"((J2000|NOW))");
     std::smatch sm;
 
-    if (std::regex_search(res->body, sm, r)) {
+    if (std::regex_search(body, sm, r)) {
         return (sm[1].compare("J2000") == 0) ? COORD_TYPE_J2000 : COORD_TYPE_NOW;
     } else {
         throw std::runtime_error("Could not get coordinate type");
@@ -275,70 +406,36 @@ StarbookTen::setCoordType(CoordType ct) {
 
 StarbookTen::MountStatus
 StarbookTen::getStatus() {
-    auto res = http->Get("/getstatus2");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
-
-    std::regex r(R"(<!--RA=(\-?\d+\.\d+)&DEC=(\-?\d+\.\d+)&GOTO=([01])&STATE=([A-Z]+)-->)");
-    std::smatch sm;
-
-    if (std::regex_search(res->body, sm, r)) {
-        MountStatus stat;
+    MountStatus stat;
 
-        stat.ra = std::stod(sm[1]);
-        stat.dec = std::stod(sm[2]);
-        stat.goto_busy = !(sm[3].compare("0") == 0);
-        stat.state =
-            (sm[4].compare("USER") == 0)  ? STATE_USER  :
-            (sm[4].compare("CHART") == 0) ? STATE_CHART :
-            (sm[4].compare("SCOPE") == 0) ? STATE_SCOPE : STATE_INIT;
-
-        return stat;
-    } else {
+    if (!parseStatus(get(http, "/getstatus2"), &stat)) {
         throw std::runtime_error("Could not get status");
     }
+
+    return stat;
 }
 
 bool
 StarbookTen::isTracking() {
-    auto res = http->Get("/gettrackstatus");
-
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
-
-    // TRACK=2 seems to be used during gotos, but since we can already figure
-    // gotos out from the getstatus2 call, there's no need to handle it here.
-    std::regex r(R"(<!--TRACK=([012])-->)");
-    std::smatch sm;
+    bool tracking;
 
-    if (std::regex_search(res->body, sm, r)) {
-        return !(sm[1].compare("1"));
-    } else {
+    if (!parseTrackStatus(get(http, "/gettrackstatus"), &tracking)) {
         throw std::runtime_error("Could not get track status");
     }
+
+    return tracking;
 }
 
 
 std::tuple<bool,bool>
 StarbookTen::getGuidingRaDec() {
-    auto res = http->Get("/getguidestatus");
+    bool ra, dec;
 
-    if (!res || res->status != 200) {
-        throw std::runtime_error("HTTP get failed");
-    }
-
-    std::regex r(R"(<!--RA\+=([01])&RA\-=([01])&DEC\+=([01])&DEC\-=([01])-->)");
-    std::smatch sm;
-
-    if (std::regex_search(res->body, sm, r)) {
-        return std::tuple<bool,bool>((!(sm[1].compare("1")) || !(sm[2].compare("1"))),
-                                     (!(sm[3].compare("1")) || !(sm[4].compare("1"))));
-    } else {
+    if (!parseGuideStatus(get(http, "/getguidestatus"), &ra, &dec)) {
         throw std::runtime_error("Could not get guide status");
     }
+
+    return std::tuple<bool,bool>(ra, dec);
 }
 
 
@@ -350,19 +447,64 @@ StarbookTen::getRaDec() {
 }
 
 
+StarbookTen::PollStatus
+StarbookTen::pollStatus(bool guiding) {
+    static const char *paths[] = { "/getstatus2", "/gettrackstatus", "/get_pierside", "/getguidestatus" };
+    const size_t count = guiding ? 4 : 3;
+    std::string bodies[4];
+
+    if (sessions.empty()) {
+        for (size_t i = 0; i < count; i++)
+            bodies[i] = get(http, paths[i]);
+    } else {
+        // One request in flight per session. The futures wait for their request
+        // on destruction, so an exception never leaves a session busy.
+        std::future<std::string> replies[4];
+
+        for (size_t first = 0; first < count; first += sessions.size()) {
+            size_t last = std::min(count, first + sessions.size());
+
+            for (size_t i = first; i < last; i++)
+                replies[i] = std::async(std::launch::async, &StarbookTen::get, this,
+                                        sessions[i - first].get(), paths[i]);
+            for (size_t i = first; i < last; i++)
+                bodies[i] = replies[i].get();
+        }
+    }
+
+    PollStatus poll;
+    poll.guiding_ra = poll.guiding_dec = false;
+
+    if (!parseStatus(bodies[0], &poll.status)) {
+        throw std::runtime_error("Could not get status");
+    }
+    if (!parseTrackStatus(bodies[1], &poll.tracking)) {
+        throw std::runtime_error("Could not get track status");
+    }
+    if (!parsePierSide(bodies[2], &poll.pierside)) {
+        throw std::runtime_error("Could not get pier side");
+    }
+    if (guiding && !parseGuideStatus(bodies[3], &poll.guiding_ra, &poll.guiding_dec)) {
+        throw std::runtime_error("Could not get guide status");
+    }
+
+    return poll;
+}
+
+
 bool
 StarbookTen::setPulseRate(int ra_arcsec_per_sec, int dec_arcsec_per_sec) {
-    std::stringstream cmd_ss;
-    cmd_ss << "/setpulsespeed?ra=" << ra_arcsec_per_sec << "&dec=" << dec_arcsec_per_sec;
-    return sendBasicCmd(cmd_ss.str().c_str());
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "/setpulsespeed?ra=%d&dec=%d", ra_arcsec_per_sec, dec_arcsec_per_sec);
+    return sendBasicCmd(cmd);
 }
 
 
 bool
 StarbookTen::movePulse(GuideDirection dir, uint32_t ms) {
-    std::stringstream cmd_ss;
-    cmd_ss << "/movepulse?direct=" << static_cast<int>(dir) << "&duration=" << ms;
-    return sendBasicCmd(cmd_ss.str().c_str());
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "/movepulse?direct=%d&duration=%u", static_cast<int>(dir), static_cast<unsigned>(ms));
+    return sendBasicCmd(cmd);
 }
 
 
@@ -414,25 +556,25 @@ StarbookTen::setSlewRate(int index) {
         throw std::runtime_error("Invalid slew rate");
     }
 
-    std::stringstream cmd_ss;
-    cmd_ss << "/setspeed?speed=" << index;
-    return sendBasicCmd(cmd_ss.str().c_str());
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "/setspeed?speed=%d", index);
+    return sendBasicCmd(cmd);
 }
 
 
 bool
 StarbookTen::goTo(double ra, double dec) {
-    std::stringstream cmd_ss;
-    cmd_ss << "/gotoradec?ra=" << sxfmt(ra) << "&dec=" << sxfmt(dec);
-    return sendBasicCmd(cmd_ss.str().c_str());
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "/gotoradec?ra=%s&dec=%s", sxfmt(ra).c_str(), sxfmt(dec).c_str());
+    return sendBasicCmd(cmd);
 }
 
 
 bool
 StarbookTen::sync(double ra, double dec) {
-    std::stringstream cmd_ss;
-    cmd_ss << "/align?ra=" << sxfmt(ra) << "&dec=" << sxfmt(dec);
-    return sendBasicCmd(cmd_ss.str().c_str());
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "/align?ra=%s&dec=%s", sxfmt(ra).c_str(), sxfmt(dec).c_str());
+    return sendBasicCmd(cmd);
 }
 
 
@@ -442,9 +584,9 @@ StarbookTen::move(StarbookTen::Axis axis, double rate) {
         throw std::runtime_error("Invalid move rate");
     }
 
-    std::stringstream cmd_ss;
-    cmd_ss << "/move_axis?axis=" << static_cast<int>(axis) << "&rate=" << rate;
-    return sendBasicCmd(cmd_ss.str().c_str());
+    char cmd[128];
+    snprintf(cmd, sizeof(cmd), "/move_axis?axis=%d&rate=%g", static_cast<int>(axis), rate);
+    return sendBasicCmd(cmd);
 }
 
 
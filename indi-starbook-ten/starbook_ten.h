@@ -1,7 +1,11 @@
 #ifndef _STARBOOK_TEN_H_
 #define _STARBOOK_TEN_H_
 
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include <libnova/julian_day.h>
 #include <libnova/utility.h>
 #include "httplib.h"
@@ -9,9 +13,31 @@
 #define STARBOOK_TEN_DEFAULT_PULSE_RATE 288
 
 class StarbookTen {
+public:
+    struct EndpointStats {
+        uint64_t requests = 0;
+        uint64_t failures = 0;
+        double   totalMS  = 0;
+        double   maxMS    = 0;
+
+        double averageMS() const { return requests ? totalMS / requests : 0; }
+    };
+
+    /* Number of keep-alive sessions used to poll the mount concurrently */
+    static const size_t POLL_SESSIONS = 4;
+
 private:
     httplib::Client *http;
 
+    /* Poll sessions, each one only ever used by one request at a time */
+    std::vector<std::unique_ptr<httplib::Client>> sessions;
+
+    std::mutex statsMutex;
+    std::map<std::string, EndpointStats> stats;
+
+    static void configureClient(httplib::Client *client);
+    std::string get(httplib::Client *client, const char *path);
+
     bool sendBasicCmd(const char *cmd);
     std::string sxfmt(double x);
 
@@ -52,6 +78,14 @@ public:
         State  state;
     };
 
+    struct PollStatus {
+        MountStatus status;
+        bool        tracking;
+        PierSide    pierside;
+        bool        guiding_ra;
+        bool        guiding_dec;
+    };
+
     static const double slewRates[];
 
     StarbookTen(httplib::Client *http);
@@ -62,6 +96,12 @@ public:
 
     void setHttpClient(httplib::Client *http);
 
+    void openSessions(const char *base_url);
+    void closeSessions();
+
+    std::map<std::string, EndpointStats> getEndpointStats();
+    void resetEndpointStats();
+
     std::tuple<int,int> getFirmwareVersion();
 
     PierSide getPierSide();
@@ -83,6 +123,9 @@ public:
 
     std::tuple<double,double> getRaDec();
 
+    /* Status, tracking, pier side and optionally guiding queried concurrently */
+    PollStatus pollStatus(bool guiding);
+
     bool setPulseRate(int ra_arcsec_per_sec, int dec_arcsec_per_sec);
     bool movePulse(GuideDirection dir, uint32_t ms);
 
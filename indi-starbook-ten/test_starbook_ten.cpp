@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include "starbook_ten.h"
+
+/*
+ * Starbook Ten emulator on the loopback interface. Every status endpoint
+ * answers after a fixed delay, so that concurrent polling shows in the
+ * elapsed time and in the number of requests in flight.
+ */
+class StarbookEmulator {
+public:
+    explicit StarbookEmulator(int delayMS) : delayMS(delayMS) {
+        reply("/getstatus2", "<html><!--RA=12.5&DEC=-33.25&GOTO=1&STATE=SCOPE--></html>");
+        reply("/gettrackstatus", "<!--TRACK=1-->");
+        reply("/get_pierside", "<!--PIERSIDE=1-->");
+        reply("/getguidestatus", "<!--RA+=0&RA-=1&DEC+=0&DEC-=0-->");
+        server.Get("/movepulse", [](const httplib::Request &req, httplib::Response &res) {
+            bool ok = req.get_param_value("direct") == "2" && req.get_param_value("duration") == "250";
+            res.set_content(ok ? "<!--OK-->" : "<!--ERROR-->", "text/html");
+        });
+
+        port = server.bind_to_any_port("127.0.0.1");
+        thread = std::thread([this]() { server.listen_after_bind(); });
+        while (!server.is_running())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        url = "http://127.0.0.1:" + std::to_string(port);
+    }
+
+    ~StarbookEmulator() {
+        stop();
+    }
+
+    void stop() {
+        server.stop();
+        if (thread.joinable())
+            thread.join();
+    }
+
+    std::string url;
+    std::atomic<int> maxInFlight { 0 };
+
+private:
+    void reply(const char *path, const std::string &body) {
+        server.Get(path, [this, body](const httplib::Request &, httplib::Response &res) {
+            int n = ++inFlight;
+            for (int m = maxInFlight; n > m && !maxInFlight.compare_exchange_weak(m, n);)
+                ;
+            std::this_thread::sleep_for(std::chrono::milliseconds(delayMS));
+            --inFlight;
+            res.set_content(body, "text/html");
+        });
+    }
+
+    int delayMS;
+    int port { 0 };
+    std::atomic<int> inFlight { 0 };
+    httplib::Server server;
+    std::thread thread;
+};
+
+static double elapsedMS(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+TEST(StarbookTenTest, poll_matches_single_queries) {
+    StarbookEmulator emulator(0);
+    httplib::Client client(emulator.url.c_str());
+    StarbookTen starbook(&client);
+
+    auto stat = starbook.getStatus();
+    EXPECT_EQ(stat.ra, 12.5);
+    EXPECT_EQ(stat.dec, -33.25);
+    EXPECT_TRUE(stat.goto_busy);
+    EXPECT_EQ(stat.state, StarbookTen::STATE_SCOPE);
+
+    // Without sessions the poll falls back to the main client, one query after the other
+    for (int sessions = 0; sessions < 2; sessions++) {
+        if (sessions)
+            starbook.openSessions(emulator.url.c_str());
+
+        auto poll = starbook.pollStatus(true);
+        EXPECT_EQ(poll.status.ra, stat.ra);
+        EXPECT_EQ(poll.status.dec, stat.dec);
+        EXPECT_EQ(poll.status.goto_busy, stat.goto_busy);
+        EXPECT_EQ(poll.status.state, stat.state);
+        EXPECT_EQ(poll.tracking, starbook.isTracking());
+        EXPECT_EQ(poll.pierside, starbook.getPierSide());
+        EXPECT_EQ(poll.pierside, StarbookTen::PIERSIDE_EAST);
+        EXPECT_TRUE(poll.guiding_ra);
+        EXPECT_FALSE(poll.guiding_dec);
+
+        // Guide status is only asked for while guiding
+        poll = starbook.pollStatus(false);
+        EXPECT_FALSE(poll.guiding_ra);
+    }
+
+    EXPECT_TRUE(starbook.movePulse(StarbookTen::GUIDE_EAST, 250));
+}
+
+TEST(StarbookTenTest, poll_is_concurrent) {
+    const int delay = 50;
+    StarbookEmulator emulator(delay);
+    httplib::Client client(emulator.url.c_str());
+    StarbookTen starbook(&client);
+
+    auto start = std::chrono::steady_clock::now();
+    starbook.pollStatus(true);
+    double sequential = elapsedMS(start);
+    EXPECT_GE(sequential, 4 * delay);
+    EXPECT_EQ(emulator.maxInFlight, 1);
+
+    starbook.openSessions(emulator.url.c_str());
+    starbook.pollStatus(true);
+    start = std::chrono::steady_clock::now();
+    starbook.pollStatus(true);
+    double concurrent = elapsedMS(start);
+    EXPECT_EQ(emulator.maxInFlight, static_cast<int>(StarbookTen::POLL_SESSIONS));
+    EXPECT_LT(concurrent, 2 * delay);
+}
+
+TEST(StarbookTenTest, endpoint_stats) {
+    StarbookEmulator emulator(0);
+    httplib::Client client(emulator.url.c_str());
+    StarbookTen starbook(&client);
+    starbook.openSessions(emulator.url.c_str());
+
+    for (int i = 0; i < 5; i++)
+        starbook.pollStatus(false);
+    starbook.pollStatus(true);
+    starbook.movePulse(StarbookTen::GUIDE_EAST, 250);
+
+    auto stats = starbook.getEndpointStats();
+    EXPECT_EQ(stats["/getstatus2"].requests, 6u);
+    EXPECT_EQ(stats["/getguidestatus"].requests, 1u);
+    // Accounted without the query string
+    EXPECT_EQ(stats["/movepulse"].requests, 1u);
+    EXPECT_EQ(stats["/getstatus2"].failures, 0u);
+    EXPECT_LE(stats["/getstatus2"].averageMS(), stats["/getstatus2"].maxMS);
+
+    starbook.resetEndpointStats();
+    EXPECT_TRUE(starbook.getEndpointStats().empty());
+
+    // Mount gone, the failed requests are counted too
+    emulator.stop();
+    EXPECT_THROW(starbook.pollStatus(false), std::exception);
+    stats = starbook.getEndpointStats();
+    EXPECT_EQ(stats["/getstatus2"].failures, 1u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
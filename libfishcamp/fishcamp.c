@@ -1434,21 +1434,11 @@ void fcImage_IBIS_computeAvgColOffsets(int camNum)
 //
 void fcImage_IBIS_doFullFrameColLevelNormalization(UInt16 *frameBufferPtr, int imageWidth, int imageHeight)
 {
-    //float reference;
     int row, col;
     UInt16 *inputPtr;
-    UInt16 aPixel;
-    //float rowAvg;
-    SInt32 thisColBlack;
-    //float minRowAvg;
-    //float colAvg;
     float frameAvg;
-    //float rowOffset;
-    SInt32 colOffset;
-    //float floatPixel;
     SInt32 blackAvg;
     SInt32 bigPixel;
-    //SInt32 theOffset;
 
     // make sure we are dealing with 16 bit pixels
 
@@ -1458,23 +1448,15 @@ void fcImage_IBIS_doFullFrameColLevelNormalization(UInt16 *frameBufferPtr, int i
     frameAvg = fcImage_IBIS_calcFirstBlackRowAverage(frameBufferPtr, imageWidth, imageHeight);
     blackAvg = (SInt32)frameAvg;
 
-    for (col = 0; col < imageWidth; col++)
+    // walk the image in memory order.  Each col is shifted by the difference between the
+    // average black level and this cols black pixel from the first row of the image
+    for (row = 1; row < imageHeight; row++)
     {
-        // first get this cols black pixel from the first row of the image
-        thisColBlack = gBlackOffsets[col];
-
-        colOffset = blackAvg - thisColBlack;
-
-        for (row = 1; row < imageHeight; row++)
+        inputPtr = frameBufferPtr + (row * imageWidth);
+        for (col = 0; col < imageWidth; col++)
         {
-            // get the pixel for this row/col
-            inputPtr = frameBufferPtr;
-            inputPtr = inputPtr + (row * imageWidth) + col;
-            aPixel   = *inputPtr;
-            bigPixel = (SInt32)aPixel;
-
             // normalize
-            bigPixel = bigPixel + colOffset;
+            bigPixel = (SInt32)inputPtr[col] + (blackAvg - gBlackOffsets[col]);
 
             if (bigPixel > 65535)
                 bigPixel = 65535;
@@ -1483,7 +1465,7 @@ void fcImage_IBIS_doFullFrameColLevelNormalization(UInt16 *frameBufferPtr, int i
                 bigPixel = 0;
 
             // put corrected value back
-            *inputPtr = (UInt16)bigPixel;
+            inputPtr[col] = (UInt16)bigPixel;
         }
     }
 }
@@ -1497,7 +1479,6 @@ void fcImage_PRO_calcColOffsets(UInt16 *frameBufferPtr, int imageWidth, int imag
     //float reference;
     int row, col;
     UInt16 *inputPtr;
-    UInt16 aPixel;
     //float rowAvg;
     //float thisRowAvg;
     //float minRowAvg;
@@ -1520,24 +1501,20 @@ void fcImage_PRO_calcColOffsets(UInt16 *frameBufferPtr, int imageWidth, int imag
     startRow = 2100;
     endRow   = 2300;
 
-    // accumulate the average
-    for (col = 0; col < imageWidth; col++)
+    // accumulate the average, one overscan row at a time
+    for (row = startRow; row < endRow; row++)
     {
-        for (row = startRow; row < endRow; row++)
+        inputPtr = frameBufferPtr + (row * imageWidth);
+        for (col = 0; col < imageWidth; col++)
         {
-            inputPtr = frameBufferPtr;
-            inputPtr = inputPtr + (row * imageWidth) + col;
-
-            // get the next pixel
-            aPixel = *inputPtr;
-
             // add up
-            gProBlackColOffsets[col] += (SInt32)aPixel;
+            gProBlackColOffsets[col] += (SInt32)inputPtr[col];
         }
+    }
 
-        // divide by the number of rows in the overscan area
+    // divide by the number of rows in the overscan area
+    for (col = 0; col < imageWidth; col++)
         gProBlackColOffsets[col] = gProBlackColOffsets[col] / (SInt32)(endRow - startRow);
-    }
 
     // now calculate the average of all the columns
     colAverage = 0;
@@ -1667,153 +1644,96 @@ void fcImage_PRO_calibrateProCamera(int camNum, UInt16 *frameBufferPtr, int imag
     gProWantColNormalization = savedWantNorm;
 }
 
-// routine to perform a 3x3 kernel filter on the image buffer
+// helper routine for the box filters.  Performs a 3x3 (radius 1) or 5x5 (radius 2) box filter 'in place'.
 //
-void fcImage_do_3x3_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer)
+// the image is streamed one row at a time.  Before a row is overwritten we keep a copy of it in a
+// small ring of (radius + 1) lines so the rows below can still see the unfiltered pixels.  For every
+// row we first sum the kernel rows column by column (a straight loop the compiler vectorizes) and then
+// slide a horizontal window along those column sums.  The border pixels are left untouched.
+//
+static void fcImage_do_box_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer, int radius)
 {
-    //float reference;
-    int row, col;
-    UInt16 *inputPtr;
-    UInt16 *outputPtr;
-    UInt16 aPixel;
+    int row, col, k;
+    int numLines;
     UInt32 accumPixel;
-    UInt16 *tempBuffer;
-    size_t size;
-
-    // this routine will work 'in place'.  We will first allocate a temporary image buffer
-    // we copy the image to it and then fill the original buffer with the filtered image
-    //
-    size       = imageWidth * imageHeight * 2; // 2 bytes/pixel
-    tempBuffer = (UInt16 *)malloc(size);
-
-    if (tempBuffer != NULL)
-    {
-        // copy the image buffer to my local storage
-        memcpy(tempBuffer, frameBuffer, size);
-
-        // Start at row '1'
-        for (row = 1; row < (imageHeight - 1); row++)
-        {
-            for (col = 1; col < (imageWidth - 1); col++)
-            {
-                inputPtr  = tempBuffer;
-                inputPtr  = inputPtr + (row * imageWidth) + col;
-                outputPtr = frameBuffer;
-                outputPtr = outputPtr + (row * imageWidth) + col;
-
-                accumPixel = 0;
+    UInt32 *colSums;
+    UInt16 *lines;
+    UInt16 *outputPtr;
+    const UInt16 *rowPtr[5];
 
-                inputPtr   = inputPtr - imageWidth - 1; // 1
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+    if (imageHeight <= 2 * radius || imageWidth <= 2 * radius)
+        return;
 
-                inputPtr++; // 2
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+    numLines = radius + 1;
 
-                inputPtr++; // 3
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+    // a few lines of scratch, allocated per call so cameras filtering frames concurrently
+    // never share it
+    colSums = (UInt32 *)malloc(imageWidth * (sizeof(UInt32) + numLines * sizeof(UInt16)));
+    if (colSums == NULL)
+        return;
+    lines = (UInt16 *)(colSums + imageWidth);
 
-                inputPtr   = inputPtr + imageWidth - 2; // 4
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+    for (row = radius; row < (imageHeight - radius); row++)
+    {
+        outputPtr = frameBuffer + (row * imageWidth);
 
-                inputPtr++; // 5
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+        // remember the unfiltered row before we overwrite it
+        memcpy(lines + (row % numLines) * imageWidth, outputPtr, imageWidth * sizeof(UInt16));
 
-                inputPtr++; // 6
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+        // rows above us have been filtered already, so take them from the ring.  The first 'radius'
+        // rows are never modified and the rows below have not been reached yet.
+        for (k = -radius; k <= radius; k++)
+        {
+            if (k < 0 && (row + k) >= radius)
+                rowPtr[k + radius] = lines + ((row + k) % numLines) * imageWidth;
+            else
+                rowPtr[k + radius] = frameBuffer + ((row + k) * imageWidth);
+        }
 
-                inputPtr   = inputPtr + imageWidth - 2; // 7
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+        // vertical sums
+        for (col = 0; col < imageWidth; col++)
+            colSums[col] = rowPtr[0][col];
+        for (k = 1; k <= 2 * radius; k++)
+        {
+            for (col = 0; col < imageWidth; col++)
+                colSums[col] += rowPtr[k][col];
+        }
 
-                inputPtr++; // 8
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+        // horizontal sliding sum
+        accumPixel = 0;
+        for (col = 0; col < 2 * radius; col++)
+            accumPixel += colSums[col];
 
-                inputPtr++; // 9
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
+        for (col = radius; col < (imageWidth - radius); col++)
+        {
+            accumPixel += colSums[col + radius];
 
-                // divide by the kernel size
-                accumPixel = accumPixel / 9;
+            // divide by the kernel size and put filtered value back.  Spelled out so the
+            // compiler turns the division into a multiply.
+            if (radius == 1)
+                outputPtr[col] = (UInt16)(accumPixel / 9);
+            else
+                outputPtr[col] = (UInt16)(accumPixel / 25);
 
-                // put filtered value back
-                *outputPtr = (UInt16)accumPixel;
-            }
+            accumPixel -= colSums[col - radius];
         }
-
-        free(tempBuffer);
     }
+
+    free(colSums);
+}
+
+// routine to perform a 3x3 kernel filter on the image buffer
+//
+void fcImage_do_3x3_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer)
+{
+    fcImage_do_box_kernel(imageHeight, imageWidth, frameBuffer, 1);
 }
 
 // routine to perform a 5x5 kernel filter on the image buffer
 //
 void fcImage_do_5x5_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer)
 {
-    //float reference;
-    int row, col;
-    UInt16 *inputPtr;
-    UInt16 *outputPtr;
-    UInt16 aPixel;
-    UInt32 accumPixel;
-    UInt16 *tempBuffer;
-    size_t size;
-    int x, y;
-
-    // this routine will work 'in place'.  We will first allocate a temporary image buffer
-    // we copy the image to it and then fill the original buffer with the filtered image
-    //
-    size       = imageWidth * imageHeight * 2; // 2 bytes/pixel
-    tempBuffer = (UInt16 *)malloc(size);
-
-    if (tempBuffer != NULL)
-    {
-        // copy the image buffer to my local storage
-        memcpy(tempBuffer, frameBuffer, size);
-
-        // Start at row '2'
-        for (row = 2; row < (imageHeight - 2); row++)
-        {
-            for (col = 2; col < (imageWidth - 2); col++)
-            {
-                inputPtr  = tempBuffer;
-                inputPtr  = inputPtr + (row * imageWidth) + col;
-                outputPtr = frameBuffer;
-                outputPtr = outputPtr + (row * imageWidth) + col;
-
-                accumPixel = 0;
-
-                inputPtr = inputPtr - (3 * imageWidth) + 2;
-
-                for (y = 0; y < 5; y++)
-                {
-                    inputPtr   = inputPtr + imageWidth - 4;
-                    aPixel     = *inputPtr;
-                    accumPixel = accumPixel + (UInt32)aPixel;
-
-                    for (x = 0; x < 4; x++)
-                    {
-                        inputPtr++;
-                        aPixel     = *inputPtr;
-                        accumPixel = accumPixel + (UInt32)aPixel;
-                    }
-                }
-
-                // divide by the kernel size
-                accumPixel = accumPixel / 25;
-
-                // put filtered value back
-                *outputPtr = (UInt16)accumPixel;
-            }
-        }
-
-        free(tempBuffer);
-    }
+    fcImage_do_box_kernel(imageHeight, imageWidth, frameBuffer, 2);
 }
 
 // routine to perform hot pixel removal filter on the image buffer
@@ -1822,119 +1742,88 @@ void fcImage_do_5x5_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameB
 // brighter than the brightest of the neigboring pixels.  If it is
 // then it will replace it with the average of the neighboring pixels.
 //
+// like the box filters this streams the image a row at a time, keeping the unfiltered
+// copy of the previous row in a two line ring instead of copying the whole frame.
+//
 void fcImage_do_hotPixel_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer)
 {
     float floatBrightPixel;
     float floatCenterPixel;
     int row, col;
-    UInt16 *inputPtr;
+    const UInt16 *above, *center, *below;
     UInt16 *outputPtr;
-    UInt16 aPixel;
+    UInt16 *lines;
+    UInt32 *colSums;
+    UInt16 *colMax;
     UInt32 accumPixel;
-    UInt16 *tempBuffer;
-    size_t size;
     UInt16 brightestNeighbor;
     UInt16 thisPixel;
     int numHotPixels;
 
-    // this routine will work 'in place'.  We will first allocate a temporary image buffer
-    // we copy the image to it and then fill the original buffer with the filtered image
-    //
-    size       = imageWidth * imageHeight * 2; // 2 bytes/pixel
-    tempBuffer = (UInt16 *)malloc(size);
+    if (imageHeight <= 2 || imageWidth <= 2)
+        return;
+
+    // per call, see fcImage_do_box_kernel
+    colSums = (UInt32 *)malloc(imageWidth * (sizeof(UInt32) + 3 * sizeof(UInt16)));
+    if (colSums == NULL)
+        return;
+    colMax = (UInt16 *)(colSums + imageWidth);
+    lines  = colMax + imageWidth;
+
+    numHotPixels = 0;
 
-    if (tempBuffer != NULL)
+    // Start at row '1'
+    for (row = 1; row < (imageHeight - 1); row++)
     {
-        numHotPixels = 0;
+        outputPtr = frameBuffer + (row * imageWidth);
 
-        // copy the image buffer to my local storage
-        memcpy(tempBuffer, frameBuffer, size);
+        // remember the unfiltered row before we modify it
+        memcpy(lines + (row % 2) * imageWidth, outputPtr, imageWidth * sizeof(UInt16));
 
-        // Start at row '1'
-        for (row = 1; row < (imageHeight - 1); row++)
+        above  = (row > 1) ? lines + ((row - 1) % 2) * imageWidth : frameBuffer;
+        center = lines + (row % 2) * imageWidth;
+        below  = outputPtr + imageWidth;
+
+        // sum and maximum of the pixels directly above and below each column
+        for (col = 0; col < imageWidth; col++)
         {
-            for (col = 1; col < (imageWidth - 1); col++)
+            colSums[col] = (UInt32)above[col] + (UInt32)below[col];
+            colMax[col]  = above[col] > below[col] ? above[col] : below[col];
+        }
+
+        for (col = 1; col < (imageWidth - 1); col++)
+        {
+            thisPixel = center[col];
+
+            accumPixel = colSums[col - 1] + colSums[col] + colSums[col + 1] + (UInt32)center[col - 1] +
+                         (UInt32)center[col + 1];
+
+            brightestNeighbor = colMax[col - 1];
+            if (brightestNeighbor < colMax[col])
+                brightestNeighbor = colMax[col];
+            if (brightestNeighbor < colMax[col + 1])
+                brightestNeighbor = colMax[col + 1];
+            if (brightestNeighbor < center[col - 1])
+                brightestNeighbor = center[col - 1];
+            if (brightestNeighbor < center[col + 1])
+                brightestNeighbor = center[col + 1];
+
+            floatBrightPixel = (float)brightestNeighbor;
+            floatBrightPixel = floatBrightPixel * 1.2;
+
+            floatCenterPixel = (float)thisPixel;
+
+            if (floatCenterPixel > floatBrightPixel)
             {
-                inputPtr  = tempBuffer;
-                inputPtr  = inputPtr + (row * imageWidth) + col;
-                outputPtr = frameBuffer;
-                outputPtr = outputPtr + (row * imageWidth) + col;
-
-                accumPixel        = 0;
-                brightestNeighbor = 0;
-
-                inputPtr   = inputPtr - imageWidth - 1; // 1
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                inputPtr++; // 2
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                inputPtr++; // 3
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                inputPtr   = inputPtr + imageWidth - 2; // 4
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                inputPtr++; // 5 - center pixel
-                aPixel    = *inputPtr;
-                thisPixel = aPixel;
-
-                inputPtr++; // 6
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                inputPtr   = inputPtr + imageWidth - 2; // 7
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                inputPtr++; // 8
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                inputPtr++; // 9
-                aPixel     = *inputPtr;
-                accumPixel = accumPixel + (UInt32)aPixel;
-                if (brightestNeighbor < aPixel)
-                    brightestNeighbor = aPixel;
-
-                // divide by the number of surrounding pixels
-                accumPixel = accumPixel / 8;
-
-                floatBrightPixel = (float)brightestNeighbor;
-                floatBrightPixel = floatBrightPixel * 1.2;
-
-                floatCenterPixel = (float)thisPixel;
-
-                if (floatCenterPixel > floatBrightPixel)
-                {
-                    numHotPixels++;
-                    // substitute average
-                    *outputPtr = (UInt16)accumPixel;
-                }
+                numHotPixels++;
+                // substitute average of the surrounding pixels
+                outputPtr[col] = (UInt16)(accumPixel / 8);
             }
         }
-
-        free(tempBuffer);
     }
 
+    free(colSums);
+
     //	Starfish_LogFmt("fcImage_do_hotPixel_kernel numHotPixels = %d\n", numHotPixels);
 }
 
@@ -0,0 +1,565 @@
+/*
+
+Copyright (c) 2001-2013 Fishcamp Engineering (support@fishcamp.com)
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions
+are met:
+
+		Redistributions of source code must retain the above copyright
+		notice, this list of conditions and the following disclaimer.
+
+		Redistributions in binary form must reproduce the above
+		copyright notice, this list of conditions and the following
+		disclaimer in the documentation and/or other materials
+		provided with the distribution.
+
+Modified by: Jasem Mutlaq (2013)
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+``AS IS'' AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+POSSIBILITY OF SUCH DAMAGE.
+======================================================================
+*/
+
+/*
+    Checks the row streaming image filters and the memory order normalization against the
+    original full frame implementations, which are kept below as they were. Every frame must
+    come out bit for bit identical.
+*/
+
+#include "fishcamp.h"
+#include "indimacros.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+extern "C" {
+// Not part of the public interface
+void fcImage_do_3x3_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer);
+void fcImage_do_5x5_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer);
+void fcImage_do_hotPixel_kernel(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer);
+void fcImage_IBIS_doFullFrameColLevelNormalization(UInt16 *frameBufferPtr, int imageWidth, int imageHeight);
+void fcImage_PRO_calcColOffsets(UInt16 *frameBufferPtr, int imageWidth, int imageHeight);
+float fcImage_IBIS_calcFirstBlackRowAverage(UInt16 *frameBufferPtr, int imageWidth, int imageHeight);
+
+extern SInt32 gBlackOffsets[1280];
+extern SInt32 gProBlackColOffsets[4096];
+}
+
+// routine to perform a 3x3 kernel filter on the image buffer
+//
+static void fcImage_do_3x3_kernel_reference(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer)
+{
+    //float reference;
+    int row, col;
+    UInt16 *inputPtr;
+    UInt16 *outputPtr;
+    UInt16 aPixel;
+    UInt32 accumPixel;
+    UInt16 *tempBuffer;
+    size_t size;
+
+    // this routine will work 'in place'.  We will first allocate a temporary image buffer
+    // we copy the image to it and then fill the original buffer with the filtered image
+    //
+    size       = imageWidth * imageHeight * 2; // 2 bytes/pixel
+    tempBuffer = (UInt16 *)malloc(size);
+
+    if (tempBuffer != NULL)
+    {
+        // copy the image buffer to my local storage
+        memcpy(tempBuffer, frameBuffer, size);
+
+        // Start at row '1'
+        for (row = 1; row < (imageHeight - 1); row++)
+        {
+            for (col = 1; col < (imageWidth - 1); col++)
+            {
+                inputPtr  = tempBuffer;
+                inputPtr  = inputPtr + (row * imageWidth) + col;
+                outputPtr = frameBuffer;
+                outputPtr = outputPtr + (row * imageWidth) + col;
+
+                accumPixel = 0;
+
+                inputPtr   = inputPtr - imageWidth - 1; // 1
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr++; // 2
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr++; // 3
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr   = inputPtr + imageWidth - 2; // 4
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr++; // 5
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr++; // 6
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr   = inputPtr + imageWidth - 2; // 7
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr++; // 8
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                inputPtr++; // 9
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+
+                // divide by the kernel size
+                accumPixel = accumPixel / 9;
+
+                // put filtered value back
+                *outputPtr = (UInt16)accumPixel;
+            }
+        }
+
+        free(tempBuffer);
+    }
+}
+
+// routine to perform a 5x5 kernel filter on the image buffer
+//
+static void fcImage_do_5x5_kernel_reference(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer)
+{
+    //float reference;
+    int row, col;
+    UInt16 *inputPtr;
+    UInt16 *outputPtr;
+    UInt16 aPixel;
+    UInt32 accumPixel;
+    UInt16 *tempBuffer;
+    size_t size;
+    int x, y;
+
+    // this routine will work 'in place'.  We will first allocate a temporary image buffer
+    // we copy the image to it and then fill the original buffer with the filtered image
+    //
+    size       = imageWidth * imageHeight * 2; // 2 bytes/pixel
+    tempBuffer = (UInt16 *)malloc(size);
+
+    if (tempBuffer != NULL)
+    {
+        // copy the image buffer to my local storage
+        memcpy(tempBuffer, frameBuffer, size);
+
+        // Start at row '2'
+        for (row = 2; row < (imageHeight - 2); row++)
+        {
+            for (col = 2; col < (imageWidth - 2); col++)
+            {
+                inputPtr  = tempBuffer;
+                inputPtr  = inputPtr + (row * imageWidth) + col;
+                outputPtr = frameBuffer;
+                outputPtr = outputPtr + (row * imageWidth) + col;
+
+                accumPixel = 0;
+
+                inputPtr = inputPtr - (3 * imageWidth) + 2;
+
+                for (y = 0; y < 5; y++)
+                {
+                    inputPtr   = inputPtr + imageWidth - 4;
+                    aPixel     = *inputPtr;
+                    accumPixel = accumPixel + (UInt32)aPixel;
+
+                    for (x = 0; x < 4; x++)
+                    {
+                        inputPtr++;
+                        aPixel     = *inputPtr;
+                        accumPixel = accumPixel + (UInt32)aPixel;
+                    }
+                }
+
+                // divide by the kernel size
+                accumPixel = accumPixel / 25;
+
+                // put filtered value back
+                *outputPtr = (UInt16)accumPixel;
+            }
+        }
+
+        free(tempBuffer);
+    }
+}
+
+// routine to perform hot pixel removal filter on the image buffer
+//
+// algorithm looks for the center pixel ina 3x3 grid being more than 20%
+// brighter than the brightest of the neigboring pixels.  If it is
+// then it will replace it with the average of the neighboring pixels.
+//
+static void fcImage_do_hotPixel_kernel_reference(UInt16 imageHeight, UInt16 imageWidth, UInt16 *frameBuffer)
+{
+    float floatBrightPixel;
+    float floatCenterPixel;
+    int row, col;
+    UInt16 *inputPtr;
+    UInt16 *outputPtr;
+    UInt16 aPixel;
+    UInt32 accumPixel;
+    UInt16 *tempBuffer;
+    size_t size;
+    UInt16 brightestNeighbor;
+    UInt16 thisPixel;
+    int numHotPixels;
+
+    // this routine will work 'in place'.  We will first allocate a temporary image buffer
+    // we copy the image to it and then fill the original buffer with the filtered image
+    //
+    size       = imageWidth * imageHeight * 2; // 2 bytes/pixel
+    tempBuffer = (UInt16 *)malloc(size);
+
+    if (tempBuffer != NULL)
+    {
+        numHotPixels = 0;
+
+        // copy the image buffer to my local storage
+        memcpy(tempBuffer, frameBuffer, size);
+
+        // Start at row '1'
+        for (row = 1; row < (imageHeight - 1); row++)
+        {
+            for (col = 1; col < (imageWidth - 1); col++)
+            {
+                inputPtr  = tempBuffer;
+                inputPtr  = inputPtr + (row * imageWidth) + col;
+                outputPtr = frameBuffer;
+                outputPtr = outputPtr + (row * imageWidth) + col;
+
+                accumPixel        = 0;
+                brightestNeighbor = 0;
+
+                inputPtr   = inputPtr - imageWidth - 1; // 1
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                inputPtr++; // 2
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                inputPtr++; // 3
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                inputPtr   = inputPtr + imageWidth - 2; // 4
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                inputPtr++; // 5 - center pixel
+                aPixel    = *inputPtr;
+                thisPixel = aPixel;
+
+                inputPtr++; // 6
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                inputPtr   = inputPtr + imageWidth - 2; // 7
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                inputPtr++; // 8
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                inputPtr++; // 9
+                aPixel     = *inputPtr;
+                accumPixel = accumPixel + (UInt32)aPixel;
+                if (brightestNeighbor < aPixel)
+                    brightestNeighbor = aPixel;
+
+                // divide by the number of surrounding pixels
+                accumPixel = accumPixel / 8;
+
+                floatBrightPixel = (float)brightestNeighbor;
+                floatBrightPixel = floatBrightPixel * 1.2;
+
+                floatCenterPixel = (float)thisPixel;
+
+                if (floatCenterPixel > floatBrightPixel)
+                {
+                    numHotPixels++;
+                    // substitute average
+                    *outputPtr = (UInt16)accumPixel;
+                }
+            }
+        }
+
+        free(tempBuffer);
+    }
+
+    //	Starfish_LogFmt("fcImage_do_hotPixel_kernel_reference numHotPixels = %d\n", numHotPixels);
+}
+
+static void fcImage_IBIS_doFullFrameColLevelNormalization_reference(UInt16 *frameBufferPtr, int imageWidth, int imageHeight)
+{
+    //float reference;
+    int row, col;
+    UInt16 *inputPtr;
+    UInt16 aPixel;
+    //float rowAvg;
+    SInt32 thisColBlack;
+    //float minRowAvg;
+    //float colAvg;
+    float frameAvg;
+    //float rowOffset;
+    SInt32 colOffset;
+    //float floatPixel;
+    SInt32 blackAvg;
+    SInt32 bigPixel;
+    //SInt32 theOffset;
+
+    // make sure we are dealing with 16 bit pixels
+
+    //	printf("fcImage_IBIS_doFullFrameColLevelNormalization_reference\n");
+
+    // calculate the average of all the black pixels
+    frameAvg = fcImage_IBIS_calcFirstBlackRowAverage(frameBufferPtr, imageWidth, imageHeight);
+    blackAvg = (SInt32)frameAvg;
+
+    for (col = 0; col < imageWidth; col++)
+    {
+        // first get this cols black pixel from the first row of the image
+        thisColBlack = gBlackOffsets[col];
+
+        colOffset = blackAvg - thisColBlack;
+
+        for (row = 1; row < imageHeight; row++)
+        {
+            // get the pixel for this row/col
+            inputPtr = frameBufferPtr;
+            inputPtr = inputPtr + (row * imageWidth) + col;
+            aPixel   = *inputPtr;
+            bigPixel = (SInt32)aPixel;
+
+            // normalize
+            bigPixel = bigPixel + colOffset;
+
+            if (bigPixel > 65535)
+                bigPixel = 65535;
+
+            if (bigPixel < 0)
+                bigPixel = 0;
+
+            // put corrected value back
+            *inputPtr = (UInt16)bigPixel;
+        }
+    }
+}
+
+// routine to compute the column level offsets in the image.
+// We do this by examining the vertical overscan region in the image
+// Computing the average in the particular column.
+static void fcImage_PRO_calcColOffsets_reference(UInt16 *frameBufferPtr, int imageWidth, int imageHeight)
+{
+	INDI_UNUSED(imageHeight);
+    //float reference;
+    int row, col;
+    UInt16 *inputPtr;
+    UInt16 aPixel;
+    //float rowAvg;
+    //float thisRowAvg;
+    //float minRowAvg;
+    //float colAvg;
+    //float frameAvg;
+    //float rowOffset;
+    //float colOffset;
+    //float floatPixel;
+    int startRow, endRow;
+    SInt32 colAverage;
+
+    // clear out any old results
+    for (col = 0; col < 4096; col++)
+        gProBlackColOffsets[col] = 0;
+
+    // define the start row and end row of the vertical overscan region of the image
+    startRow = 2100;
+    endRow   = 2300;
+
+    // accumulate the average
+    for (col = 0; col < imageWidth; col++)
+    {
+        for (row = startRow; row < endRow; row++)
+        {
+            inputPtr = frameBufferPtr;
+            inputPtr = inputPtr + (row * imageWidth) + col;
+
+            // get the next pixel
+            aPixel = *inputPtr;
+
+            // add up
+            gProBlackColOffsets[col] += (SInt32)aPixel;
+        }
+
+        // divide by the number of rows in the overscan area
+        gProBlackColOffsets[col] = gProBlackColOffsets[col] / (SInt32)(endRow - startRow);
+    }
+
+    // now calculate the average of all the columns
+    colAverage = 0;
+    for (col = 0; col < imageWidth; col++)
+    {
+        colAverage += gProBlackColOffsets[col];
+    }
+
+    colAverage = colAverage / (SInt32)imageWidth;
+
+    // normalize the offsets to the column average
+    for (col = 0; col < imageWidth; col++)
+    {
+        gProBlackColOffsets[col] = gProBlackColOffsets[col] - colAverage;
+    }
+}
+
+typedef enum
+{
+    FRAME_SKY,
+    FRAME_SATURATED,
+    FRAME_NOISE,
+    FRAME_BLACK
+} FrameType;
+
+static std::vector<UInt16> makeFrame(int height, int width, FrameType type, std::mt19937 &random)
+{
+    std::vector<UInt16> frame(static_cast<size_t>(height) * width);
+    std::uniform_int_distribution<int> full(0, 65535), background(1000, 1199), hot(0, 19);
+
+    for (auto &pixel : frame)
+    {
+        switch (type)
+        {
+            case FRAME_SKY:
+                // Background with sparse hot pixels
+                pixel = hot(random) == 0 ? full(random) : background(random);
+                break;
+            case FRAME_SATURATED:
+                pixel = 65535;
+                break;
+            case FRAME_NOISE:
+                pixel = full(random);
+                break;
+            case FRAME_BLACK:
+                pixel = 0;
+                break;
+        }
+    }
+    return frame;
+}
+
+typedef void (*Kernel)(UInt16, UInt16, UInt16 *);
+
+static void compareKernel(Kernel reference, Kernel kernel, const char *name)
+{
+    static const int sizes[][2] = { { 1, 10 }, { 2, 2 }, { 3, 3 }, { 4, 7 }, { 5, 5 }, { 6, 9 }, { 17, 33 }, { 1024, 1280 } };
+    std::mt19937 random(1);
+
+    for (const auto &size : sizes)
+    {
+        for (FrameType type : { FRAME_SKY, FRAME_SATURATED, FRAME_NOISE, FRAME_BLACK })
+        {
+            std::vector<UInt16> expected = makeFrame(size[0], size[1], type, random);
+            std::vector<UInt16> actual = expected;
+
+            reference(size[0], size[1], expected.data());
+            kernel(size[0], size[1], actual.data());
+            EXPECT_TRUE(expected == actual) << name << " differs on a " << size[0] << "x" << size[1] << " frame of type " << type;
+        }
+    }
+}
+
+TEST(FishcampKernels, Box3x3)
+{
+    compareKernel(fcImage_do_3x3_kernel_reference, fcImage_do_3x3_kernel, "3x3");
+}
+
+TEST(FishcampKernels, Box5x5)
+{
+    compareKernel(fcImage_do_5x5_kernel_reference, fcImage_do_5x5_kernel, "5x5");
+}
+
+TEST(FishcampKernels, HotPixel)
+{
+    compareKernel(fcImage_do_hotPixel_kernel_reference, fcImage_do_hotPixel_kernel, "hot pixel");
+}
+
+TEST(FishcampKernels, IBISColumnNormalization)
+{
+    std::mt19937 random(2);
+    std::uniform_int_distribution<int> black(0, 2999);
+
+    for (FrameType type : { FRAME_SKY, FRAME_SATURATED, FRAME_NOISE, FRAME_BLACK })
+    {
+        for (auto &offset : gBlackOffsets)
+            offset = black(random);
+
+        std::vector<UInt16> expected = makeFrame(1024, 1280, type, random);
+        std::vector<UInt16> actual = expected;
+
+        fcImage_IBIS_doFullFrameColLevelNormalization_reference(expected.data(), 1280, 1024);
+        fcImage_IBIS_doFullFrameColLevelNormalization(actual.data(), 1280, 1024);
+        EXPECT_TRUE(expected == actual) << "frame of type " << type;
+    }
+}
+
+TEST(FishcampKernels, PROColumnOffsets)
+{
+    std::mt19937 random(3);
+
+    for (FrameType type : { FRAME_SKY, FRAME_SATURATED, FRAME_NOISE, FRAME_BLACK })
+    {
+        // The overscan rows end at 2300
+        std::vector<UInt16> frame = makeFrame(2305, 2304, type, random);
+        std::vector<SInt32> expected(4096);
+
+        fcImage_PRO_calcColOffsets_reference(frame.data(), 2304, 2305);
+        std::copy(gProBlackColOffsets, gProBlackColOffsets + 4096, expected.begin());
+        fcImage_PRO_calcColOffsets(frame.data(), 2304, 2305);
+        EXPECT_TRUE(std::equal(expected.begin(), expected.end(), gProBlackColOffsets)) << "frame of type " << type;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
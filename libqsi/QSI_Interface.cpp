@@ -15,6 +15,7 @@ REVISION HISTORY
 #include "QSI_Interface.h"
 #include "IHostIO.h"
 #include "QSIError.h"
+#include <cstring>
 
 //////////////////////////////////////////////////////////////////////////////////////////
 // Constructor
@@ -360,20 +361,23 @@ int  QSI_Interface::ReadImageByRow(PVOID pvRxBuffer, int iRowsRequested, int iCo
 	}
 
 	// Calculate number of rows to read, based on connection type. Some protocols are limited to one row at a time
-	int iMaxRows = m_MaxBytesPerReadBlock / (iColumnsRequested * iPixelSize);
+	int iRowBytes = iColumnsRequested * iPixelSize;
+	int iMaxRows = m_MaxBytesPerReadBlock / iRowBytes;
 	if (iMaxRows == 0)
 		iMaxRows = 1;
 	
 	if (m_HostCon.m_HostIO->GetTransferType() == IOType_SingleRow)
 		iRowsToRead = 1;
-	else if (iColumnsRequested * iPixelSize != iStride) // Non-contiguous rows, so read one row at a time
+	else if (iStride < iRowBytes) // Overlapping rows can't be scattered in place, so read one row at a time
 		iRowsToRead = 1;
 	else if (iRowsRequested < iMaxRows)
 		iRowsToRead = iRowsRequested;
 	else
 		iRowsToRead = iMaxRows;
 
-	iError = m_HostCon.m_HostIO->Read((unsigned char *)pvRxBuffer, iRowsToRead * iColumnsRequested * iPixelSize, &iBytesReturned);
+	// Rows are always read packed as one block. When the caller's stride is wider than a row,
+	// the block is spread out to the stride afterwards, so padding does not cost a USB transfer per row.
+	iError = m_HostCon.m_HostIO->Read((unsigned char *)pvRxBuffer, iRowsToRead * iRowBytes, &iBytesReturned);
 
 	iRowsRead = (iBytesReturned / iPixelSize) / iColumnsRequested;
 
@@ -384,10 +388,22 @@ int  QSI_Interface::ReadImageByRow(PVOID pvRxBuffer, int iRowsRequested, int iCo
 		return iError;
 	}
 
+	if (iStride != iRowBytes)
+		ScatterRows((BYTE *)pvRxBuffer, iRowsRead, iRowBytes, iStride);
+
 	m_log->Write(2, _T("ReadImageByRow completed."));
 	return iError;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+// Spread iRows packed rows of iRowBytes at the start of pBuffer out to iStride bytes per row.
+// Work from the last row back so no row is overwritten before it is moved (iStride >= iRowBytes).
+void QSI_Interface::ScatterRows(BYTE * pBuffer, int iRows, int iRowBytes, int iStride)
+{
+	for (int iRow = iRows - 1; iRow > 0; iRow--)
+		memmove(pBuffer + (size_t)iRow * iStride, pBuffer + (size_t)iRow * iRowBytes, iRowBytes);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 int QSI_Interface::CMD_InitCamera ( void )
@@ -2514,11 +2530,37 @@ void QSI_Interface::GetAutoZeroAdjustment(QSI_AutoZeroData autoZeroData, USHORT
 
 }
 
+//////////////////////////////////////////////////////////////////////////////////////////
+// Offset, clamp and copy pixels in a single pass, counting clipped pixels as we go.
+// The loop body is branch free so the compiler can vectorize it (SSE/NEON).
+template <typename TDst, typename TAcc>
+static void AdjustPixels(const USHORT * pSrc, TDst * pDst, size_t count, TAcc adjust, TAcc maxADU,
+						 int & iNegPixelCount, int & iSatPixelCount, TAcc & lowPixel)
+{
+	int iNeg = 0;
+	int iSat = 0;
+	TAcc low = lowPixel;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		TAcc pixel = (TAcc)pSrc[i] + adjust;
+		iNeg += (pixel < 0);
+		pixel = pixel < 0 ? 0 : pixel;
+		low = pixel < low ? pixel : low;
+		iSat += (pixel > maxADU);
+		pixel = pixel > maxADU ? maxADU : pixel;
+		pDst[i] = (TDst)pixel;
+	}
+
+	iNegPixelCount += iNeg;
+	iSatPixelCount += iSat;
+	lowPixel = low;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 // AutoZero (drift adjust) the image using the median value of the zero data
 int QSI_Interface::AdjustZero(USHORT* pSrc, USHORT* pDst, int iPixelsPerRow, int iRowsLeft, int usAdjust, bool bAdjust)
 {
-	int pixel;
 	int result;
 	int iNegPixelCount;
 	int iLowPixel;
@@ -2534,21 +2576,24 @@ int QSI_Interface::AdjustZero(USHORT* pSrc, USHORT* pDst, int iPixelsPerRow, int
 		bAdjust = false;
 	}
 
-	m_log->Write(6, _T("First row of un-adjusted image data (up to the first 512 bytes):"));
+	if (m_log->LoggingEnabled(6))
+	{
+		m_log->Write(6, _T("First row of un-adjusted image data (up to the first 512 bytes):"));
 
-	int iSampleSize = iPixelsPerRow  > 512 ? 512 : iPixelsPerRow;
-	int iLines = (iSampleSize / 16);
-	if (iSampleSize % 16 > 0)
-		iLines++;
+		int iSampleSize = iPixelsPerRow  > 512 ? 512 : iPixelsPerRow;
+		int iLines = (iSampleSize / 16);
+		if (iSampleSize % 16 > 0)
+			iLines++;
 
-	for (int i = 0; i < iLines; i++)
-	{
-		for (int j = 0; j < 16 && iSampleSize > 0; j++)
+		for (int i = 0; i < iLines; i++)
 		{
-			snprintf(m_log->m_Message+(j*6), MSGSIZE, _T("%5u "), ((unsigned short*)pSrc)[(i*16)+j]);
-			iSampleSize--;
+			for (int j = 0; j < 16 && iSampleSize > 0; j++)
+			{
+				snprintf(m_log->m_Message+(j*6), MSGSIZE, _T("%5u "), ((unsigned short*)pSrc)[(i*16)+j]);
+				iSampleSize--;
+			}
+			m_log->Write(6);
 		}
-		m_log->Write(6);
 	}
 
 	//
@@ -2561,29 +2606,8 @@ int QSI_Interface::AdjustZero(USHORT* pSrc, USHORT* pDst, int iPixelsPerRow, int
 	// Break up adjustment into rows with pad
 	//
 
-	USHORT* psrc = pSrc;
-	USHORT* pdst = pDst;
-	while (iRowsLeft-- > 0)
-	{
-		for (int i = 0; i < iPixelsPerRow; i++)
-		{
-			pixel = *psrc++;
-			if (bAdjust) pixel = pixel + (int)usAdjust;
-			if (pixel < 0) 
-			{
-				pixel = 0; 				//result = ERR_IFC_NegAutoZero;
-				iNegPixelCount++;
-			}
-			if (pixel < iLowPixel) 
-				iLowPixel = pixel;
-			if (pixel > (int)m_dwAutoZeroMaxADU)
-			{
-				pixel = (int)m_dwAutoZeroMaxADU;
-				iSatPixelCount++;
-			}
-			*pdst++ = (USHORT)pixel;
-		}
-	}
+	AdjustPixels(pSrc, pDst, (size_t)iPixelsPerRow * (iRowsLeft > 0 ? iRowsLeft : 0), bAdjust ? (int)usAdjust : 0,
+				 (int)m_dwAutoZeroMaxADU, iNegPixelCount, iSatPixelCount, iLowPixel);
 
 	if (m_log->LoggingEnabled(6) || (m_log->LoggingEnabled(1) && iNegPixelCount > 0) )
 	{
@@ -2619,7 +2643,6 @@ int QSI_Interface::AdjustZero(USHORT* pSrc, USHORT* pDst, int iPixelsPerRow, int
 
 int QSI_Interface::AdjustZero(USHORT* pSrc, double * pDst, int iPixelsPerRow, int iRowsLeft, double dAdjust, bool bAdjust)
 {
-	double pixel;
 	int result;
 	int iNegPixelCount;
 	double dLowPixel;
@@ -2666,29 +2689,8 @@ int QSI_Interface::AdjustZero(USHORT* pSrc, double * pDst, int iPixelsPerRow, in
 	// Break up adjustment into rows with pad
 	//
 
-	USHORT* psrc = pSrc;
-	double* pdst = pDst;
-	while (iRowsLeft-- > 0)
-	{
-		for (int i = 0; i < iPixelsPerRow; i++)
-		{
-			pixel = (double)(*psrc++);
-			if (bAdjust) pixel = pixel + dAdjust;
-			if (pixel < 0) 
-			{
-				pixel = 0; //result = ERR_IFC_NegAutoZero;
-				iNegPixelCount++;
-			}
-			if (pixel < dLowPixel) 
-				dLowPixel = pixel;
-			if (pixel > (double)m_dwAutoZeroMaxADU)
-			{
-				pixel = (double)m_dwAutoZeroMaxADU;
-				iSatPixelCount++;
-			}
-			*pdst++ = pixel;
-		}
-	}
+	AdjustPixels(pSrc, pDst, (size_t)iPixelsPerRow * (iRowsLeft > 0 ? iRowsLeft : 0), bAdjust ? dAdjust : 0.0,
+				 (double)m_dwAutoZeroMaxADU, iNegPixelCount, iSatPixelCount, dLowPixel);
 
 	if (m_log->LoggingEnabled(6) || (m_log->LoggingEnabled(1) && iNegPixelCount > 0) )
 	{
@@ -2724,7 +2726,6 @@ int QSI_Interface::AdjustZero(USHORT* pSrc, double * pDst, int iPixelsPerRow, in
 
 int QSI_Interface::AdjustZero(USHORT* pSrc, long* pDst, int iPixelsPerRow, int iRowsLeft, int usAdjust, bool bAdjust)
 {
-	int pixel;
 	int result;
 	int iNegPixelCount;
 	int iLowPixel;
@@ -2740,21 +2741,24 @@ int QSI_Interface::AdjustZero(USHORT* pSrc, long* pDst, int iPixelsPerRow, int i
 		bAdjust = false;
 	}
 
-	m_log->Write(6, _T("First row of un-adjusted image data (up to the first 512 bytes):"));
+	if (m_log->LoggingEnabled(6))
+	{
+		m_log->Write(6, _T("First row of un-adjusted image data (up to the first 512 bytes):"));
 
-	int iSampleSize = iPixelsPerRow  > 512 ? 512 : iPixelsPerRow;
-	int iLines = (iSampleSize / 16);
-	if (iSampleSize % 16 > 0)
-		iLines++;
+		int iSampleSize = iPixelsPerRow  > 512 ? 512 : iPixelsPerRow;
+		int iLines = (iSampleSize / 16);
+		if (iSampleSize % 16 > 0)
+			iLines++;
 
-	for (int i = 0; i < iLines; i++)
-	{
-		for (int j = 0; j < 16 && iSampleSize > 0; j++)
+		for (int i = 0; i < iLines; i++)
 		{
-			snprintf(m_log->m_Message+(j*6), MSGSIZE, _T("%5u "), ((unsigned short*)pSrc)[(i*16)+j]);
-			iSampleSize--;
+			for (int j = 0; j < 16 && iSampleSize > 0; j++)
+			{
+				snprintf(m_log->m_Message+(j*6), MSGSIZE, _T("%5u "), ((unsigned short*)pSrc)[(i*16)+j]);
+				iSampleSize--;
+			}
+			m_log->Write(6);
 		}
-		m_log->Write(6);
 	}
 
 	//
@@ -2767,29 +2771,8 @@ int QSI_Interface::AdjustZero(USHORT* pSrc, long* pDst, int iPixelsPerRow, int i
 	// Break up adjustment into rows with pad
 	//
 
-	USHORT* psrc = pSrc;
-	long* pdst = pDst;
-	while (iRowsLeft-- > 0)
-	{
-		for (int i = 0; i < iPixelsPerRow; i++)
-		{
-			pixel = *psrc++;
-			if (bAdjust) pixel = pixel + (int)usAdjust;
-			if (pixel < 0) 
-			{
-				pixel = 0; 				//result = ERR_IFC_NegAutoZero;
-				iNegPixelCount++;
-			}
-			if (pixel < iLowPixel) 
-				iLowPixel = pixel;
-			if (pixel > (int)m_dwAutoZeroMaxADU)
-			{
-				pixel = (int)m_dwAutoZeroMaxADU;
-				iSatPixelCount++;
-			}
-			*pdst++ = (long)pixel;
-		}
-	}
+	AdjustPixels(pSrc, pDst, (size_t)iPixelsPerRow * (iRowsLeft > 0 ? iRowsLeft : 0), bAdjust ? (int)usAdjust : 0,
+				 (int)m_dwAutoZeroMaxADU, iNegPixelCount, iSatPixelCount, iLowPixel);
 
 	if (m_log->LoggingEnabled(6) || (m_log->LoggingEnabled(1) && iNegPixelCount > 0) )
 	{
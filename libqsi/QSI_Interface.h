@@ -163,6 +163,7 @@ private:
 	// Private methods and variables
 	int CMD_GetCCDSpecs( QSI_CCDSpecs & CCDSpecs);
 	int UpdateAdvSettings( QSI_AdvSettings AdvSettings );
+	void ScatterRows(BYTE * pBuffer, int iRows, int iRowBytes, int iStride);
 	int AutoGainAdjust(QSI_ExposureSettings ExpSettings, QSI_AdvSettings AdvSettings);
 	bool GetBoolean(UCHAR);
 	USHORT Get2Bytes(PVOID);